@@ -13,10 +13,18 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <iterator>
+#include <map>
+#include <memory>
 #include <utility>
 #include <vector>
 
+#include "absl/time/time.h"
+#include "mediapipe/calculators/core/flow_limiter_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/deadline_tracker.h"
+#include "mediapipe/framework/deps/clock.h"
+#include "mediapipe/framework/deps/monotonic_clock.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/util/header_util.h"
@@ -36,8 +44,23 @@ namespace mediapipe {
 // input with a backwards edge, this allows FLC to keep track of how many
 // timestamps are currently being processed.
 //
-// The limit defaults to 1, and can be overridden with the MAX_IN_FLIGHT side
-// packet.
+// The limit defaults to 1, and can be overridden with the max_in_flight option
+// or the MAX_IN_FLIGHT side packet.
+//
+// With the target_latency_usec option, the limit adapts to the latency from
+// forwarding a timestamp to receiving it on FINISHED: it grows additively
+// while the latency stays within the target and the limit is reached, and
+// shrinks multiplicatively when the latency exceeds the target. Each
+// adjustment is output as a FlowLimiterDecision on the optional LIMIT stream,
+// at the timestamp of the FINISHED packet that caused it. The timestamp bound
+// of LIMIT advances with every FINISHED packet.
+// The optional CLOCK side packet provides the clock to measure latency with.
+//
+// If the graph has a latency budget (see
+// CalculatorGraphConfig.latency_budget_usec), FLC also drops packets whose
+// timestamp can no longer meet its deadline: those that arrived in the graph
+// so long ago that the time left is less than the smoothed latency from
+// forwarding a timestamp to receiving it on FINISHED.
 //
 // As long as the number of timestamps being processed ("in flight") is below
 // the limit, FLC allows input to pass through. When the limit is reached,
@@ -73,6 +96,24 @@ namespace mediapipe {
 //   }
 //   output_stream: "gated_frames"
 // }
+//
+// Example config with an adaptive limit:
+// node {
+//   calculator: "FlowLimiterCalculator"
+//   input_stream: "raw_frames"
+//   input_stream: "FINISHED:finished"
+//   input_stream_info: {
+//     tag_index: 'FINISHED'
+//     back_edge: true
+//   }
+//   output_stream: "gated_frames"
+//   output_stream: "LIMIT:flow_limit"
+//   options: {
+//     [mediapipe.FlowLimiterCalculatorOptions.ext] {
+//       target_latency_usec: 100000
+//     }
+//   }
+// }
 class FlowLimiterCalculator : public CalculatorBase {
  public:
   static ::mediapipe::Status GetContract(CalculatorContract* cc) {
@@ -89,25 +130,64 @@ class FlowLimiterCalculator : public CalculatorBase {
     if (cc->InputSidePackets().HasTag("MAX_IN_FLIGHT")) {
       cc->InputSidePackets().Tag("MAX_IN_FLIGHT").Set<int>();
     }
+    if (cc->InputSidePackets().HasTag("CLOCK")) {
+      cc->InputSidePackets()
+          .Tag("CLOCK")
+          .Set<std::shared_ptr<::mediapipe::Clock>>();
+    }
     if (cc->Outputs().HasTag("ALLOW")) {
       cc->Outputs().Tag("ALLOW").Set<bool>();
     }
+    if (cc->Outputs().HasTag("LIMIT")) {
+      cc->Outputs().Tag("LIMIT").Set<FlowLimiterDecision>();
+    }
 
     cc->SetInputStreamHandler("ImmediateInputStreamHandler");
+    cc->UseService(kDeadlineTrackerService).Optional();
 
     return ::mediapipe::OkStatus();
   }
 
   ::mediapipe::Status Open(CalculatorContext* cc) final {
+    options_ = cc->Options<FlowLimiterCalculatorOptions>();
     finished_id_ = cc->Inputs().GetId("FINISHED", 0);
-    max_in_flight_ = 1;
+    max_in_flight_ = options_.max_in_flight();
     if (cc->InputSidePackets().HasTag("MAX_IN_FLIGHT")) {
       max_in_flight_ = cc->InputSidePackets().Tag("MAX_IN_FLIGHT").Get<int>();
     }
     RET_CHECK_GE(max_in_flight_, 1);
     num_in_flight_ = 0;
 
+    if (cc->Service(kDeadlineTrackerService).IsAvailable()) {
+      deadline_tracker_ = &cc->Service(kDeadlineTrackerService).GetObject();
+    }
+    adaptive_ = options_.target_latency_usec() > 0;
+    if (adaptive_) {
+      RET_CHECK_GE(options_.min_adaptive_in_flight(), 1);
+      RET_CHECK_GE(options_.max_adaptive_in_flight(),
+                   options_.min_adaptive_in_flight());
+      RET_CHECK(options_.decrease_factor() > 0 &&
+                options_.decrease_factor() < 1)
+          << "decrease_factor must be between 0 and 1.";
+      max_in_flight_ =
+          std::min(std::max(max_in_flight_, options_.min_adaptive_in_flight()),
+                   options_.max_adaptive_in_flight());
+      last_decrease_time_ = absl::InfinitePast();
+    }
+    measure_latency_ = adaptive_ || deadline_tracker_ != nullptr;
+    if (measure_latency_) {
+      if (cc->InputSidePackets().HasTag("CLOCK")) {
+        clock_ = cc->InputSidePackets()
+                     .Tag("CLOCK")
+                     .Get<std::shared_ptr<::mediapipe::Clock>>();
+      } else {
+        clock_.reset(
+            ::mediapipe::MonotonicClock::CreateSynchronizedMonotonicClock());
+      }
+    }
+
     allowed_id_ = cc->Outputs().GetId("ALLOW", 0);
+    limit_id_ = cc->Outputs().GetId("LIMIT", 0);
     allow_ctr_ts_ = Timestamp(0);
 
     num_data_streams_ = cc->Inputs().NumEntries("");
@@ -118,15 +198,31 @@ class FlowLimiterCalculator : public CalculatorBase {
 
   bool Allow() { return num_in_flight_ < max_in_flight_; }
 
+  // Returns true if "ts" is expected to finish after its deadline.
+  bool MissesDeadline(Timestamp ts) {
+    return deadline_tracker_ != nullptr &&
+           deadline_tracker_->RemainingUsec(ts) < latency_usec_;
+  }
+
   ::mediapipe::Status Process(CalculatorContext* cc) final {
     bool old_allow = Allow();
     Timestamp lowest_incomplete_ts = Timestamp::Done();
 
     // Process FINISHED stream.
-    if (!cc->Inputs().Get(finished_id_).Value().IsEmpty()) {
+    const Packet& finished = cc->Inputs().Get(finished_id_).Value();
+    if (!finished.IsEmpty()) {
       RET_CHECK_GT(num_in_flight_, 0)
           << "Received a FINISHED packet, but we had none in flight.";
+      if (measure_latency_) {
+        MeasureLatency(finished.Timestamp(), cc);
+      }
       --num_in_flight_;
+      // LIMIT only changes when a timestamp finishes, so its bound follows
+      // FINISHED and nodes reading LIMIT with other streams are not held up.
+      if (limit_id_.IsValid()) {
+        cc->Outputs().Get(limit_id_).SetNextTimestampBound(
+            finished.Timestamp().NextAllowedInStream());
+      }
     }
 
     // Process data streams.
@@ -156,13 +252,17 @@ class FlowLimiterCalculator : public CalculatorBase {
         // If we have already sent this timestamp (on another stream), send it
         // on this stream too.
         out.AddPacket(std::move(packet));
-      } else if (Allow() && (ts > last_dropped_ts_)) {
-        // If the in-flight is under the limit, and if we have not already
-        // dropped this or a later timestamp on another stream, then send
-        // the packet and add an in-flight timestamp.
+      } else if (Allow() && (ts > last_dropped_ts_) && !MissesDeadline(ts)) {
+        // If the in-flight is under the limit, if we have not already
+        // dropped this or a later timestamp on another stream, and if the
+        // timestamp can still meet its deadline, then send the packet and add
+        // an in-flight timestamp.
         out.AddPacket(std::move(packet));
         pending_ts_.insert(ts);
         ++num_in_flight_;
+        if (measure_latency_) {
+          forward_times_[ts] = clock_->TimeNow();
+        }
       } else {
         // Otherwise, we'll drop the packet.
         last_dropped_ts_ = std::max(last_dropped_ts_, ts);
@@ -184,6 +284,83 @@ class FlowLimiterCalculator : public CalculatorBase {
   }
 
  private:
+  // Measures the latency of the timestamp received on FINISHED, and adjusts
+  // max_in_flight_ to it if the limit is adaptive. Called before
+  // num_in_flight_ is decremented.
+  void MeasureLatency(Timestamp finished_ts, CalculatorContext* cc) {
+    absl::Time now = clock_->TimeNow();
+    // The FINISHED packet usually has the timestamp of the forwarded packet.
+    // Otherwise, it is taken to finish the oldest timestamp in flight.
+    auto it = forward_times_.find(finished_ts);
+    if (it == forward_times_.end()) {
+      it = forward_times_.begin();
+    }
+    if (it == forward_times_.end()) {
+      return;
+    }
+    absl::Time forward_time = it->second;
+    forward_times_.erase(forward_times_.begin(), std::next(it));
+    int64 latency_usec = absl::ToInt64Microseconds(now - forward_time);
+    latency_usec_ = latency_usec_ > 0
+                        ? 0.9 * latency_usec_ + 0.1 * latency_usec
+                        : latency_usec;
+    if (adaptive_) {
+      AdaptLimit(finished_ts, now, forward_time, latency_usec, cc);
+    }
+  }
+
+  // Adjusts max_in_flight_ to the latency of the timestamp received on
+  // FINISHED.
+  void AdaptLimit(Timestamp finished_ts, absl::Time now,
+                  absl::Time forward_time, int64 latency_usec,
+                  CalculatorContext* cc) {
+    // Smooths the interval between FINISHED packets to report throughput.
+    if (last_finished_time_ != absl::InfinitePast()) {
+      double interval_usec =
+          absl::ToDoubleMicroseconds(now - last_finished_time_);
+      finished_interval_usec_ =
+          finished_interval_usec_ > 0
+              ? 0.9 * finished_interval_usec_ + 0.1 * interval_usec
+              : interval_usec;
+    }
+    last_finished_time_ = now;
+
+    int old_max_in_flight = max_in_flight_;
+    if (latency_usec > options_.target_latency_usec()) {
+      // Decreases once per round trip: only timestamps forwarded after the
+      // previous decrease reflect it.
+      if (forward_time >= last_decrease_time_) {
+        max_in_flight_ = std::max(
+            static_cast<int>(max_in_flight_ * options_.decrease_factor()),
+            options_.min_adaptive_in_flight());
+        last_decrease_time_ = now;
+        increase_credit_ = 0;
+      }
+    } else if (num_in_flight_ >= max_in_flight_) {
+      // Grows by one per max_in_flight_ timestamps finished within the
+      // target, while the limit is what holds back the input.
+      increase_credit_ += 1.0 / max_in_flight_;
+      if (increase_credit_ >= 1.0) {
+        increase_credit_ = 0;
+        max_in_flight_ =
+            std::min(max_in_flight_ + 1, options_.max_adaptive_in_flight());
+      }
+    }
+
+    if (max_in_flight_ != old_max_in_flight && limit_id_.IsValid()) {
+      FlowLimiterDecision decision;
+      decision.set_max_in_flight(max_in_flight_);
+      decision.set_latency_usec(latency_usec);
+      if (finished_interval_usec_ > 0) {
+        decision.set_finished_per_second(1e6 / finished_interval_usec_);
+      }
+      decision.set_num_in_flight(num_in_flight_);
+      cc->Outputs().Get(limit_id_).AddPacket(
+          MakePacket<FlowLimiterDecision>(decision).At(finished_ts));
+    }
+  }
+
+  FlowLimiterCalculatorOptions options_;
   std::set<Timestamp> pending_ts_;
   Timestamp last_dropped_ts_;
   int num_data_streams_;
@@ -193,6 +370,25 @@ class FlowLimiterCalculator : public CalculatorBase {
   CollectionItemId allowed_id_;
   Timestamp allow_ctr_ts_;
   std::vector<Timestamp> data_stream_bound_ts_;
+
+  // State of the latency measurement, used by the adaptive limit and the
+  // deadline check.
+  bool measure_latency_ = false;
+  std::shared_ptr<::mediapipe::Clock> clock_;
+  // The times at which the timestamps in flight were forwarded.
+  std::map<Timestamp, absl::Time> forward_times_;
+  // The smoothed latency from forwarding a timestamp to receiving it on
+  // FINISHED, in microseconds.
+  double latency_usec_ = 0;
+  const DeadlineTracker* deadline_tracker_ = nullptr;
+
+  // State of the adaptive limit.
+  bool adaptive_ = false;
+  CollectionItemId limit_id_;
+  absl::Time last_decrease_time_;
+  absl::Time last_finished_time_ = absl::InfinitePast();
+  double finished_interval_usec_ = 0;
+  double increase_credit_ = 0;
 };
 REGISTER_CALCULATOR(FlowLimiterCalculator);
 
@@ -19,8 +19,11 @@
 
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "mediapipe/calculators/core/flow_limiter_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/deadline_tracker.h"
+#include "mediapipe/framework/deps/clock.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
@@ -490,5 +493,212 @@ TEST(FlowLimiterCalculator, CanConsume) {
   MP_EXPECT_OK(graph_.WaitUntilDone());
 }
 
+// A clock that advances only when told to.
+class ManualClock : public ::mediapipe::Clock {
+ public:
+  absl::Time TimeNow() override { return now_; }
+  void Sleep(absl::Duration d) override { now_ += d; }
+  void SleepUntil(absl::Time wakeup_time) override {
+    now_ = std::max(now_, wakeup_time);
+  }
+
+ private:
+  absl::Time now_ = absl::UnixEpoch();
+};
+
+// Shows that the adaptive limit grows while the latency is within the target
+// and the limit is reached, and shrinks when the latency exceeds the target.
+TEST(FlowLimiterCalculator, AdaptsToLatency) {
+  std::vector<Packet> in_sampled_packets;
+  std::vector<Packet> limit_packets;
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: 'in'
+        input_stream: 'finished'
+        node {
+          calculator: 'FlowLimiterCalculator'
+          input_side_packet: 'CLOCK:clock'
+          input_stream: 'in'
+          input_stream: 'FINISHED:finished'
+          input_stream_info: { tag_index: 'FINISHED' back_edge: true }
+          output_stream: 'in_sampled'
+          output_stream: 'LIMIT:limit'
+          options: {
+            [mediapipe.FlowLimiterCalculatorOptions.ext] {
+              target_latency_usec: 1000
+              max_adaptive_in_flight: 4
+            }
+          }
+        }
+      )");
+  tool::AddVectorSink("in_sampled", &graph_config, &in_sampled_packets);
+  tool::AddVectorSink("limit", &graph_config, &limit_packets);
+
+  auto clock = std::make_shared<ManualClock>();
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(
+      graph_config,
+      {{"clock", MakePacket<std::shared_ptr<::mediapipe::Clock>>(clock)}}));
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  auto send_packet = [&graph](const std::string& input_name, int n) {
+    MP_EXPECT_OK(graph.AddPacketToInputStream(
+        input_name, MakePacket<int>(n).At(Timestamp(n))));
+    MP_EXPECT_OK(graph.WaitUntilIdle());
+  };
+
+  // The initial limit of 1 is reached, and the latency is within the target.
+  send_packet("in", 1);
+  clock->Sleep(absl::Microseconds(500));
+  send_packet("finished", 1);
+
+  // The limit of 2 is reached twice within the target.
+  send_packet("in", 2);
+  send_packet("in", 3);
+  clock->Sleep(absl::Microseconds(500));
+  send_packet("finished", 2);
+  send_packet("in", 4);
+  send_packet("finished", 3);
+
+  // The latency exceeds the target.
+  clock->Sleep(absl::Microseconds(5000));
+  send_packet("finished", 4);
+  send_packet("in", 5);
+  send_packet("in", 6);
+
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  EXPECT_EQ(TimestampValues(in_sampled_packets),
+            (std::vector<int64>{1, 2, 3, 4, 5}));
+  std::vector<int> limits;
+  for (const Packet& packet : limit_packets) {
+    limits.push_back(packet.Get<FlowLimiterDecision>().max_in_flight());
+  }
+  EXPECT_EQ(limits, (std::vector<int>{2, 3, 1}));
+  EXPECT_EQ(TimestampValues(limit_packets), (std::vector<int64>{1, 3, 4}));
+  EXPECT_EQ(limit_packets[2].Get<FlowLimiterDecision>().latency_usec(), 5000);
+}
+
+// Shows that a node reading LIMIT together with FINISHED runs for every
+// finished timestamp, even when the limit does not change.
+TEST(FlowLimiterCalculator, AdvancesLimitBound) {
+  std::vector<Packet> synced_packets;
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: 'in'
+        input_stream: 'finished'
+        node {
+          calculator: 'FlowLimiterCalculator'
+          input_side_packet: 'CLOCK:clock'
+          input_stream: 'in'
+          input_stream: 'FINISHED:finished'
+          input_stream_info: { tag_index: 'FINISHED' back_edge: true }
+          output_stream: 'in_sampled'
+          output_stream: 'LIMIT:limit'
+          options: {
+            [mediapipe.FlowLimiterCalculatorOptions.ext] {
+              target_latency_usec: 1000
+              max_adaptive_in_flight: 4
+            }
+          }
+        }
+        node {
+          calculator: 'PassThroughCalculator'
+          input_stream: 'finished'
+          input_stream: 'limit'
+          output_stream: 'synced_finished'
+          output_stream: 'synced_limit'
+        }
+      )");
+  tool::AddVectorSink("synced_finished", &graph_config, &synced_packets);
+
+  auto clock = std::make_shared<ManualClock>();
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(
+      graph_config,
+      {{"clock", MakePacket<std::shared_ptr<::mediapipe::Clock>>(clock)}}));
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  auto send_packet = [&graph](const std::string& input_name, int n) {
+    MP_EXPECT_OK(graph.AddPacketToInputStream(
+        input_name, MakePacket<int>(n).At(Timestamp(n))));
+    MP_EXPECT_OK(graph.WaitUntilIdle());
+  };
+
+  // Finishing timestamp 1 raises the limit to 2.
+  send_packet("in", 1);
+  send_packet("finished", 1);
+  EXPECT_EQ(TimestampValues(synced_packets), (std::vector<int64>{1}));
+
+  // Finishing timestamp 2 leaves the limit unchanged.
+  send_packet("in", 2);
+  send_packet("in", 3);
+  send_packet("finished", 2);
+  EXPECT_EQ(TimestampValues(synced_packets), (std::vector<int64>{1, 2}));
+
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+// Shows that with a latency budget, packets that arrived in the graph too
+// long ago to finish before their deadline are dropped.
+TEST(FlowLimiterCalculator, DropsPacketsPastDeadline) {
+  std::vector<Packet> in_sampled_packets;
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: 'in'
+        input_stream: 'finished'
+        latency_budget_usec: 10000
+        node {
+          calculator: 'FlowLimiterCalculator'
+          input_side_packet: 'CLOCK:clock'
+          input_stream: 'in'
+          input_stream: 'FINISHED:finished'
+          input_stream_info: { tag_index: 'FINISHED' back_edge: true }
+          output_stream: 'in_sampled'
+          options: {
+            [mediapipe.FlowLimiterCalculatorOptions.ext] { max_in_flight: 4 }
+          }
+        }
+      )");
+  tool::AddVectorSink("in_sampled", &graph_config, &in_sampled_packets);
+
+  auto clock = std::make_shared<ManualClock>();
+  auto deadlines = std::make_shared<DeadlineTracker>(
+      graph_config.latency_budget_usec(), clock);
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(
+      graph_config,
+      {{"clock", MakePacket<std::shared_ptr<::mediapipe::Clock>>(clock)}}));
+  MP_ASSERT_OK(graph.SetServiceObject(kDeadlineTrackerService, deadlines));
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  auto send_packet = [&graph](const std::string& input_name, int n) {
+    MP_EXPECT_OK(graph.AddPacketToInputStream(
+        input_name, MakePacket<int>(n).At(Timestamp(n))));
+    MP_EXPECT_OK(graph.WaitUntilIdle());
+  };
+
+  // Measures a latency of 4 ms.
+  send_packet("in", 1);
+  clock->Sleep(absl::Microseconds(4000));
+  send_packet("finished", 1);
+
+  // Timestamp 2 is captured, but reaches the limiter with only 3 ms left.
+  deadlines->RecordArrival(Timestamp(2));
+  clock->Sleep(absl::Microseconds(7000));
+  send_packet("in", 2);
+
+  // Timestamp 3 has the whole budget left.
+  send_packet("in", 3);
+
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  EXPECT_EQ(TimestampValues(in_sampled_packets),
+            (std::vector<int64>{1, 3}));
+}
+
 }  // anonymous namespace
 }  // namespace mediapipe
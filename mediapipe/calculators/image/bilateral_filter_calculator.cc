@@ -243,7 +243,7 @@ REGISTER_CALCULATOR(BilateralFilterCalculator);
   auto input_mat = mediapipe::formats::MatView(&input_frame);
 
   // Only 1 or 3 channel images supported by OpenCV.
-  if ((input_mat.channels() == 1 || input_mat.channels() == 3)) {
+  if (!(input_mat.channels() == 1 || input_mat.channels() == 3)) {
     return ::mediapipe::InternalError(
         "CPU filtering supports only 1 or 3 channel input images.");
   }
@@ -0,0 +1,72 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+using ::testing::HasSubstr;
+
+// Runs the CPU filter on a "format" image, returning the status of the run.
+::mediapipe::Status RunFilter(ImageFormat::Format format,
+                              std::vector<Packet>* output) {
+  CalculatorRunner runner(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"(
+        calculator: "BilateralFilterCalculator"
+        input_stream: "IMAGE:image"
+        output_stream: "IMAGE:filtered"
+        options {
+          [mediapipe.BilateralFilterCalculatorOptions.ext] {
+            sigma_space: 2
+            sigma_color: 0.1
+          }
+        }
+      )"));
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(
+      MakePacket<ImageFrame>(format, 16, 8).At(Timestamp(0)));
+  MP_RETURN_IF_ERROR(runner.Run());
+  *output = runner.Outputs().Tag("IMAGE").packets;
+  return ::mediapipe::OkStatus();
+}
+
+TEST(BilateralFilterCalculatorTest, FiltersGrayAndRgbImages) {
+  for (ImageFormat::Format format : {ImageFormat::GRAY8, ImageFormat::SRGB}) {
+    std::vector<Packet> output;
+    MP_ASSERT_OK(RunFilter(format, &output));
+    ASSERT_EQ(1, output.size());
+    const ImageFrame& filtered = output[0].Get<ImageFrame>();
+    EXPECT_EQ(format, filtered.Format());
+    EXPECT_EQ(16, filtered.Width());
+    EXPECT_EQ(8, filtered.Height());
+  }
+}
+
+TEST(BilateralFilterCalculatorTest, RejectsRgbaImages) {
+  std::vector<Packet> output;
+  const ::mediapipe::Status status = RunFilter(ImageFormat::SRGBA, &output);
+  EXPECT_FALSE(status.ok());
+  EXPECT_THAT(status.message(), HasSubstr("1 or 3 channel"));
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -14,6 +14,7 @@
 
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/logging.h"
@@ -139,6 +140,8 @@ REGISTER_CALCULATOR(ColorConvertCalculator);
     cc->Outputs().Tag(kBgraOutTag).Set<ImageFrame>();
   }
 
+  cc->UseService(kImageFrameBufferPoolService).Optional();
+
   return ::mediapipe::OkStatus();
 }
 
@@ -148,8 +151,9 @@ REGISTER_CALCULATOR(ColorConvertCalculator);
     CalculatorContext* cc) {
   const cv::Mat& input_mat =
       formats::MatView(&cc->Inputs().Tag(input_tag).Get<ImageFrame>());
-  std::unique_ptr<ImageFrame> output_frame(
-      new ImageFrame(output_format, input_mat.cols, input_mat.rows));
+  std::unique_ptr<ImageFrame> output_frame = ImageFrameBufferPool::NewFrame(
+      cc->Service(kImageFrameBufferPoolService), output_format, input_mat.cols,
+      input_mat.rows);
   cv::Mat output_mat = formats::MatView(output_frame.get());
   cv::cvtColor(input_mat, output_mat, open_cv_convert_code);
 
@@ -14,11 +14,15 @@
 
 #include "mediapipe/calculators/image/image_cropping_calculator.h"
 
+#include <algorithm>
 #include <cmath>
 
+#include "absl/memory/memory.h"
 #include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
@@ -48,6 +52,7 @@ constexpr char kHeightTag[] = "HEIGHT";
 constexpr char kImageTag[] = "IMAGE";
 constexpr char kImageGpuTag[] = "IMAGE_GPU";
 constexpr char kWidthTag[] = "WIDTH";
+constexpr char kYuvImageTag[] = "YUV_IMAGE";
 
 }  // namespace
 
@@ -55,9 +60,14 @@ REGISTER_CALCULATOR(ImageCroppingCalculator);
 
 ::mediapipe::Status ImageCroppingCalculator::GetContract(
     CalculatorContract* cc) {
-  RET_CHECK(cc->Inputs().HasTag(kImageTag) ^ cc->Inputs().HasTag(kImageGpuTag));
-  RET_CHECK(cc->Outputs().HasTag(kImageTag) ^
-            cc->Outputs().HasTag(kImageGpuTag));
+  RET_CHECK_EQ(cc->Inputs().HasTag(kImageTag) +
+                   cc->Inputs().HasTag(kImageGpuTag) +
+                   cc->Inputs().HasTag(kYuvImageTag),
+               1);
+  RET_CHECK_EQ(cc->Outputs().HasTag(kImageTag) +
+                   cc->Outputs().HasTag(kImageGpuTag) +
+                   cc->Outputs().HasTag(kYuvImageTag),
+               1);
 
   bool use_gpu = false;
 
@@ -65,6 +75,12 @@ REGISTER_CALCULATOR(ImageCroppingCalculator);
     RET_CHECK(cc->Outputs().HasTag(kImageTag));
     cc->Inputs().Tag(kImageTag).Set<ImageFrame>();
     cc->Outputs().Tag(kImageTag).Set<ImageFrame>();
+    cc->UseService(kImageFrameBufferPoolService).Optional();
+  }
+  if (cc->Inputs().HasTag(kYuvImageTag)) {
+    RET_CHECK(cc->Outputs().HasTag(kYuvImageTag));
+    cc->Inputs().Tag(kYuvImageTag).Set<YUVImage>();
+    cc->Outputs().Tag(kYuvImageTag).Set<YUVImage>();
   }
 #if !defined(MEDIAPIPE_DISABLE_GPU)
   if (cc->Inputs().HasTag(kImageGpuTag)) {
@@ -172,6 +188,8 @@ REGISTER_CALCULATOR(ImageCroppingCalculator);
           return ::mediapipe::OkStatus();
         }));
 #endif  //  !MEDIAPIPE_DISABLE_GPU
+  } else if (cc->Inputs().HasTag(kYuvImageTag)) {
+    MP_RETURN_IF_ERROR(RenderYuv(cc));
   } else {
     MP_RETURN_IF_ERROR(RenderCpu(cc));
   }
@@ -256,21 +274,92 @@ REGISTER_CALCULATOR(ImageCroppingCalculator);
   cv::Mat dst_points = cv::Mat(4, 2, CV_32F, dst_corners);
   cv::Mat projection_matrix =
       cv::getPerspectiveTransform(src_points, dst_points);
-  cv::Mat cropped_image;
-  cv::warpPerspective(input_mat, cropped_image, projection_matrix,
-                      cv::Size(output_width, output_height),
+  // Warp directly into the output frame.
+  const cv::Size output_size(output_width, output_height);
+  std::unique_ptr<ImageFrame> output_frame = ImageFrameBufferPool::NewFrame(
+      cc->Service(kImageFrameBufferPoolService), input_img.Format(),
+      output_size.width, output_size.height);
+  cv::Mat output_mat = formats::MatView(output_frame.get());
+  cv::warpPerspective(input_mat, output_mat, projection_matrix, output_size,
                       /* flags = */ 0,
                       /* borderMode = */ border_mode);
-
-  std::unique_ptr<ImageFrame> output_frame(new ImageFrame(
-      input_img.Format(), cropped_image.cols, cropped_image.rows));
-  cv::Mat output_mat = formats::MatView(output_frame.get());
-  cropped_image.copyTo(output_mat);
   cc->Outputs().Tag(kImageTag).Add(output_frame.release(),
                                    cc->InputTimestamp());
   return ::mediapipe::OkStatus();
 }
 
+::mediapipe::Status ImageCroppingCalculator::RenderYuv(CalculatorContext* cc) {
+  const Packet& input_packet = cc->Inputs().Tag(kYuvImageTag).Value();
+  if (input_packet.IsEmpty()) {
+    return ::mediapipe::OkStatus();
+  }
+  const auto& input = input_packet.Get<YUVImage>();
+  RET_CHECK_EQ(input.bit_depth(), 8) << "Only 8-bit YUV images are supported.";
+
+  RectSpec specs = GetCropSpecs(cc, input.width(), input.height());
+  RET_CHECK_EQ(specs.rotation, 0.0f)
+      << "Only axis-aligned crops are supported for YUV_IMAGE.";
+  // The crop is clipped to the image, and starts on an even pixel so that it
+  // covers whole 2x2 blocks of luma samples sharing chroma samples. An odd
+  // left or top edge is moved one pixel left or up, which makes the crop one
+  // pixel wider or taller; the right and bottom edges stay in place.
+  const int requested_left = std::max(specs.center_x - specs.width / 2, 0);
+  const int requested_top = std::max(specs.center_y - specs.height / 2, 0);
+  const int left = requested_left & ~1;
+  const int top = requested_top & ~1;
+  if (left != requested_left || top != requested_top) {
+    LOG_FIRST_N(WARNING, 1)
+        << "YUV_IMAGE crops start on even coordinates, the crop starting at ("
+        << requested_left << ", " << requested_top
+        << ") is extended to start at (" << left << ", " << top << ").";
+  }
+  const int right =
+      std::min(specs.center_x - specs.width / 2 + specs.width, input.width());
+  const int bottom = std::min(
+      specs.center_y - specs.height / 2 + specs.height, input.height());
+  RET_CHECK(left < right && top < bottom)
+      << "The crop rectangle does not overlap the YUV_IMAGE.";
+  RET_CHECK(right - left <= output_max_width_ &&
+            bottom - top <= output_max_height_)
+      << "YUV_IMAGE crops cannot be scaled to the maximum output size, "
+         "use ImageTransformationCalculator to scale them.";
+
+  // Chroma samples are 2 bytes apart in semi-planar layouts.
+  int chroma_pixel_size;
+  switch (input.fourcc()) {
+    case libyuv::FOURCC_I420:
+    case libyuv::FOURCC_YV12:
+      chroma_pixel_size = 1;
+      break;
+    case libyuv::FOURCC_NV12:
+    case libyuv::FOURCC_NV21:
+      chroma_pixel_size = 2;
+      break;
+    default:
+      RET_CHECK_FAIL() << "Unsupported YUV_IMAGE fourcc: " << input.fourcc();
+  }
+  auto plane_at = [&input](int plane, int x, int y, int pixel_size) {
+    return input.data(plane) == nullptr
+               ? nullptr
+               : const_cast<uint8*>(input.data(plane)) +
+                     y * input.stride(plane) + x * pixel_size;
+  };
+
+  // The output refers to the pixels of the input, which it keeps alive.
+  auto output = absl::make_unique<YUVImage>();
+  output->Initialize(input.fourcc(), [input_packet]() {},
+                     plane_at(0, left, top, 1), input.stride(0),
+                     plane_at(1, left / 2, top / 2, chroma_pixel_size),
+                     input.stride(1),
+                     plane_at(2, left / 2, top / 2, chroma_pixel_size),
+                     input.stride(2), right - left, bottom - top,
+                     input.bit_depth());
+  output->set_matrix_coefficients(input.matrix_coefficients());
+  output->set_full_range(input.full_range());
+  cc->Outputs().Tag(kYuvImageTag).Add(output.release(), cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
 ::mediapipe::Status ImageCroppingCalculator::RenderGpu(CalculatorContext* cc) {
   if (cc->Inputs().Tag(kImageGpuTag).IsEmpty()) {
     return ::mediapipe::OkStatus();
@@ -16,9 +16,16 @@
 // be in radian, see rect.proto for detail.
 //
 // Input:
-//   One of the following two tags:
+//   One of the following three tags:
 //   IMAGE - ImageFrame representing the input image.
 //   IMAGE_GPU - GpuBuffer representing the input image.
+//   YUV_IMAGE - 8-bit I420, YV12, NV12 or NV21 YUVImage representing the
+//               input image. Only axis-aligned crops are supported. They are
+//               clipped to the image and are not scaled, and they share the
+//               pixels of the input. They start on even coordinates, so that
+//               they cover whole chroma samples: a crop with an odd left or
+//               top edge is extended by one pixel to the left or top, and a
+//               warning is logged.
 //   One of the following two tags (optional if WIDTH/HEIGHT is specified):
 //   RECT - A Rect proto specifying the width/height and location of the
 //          cropping rectangle.
@@ -31,9 +38,10 @@
 //            based on image center
 //
 // Output:
-//   One of the following two tags:
+//   One of the following three tags, matching the input:
 //   IMAGE - Cropped ImageFrame
 //   IMAGE_GPU - Cropped GpuBuffer.
+//   YUV_IMAGE - Cropped YUVImage.
 //
 // Note: input_stream values take precedence over options defined in the graph.
 //
@@ -69,6 +77,7 @@ class ImageCroppingCalculator : public CalculatorBase {
   ::mediapipe::Status ValidateBorderModeForCPU(CalculatorContext* cc);
   ::mediapipe::Status ValidateBorderModeForGPU(CalculatorContext* cc);
   ::mediapipe::Status RenderCpu(CalculatorContext* cc);
+  ::mediapipe::Status RenderYuv(CalculatorContext* cc);
   ::mediapipe::Status RenderGpu(CalculatorContext* cc);
   ::mediapipe::Status InitGpu(CalculatorContext* cc);
   void GlRender();
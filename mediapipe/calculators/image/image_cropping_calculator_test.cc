@@ -19,7 +19,9 @@
 
 #include "mediapipe/calculators/image/image_cropping_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"
@@ -212,5 +214,51 @@ TEST(ImageCroppingCalculatorTest, RedundantSpecWithInputStream) {
             expectRect);
 }  // TEST
 
+// Crops of a YUV_IMAGE share its pixels and start on even coordinates.
+TEST(ImageCroppingCalculatorTest, CropsYuvImageWithoutCopying) {
+  constexpr int kWidth = 8;
+  constexpr int kHeight = 6;
+  auto luma = absl::make_unique<uint8[]>(kWidth * kHeight);
+  for (int i = 0; i < kWidth * kHeight; ++i) {
+    luma[i] = i;
+  }
+  // Interleaved NV12 chroma, one row per two luma rows.
+  auto chroma = absl::make_unique<uint8[]>(kWidth * kHeight / 2);
+  for (int i = 0; i < kWidth * kHeight / 2; ++i) {
+    chroma[i] = 100 + i;
+  }
+  auto input = absl::make_unique<YUVImage>(
+      libyuv::FOURCC_NV12, std::move(luma), kWidth, std::move(chroma), kWidth,
+      /*data2=*/nullptr, /*stride2=*/0, kWidth, kHeight);
+
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"(
+    calculator: "ImageCroppingCalculator"
+    input_stream: "YUV_IMAGE:input"
+    input_stream: "RECT:rect"
+    output_stream: "YUV_IMAGE:output"
+  )"));
+  const YUVImage* input_image = input.get();
+  runner.MutableInputs()->Tag("YUV_IMAGE").packets.push_back(
+      Adopt(input.release()).At(Timestamp(0)));
+  runner.MutableInputs()->Tag(kRectTag).packets.push_back(
+      MakePacket<Rect>(ParseTextProtoOrDie<Rect>(
+                           "x_center: 4 y_center: 3 width: 3 height: 3"))
+          .At(Timestamp(0)));
+  MP_ASSERT_OK(runner.Run());
+
+  const std::vector<Packet>& output = runner.Outputs().Tag("YUV_IMAGE").packets;
+  ASSERT_EQ(1, output.size());
+  const YUVImage& image = output[0].Get<YUVImage>();
+  // The 3x3 crop at (3, 2) is extended to start at (2, 2).
+  EXPECT_EQ(libyuv::FOURCC_NV12, image.fourcc());
+  EXPECT_EQ(4, image.width());
+  EXPECT_EQ(3, image.height());
+  EXPECT_EQ(input_image->data(0) + 2 * kWidth + 2, image.data(0));
+  EXPECT_EQ(2 * kWidth + 2, image.data(0)[0]);
+  EXPECT_EQ(input_image->data(1) + 1 * kWidth + 2, image.data(1));
+  EXPECT_EQ(100 + kWidth + 2, image.data(1)[0]);
+  EXPECT_EQ(kWidth, image.stride(0));
+}
+
 }  // namespace
 }  // namespace mediapipe
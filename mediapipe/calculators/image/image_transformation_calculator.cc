@@ -12,10 +12,22 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "libyuv/planar_functions.h"
+#include "libyuv/rotate.h"
+#include "libyuv/scale.h"
 #include "mediapipe/calculators/image/image_transformation_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
@@ -49,6 +61,7 @@ namespace mediapipe {
 namespace {
 constexpr char kImageFrameTag[] = "IMAGE";
 constexpr char kGpuBufferTag[] = "IMAGE_GPU";
+constexpr char kYuvImageTag[] = "YUV_IMAGE";
 
 int RotationModeToDegrees(mediapipe::RotationMode_Mode rotation) {
   switch (rotation) {
@@ -93,6 +106,123 @@ mediapipe::ScaleMode_Mode ParseScaleMode(
       return default_mode;
   }
 }
+
+// Returns the affine transform that maps each output pixel to the source
+// pixel it is sampled from, when the source is rotated counterclockwise by
+// "rotation", then flipped, then scaled to cover "content" in the output.
+cv::Matx23d OutputToSourceTransform(const cv::Size& source_size,
+                                    mediapipe::RotationMode_Mode rotation,
+                                    bool flip_horizontally,
+                                    bool flip_vertically,
+                                    const cv::Rect& content) {
+  const bool swap_axes = rotation == mediapipe::RotationMode_Mode_ROTATION_90 ||
+                         rotation == mediapipe::RotationMode_Mode_ROTATION_270;
+  const double rotated_width =
+      swap_axes ? source_size.height : source_size.width;
+  const double rotated_height =
+      swap_axes ? source_size.width : source_size.height;
+  // Position in the rotated and flipped source, in pixel edge coordinates,
+  // of the center of output pixel (x, y): (u_scale * x + u_offset,
+  // v_scale * y + v_offset).
+  double u_scale = rotated_width / content.width;
+  double u_offset = (0.5 - content.x) * u_scale;
+  double v_scale = rotated_height / content.height;
+  double v_offset = (0.5 - content.y) * v_scale;
+  if (flip_horizontally) {
+    u_scale = -u_scale;
+    u_offset = rotated_width - u_offset;
+  }
+  if (flip_vertically) {
+    v_scale = -v_scale;
+    v_offset = rotated_height - v_offset;
+  }
+  const double width = source_size.width;
+  const double height = source_size.height;
+  // Undoes the rotation, and moves from edge to center coordinates.
+  switch (rotation) {
+    case mediapipe::RotationMode_Mode_ROTATION_90:
+      return cv::Matx23d(0, -v_scale, width - v_offset - 0.5,  //
+                         u_scale, 0, u_offset - 0.5);
+    case mediapipe::RotationMode_Mode_ROTATION_180:
+      return cv::Matx23d(-u_scale, 0, width - u_offset - 0.5,  //
+                         0, -v_scale, height - v_offset - 0.5);
+    case mediapipe::RotationMode_Mode_ROTATION_270:
+      return cv::Matx23d(0, v_scale, v_offset - 0.5,  //
+                         -u_scale, 0, height - u_offset - 0.5);
+    default:
+      return cv::Matx23d(u_scale, 0, u_offset - 0.5,  //
+                         0, v_scale, v_offset - 0.5);
+  }
+}
+
+// Sets the pixels of "output" outside of "content" to zero.
+void FillConstantPadding(const cv::Rect& content, cv::Mat* output) {
+  const cv::Rect padding_rects[] = {
+      cv::Rect(0, 0, output->cols, content.y),
+      cv::Rect(0, content.br().y, output->cols, output->rows - content.br().y),
+      cv::Rect(0, content.y, content.x, content.height),
+      cv::Rect(content.br().x, content.y, output->cols - content.br().x,
+               content.height)};
+  for (const cv::Rect& rect : padding_rects) {
+    if (!rect.empty()) {
+      (*output)(rect).setTo(cv::Scalar::all(0));
+    }
+  }
+}
+
+template <int kPixelSize>
+void CopyPixelRow(const uint8* src, int src_stride, int width, uint8* dst) {
+  for (int x = 0; x < width; ++x, src += src_stride, dst += kPixelSize) {
+    std::memcpy(dst, src, kPixelSize);
+  }
+}
+
+// Copies the pixels of "source" to "output" along "transform", which must
+// map pixels to pixels without scaling.
+void CopyPixels(const cv::Mat& source, const cv::Matx23d& transform,
+                cv::Mat* output) {
+  const int pixel_size = source.elemSize();
+  const int m00 = std::lround(transform(0, 0));
+  const int m01 = std::lround(transform(0, 1));
+  const int m02 = std::lround(transform(0, 2));
+  const int m10 = std::lround(transform(1, 0));
+  const int m11 = std::lround(transform(1, 1));
+  const int m12 = std::lround(transform(1, 2));
+  const int src_stride =
+      m00 * pixel_size + m10 * static_cast<int>(source.step[0]);
+  const int width = output->cols;
+  for (int y = 0; y < output->rows; ++y) {
+    const uint8* src = source.ptr<uint8>(m11 * y + m12) +
+                       (m01 * y + m02) * pixel_size;
+    uint8* dst = output->ptr<uint8>(y);
+    if (src_stride == pixel_size) {
+      std::memcpy(dst, src, width * pixel_size);
+      continue;
+    }
+    switch (pixel_size) {
+      case 1:
+        CopyPixelRow<1>(src, src_stride, width, dst);
+        break;
+      case 2:
+        CopyPixelRow<2>(src, src_stride, width, dst);
+        break;
+      case 3:
+        CopyPixelRow<3>(src, src_stride, width, dst);
+        break;
+      case 4:
+        CopyPixelRow<4>(src, src_stride, width, dst);
+        break;
+      case 8:
+        CopyPixelRow<8>(src, src_stride, width, dst);
+        break;
+      default:
+        for (int x = 0; x < width; ++x) {
+          std::memcpy(dst + x * pixel_size, src + x * src_stride, pixel_size);
+        }
+        break;
+    }
+  }
+}
 }  // namespace
 
 // Scales, rotates, and flips images horizontally or vertically.
@@ -101,6 +231,11 @@ mediapipe::ScaleMode_Mode ParseScaleMode(
 //   One of the following tags:
 //   IMAGE: ImageFrame representing the input image.
 //   IMAGE_GPU: GpuBuffer representing the input image.
+//   YUV_IMAGE: 8-bit I420, YV12, NV12 or NV21 YUVImage representing the
+//   input image. It is transformed without conversion to RGB. With FIT, the
+//   content is placed on even coordinates, so that it covers whole chroma
+//   samples, which can shift it by one pixel left or up from the
+//   LETTERBOX_PADDING; a warning is logged when it does.
 //
 //   ROTATION_DEGREES (optional): The counterclockwise rotation angle in
 //   degrees. This allows different rotation angles for different frames. It has
@@ -119,6 +254,8 @@ mediapipe::ScaleMode_Mode ParseScaleMode(
 //   One of the following tags:
 //   IMAGE - ImageFrame representing the output image.
 //   IMAGE_GPU - GpuBuffer representing the output image.
+//   YUV_IMAGE - I420 YUVImage representing the output image, or the input
+//   YUVImage itself if it is left unchanged.
 //
 //   LETTERBOX_PADDING (optional): An std::array<float, 4> representing the
 //   letterbox padding from the 4 sides ([left, top, right, bottom]) of the
@@ -155,8 +292,14 @@ mediapipe::ScaleMode_Mode ParseScaleMode(
 // Note: To enable horizontal or vertical flipping, specify them in the
 // calculator options. Flipping is applied after rotation.
 //
+// Note: The input is rotated and flipped before it is scaled to the output
+// dimensions. On CPU, all of these and the FIT padding are applied in a
+// single pass over the output, and rotations without scaling only move
+// pixels. Downscales average areas, as cv::resize() with INTER_AREA, and
+// take a second pass if the input is also rotated or flipped.
+//
 // Note: Input defines output, so only matchig types supported:
-// IMAGE -> IMAGE  or  IMAGE_GPU -> IMAGE_GPU
+// IMAGE -> IMAGE, IMAGE_GPU -> IMAGE_GPU  or  YUV_IMAGE -> YUV_IMAGE
 //
 class ImageTransformationCalculator : public CalculatorBase {
  public:
@@ -174,8 +317,15 @@ class ImageTransformationCalculator : public CalculatorBase {
   ::mediapipe::Status RenderGpu(CalculatorContext* cc);
   ::mediapipe::Status GlSetup();
 
+  ::mediapipe::Status RenderYuv(CalculatorContext* cc);
+
   void ComputeOutputDimensions(int input_width, int input_height,
                                int* output_width, int* output_height);
+  // Computes the output dimensions and the rectangle of the output covered
+  // by the rotated and scaled input. With FIT, the rest is padding.
+  void ComputeOutputContent(int input_width, int input_height,
+                            int* output_width, int* output_height,
+                            cv::Rect* content);
   void ComputeOutputLetterboxPadding(int input_width, int input_height,
                                      int output_width, int output_height,
                                      std::array<float, 4>* padding);
@@ -202,8 +352,10 @@ REGISTER_CALCULATOR(ImageTransformationCalculator);
 ::mediapipe::Status ImageTransformationCalculator::GetContract(
     CalculatorContract* cc) {
   // Only one input can be set, and the output type must match.
-  RET_CHECK(cc->Inputs().HasTag(kImageFrameTag) ^
-            cc->Inputs().HasTag(kGpuBufferTag));
+  RET_CHECK_EQ(cc->Inputs().HasTag(kImageFrameTag) +
+                   cc->Inputs().HasTag(kGpuBufferTag) +
+                   cc->Inputs().HasTag(kYuvImageTag),
+               1);
 
   bool use_gpu = false;
 
@@ -211,6 +363,12 @@ REGISTER_CALCULATOR(ImageTransformationCalculator);
     RET_CHECK(cc->Outputs().HasTag(kImageFrameTag));
     cc->Inputs().Tag(kImageFrameTag).Set<ImageFrame>();
     cc->Outputs().Tag(kImageFrameTag).Set<ImageFrame>();
+    cc->UseService(kImageFrameBufferPoolService).Optional();
+  }
+  if (cc->Inputs().HasTag(kYuvImageTag)) {
+    RET_CHECK(cc->Outputs().HasTag(kYuvImageTag));
+    cc->Inputs().Tag(kYuvImageTag).Set<YUVImage>();
+    cc->Outputs().Tag(kYuvImageTag).Set<YUVImage>();
   }
 #if !defined(MEDIAPIPE_DISABLE_GPU)
   if (cc->Inputs().HasTag(kGpuBufferTag)) {
@@ -339,6 +497,11 @@ REGISTER_CALCULATOR(ImageTransformationCalculator);
     return gpu_helper_.RunInGlContext(
         [this, cc]() -> ::mediapipe::Status { return RenderGpu(cc); });
 #endif  //  !MEDIAPIPE_DISABLE_GPU
+  } else if (cc->Inputs().HasTag(kYuvImageTag)) {
+    if (cc->Inputs().Tag(kYuvImageTag).IsEmpty()) {
+      return ::mediapipe::OkStatus();
+    }
+    return RenderYuv(cc);
   } else {
     if (cc->Inputs().Tag(kImageFrameTag).IsEmpty()) {
       return ::mediapipe::OkStatus();
@@ -377,58 +540,23 @@ REGISTER_CALCULATOR(ImageTransformationCalculator);
 
 ::mediapipe::Status ImageTransformationCalculator::RenderCpu(
     CalculatorContext* cc) {
-  cv::Mat input_mat;
-  mediapipe::ImageFormat::Format format;
-
   const auto& input = cc->Inputs().Tag(kImageFrameTag).Get<ImageFrame>();
-  input_mat = formats::MatView(&input);
-  format = input.Format();
+  cv::Mat input_mat = formats::MatView(&input);
+  const mediapipe::ImageFormat::Format format = input.Format();
 
   const int input_width = input_mat.cols;
   const int input_height = input_mat.rows;
+  const bool swap_axes =
+      rotation_ == mediapipe::RotationMode_Mode_ROTATION_90 ||
+      rotation_ == mediapipe::RotationMode_Mode_ROTATION_270;
+  // Dimensions of the input once rotated.
+  int rotated_width = swap_axes ? input_height : input_width;
+  int rotated_height = swap_axes ? input_width : input_height;
   int output_width;
   int output_height;
-  ComputeOutputDimensions(input_width, input_height, &output_width,
-                          &output_height);
-
-  if (output_width_ > 0 && output_height_ > 0) {
-    cv::Mat scaled_mat;
-    if (scale_mode_ == mediapipe::ScaleMode_Mode_STRETCH) {
-      int scale_flag =
-          input_mat.cols > output_width_ && input_mat.rows > output_height_
-              ? cv::INTER_AREA
-              : cv::INTER_LINEAR;
-      cv::resize(input_mat, scaled_mat, cv::Size(output_width_, output_height_),
-                 0, 0, scale_flag);
-    } else {
-      const float scale =
-          std::min(static_cast<float>(output_width_) / input_width,
-                   static_cast<float>(output_height_) / input_height);
-      const int target_width = std::round(input_width * scale);
-      const int target_height = std::round(input_height * scale);
-      int scale_flag = scale < 1.0f ? cv::INTER_AREA : cv::INTER_LINEAR;
-      if (scale_mode_ == mediapipe::ScaleMode_Mode_FIT) {
-        cv::Mat intermediate_mat;
-        cv::resize(input_mat, intermediate_mat,
-                   cv::Size(target_width, target_height), 0, 0, scale_flag);
-        const int top = (output_height_ - target_height) / 2;
-        const int bottom = output_height_ - target_height - top;
-        const int left = (output_width_ - target_width) / 2;
-        const int right = output_width_ - target_width - left;
-        cv::copyMakeBorder(intermediate_mat, scaled_mat, top, bottom, left,
-                           right,
-                           options_.constant_padding() ? cv::BORDER_CONSTANT
-                                                       : cv::BORDER_REPLICATE);
-      } else {
-        cv::resize(input_mat, scaled_mat, cv::Size(target_width, target_height),
-                   0, 0, scale_flag);
-        output_width = target_width;
-        output_height = target_height;
-      }
-    }
-    input_mat = scaled_mat;
-  }
-
+  cv::Rect content;
+  ComputeOutputContent(input_width, input_height, &output_width,
+                       &output_height, &content);
   if (cc->Outputs().HasTag("LETTERBOX_PADDING")) {
     auto padding = absl::make_unique<std::array<float, 4>>();
     ComputeOutputLetterboxPadding(input_width, input_height, output_width,
@@ -438,44 +566,78 @@ REGISTER_CALCULATOR(ImageTransformationCalculator);
         .Add(padding.release(), cc->InputTimestamp());
   }
 
-  cv::Mat rotated_mat;
-  cv::Size rotated_size(output_width, output_height);
-  if (input_mat.size() == rotated_size) {
-    const int angle = RotationModeToDegrees(rotation_);
-    cv::Point2f src_center(input_mat.cols / 2.0, input_mat.rows / 2.0);
-    cv::Mat rotation_mat = cv::getRotationMatrix2D(src_center, angle, 1.0);
-    cv::warpAffine(input_mat, rotated_mat, rotation_mat, rotated_size);
-  } else {
-    switch (rotation_) {
-      case mediapipe::RotationMode_Mode_UNKNOWN:
-      case mediapipe::RotationMode_Mode_ROTATION_0:
-        rotated_mat = input_mat;
-        break;
-      case mediapipe::RotationMode_Mode_ROTATION_90:
-        cv::rotate(input_mat, rotated_mat, cv::ROTATE_90_COUNTERCLOCKWISE);
-        break;
-      case mediapipe::RotationMode_Mode_ROTATION_180:
-        cv::rotate(input_mat, rotated_mat, cv::ROTATE_180);
-        break;
-      case mediapipe::RotationMode_Mode_ROTATION_270:
-        cv::rotate(input_mat, rotated_mat, cv::ROTATE_90_CLOCKWISE);
-        break;
-    }
+  const bool resample =
+      content.width != rotated_width || content.height != rotated_height;
+  const bool pad =
+      content.width != output_width || content.height != output_height;
+  const bool reorient =
+      swap_axes || rotation_ == mediapipe::RotationMode_Mode_ROTATION_180 ||
+      flip_horizontally_ || flip_vertically_;
+  if (!resample && !pad && !reorient) {
+    // Nothing to do, the input is forwarded without copying.
+    cc->Outputs()
+        .Tag(kImageFrameTag)
+        .AddPacket(cc->Inputs().Tag(kImageFrameTag).Value());
+    return ::mediapipe::OkStatus();
   }
 
-  cv::Mat flipped_mat;
-  if (flip_horizontally_ || flip_vertically_) {
-    const int flip_code =
-        flip_horizontally_ && flip_vertically_ ? -1 : flip_horizontally_;
-    cv::flip(rotated_mat, flipped_mat, flip_code);
+  std::unique_ptr<ImageFrame> output_frame = ImageFrameBufferPool::NewFrame(
+      cc->Service(kImageFrameBufferPoolService), format, output_width,
+      output_height);
+  cv::Mat output_mat = formats::MatView(output_frame.get());
+
+  // Bilinear sampling skips source pixels when shrinking, so downscales
+  // average areas instead, as cv::resize() with INTER_AREA. STRETCH only
+  // does so when both dimensions shrink.
+  const bool area_resize =
+      scale_mode_ == mediapipe::ScaleMode_Mode_STRETCH
+          ? content.width < rotated_width && content.height < rotated_height
+          : content.width < rotated_width || content.height < rotated_height;
+  if (area_resize && !reorient && (!pad || options_.constant_padding())) {
+    // The input is shrunk straight into the content of the output.
+    cv::Mat content_mat = output_mat(content);
+    cv::resize(input_mat, content_mat, content.size(), 0, 0, cv::INTER_AREA);
+    FillConstantPadding(content, &output_mat);
   } else {
-    flipped_mat = rotated_mat;
+    // Otherwise a shrunk input is rotated, flipped and padded in a second
+    // pass.
+    cv::Mat source_mat = input_mat;
+    if (area_resize) {
+      const cv::Size shrunk_size =
+          swap_axes ? cv::Size(content.height, content.width) : content.size();
+      cv::resize(input_mat, source_mat, shrunk_size, 0, 0, cv::INTER_AREA);
+      rotated_width = content.width;
+      rotated_height = content.height;
+    }
+    if (content.width == rotated_width && content.height == rotated_height &&
+        !pad) {
+      // A rotation by a multiple of 90 degrees and flips only move pixels.
+      const cv::Matx23d transform = OutputToSourceTransform(
+          source_mat.size(), rotation_, flip_horizontally_, flip_vertically_,
+          content);
+      CopyPixels(source_mat, transform, &output_mat);
+    } else if (pad && options_.constant_padding()) {
+      // Sampling stays within the content, so that its edges are not blended
+      // with the padding.
+      cv::Mat content_mat = output_mat(content);
+      const cv::Matx23d transform = OutputToSourceTransform(
+          source_mat.size(), rotation_, flip_horizontally_, flip_vertically_,
+          cv::Rect(cv::Point(0, 0), content.size()));
+      cv::warpAffine(source_mat, content_mat, transform, content_mat.size(),
+                     cv::INTER_LINEAR | cv::WARP_INVERSE_MAP,
+                     cv::BORDER_REPLICATE);
+      FillConstantPadding(content, &output_mat);
+    } else {
+      // Replicated padding comes from sampling beyond the input edges.
+      const cv::Matx23d transform = OutputToSourceTransform(
+          source_mat.size(), rotation_, flip_horizontally_, flip_vertically_,
+          content);
+      cv::warpAffine(source_mat, output_mat, transform, output_mat.size(),
+                     cv::INTER_LINEAR | cv::WARP_INVERSE_MAP,
+                     cv::BORDER_REPLICATE);
+    }
   }
 
-  std::unique_ptr<ImageFrame> output_frame(
-      new ImageFrame(format, output_width, output_height));
-  cv::Mat output_mat = formats::MatView(output_frame.get());
-  flipped_mat.copyTo(output_mat);
   cc->Outputs()
       .Tag(kImageFrameTag)
       .Add(output_frame.release(), cc->InputTimestamp());
@@ -483,6 +645,188 @@ REGISTER_CALCULATOR(ImageTransformationCalculator);
   return ::mediapipe::OkStatus();
 }
 
+::mediapipe::Status ImageTransformationCalculator::RenderYuv(
+    CalculatorContext* cc) {
+  const Packet& input_packet = cc->Inputs().Tag(kYuvImageTag).Value();
+  const auto& input = input_packet.Get<YUVImage>();
+  RET_CHECK_EQ(input.bit_depth(), 8) << "Only 8-bit YUV images are supported.";
+  const int input_width = input.width();
+  const int input_height = input.height();
+  int output_width;
+  int output_height;
+  cv::Rect content;
+  ComputeOutputContent(input_width, input_height, &output_width,
+                       &output_height, &content);
+  if (cc->Outputs().HasTag("LETTERBOX_PADDING")) {
+    auto padding = absl::make_unique<std::array<float, 4>>();
+    ComputeOutputLetterboxPadding(input_width, input_height, output_width,
+                                  output_height, padding.get());
+    cc->Outputs()
+        .Tag("LETTERBOX_PADDING")
+        .Add(padding.release(), cc->InputTimestamp());
+  }
+
+  // Flips after the rotation are turned into a vertical flip before it, which
+  // libyuv applies for free, and an extra half turn:
+  // flip_h(src) == rotate_180(flip_v(src)).
+  const bool swap_axes =
+      rotation_ == mediapipe::RotationMode_Mode_ROTATION_90 ||
+      rotation_ == mediapipe::RotationMode_Mode_ROTATION_270;
+  const bool source_flip_horizontally =
+      swap_axes ? flip_vertically_ : flip_horizontally_;
+  const bool source_flip_vertically =
+      swap_axes ? flip_horizontally_ : flip_vertically_;
+  int degrees = RotationModeToDegrees(rotation_);
+  if (source_flip_horizontally) {
+    degrees += 180;
+  }
+  const bool flip = source_flip_horizontally != source_flip_vertically;
+  // libyuv rotates clockwise.
+  libyuv::RotationMode mode;
+  switch (degrees % 360) {
+    case 90:
+      mode = libyuv::kRotate270;
+      break;
+    case 180:
+      mode = libyuv::kRotate180;
+      break;
+    case 270:
+      mode = libyuv::kRotate90;
+      break;
+    default:
+      mode = libyuv::kRotate0;
+      break;
+  }
+  // The content size in the orientation of the input.
+  const int content_width = swap_axes ? content.height : content.width;
+  const int content_height = swap_axes ? content.width : content.height;
+  const bool resample =
+      content_width != input_width || content_height != input_height;
+  const bool pad =
+      content.width != output_width || content.height != output_height;
+  if (mode == libyuv::kRotate0 && !flip && !resample && !pad) {
+    // Nothing to do, the input is forwarded without copying.
+    cc->Outputs().Tag(kYuvImageTag).AddPacket(input_packet);
+    return ::mediapipe::OkStatus();
+  }
+
+  // Planar I420 views of the input. Semi-planar chroma is split first, which
+  // only touches a quarter of the pixels.
+  const int input_chroma_width = (input_width + 1) / 2;
+  const int input_chroma_height = (input_height + 1) / 2;
+  const uint8* src_y = input.data(0);
+  const uint8* src_u;
+  const uint8* src_v;
+  int src_stride_u;
+  int src_stride_v;
+  std::unique_ptr<uint8[]> split_chroma;
+  switch (input.fourcc()) {
+    case libyuv::FOURCC_I420:
+      src_u = input.data(1);
+      src_v = input.data(2);
+      src_stride_u = input.stride(1);
+      src_stride_v = input.stride(2);
+      break;
+    case libyuv::FOURCC_YV12:
+      src_u = input.data(2);
+      src_v = input.data(1);
+      src_stride_u = input.stride(2);
+      src_stride_v = input.stride(1);
+      break;
+    case libyuv::FOURCC_NV12:
+    case libyuv::FOURCC_NV21: {
+      const int plane_size = input_chroma_width * input_chroma_height;
+      split_chroma = absl::make_unique<uint8[]>(2 * plane_size);
+      uint8* u = split_chroma.get();
+      uint8* v = u + plane_size;
+      if (input.fourcc() == libyuv::FOURCC_NV21) {
+        std::swap(u, v);
+      }
+      libyuv::SplitUVPlane(input.data(1), input.stride(1), u,
+                           input_chroma_width, v, input_chroma_width,
+                           input_chroma_width, input_chroma_height);
+      src_u = u;
+      src_v = v;
+      src_stride_u = input_chroma_width;
+      src_stride_v = input_chroma_width;
+      break;
+    }
+    default:
+      RET_CHECK_FAIL() << "Unsupported YUV_IMAGE fourcc: " << input.fourcc();
+  }
+  int src_stride_y = input.stride(0);
+  int src_width = input_width;
+  int src_height = input_height;
+
+  // Scaling happens before the rotation, on the smaller of the two images.
+  std::unique_ptr<uint8[]> scaled;
+  if (resample) {
+    const int chroma_width = (content_width + 1) / 2;
+    const int chroma_height = (content_height + 1) / 2;
+    const int luma_size = content_width * content_height;
+    scaled = absl::make_unique<uint8[]>(luma_size +
+                                        2 * chroma_width * chroma_height);
+    uint8* y = scaled.get();
+    uint8* u = y + luma_size;
+    uint8* v = u + chroma_width * chroma_height;
+    const bool shrink =
+        content_width < src_width && content_height < src_height;
+    RET_CHECK_EQ(
+        0, libyuv::I420Scale(src_y, src_stride_y, src_u, src_stride_u, src_v,
+                             src_stride_v, src_width, src_height, y,
+                             content_width, u, chroma_width, v, chroma_width,
+                             content_width, content_height,
+                             shrink ? libyuv::kFilterBox
+                                    : libyuv::kFilterBilinear));
+    src_y = y;
+    src_u = u;
+    src_v = v;
+    src_stride_y = content_width;
+    src_stride_u = chroma_width;
+    src_stride_v = chroma_width;
+    src_width = content_width;
+    src_height = content_height;
+  }
+
+  const int chroma_width = (output_width + 1) / 2;
+  const int chroma_height = (output_height + 1) / 2;
+  auto y = absl::make_unique<uint8[]>(output_width * output_height);
+  auto u = absl::make_unique<uint8[]>(chroma_width * chroma_height);
+  auto v = absl::make_unique<uint8[]>(chroma_width * chroma_height);
+  // The content starts on an even pixel, so that it covers whole chroma
+  // samples.
+  const int left = content.x & ~1;
+  const int top = content.y & ~1;
+  if (left != content.x || top != content.y) {
+    LOG_FIRST_N(WARNING, 1)
+        << "YUV_IMAGE content starts on even coordinates, the content at ("
+        << content.x << ", " << content.y << ") is moved to (" << left << ", "
+        << top << ").";
+  }
+  if (pad) {
+    const int black = input.full_range() ? 0 : 16;
+    RET_CHECK_EQ(0, libyuv::I420Rect(y.get(), output_width, u.get(),
+                                     chroma_width, v.get(), chroma_width, 0,
+                                     0, output_width, output_height, black,
+                                     128, 128));
+  }
+  RET_CHECK_EQ(
+      0, libyuv::I420Rotate(
+             src_y, src_stride_y, src_u, src_stride_u, src_v, src_stride_v,
+             y.get() + top * output_width + left, output_width,
+             u.get() + top / 2 * chroma_width + left / 2, chroma_width,
+             v.get() + top / 2 * chroma_width + left / 2, chroma_width,
+             src_width, flip ? -src_height : src_height, mode));
+
+  auto output = absl::make_unique<YUVImage>(
+      libyuv::FOURCC_I420, std::move(y), output_width, std::move(u),
+      chroma_width, std::move(v), chroma_width, output_width, output_height);
+  output->set_matrix_coefficients(input.matrix_coefficients());
+  output->set_full_range(input.full_range());
+  cc->Outputs().Tag(kYuvImageTag).Add(output.release(), cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
 ::mediapipe::Status ImageTransformationCalculator::RenderGpu(
     CalculatorContext* cc) {
 #if !defined(MEDIAPIPE_DISABLE_GPU)
@@ -573,6 +917,34 @@ REGISTER_CALCULATOR(ImageTransformationCalculator);
   return ::mediapipe::OkStatus();
 }
 
+void ImageTransformationCalculator::ComputeOutputContent(
+    int input_width, int input_height, int* output_width, int* output_height,
+    cv::Rect* content) {
+  ComputeOutputDimensions(input_width, input_height, output_width,
+                          output_height);
+  *content = cv::Rect(0, 0, *output_width, *output_height);
+  if (output_width_ > 0 && output_height_ > 0 &&
+      scale_mode_ != mediapipe::ScaleMode_Mode_STRETCH) {
+    const bool swap_axes =
+        rotation_ == mediapipe::RotationMode_Mode_ROTATION_90 ||
+        rotation_ == mediapipe::RotationMode_Mode_ROTATION_270;
+    const int rotated_width = swap_axes ? input_height : input_width;
+    const int rotated_height = swap_axes ? input_width : input_height;
+    const float scale =
+        std::min(static_cast<float>(output_width_) / rotated_width,
+                 static_cast<float>(output_height_) / rotated_height);
+    content->width = std::round(rotated_width * scale);
+    content->height = std::round(rotated_height * scale);
+    if (scale_mode_ == mediapipe::ScaleMode_Mode_FIT) {
+      content->x = (output_width_ - content->width) / 2;
+      content->y = (output_height_ - content->height) / 2;
+    } else {
+      *output_width = content->width;
+      *output_height = content->height;
+    }
+  }
+}
+
 void ImageTransformationCalculator::ComputeOutputDimensions(
     int input_width, int input_height, int* output_width, int* output_height) {
   if (output_width_ > 0 && output_height_ > 0) {
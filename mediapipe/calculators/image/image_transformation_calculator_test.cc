@@ -0,0 +1,344 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "libyuv/video_common.h"
+
+namespace mediapipe {
+namespace {
+
+// Returns a GRAY8 image whose pixel (x, y) is "value(x, y)".
+Packet MakeGrayImage(int width, int height,
+                     const std::function<uint8(int, int)>& value) {
+  auto image =
+      absl::make_unique<ImageFrame>(ImageFormat::GRAY8, width, height);
+  for (int y = 0; y < height; ++y) {
+    uint8* row = image->MutablePixelData() + y * image->WidthStep();
+    for (int x = 0; x < width; ++x) {
+      row[x] = value(x, y);
+    }
+  }
+  return Adopt(image.release()).At(Timestamp(0));
+}
+
+uint8 PixelAt(const ImageFrame& image, int x, int y) {
+  return image.PixelData()[y * image.WidthStep() + x];
+}
+
+// Runs the calculator on "input" and returns its output packets.
+std::vector<Packet> RunCalculator(const std::string& options,
+                                  const Packet& input,
+                                  std::array<float, 4>* padding = nullptr) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(
+      absl::StrCat(R"(
+        calculator: "ImageTransformationCalculator"
+        input_stream: "IMAGE:input"
+        output_stream: "IMAGE:output"
+        output_stream: "LETTERBOX_PADDING:padding"
+        options {
+          [mediapipe.ImageTransformationCalculatorOptions.ext] {)",
+                   options, "}}")));
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(input);
+  MP_EXPECT_OK(runner.Run());
+  const std::vector<Packet>& padding_packets =
+      runner.Outputs().Tag("LETTERBOX_PADDING").packets;
+  if (padding && padding_packets.size() == 1) {
+    *padding = padding_packets[0].Get<std::array<float, 4>>();
+  }
+  return runner.Outputs().Tag("IMAGE").packets;
+}
+
+TEST(ImageTransformationCalculatorTest, ForwardsUnchangedInput) {
+  Packet input = MakeGrayImage(4, 3, [](int x, int y) { return x + 4 * y; });
+  std::vector<Packet> output = RunCalculator("", input);
+  ASSERT_EQ(1, output.size());
+  EXPECT_EQ(input.Get<ImageFrame>().PixelData(),
+            output[0].Get<ImageFrame>().PixelData());
+}
+
+TEST(ImageTransformationCalculatorTest, RotatesAndFlipsWithoutScaling) {
+  constexpr int kWidth = 4;
+  constexpr int kHeight = 3;
+  Packet input =
+      MakeGrayImage(kWidth, kHeight, [](int x, int y) { return x + 4 * y; });
+
+  std::vector<Packet> output =
+      RunCalculator("rotation_mode: ROTATION_90", input);
+  ASSERT_EQ(1, output.size());
+  const ImageFrame& rotated = output[0].Get<ImageFrame>();
+  ASSERT_EQ(kHeight, rotated.Width());
+  ASSERT_EQ(kWidth, rotated.Height());
+  for (int y = 0; y < kWidth; ++y) {
+    for (int x = 0; x < kHeight; ++x) {
+      EXPECT_EQ(kWidth - 1 - y + 4 * x, PixelAt(rotated, x, y));
+    }
+  }
+
+  output = RunCalculator(
+      "rotation_mode: ROTATION_180 flip_horizontally: true", input);
+  ASSERT_EQ(1, output.size());
+  const ImageFrame& flipped = output[0].Get<ImageFrame>();
+  ASSERT_EQ(kWidth, flipped.Width());
+  ASSERT_EQ(kHeight, flipped.Height());
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      EXPECT_EQ(x + 4 * (kHeight - 1 - y), PixelAt(flipped, x, y));
+    }
+  }
+}
+
+// The input is rotated before it is stretched to the output dimensions.
+TEST(ImageTransformationCalculatorTest, ScalesAfterRotation) {
+  Packet input =
+      MakeGrayImage(4, 2, [](int x, int y) { return x < 2 ? 0 : 100; });
+  std::vector<Packet> output = RunCalculator(R"(
+    rotation_mode: ROTATION_90
+    output_width: 1
+    output_height: 2
+    scale_mode: STRETCH)",
+                                             input);
+  ASSERT_EQ(1, output.size());
+  const ImageFrame& image = output[0].Get<ImageFrame>();
+  ASSERT_EQ(1, image.Width());
+  ASSERT_EQ(2, image.Height());
+  EXPECT_EQ(100, PixelAt(image, 0, 0));
+  EXPECT_EQ(0, PixelAt(image, 0, 1));
+}
+
+// Downscales average areas, as cv::resize() with INTER_AREA does, also by
+// factors between one half and one, where bilinear sampling would differ.
+TEST(ImageTransformationCalculatorTest, DownscalesByAreaAveraging) {
+  Packet input = MakeGrayImage(
+      8, 4, [](int x, int y) { return (x % 2 ? 200 : 0) + 10 * y; });
+  cv::Mat expected;
+  cv::resize(formats::MatView(&input.Get<ImageFrame>()), expected,
+             cv::Size(6, 3), 0, 0, cv::INTER_AREA);
+
+  std::vector<Packet> output = RunCalculator(R"(
+    output_width: 6
+    output_height: 3
+    scale_mode: STRETCH)",
+                                             input);
+  ASSERT_EQ(1, output.size());
+  const ImageFrame& image = output[0].Get<ImageFrame>();
+  ASSERT_EQ(6, image.Width());
+  ASSERT_EQ(3, image.Height());
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 6; ++x) {
+      EXPECT_EQ(expected.at<uint8>(y, x), PixelAt(image, x, y));
+    }
+  }
+
+  // A rotated input is shrunk the same way before it is rotated.
+  output = RunCalculator(R"(
+    rotation_mode: ROTATION_180
+    output_width: 6
+    output_height: 3
+    scale_mode: STRETCH)",
+                         input);
+  ASSERT_EQ(1, output.size());
+  const ImageFrame& rotated = output[0].Get<ImageFrame>();
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 6; ++x) {
+      EXPECT_EQ(expected.at<uint8>(2 - y, 5 - x), PixelAt(rotated, x, y));
+    }
+  }
+}
+
+TEST(ImageTransformationCalculatorTest, FitPadsWithConstant) {
+  Packet input = MakeGrayImage(2, 2, [](int x, int y) { return 200; });
+  std::array<float, 4> padding;
+  std::vector<Packet> output = RunCalculator(R"(
+    output_width: 4
+    output_height: 2
+    scale_mode: FIT)",
+                                             input, &padding);
+  ASSERT_EQ(1, output.size());
+  const ImageFrame& image = output[0].Get<ImageFrame>();
+  ASSERT_EQ(4, image.Width());
+  ASSERT_EQ(2, image.Height());
+  for (int y = 0; y < 2; ++y) {
+    EXPECT_EQ(0, PixelAt(image, 0, y));
+    EXPECT_EQ(200, PixelAt(image, 1, y));
+    EXPECT_EQ(200, PixelAt(image, 2, y));
+    EXPECT_EQ(0, PixelAt(image, 3, y));
+  }
+  EXPECT_THAT(padding, testing::ElementsAre(0.25f, 0.f, 0.25f, 0.f));
+}
+
+// Returns an NV12 image whose luma at (x, y) is "luma(x, y)", and whose
+// chroma sample at (x, y) is (10 + x + 4 * y, 20 + x + 4 * y).
+Packet MakeNv12Image(int width, int height,
+                     const std::function<uint8(int, int)>& luma) {
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  auto y_plane = absl::make_unique<uint8[]>(width * height);
+  auto uv_plane = absl::make_unique<uint8[]>(2 * chroma_width * chroma_height);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      y_plane[y * width + x] = luma(x, y);
+    }
+  }
+  for (int y = 0; y < chroma_height; ++y) {
+    for (int x = 0; x < chroma_width; ++x) {
+      uv_plane[2 * (y * chroma_width + x)] = 10 + x + 4 * y;
+      uv_plane[2 * (y * chroma_width + x) + 1] = 20 + x + 4 * y;
+    }
+  }
+  auto image = absl::make_unique<YUVImage>(
+      libyuv::FOURCC_NV12, std::move(y_plane), width, std::move(uv_plane),
+      2 * chroma_width, nullptr, 0, width, height);
+  image->set_full_range(true);
+  return Adopt(image.release()).At(Timestamp(0));
+}
+
+// Runs the calculator on the YUV_IMAGE "input" and returns its output.
+std::vector<Packet> RunYuvCalculator(const std::string& options,
+                                     const Packet& input) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(
+      absl::StrCat(R"(
+        calculator: "ImageTransformationCalculator"
+        input_stream: "YUV_IMAGE:input"
+        output_stream: "YUV_IMAGE:output"
+        options {
+          [mediapipe.ImageTransformationCalculatorOptions.ext] {)",
+                   options, "}}")));
+  runner.MutableInputs()->Tag("YUV_IMAGE").packets.push_back(input);
+  MP_EXPECT_OK(runner.Run());
+  return runner.Outputs().Tag("YUV_IMAGE").packets;
+}
+
+TEST(ImageTransformationCalculatorTest, ForwardsUnchangedYuvImage) {
+  Packet input = MakeNv12Image(4, 2, [](int x, int y) { return x; });
+  std::vector<Packet> output = RunYuvCalculator("", input);
+  ASSERT_EQ(1, output.size());
+  EXPECT_EQ(input.Get<YUVImage>().data(0), output[0].Get<YUVImage>().data(0));
+}
+
+TEST(ImageTransformationCalculatorTest, RotatesYuvImage) {
+  constexpr int kWidth = 4;
+  constexpr int kHeight = 2;
+  Packet input =
+      MakeNv12Image(kWidth, kHeight, [](int x, int y) { return x + 4 * y; });
+  std::vector<Packet> output =
+      RunYuvCalculator("rotation_mode: ROTATION_90", input);
+  ASSERT_EQ(1, output.size());
+  const YUVImage& rotated = output[0].Get<YUVImage>();
+  ASSERT_EQ(libyuv::FOURCC_I420, rotated.fourcc());
+  ASSERT_EQ(kHeight, rotated.width());
+  ASSERT_EQ(kWidth, rotated.height());
+  EXPECT_TRUE(rotated.full_range());
+  for (int y = 0; y < kWidth; ++y) {
+    for (int x = 0; x < kHeight; ++x) {
+      EXPECT_EQ(kWidth - 1 - y + 4 * x,
+                rotated.data(0)[y * rotated.stride(0) + x]);
+    }
+  }
+  for (int y = 0; y < kWidth / 2; ++y) {
+    EXPECT_EQ(10 + 1 - y, rotated.data(1)[y * rotated.stride(1)]);
+    EXPECT_EQ(20 + 1 - y, rotated.data(2)[y * rotated.stride(2)]);
+  }
+}
+
+// Flips combined with rotations move the pixels of a YUV_IMAGE as they move
+// those of an IMAGE, and move its chroma samples like a half-size image.
+TEST(ImageTransformationCalculatorTest, RotatesAndFlipsYuvImageLikeImage) {
+  constexpr int kWidth = 6;
+  constexpr int kHeight = 4;
+  auto luma = [](int x, int y) { return x + 8 * y; };
+  Packet yuv_input = MakeNv12Image(kWidth, kHeight, luma);
+  Packet luma_input = MakeGrayImage(kWidth, kHeight, luma);
+  Packet u_input = MakeGrayImage(kWidth / 2, kHeight / 2,
+                                 [](int x, int y) { return 10 + x + 4 * y; });
+  for (const char* rotation :
+       {"ROTATION_0", "ROTATION_90", "ROTATION_180", "ROTATION_270"}) {
+    for (const char* flips :
+         {"flip_horizontally: true", "flip_vertically: true",
+          "flip_horizontally: true flip_vertically: true"}) {
+      const std::string options =
+          absl::StrCat("rotation_mode: ", rotation, " ", flips);
+      std::vector<Packet> yuv_output = RunYuvCalculator(options, yuv_input);
+      std::vector<Packet> luma_output = RunCalculator(options, luma_input);
+      std::vector<Packet> u_output = RunCalculator(options, u_input);
+      ASSERT_EQ(1, yuv_output.size()) << options;
+      ASSERT_EQ(1, luma_output.size()) << options;
+      ASSERT_EQ(1, u_output.size()) << options;
+      const YUVImage& yuv = yuv_output[0].Get<YUVImage>();
+      const ImageFrame& expected_luma = luma_output[0].Get<ImageFrame>();
+      const ImageFrame& expected_u = u_output[0].Get<ImageFrame>();
+      ASSERT_EQ(expected_luma.Width(), yuv.width()) << options;
+      ASSERT_EQ(expected_luma.Height(), yuv.height()) << options;
+      for (int y = 0; y < yuv.height(); ++y) {
+        for (int x = 0; x < yuv.width(); ++x) {
+          EXPECT_EQ(PixelAt(expected_luma, x, y),
+                    yuv.data(0)[y * yuv.stride(0) + x])
+              << options << " at " << x << ", " << y;
+        }
+      }
+      // Transforms that cancel out, such as a half turn and both flips,
+      // forward the NV12 input; the others output I420.
+      const int u_step = yuv.fourcc() == libyuv::FOURCC_NV12 ? 2 : 1;
+      for (int y = 0; y < expected_u.Height(); ++y) {
+        for (int x = 0; x < expected_u.Width(); ++x) {
+          EXPECT_EQ(PixelAt(expected_u, x, y),
+                    yuv.data(1)[y * yuv.stride(1) + x * u_step])
+              << options << " at " << x << ", " << y;
+        }
+      }
+    }
+  }
+}
+
+TEST(ImageTransformationCalculatorTest, FitPadsYuvImageWithBlack) {
+  Packet input = MakeNv12Image(2, 2, [](int x, int y) { return 200; });
+  std::vector<Packet> output = RunYuvCalculator(R"(
+    output_width: 6
+    output_height: 2
+    scale_mode: FIT)",
+                                                input);
+  ASSERT_EQ(1, output.size());
+  const YUVImage& image = output[0].Get<YUVImage>();
+  ASSERT_EQ(6, image.width());
+  ASSERT_EQ(2, image.height());
+  const uint8 expected_luma[] = {0, 0, 200, 200, 0, 0};
+  const uint8 expected_u[] = {128, 10, 128};
+  for (int x = 0; x < 6; ++x) {
+    EXPECT_EQ(expected_luma[x], image.data(0)[x]);
+    EXPECT_EQ(expected_luma[x], image.data(0)[image.stride(0) + x]);
+  }
+  for (int x = 0; x < 3; ++x) {
+    EXPECT_EQ(expected_u[x], image.data(1)[x]);
+  }
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -18,6 +18,7 @@
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/parallel_for.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
@@ -144,6 +145,7 @@ REGISTER_CALCULATOR(RecolorCalculator);
 #endif  //  !MEDIAPIPE_DISABLE_GPU
   if (cc->Outputs().HasTag(kImageFrameTag)) {
     cc->Outputs().Tag(kImageFrameTag).Set<ImageFrame>();
+    cc->UseService(kParallelForService).Optional();
   }
 
   // Confirm only one of the input streams is present.
@@ -246,20 +248,26 @@ REGISTER_CALCULATOR(RecolorCalculator);
 
       fragColor = mix(color1, color2, mix_value);
   */
-  for (int i = 0; i < output_mat.rows; ++i) {
-    for (int j = 0; j < output_mat.cols; ++j) {
-      float weight = mask_full.at<uchar>(i, j) * (1.0 / 255.0);
-      cv::Vec3f color1 = input_mat.at<cv::Vec3b>(i, j);
-      cv::Vec3f color2 = {color_[0], color_[1], color_[2]};
-
-      float luminance =
-          (color1[0] * 0.299 + color1[1] * 0.587 + color1[2] * 0.114) / 255;
-      float mix_value = weight * luminance;
-
-      cv::Vec3b mix_color = color1 * (1.0 - mix_value) + color2 * mix_value;
-      output_mat.at<cv::Vec3b>(i, j) = mix_color;
-    }
-  }
+  const cv::Vec3f color2 = {color_[0], color_[1], color_[2]};
+  ForEachRowBand(
+      cc, output_mat.rows, output_img->WidthStep(),
+      [&input_mat, &mask_full, &output_mat, &color2](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+          for (int j = 0; j < output_mat.cols; ++j) {
+            float weight = mask_full.at<uchar>(i, j) * (1.0 / 255.0);
+            cv::Vec3f color1 = input_mat.at<cv::Vec3b>(i, j);
+
+            float luminance =
+                (color1[0] * 0.299 + color1[1] * 0.587 + color1[2] * 0.114) /
+                255;
+            float mix_value = weight * luminance;
+
+            cv::Vec3b mix_color =
+                color1 * (1.0 - mix_value) + color2 * mix_value;
+            output_mat.at<cv::Vec3b>(i, j) = mix_color;
+          }
+        }
+      });
 
   cc->Outputs()
       .Tag(kImageFrameTag)
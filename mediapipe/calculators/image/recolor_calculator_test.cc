@@ -0,0 +1,112 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/tool/sink.h"
+
+namespace mediapipe {
+namespace {
+
+// Large enough for ForEachRowBand to split the output into several bands.
+constexpr int kWidth = 512;
+constexpr int kHeight = 300;
+
+// Returns an image of "format" filled with a pattern that varies along both
+// axes and across channels.
+Packet MakeImage(ImageFormat::Format format, int width, int height) {
+  auto image = absl::make_unique<ImageFrame>(format, width, height);
+  const int row_size = width * image->NumberOfChannels();
+  for (int y = 0; y < height; ++y) {
+    uint8* row = image->MutablePixelData() + y * image->WidthStep();
+    for (int i = 0; i < row_size; ++i) {
+      row[i] = (7 * i + 13 * y) & 0xff;
+    }
+  }
+  return Adopt(image.release()).At(Timestamp(0));
+}
+
+// Runs the RGB "image" and the "mask" through a RecolorCalculator in a graph
+// with "executor_config", and returns the output image.
+Packet RunRecolor(const std::string& executor_config, const Packet& image,
+                  const Packet& mask) {
+  CalculatorGraphConfig config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(absl::StrCat(R"(
+        input_stream: "image"
+        input_stream: "mask"
+        node {
+          calculator: "RecolorCalculator"
+          input_stream: "IMAGE:image"
+          input_stream: "MASK:mask"
+          output_stream: "IMAGE:recolored"
+          options {
+            [mediapipe.RecolorCalculatorOptions.ext] {
+              color { r: 0 g: 0 b: 255 }
+            }
+          }
+        })",
+                                                              executor_config));
+  std::vector<Packet> output;
+  tool::AddVectorSink("recolored", &config, &output);
+  CalculatorGraph graph;
+  MP_EXPECT_OK(graph.Initialize(config));
+  MP_EXPECT_OK(graph.StartRun({}));
+  MP_EXPECT_OK(graph.AddPacketToInputStream("image", image));
+  MP_EXPECT_OK(graph.AddPacketToInputStream("mask", mask));
+  MP_EXPECT_OK(graph.CloseAllInputStreams());
+  MP_EXPECT_OK(graph.WaitUntilDone());
+  EXPECT_EQ(1, output.size());
+  return output.empty() ? Packet() : output[0];
+}
+
+// The default executor splits the image into row bands, while the application
+// thread processes it in one call. Both must give the same bytes.
+TEST(RecolorCalculatorTest, RowBandsMatchWholeImage) {
+  const Packet image = MakeImage(ImageFormat::SRGB, kWidth, kHeight);
+  const Packet mask = MakeImage(ImageFormat::GRAY8, kWidth, kHeight);
+  const Packet banded = RunRecolor("", image, mask);
+  const Packet whole = RunRecolor(R"(
+        executor { type: "ApplicationThreadExecutor" })",
+                                  image, mask);
+  ASSERT_FALSE(banded.IsEmpty());
+  ASSERT_FALSE(whole.IsEmpty());
+
+  const ImageFrame& banded_frame = banded.Get<ImageFrame>();
+  const ImageFrame& whole_frame = whole.Get<ImageFrame>();
+  ASSERT_EQ(kWidth, banded_frame.Width());
+  ASSERT_EQ(kHeight, banded_frame.Height());
+  ASSERT_EQ(kWidth, whole_frame.Width());
+  ASSERT_EQ(kHeight, whole_frame.Height());
+  const int row_size = kWidth * banded_frame.NumberOfChannels();
+  for (int y = 0; y < kHeight; ++y) {
+    const uint8* banded_row =
+        banded_frame.PixelData() + y * banded_frame.WidthStep();
+    const uint8* whole_row =
+        whole_frame.PixelData() + y * whole_frame.WidthStep();
+    ASSERT_EQ(std::vector<uint8>(whole_row, whole_row + row_size),
+              std::vector<uint8>(banded_row, banded_row + row_size))
+        << "row " << y;
+  }
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -18,6 +18,7 @@
 #include <memory>
 #include <string>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
 #include "libyuv/scale.h"
@@ -26,6 +27,7 @@
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/formats/video_stream_header.h"
 #include "mediapipe/framework/formats/yuv_image.h"
@@ -179,6 +181,7 @@ class ScaleImageCalculator : public CalculatorBase {
       cc->Outputs().Get(output_data_id).Set<YUVImage>();
     } else {
       cc->Outputs().Get(output_data_id).Set<ImageFrame>();
+      cc->UseService(kImageFrameBufferPoolService).Optional();
     }
 
     if (cc->Inputs().HasTag("OVERRIDE_OPTIONS")) {
@@ -614,8 +617,9 @@ ScaleImageCalculator::~ScaleImageCalculator() {}
   if (crop_width_ < input_width_ || crop_height_ < input_height_) {
     cc->GetCounter("Crops")->Increment();
     // TODO Do the crop as a range restrict inside OpenCV code below.
-    cropped_image.reset(new ImageFrame(image_frame->Format(), crop_width_,
-                                       crop_height_, alignment_boundary_));
+    cropped_image = ImageFrameBufferPool::NewFrame(
+        cc->Service(kImageFrameBufferPoolService), image_frame->Format(),
+        crop_width_, crop_height_, alignment_boundary_);
     if (image_frame->ByteDepth() == 1 || image_frame->ByteDepth() == 2) {
       CropImageFrame(*image_frame, col_start_, row_start_, crop_width_,
                      crop_height_, cropped_image.get());
@@ -668,19 +672,21 @@ ScaleImageCalculator::~ScaleImageCalculator() {}
   }
 
   // Rescale the image frame.
-  std::unique_ptr<ImageFrame> output_frame(new ImageFrame());
+  std::unique_ptr<ImageFrame> output_frame;
   if (image_frame->Width() >= output_width_ &&
       image_frame->Height() >= output_height_) {
     // Downscale.
     cc->GetCounter("Downscales")->Increment();
     cv::Mat input_mat = ::mediapipe::formats::MatView(image_frame);
-    output_frame->Reset(image_frame->Format(), output_width_, output_height_,
-                        alignment_boundary_);
+    output_frame = ImageFrameBufferPool::NewFrame(
+        cc->Service(kImageFrameBufferPoolService), image_frame->Format(),
+        output_width_, output_height_, alignment_boundary_);
     cv::Mat output_mat = ::mediapipe::formats::MatView(output_frame.get());
     downscaler_->Resize(input_mat, &output_mat);
   } else {
     // Upscale. If upscaling is disallowed, output_width_ and output_height_ are
     // the same as the input/crop width and height.
+    output_frame = absl::make_unique<ImageFrame>();
     image_frame_util::RescaleImageFrame(
         *image_frame, output_width_, output_height_, alignment_boundary_,
         interpolation_algorithm_, output_frame.get());
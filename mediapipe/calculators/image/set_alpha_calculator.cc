@@ -20,6 +20,7 @@
 #include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/parallel_for.h"
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/status.h"
@@ -158,6 +159,7 @@ REGISTER_CALCULATOR(SetAlphaCalculator);
 #endif  //  !MEDIAPIPE_DISABLE_GPU
   if (cc->Outputs().HasTag(kOutputFrameTag)) {
     cc->Outputs().Tag(kOutputFrameTag).Set<ImageFrame>();
+    cc->UseService(kParallelForService).Optional();
   }
 
   if (use_gpu) {
@@ -260,34 +262,43 @@ REGISTER_CALCULATOR(SetAlphaCalculator);
     RET_CHECK_EQ(input_mat.rows, alpha_mat.rows);
     RET_CHECK_EQ(input_mat.cols, alpha_mat.cols);
 
-    for (int i = 0; i < output_mat.rows; ++i) {
-      const uchar* in_ptr = input_mat.ptr<uchar>(i);
-      uchar* alpha_ptr = alpha_mat.ptr<uchar>(i);
-      uchar* out_ptr = output_mat.ptr<uchar>(i);
-      for (int j = 0; j < output_mat.cols; ++j) {
-        const int out_idx = j * kNumChannelsRGBA;
-        const int in_idx = j * input_mat.channels();
-        const int alpha_idx = j * alpha_mat.channels();
-        out_ptr[out_idx + 0] = in_ptr[in_idx + 0];
-        out_ptr[out_idx + 1] = in_ptr[in_idx + 1];
-        out_ptr[out_idx + 2] = in_ptr[in_idx + 2];
-        out_ptr[out_idx + 3] = alpha_ptr[alpha_idx + 0];  // channel 0 of mask
-      }
-    }
+    ForEachRowBand(
+        cc, output_mat.rows, output_frame->WidthStep(),
+        [&input_mat, &alpha_mat, &output_mat](int begin, int end) {
+          for (int i = begin; i < end; ++i) {
+            const uchar* in_ptr = input_mat.ptr<uchar>(i);
+            const uchar* alpha_ptr = alpha_mat.ptr<uchar>(i);
+            uchar* out_ptr = output_mat.ptr<uchar>(i);
+            for (int j = 0; j < output_mat.cols; ++j) {
+              const int out_idx = j * kNumChannelsRGBA;
+              const int in_idx = j * input_mat.channels();
+              const int alpha_idx = j * alpha_mat.channels();
+              out_ptr[out_idx + 0] = in_ptr[in_idx + 0];
+              out_ptr[out_idx + 1] = in_ptr[in_idx + 1];
+              out_ptr[out_idx + 2] = in_ptr[in_idx + 2];
+              // channel 0 of mask
+              out_ptr[out_idx + 3] = alpha_ptr[alpha_idx + 0];
+            }
+          }
+        });
   } else {
     const uchar alpha_value = std::min(std::max(0.0f, alpha_value_), 255.0f);
-    for (int i = 0; i < output_mat.rows; ++i) {
-      const uchar* in_ptr = input_mat.ptr<uchar>(i);
-      uchar* out_ptr = output_mat.ptr<uchar>(i);
-      for (int j = 0; j < output_mat.cols; ++j) {
-        const int out_idx = j * kNumChannelsRGBA;
-        const int in_idx = j * input_mat.channels();
-        out_ptr[out_idx + 0] = in_ptr[in_idx + 0];
-        out_ptr[out_idx + 1] = in_ptr[in_idx + 1];
-        out_ptr[out_idx + 2] = in_ptr[in_idx + 2];
-        out_ptr[out_idx + 3] = alpha_value;  // use value from options
-      }
-    }
+    ForEachRowBand(
+        cc, output_mat.rows, output_frame->WidthStep(),
+        [&input_mat, &output_mat, alpha_value](int begin, int end) {
+          for (int i = begin; i < end; ++i) {
+            const uchar* in_ptr = input_mat.ptr<uchar>(i);
+            uchar* out_ptr = output_mat.ptr<uchar>(i);
+            for (int j = 0; j < output_mat.cols; ++j) {
+              const int out_idx = j * kNumChannelsRGBA;
+              const int in_idx = j * input_mat.channels();
+              out_ptr[out_idx + 0] = in_ptr[in_idx + 0];
+              out_ptr[out_idx + 1] = in_ptr[in_idx + 1];
+              out_ptr[out_idx + 2] = in_ptr[in_idx + 2];
+              out_ptr[out_idx + 3] = alpha_value;  // use value from options
+            }
+          }
+        });
   }
 
   cc->Outputs()
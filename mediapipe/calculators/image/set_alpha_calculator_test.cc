@@ -0,0 +1,132 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/tool/sink.h"
+
+namespace mediapipe {
+namespace {
+
+// Large enough for ForEachRowBand to split the output into several bands.
+constexpr int kWidth = 512;
+constexpr int kHeight = 300;
+
+constexpr char kApplicationThread[] = R"(
+    executor { type: "ApplicationThreadExecutor" })";
+
+// Returns an image of "format" filled with a pattern that varies along both
+// axes and across channels.
+Packet MakeImage(ImageFormat::Format format, int width, int height) {
+  auto image = absl::make_unique<ImageFrame>(format, width, height);
+  const int row_size = width * image->NumberOfChannels();
+  for (int y = 0; y < height; ++y) {
+    uint8* row = image->MutablePixelData() + y * image->WidthStep();
+    for (int i = 0; i < row_size; ++i) {
+      row[i] = (7 * i + 13 * y) & 0xff;
+    }
+  }
+  return Adopt(image.release()).At(Timestamp(0));
+}
+
+// Runs "image", and "alpha" unless it is empty, through a SetAlphaCalculator
+// with "options" in a graph with "executor_config", and returns the output.
+Packet RunSetAlpha(const std::string& executor_config,
+                   const std::string& options, const Packet& image,
+                   const Packet& alpha) {
+  const bool use_alpha = !alpha.IsEmpty();
+  CalculatorGraphConfig config = ParseTextProtoOrDie<CalculatorGraphConfig>(
+      absl::StrCat(R"(
+        input_stream: "image"
+        node {
+          calculator: "SetAlphaCalculator"
+          input_stream: "IMAGE:image"
+          output_stream: "IMAGE:output"
+          options {
+            [mediapipe.SetAlphaCalculatorOptions.ext] { )",
+                   options, R"( }
+          }
+        })",
+                   executor_config));
+  if (use_alpha) {
+    config.add_input_stream("alpha");
+    config.mutable_node(0)->add_input_stream("ALPHA:alpha");
+  }
+  std::vector<Packet> output;
+  tool::AddVectorSink("output", &config, &output);
+  CalculatorGraph graph;
+  MP_EXPECT_OK(graph.Initialize(config));
+  MP_EXPECT_OK(graph.StartRun({}));
+  MP_EXPECT_OK(graph.AddPacketToInputStream("image", image));
+  if (use_alpha) {
+    MP_EXPECT_OK(graph.AddPacketToInputStream("alpha", alpha));
+  }
+  MP_EXPECT_OK(graph.CloseAllInputStreams());
+  MP_EXPECT_OK(graph.WaitUntilDone());
+  EXPECT_EQ(1, output.size());
+  return output.empty() ? Packet() : output[0];
+}
+
+// Expects the pixels of the RGBA images in "a" and "b" to be the same bytes.
+void ExpectSameImage(const Packet& a, const Packet& b) {
+  ASSERT_FALSE(a.IsEmpty());
+  ASSERT_FALSE(b.IsEmpty());
+  const ImageFrame& frame_a = a.Get<ImageFrame>();
+  const ImageFrame& frame_b = b.Get<ImageFrame>();
+  ASSERT_EQ(ImageFormat::SRGBA, frame_a.Format());
+  ASSERT_EQ(ImageFormat::SRGBA, frame_b.Format());
+  ASSERT_EQ(kWidth, frame_a.Width());
+  ASSERT_EQ(kHeight, frame_a.Height());
+  ASSERT_EQ(kWidth, frame_b.Width());
+  ASSERT_EQ(kHeight, frame_b.Height());
+  const int row_size = kWidth * 4;
+  for (int y = 0; y < kHeight; ++y) {
+    const uint8* row_a = frame_a.PixelData() + y * frame_a.WidthStep();
+    const uint8* row_b = frame_b.PixelData() + y * frame_b.WidthStep();
+    ASSERT_EQ(std::vector<uint8>(row_a, row_a + row_size),
+              std::vector<uint8>(row_b, row_b + row_size))
+        << "row " << y;
+  }
+}
+
+// The default executor splits the image into row bands, while the application
+// thread processes it in one call. Both must give the same bytes.
+TEST(SetAlphaCalculatorTest, RowBandsMatchWholeImageWithAlphaMask) {
+  const Packet image = MakeImage(ImageFormat::SRGB, kWidth, kHeight);
+  const Packet alpha = MakeImage(ImageFormat::GRAY8, kWidth, kHeight);
+  ExpectSameImage(RunSetAlpha("", "", image, alpha),
+                  RunSetAlpha(kApplicationThread, "", image, alpha));
+}
+
+TEST(SetAlphaCalculatorTest, RowBandsMatchWholeImageWithAlphaValue) {
+  const Packet image = MakeImage(ImageFormat::SRGBA, kWidth, kHeight);
+  const std::string options = "alpha_value: 128";
+  const Packet banded = RunSetAlpha("", options, image, Packet());
+  ExpectSameImage(banded,
+                  RunSetAlpha(kApplicationThread, options, image, Packet()));
+  ASSERT_FALSE(banded.IsEmpty());
+  const ImageFrame& frame = banded.Get<ImageFrame>();
+  EXPECT_EQ(128, frame.PixelData()[(kHeight - 1) * frame.WidthStep() + 3]);
+}
+
+}  // namespace
+}  // namespace mediapipe
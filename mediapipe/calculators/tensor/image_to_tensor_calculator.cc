@@ -17,12 +17,14 @@
 
 #include "mediapipe/calculators/tensor/image_to_tensor_calculator.pb.h"
 #include "mediapipe/calculators/tensor/image_to_tensor_converter.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_converter_fused.h"
 #include "mediapipe/calculators/tensor/image_to_tensor_converter_opencv.h"
 #include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/rect.pb.h"
 #include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "mediapipe/framework/port.h"
 #include "mediapipe/framework/port/canonical_errors.h"
 #include "mediapipe/framework/port/ret_check.h"
@@ -47,6 +49,7 @@
 namespace {
 constexpr char kInputCpu[] = "IMAGE";
 constexpr char kInputGpu[] = "IMAGE_GPU";
+constexpr char kInputYuv[] = "YUV_IMAGE";
 constexpr char kOutputMatrix[] = "MATRIX";
 constexpr char kOutput[] = "TENSORS";
 constexpr char kInputNormRect[] = "NORM_RECT";
@@ -63,7 +66,10 @@ namespace mediapipe {
 //     Image to extract from.
 //   IMAGE_GPU - GpuBuffer [GpuBufferFormat::kBGRA32]
 //     Image to extract from.
-//   (Either IMAGE or IMAGE_GPU has to be specified.)
+//   YUV_IMAGE - YUVImage [I420/YV12/NV12/NV21, 8-bit]
+//     Image to extract from. Only the extracted region is converted to RGB,
+//     by the FUSED CPU converter.
+//   (Exactly one of IMAGE, IMAGE_GPU or YUV_IMAGE has to be specified.)
 //
 //   NORM_RECT - NormalizedRect @Optional
 //     Describes region of image to extract.
@@ -105,6 +111,8 @@ namespace mediapipe {
 //         min: 0.0
 //         max: 1.0
 //       }
+//       # Or, for a uint8 tensor (CPU only):
+//       # output_tensor_uint_range { min: 0 max: 255 }
 //       # gpu_origin: CONVENTIONAL # or TOP_LEFT
 //     }
 //   }
@@ -115,11 +123,35 @@ class ImageToTensorCalculator : public CalculatorBase {
     const auto& options =
         cc->Options<mediapipe::ImageToTensorCalculatorOptions>();
 
-    RET_CHECK(options.has_output_tensor_float_range())
+    RET_CHECK(options.has_output_tensor_float_range() ||
+              options.has_output_tensor_int_range() ||
+              options.has_output_tensor_uint_range())
         << "Output tensor range is required.";
-    RET_CHECK_LT(options.output_tensor_float_range().min(),
-                 options.output_tensor_float_range().max())
-        << "Valid output tensor range is required.";
+    if (options.has_output_tensor_float_range()) {
+      RET_CHECK_LT(options.output_tensor_float_range().min(),
+                   options.output_tensor_float_range().max())
+          << "Valid output tensor range is required.";
+    } else {
+      RET_CHECK(cc->Inputs().HasTag(kInputCpu) ||
+                cc->Inputs().HasTag(kInputYuv))
+          << "Integer output tensor ranges are only supported for CPU input.";
+    }
+    if (options.has_output_tensor_int_range()) {
+      RET_CHECK_LT(options.output_tensor_int_range().min(),
+                   options.output_tensor_int_range().max())
+          << "Valid output tensor range is required.";
+      RET_CHECK_GE(options.output_tensor_int_range().min(), -128)
+          << "Int range must be within [-128, 127].";
+      RET_CHECK_LE(options.output_tensor_int_range().max(), 127)
+          << "Int range must be within [-128, 127].";
+    }
+    if (options.has_output_tensor_uint_range()) {
+      RET_CHECK_LT(options.output_tensor_uint_range().min(),
+                   options.output_tensor_uint_range().max())
+          << "Valid output tensor range is required.";
+      RET_CHECK_LE(options.output_tensor_uint_range().max(), 255)
+          << "UInt range must be within [0, 255].";
+    }
     RET_CHECK_GT(options.output_tensor_width(), 0)
         << "Valid output tensor width is required.";
     RET_CHECK_GT(options.output_tensor_height(), 0)
@@ -137,11 +169,16 @@ class ImageToTensorCalculator : public CalculatorBase {
 
     const bool has_cpu_input = cc->Inputs().HasTag(kInputCpu);
     const bool has_gpu_input = cc->Inputs().HasTag(kInputGpu);
-    RET_CHECK_EQ((has_cpu_input ? 1 : 0) + (has_gpu_input ? 1 : 0), 1)
-        << "Either CPU or GPU input is expected, not both.";
+    const bool has_yuv_input = cc->Inputs().HasTag(kInputYuv);
+    RET_CHECK_EQ((has_cpu_input ? 1 : 0) + (has_gpu_input ? 1 : 0) +
+                     (has_yuv_input ? 1 : 0),
+                 1)
+        << "Exactly one of CPU, GPU or YUV input is expected.";
 
     if (has_cpu_input) {
       cc->Inputs().Tag(kInputCpu).Set<mediapipe::ImageFrame>();
+    } else if (has_yuv_input) {
+      cc->Inputs().Tag(kInputYuv).Set<mediapipe::YUVImage>();
     } else if (has_gpu_input) {
 #if MEDIAPIPE_DISABLE_GPU
       return mediapipe::UnimplementedError("GPU processing is disabled");
@@ -167,11 +204,29 @@ class ImageToTensorCalculator : public CalculatorBase {
     options_ = cc->Options<mediapipe::ImageToTensorCalculatorOptions>();
     output_width_ = options_.output_tensor_width();
     output_height_ = options_.output_tensor_height();
-    range_min_ = options_.output_tensor_float_range().min();
-    range_max_ = options_.output_tensor_float_range().max();
+    Tensor::ElementType tensor_type = Tensor::ElementType::kFloat32;
+    if (options_.has_output_tensor_int_range()) {
+      tensor_type = Tensor::ElementType::kInt8;
+      range_min_ = options_.output_tensor_int_range().min();
+      range_max_ = options_.output_tensor_int_range().max();
+    } else if (options_.has_output_tensor_uint_range()) {
+      tensor_type = Tensor::ElementType::kUInt8;
+      range_min_ = options_.output_tensor_uint_range().min();
+      range_max_ = options_.output_tensor_uint_range().max();
+    } else {
+      range_min_ = options_.output_tensor_float_range().min();
+      range_max_ = options_.output_tensor_float_range().max();
+    }
 
-    if (cc->Inputs().HasTag(kInputCpu)) {
-      ASSIGN_OR_RETURN(converter_, CreateOpenCvConverter(cc));
+    if (cc->Inputs().HasTag(kInputYuv)) {
+      ASSIGN_OR_RETURN(converter_, CreateFusedCpuConverter(cc, tensor_type));
+    } else if (cc->Inputs().HasTag(kInputCpu)) {
+      if (options_.cpu_converter() ==
+          mediapipe::ImageToTensorCalculatorOptions::FUSED) {
+        ASSIGN_OR_RETURN(converter_, CreateFusedCpuConverter(cc, tensor_type));
+      } else {
+        ASSIGN_OR_RETURN(converter_, CreateOpenCvConverter(cc, tensor_type));
+      }
     } else {
 #if MEDIAPIPE_DISABLE_GPU
       return mediapipe::UnimplementedError("GPU processing is disabled");
@@ -193,8 +248,10 @@ class ImageToTensorCalculator : public CalculatorBase {
   }
 
   ::mediapipe::Status Process(CalculatorContext* cc) {
-    const InputStreamShard& input = cc->Inputs().Tag(
-        cc->Inputs().HasTag(kInputCpu) ? kInputCpu : kInputGpu);
+    const InputStreamShard& input =
+        cc->Inputs().Tag(cc->Inputs().HasTag(kInputCpu)   ? kInputCpu
+                         : cc->Inputs().HasTag(kInputYuv) ? kInputYuv
+                                                          : kInputGpu);
     if (input.IsEmpty()) {
       // Timestamp bound update happens automatically. (See Open().)
       return ::mediapipe::OkStatus();
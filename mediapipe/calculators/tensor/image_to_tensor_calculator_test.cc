@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <cmath>
+#include <string>
 #include <vector>
 
 #include "absl/memory/memory.h"
@@ -55,7 +56,25 @@ cv::Mat GetRgba(absl::string_view path) {
 // No processing/assertions should be done after the function is invoked.
 void RunTest(cv::Mat input, cv::Mat expected_result, float range_min,
              float range_max, int tensor_width, int tensor_height,
-             bool keep_aspect, const mediapipe::NormalizedRect& roi) {
+             bool keep_aspect, const mediapipe::NormalizedRect& roi,
+             Tensor::ElementType tensor_type = Tensor::ElementType::kFloat32) {
+  std::string range_field;
+  int mat_type;
+  switch (tensor_type) {
+    case Tensor::ElementType::kUInt8:
+      range_field = "output_tensor_uint_range";
+      mat_type = CV_8UC3;
+      break;
+    case Tensor::ElementType::kInt8:
+      range_field = "output_tensor_int_range";
+      mat_type = CV_8SC3;
+      break;
+    default:
+      range_field = "output_tensor_float_range";
+      mat_type = CV_32FC3;
+      break;
+  }
+
   auto graph_config = mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(
       absl::Substitute(R"(
         input_stream: "input_image"
@@ -70,7 +89,7 @@ void RunTest(cv::Mat input, cv::Mat expected_result, float range_min,
             output_tensor_width: $0
             output_tensor_height: $1
             keep_aspect_ratio: $4
-            output_tensor_float_range {
+            $5 {
                 min: $2
                 max: $3
               }
@@ -82,7 +101,8 @@ void RunTest(cv::Mat input, cv::Mat expected_result, float range_min,
                        /*$1=*/tensor_height,
                        /*$2=*/range_min,
                        /*$3=*/range_max,
-                       /*$4=*/keep_aspect ? "true" : "false"));
+                       /*$4=*/keep_aspect ? "true" : "false",
+                       /*$5=*/range_field));
 
   std::vector<Packet> output_packets;
   tool::AddVectorSink("tensor", &graph_config, &output_packets);
@@ -111,11 +131,11 @@ void RunTest(cv::Mat input, cv::Mat expected_result, float range_min,
   ASSERT_THAT(tensor_vec, testing::SizeIs(1));
 
   const Tensor& tensor = tensor_vec[0];
-  EXPECT_EQ(tensor.element_type(), Tensor::ElementType::kFloat32);
+  EXPECT_EQ(tensor.element_type(), tensor_type);
 
   auto view = tensor.GetCpuReadView();
-  cv::Mat tensor_mat(tensor_height, tensor_width, CV_32FC3,
-                     const_cast<float*>(view.buffer<float>()));
+  cv::Mat tensor_mat(tensor_height, tensor_width, mat_type,
+                     const_cast<void*>(view.buffer<void>()));
   cv::Mat result_rgb;
   auto transformation =
       GetValueRangeTransformation(range_min, range_max, 0.0f, 255.0f)
@@ -154,6 +174,24 @@ TEST(ImageToTensorCalculatorTest, MediumSubRectKeepAspect) {
       /*tensor_width=*/256, /*tensor_height=*/256, /*keep_aspect=*/true, roi);
 }
 
+TEST(ImageToTensorCalculatorTest, MediumSubRectKeepAspectInt8) {
+  mediapipe::NormalizedRect roi;
+  roi.set_x_center(0.65f);
+  roi.set_y_center(0.4f);
+  roi.set_width(0.5f);
+  roi.set_height(0.5f);
+  roi.set_rotation(0);
+  RunTest(
+      GetRgb("/mediapipe/calculators/"
+             "tensor/testdata/image_to_tensor/input.jpg"),
+      GetRgb("/mediapipe/calculators/"
+             "tensor/testdata/image_to_tensor/medium_sub_rect_keep_aspect.png"),
+      /*range_min=*/-128.0f,
+      /*range_max=*/127.0f,
+      /*tensor_width=*/256, /*tensor_height=*/256, /*keep_aspect=*/true, roi,
+      Tensor::ElementType::kInt8);
+}
+
 TEST(ImageToTensorCalculatorTest, MediumSubRectKeepAspectWithRotation) {
   mediapipe::NormalizedRect roi;
   roi.set_x_center(0.65f);
@@ -258,5 +296,22 @@ TEST(ImageToTensorCalculatorTest, NoOpExceptRange) {
           roi);
 }
 
+TEST(ImageToTensorCalculatorTest, NoOpExceptRangeUInt8) {
+  mediapipe::NormalizedRect roi;
+  roi.set_x_center(0.5f);
+  roi.set_y_center(0.5f);
+  roi.set_width(1.0f);
+  roi.set_height(1.0f);
+  roi.set_rotation(0);
+  RunTest(GetRgb("/mediapipe/calculators/"
+                 "tensor/testdata/image_to_tensor/input.jpg"),
+          GetRgb("/mediapipe/calculators/"
+                 "tensor/testdata/image_to_tensor/noop_except_range.png"),
+          /*range_min=*/0.0f,
+          /*range_max=*/255.0f,
+          /*tensor_width=*/64, /*tensor_height=*/128, /*keep_aspect=*/true,
+          roi, Tensor::ElementType::kUInt8);
+}
+
 }  // namespace
 }  // namespace mediapipe
@@ -0,0 +1,529 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/image_to_tensor_converter_fused.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <opencv2/core/hal/intrin.hpp>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_converter.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/canonical_errors.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/statusor.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr int kNumChannels = 3;
+
+// Converts a transformed value to the tensor element type, rounding and
+// saturating integers as cv::Mat::convertTo does.
+template <typename T>
+inline T ToElement(float value);
+
+template <>
+inline float ToElement<float>(float value) {
+  return value;
+}
+
+template <>
+inline uint8_t ToElement<uint8_t>(float value) {
+  return static_cast<uint8_t>(
+      std::min(std::max(std::lrint(value), 0L), 255L));
+}
+
+template <>
+inline int8_t ToElement<int8_t>(float value) {
+  return static_cast<int8_t>(
+      std::min(std::max(std::lrint(value), -128L), 127L));
+}
+
+#if CV_SIMD128
+// Loads the first three channels of the 16 4-byte pixels at "pixels" as
+// floats, channel c of pixels 4 * k to 4 * k + 3 going to "v[c][k]".
+inline void LoadPixels(const uint32_t* pixels,
+                       cv::v_float32x4 v[kNumChannels][4]) {
+  cv::v_uint8x16 channels[4];
+  cv::v_load_deinterleave(reinterpret_cast<const uint8_t*>(pixels),
+                          channels[0], channels[1], channels[2], channels[3]);
+  for (int c = 0; c < kNumChannels; ++c) {
+    cv::v_uint16x8 halves[2];
+    cv::v_expand(channels[c], halves[0], halves[1]);
+    for (int h = 0; h < 2; ++h) {
+      cv::v_uint32x4 quarters[2];
+      cv::v_expand(halves[h], quarters[0], quarters[1]);
+      for (int q = 0; q < 2; ++q) {
+        v[c][2 * h + q] =
+            cv::v_cvt_f32(cv::v_reinterpret_as_s32(quarters[q]));
+      }
+    }
+  }
+}
+
+// Stores 16 RGB pixels, whose channel c is in "v[c]", as ToElement()
+// converts them.
+inline void StorePixels(const cv::v_float32x4 v[kNumChannels][4], float* out) {
+  for (int k = 0; k < 4; ++k) {
+    cv::v_store_interleave(out + 4 * kNumChannels * k, v[0][k], v[1][k],
+                           v[2][k]);
+  }
+}
+
+inline cv::v_int16x8 RoundAndPack(const cv::v_float32x4& a,
+                                  const cv::v_float32x4& b) {
+  return cv::v_pack(cv::v_round(a), cv::v_round(b));
+}
+
+inline void StorePixels(const cv::v_float32x4 v[kNumChannels][4],
+                        uint8_t* out) {
+  cv::v_uint8x16 channels[kNumChannels];
+  for (int c = 0; c < kNumChannels; ++c) {
+    channels[c] = cv::v_pack_u(RoundAndPack(v[c][0], v[c][1]),
+                               RoundAndPack(v[c][2], v[c][3]));
+  }
+  cv::v_store_interleave(out, channels[0], channels[1], channels[2]);
+}
+
+inline void StorePixels(const cv::v_float32x4 v[kNumChannels][4],
+                        int8_t* out) {
+  cv::v_int8x16 channels[kNumChannels];
+  for (int c = 0; c < kNumChannels; ++c) {
+    channels[c] = cv::v_pack(RoundAndPack(v[c][0], v[c][1]),
+                             RoundAndPack(v[c][2], v[c][3]));
+  }
+  cv::v_store_interleave(out, channels[0], channels[1], channels[2]);
+}
+#endif  // CV_SIMD128
+
+// Samples "roi" of an interleaved 8-bit image with "kSrcChannels" channels,
+// with bilinear interpolation, and writes the first three channels of each
+// sample multiplied by "scale" plus "offset" to the "dst_width" x "dst_height"
+// RGB image "dst". Samples outside the image are clamped to it, which
+// replicates the border.
+//
+// Destination pixel (x, y) samples the source at origin + x * step_x +
+// y * step_y, where the origin is the top-left corner of the ROI. This is the
+// mapping that cv::warpPerspective() uses with the cv::boxPoints() corners.
+//
+// Each row is processed in three loops. The first computes the sample
+// positions, the second copies the four source pixels around each of them,
+// and the third deinterleaves and interpolates them, converts the range and
+// stores the interleaved elements. The first and third use OpenCV universal
+// intrinsics where available; only the copies are scalar.
+template <int kSrcChannels, typename T>
+void SampleRoi(const uint8_t* src, int src_width, int src_height,
+               int src_step, const RotatedRect& roi, int dst_width,
+               int dst_height, float scale, float offset, T* dst) {
+  const float cos_r = std::cos(roi.rotation);
+  const float sin_r = std::sin(roi.rotation);
+  const float step_x_x = cos_r * roi.width / dst_width;
+  const float step_x_y = sin_r * roi.width / dst_width;
+  const float step_y_x = -sin_r * roi.height / dst_height;
+  const float step_y_y = cos_r * roi.height / dst_height;
+  const float origin_x =
+      roi.center_x - 0.5f * (cos_r * roi.width - sin_r * roi.height);
+  const float origin_y =
+      roi.center_y - 0.5f * (sin_r * roi.width + cos_r * roi.height);
+  const float max_x = src_width - 1;
+  const float max_y = src_height - 1;
+
+  // The integer and fractional parts of the sample positions of one row.
+  std::vector<int> samples(2 * dst_width);
+  std::vector<float> fractions(2 * dst_width);
+  int* sample_x = samples.data();
+  int* sample_y = sample_x + dst_width;
+  float* fraction_x = fractions.data();
+  float* fraction_y = fraction_x + dst_width;
+  // The top-left, top-right, bottom-left and bottom-right source pixels of
+  // the samples of one row, each in the low bytes of a 32-bit word.
+  std::vector<uint32_t> corners(4 * dst_width);
+  uint32_t* top_left = corners.data();
+  uint32_t* top_right = top_left + dst_width;
+  uint32_t* bottom_left = top_right + dst_width;
+  uint32_t* bottom_right = bottom_left + dst_width;
+  for (int y = 0; y < dst_height; ++y) {
+    const float row_x = origin_x + y * step_y_x;
+    const float row_y = origin_y + y * step_y_y;
+    int x = 0;
+#if CV_SIMD128
+    {
+      const cv::v_float32x4 lanes(0.0f, 1.0f, 2.0f, 3.0f);
+      const cv::v_float32x4 zero = cv::v_setall_f32(0.0f);
+      for (; x + 4 <= dst_width; x += 4) {
+        const cv::v_float32x4 xs = cv::v_setall_f32(x) + lanes;
+        const cv::v_float32x4 sx = cv::v_min(
+            cv::v_max(cv::v_setall_f32(row_x) +
+                          xs * cv::v_setall_f32(step_x_x),
+                      zero),
+            cv::v_setall_f32(max_x));
+        const cv::v_float32x4 sy = cv::v_min(
+            cv::v_max(cv::v_setall_f32(row_y) +
+                          xs * cv::v_setall_f32(step_x_y),
+                      zero),
+            cv::v_setall_f32(max_y));
+        const cv::v_int32x4 x0 = cv::v_trunc(sx);
+        const cv::v_int32x4 y0 = cv::v_trunc(sy);
+        cv::v_store(sample_x + x, x0);
+        cv::v_store(sample_y + x, y0);
+        cv::v_store(fraction_x + x, sx - cv::v_cvt_f32(x0));
+        cv::v_store(fraction_y + x, sy - cv::v_cvt_f32(y0));
+      }
+    }
+#endif  // CV_SIMD128
+    for (; x < dst_width; ++x) {
+      const float sx = std::min(std::max(row_x + x * step_x_x, 0.0f), max_x);
+      const float sy = std::min(std::max(row_y + x * step_x_y, 0.0f), max_y);
+      sample_x[x] = static_cast<int>(sx);
+      sample_y[x] = static_cast<int>(sy);
+      fraction_x[x] = sx - sample_x[x];
+      fraction_y[x] = sy - sample_y[x];
+    }
+
+    // Copies "kSrcChannels" bytes per pixel, so that the last pixel of the
+    // image is not read past; only the first three bytes are used.
+    for (x = 0; x < dst_width; ++x) {
+      const int x0 = sample_x[x];
+      const int y0 = sample_y[x];
+      const int dx = x0 < src_width - 1 ? kSrcChannels : 0;
+      const int dy = y0 < src_height - 1 ? src_step : 0;
+      const uint8_t* p00 = src + y0 * src_step + x0 * kSrcChannels;
+      const uint8_t* p10 = p00 + dy;
+      std::memcpy(top_left + x, p00, kSrcChannels);
+      std::memcpy(top_right + x, p00 + dx, kSrcChannels);
+      std::memcpy(bottom_left + x, p10, kSrcChannels);
+      std::memcpy(bottom_right + x, p10 + dx, kSrcChannels);
+    }
+
+    T* out = dst + y * dst_width * kNumChannels;
+    x = 0;
+#if CV_SIMD128
+    {
+      const cv::v_float32x4 v_scale = cv::v_setall_f32(scale);
+      const cv::v_float32x4 v_offset = cv::v_setall_f32(offset);
+      for (; x + 16 <= dst_width; x += 16) {
+        cv::v_float32x4 top[kNumChannels][4];
+        cv::v_float32x4 bottom[kNumChannels][4];
+        cv::v_float32x4 right[kNumChannels][4];
+        LoadPixels(top_left + x, top);
+        LoadPixels(top_right + x, right);
+        for (int k = 0; k < 4; ++k) {
+          const cv::v_float32x4 ax = cv::v_load(fraction_x + x + 4 * k);
+          for (int c = 0; c < kNumChannels; ++c) {
+            top[c][k] = top[c][k] + ax * (right[c][k] - top[c][k]);
+          }
+        }
+        LoadPixels(bottom_left + x, bottom);
+        LoadPixels(bottom_right + x, right);
+        for (int k = 0; k < 4; ++k) {
+          const cv::v_float32x4 ax = cv::v_load(fraction_x + x + 4 * k);
+          const cv::v_float32x4 ay = cv::v_load(fraction_y + x + 4 * k);
+          for (int c = 0; c < kNumChannels; ++c) {
+            bottom[c][k] = bottom[c][k] + ax * (right[c][k] - bottom[c][k]);
+            top[c][k] =
+                (top[c][k] + ay * (bottom[c][k] - top[c][k])) * v_scale +
+                v_offset;
+          }
+        }
+        StorePixels(top, out + x * kNumChannels);
+      }
+    }
+#endif  // CV_SIMD128
+    for (; x < dst_width; ++x) {
+      const auto* p00 = reinterpret_cast<const uint8_t*>(top_left + x);
+      const auto* p01 = reinterpret_cast<const uint8_t*>(top_right + x);
+      const auto* p10 = reinterpret_cast<const uint8_t*>(bottom_left + x);
+      const auto* p11 = reinterpret_cast<const uint8_t*>(bottom_right + x);
+      for (int c = 0; c < kNumChannels; ++c) {
+        const float top = p00[c] + fraction_x[x] * (p01[c] - p00[c]);
+        const float bottom = p10[c] + fraction_x[x] * (p11[c] - p10[c]);
+        out[x * kNumChannels + c] = ToElement<T>(
+            (top + fraction_y[x] * (bottom - top)) * scale + offset);
+      }
+    }
+  }
+}
+
+template <typename T>
+void SampleImage(const ImageFrame& image, const RotatedRect& roi,
+                 const Size& output_dims, float scale, float offset, T* dst) {
+  if (image.NumberOfChannels() == 4) {
+    SampleRoi<4>(image.PixelData(), image.Width(), image.Height(),
+                 image.WidthStep(), roi, output_dims.width,
+                 output_dims.height, scale, offset, dst);
+  } else {
+    SampleRoi<3>(image.PixelData(), image.Width(), image.Height(),
+                 image.WidthStep(), roi, output_dims.width,
+                 output_dims.height, scale, offset, dst);
+  }
+}
+
+// Coefficients of the conversion from 8-bit YCbCr to RGB, in the [0, 255]
+// range.
+struct YuvToRgb {
+  float y_offset;
+  float y_scale;
+  float r_from_v;
+  float g_from_u;
+  float g_from_v;
+  float b_from_u;
+};
+
+YuvToRgb GetYuvToRgb(const YUVImage& image) {
+  // BT.709 luma weights, or BT.601 ones for every other matrix, as libyuv
+  // assumes.
+  const bool bt709 = image.matrix_coefficients() ==
+                     YUVImage::COLOR_MATRIX_COEFFICIENTS_BT709;
+  const float kr = bt709 ? 0.2126f : 0.299f;
+  const float kb = bt709 ? 0.0722f : 0.114f;
+  const float kg = 1.0f - kr - kb;
+  // Limited range puts luma in [16, 235] and chroma in [16, 240].
+  const float y_scale = image.full_range() ? 1.0f : 255.0f / 219.0f;
+  const float c_scale = image.full_range() ? 1.0f : 255.0f / 224.0f;
+  YuvToRgb coefficients;
+  coefficients.y_offset = image.full_range() ? 0.0f : 16.0f;
+  coefficients.y_scale = y_scale;
+  coefficients.r_from_v = 2.0f * (1.0f - kr) * c_scale;
+  coefficients.g_from_u = -2.0f * kb * (1.0f - kb) / kg * c_scale;
+  coefficients.g_from_v = -2.0f * kr * (1.0f - kr) / kg * c_scale;
+  coefficients.b_from_u = 2.0f * (1.0f - kb) * c_scale;
+  return coefficients;
+}
+
+// Bilinear interpolation of the 8-bit plane "plane" at ("x", "y"), which must
+// lie within the plane. Samples are "pixel_step" bytes apart in a row.
+inline float Interpolate(const uint8_t* plane, int width, int height,
+                         int stride, int pixel_step, float x, float y) {
+  const int x0 = static_cast<int>(x);
+  const int y0 = static_cast<int>(y);
+  const int dx = x0 < width - 1 ? pixel_step : 0;
+  const int dy = y0 < height - 1 ? stride : 0;
+  const float ax = x - x0;
+  const float ay = y - y0;
+  const uint8_t* p00 = plane + y0 * stride + x0 * pixel_step;
+  const uint8_t* p10 = p00 + dy;
+  return (1.0f - ay) * ((1.0f - ax) * p00[0] + ax * p00[dx]) +
+         ay * ((1.0f - ax) * p10[0] + ax * p10[dx]);
+}
+
+// Like SampleRoi(), for an 8-bit 4:2:0 YUV image whose chroma samples are
+// "kChromaStep" bytes apart: 1 for planar (I420, YV12) and 2 for semi-planar
+// (NV12, NV21) layouts. Only the sampled pixels are converted to RGB.
+template <int kChromaStep, typename T>
+void SampleYuvRoi(const YUVImage& image, const uint8_t* u_plane,
+                  const uint8_t* v_plane, int chroma_stride,
+                  const RotatedRect& roi, int dst_width, int dst_height,
+                  float scale, float offset, T* dst) {
+  const YuvToRgb yuv_to_rgb = GetYuvToRgb(image);
+  const int width = image.width();
+  const int height = image.height();
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  const float cos_r = std::cos(roi.rotation);
+  const float sin_r = std::sin(roi.rotation);
+  const float step_x_x = cos_r * roi.width / dst_width;
+  const float step_x_y = sin_r * roi.width / dst_width;
+  const float step_y_x = -sin_r * roi.height / dst_height;
+  const float step_y_y = cos_r * roi.height / dst_height;
+  const float origin_x =
+      roi.center_x - 0.5f * (cos_r * roi.width - sin_r * roi.height);
+  const float origin_y =
+      roi.center_y - 0.5f * (sin_r * roi.width + cos_r * roi.height);
+
+  for (int y = 0; y < dst_height; ++y) {
+    const float row_x = origin_x + y * step_y_x;
+    const float row_y = origin_y + y * step_y_y;
+    T* out = dst + y * dst_width * kNumChannels;
+    for (int x = 0; x < dst_width; ++x) {
+      const float sx =
+          std::min(std::max(row_x + x * step_x_x, 0.0f), width - 1.0f);
+      const float sy =
+          std::min(std::max(row_y + x * step_x_y, 0.0f), height - 1.0f);
+      // Chroma samples are centered between each 2x2 block of luma samples.
+      const float cx = std::min(std::max(0.5f * sx - 0.25f, 0.0f),
+                                chroma_width - 1.0f);
+      const float cy = std::min(std::max(0.5f * sy - 0.25f, 0.0f),
+                                chroma_height - 1.0f);
+      const float luma =
+          (Interpolate(image.data(0), width, height, image.stride(0), 1, sx,
+                       sy) -
+           yuv_to_rgb.y_offset) *
+          yuv_to_rgb.y_scale;
+      const float u = Interpolate(u_plane, chroma_width, chroma_height,
+                                  chroma_stride, kChromaStep, cx, cy) -
+                      128.0f;
+      const float v = Interpolate(v_plane, chroma_width, chroma_height,
+                                  chroma_stride, kChromaStep, cx, cy) -
+                      128.0f;
+      const float rgb[kNumChannels] = {
+          luma + yuv_to_rgb.r_from_v * v,
+          luma + yuv_to_rgb.g_from_u * u + yuv_to_rgb.g_from_v * v,
+          luma + yuv_to_rgb.b_from_u * u};
+      for (int c = 0; c < kNumChannels; ++c) {
+        out[c] = ToElement<T>(
+            std::min(std::max(rgb[c], 0.0f), 255.0f) * scale + offset);
+      }
+      out += kNumChannels;
+    }
+  }
+}
+
+template <typename T>
+::mediapipe::Status SampleYuvImage(const YUVImage& image,
+                                   const RotatedRect& roi,
+                                   const Size& output_dims, float scale,
+                                   float offset, T* dst) {
+  RET_CHECK_EQ(image.bit_depth(), 8) << "Only 8-bit YUV images are supported.";
+  switch (image.fourcc()) {
+    case libyuv::FOURCC_I420:
+      SampleYuvRoi<1>(image, image.data(1), image.data(2), image.stride(1),
+                      roi, output_dims.width, output_dims.height, scale,
+                      offset, dst);
+      break;
+    case libyuv::FOURCC_YV12:
+      SampleYuvRoi<1>(image, image.data(2), image.data(1), image.stride(1),
+                      roi, output_dims.width, output_dims.height, scale,
+                      offset, dst);
+      break;
+    case libyuv::FOURCC_NV12:
+      SampleYuvRoi<2>(image, image.data(1), image.data(1) + 1,
+                      image.stride(1), roi, output_dims.width,
+                      output_dims.height, scale, offset, dst);
+      break;
+    case libyuv::FOURCC_NV21:
+      SampleYuvRoi<2>(image, image.data(1) + 1, image.data(1),
+                      image.stride(1), roi, output_dims.width,
+                      output_dims.height, scale, offset, dst);
+      break;
+    default:
+      return InvalidArgumentError(
+          absl::StrCat("Only I420, YV12, NV12 and NV21 YUV images are "
+                       "supported, passed fourcc: ",
+                       static_cast<uint32_t>(image.fourcc())));
+  }
+  return ::mediapipe::OkStatus();
+}
+
+class FusedCpuProcessor : public ImageToTensorConverter {
+ public:
+  explicit FusedCpuProcessor(Tensor::ElementType tensor_type)
+      : tensor_type_(tensor_type) {}
+
+  Size GetImageSize(const Packet& image_packet) override {
+    if (image_packet.ValidateAsType<YUVImage>().ok()) {
+      const auto& image = image_packet.Get<YUVImage>();
+      return {image.width(), image.height()};
+    }
+    const auto& image = image_packet.Get<mediapipe::ImageFrame>();
+    return {image.Width(), image.Height()};
+  }
+
+  ::mediapipe::StatusOr<Tensor> Convert(const Packet& image_packet,
+                                        const RotatedRect& roi,
+                                        const Size& output_dims,
+                                        float range_min,
+                                        float range_max) override {
+    const bool is_yuv = image_packet.ValidateAsType<YUVImage>().ok();
+    if (!is_yuv) {
+      const auto& input = image_packet.Get<mediapipe::ImageFrame>();
+      if (input.Format() != mediapipe::ImageFormat::SRGB &&
+          input.Format() != mediapipe::ImageFormat::SRGBA) {
+        return InvalidArgumentError(absl::StrCat(
+            "Only RGBA/RGB formats are supported, passed format: ",
+            static_cast<uint32_t>(input.Format())));
+      }
+    }
+    RET_CHECK(output_dims.width > 0 && output_dims.height > 0);
+
+    constexpr float kInputImageRangeMin = 0.0f;
+    constexpr float kInputImageRangeMax = 255.0f;
+    ASSIGN_OR_RETURN(
+        auto transform,
+        GetValueRangeTransformation(kInputImageRangeMin, kInputImageRangeMax,
+                                    range_min, range_max));
+
+    Tensor tensor(
+        tensor_type_,
+        Tensor::Shape{1, output_dims.height, output_dims.width, kNumChannels});
+    auto buffer_view = tensor.GetCpuWriteView();
+    if (is_yuv) {
+      const auto& input = image_packet.Get<YUVImage>();
+      switch (tensor_type_) {
+        case Tensor::ElementType::kUInt8:
+          MP_RETURN_IF_ERROR(SampleYuvImage(input, roi, output_dims,
+                                            transform.scale, transform.offset,
+                                            buffer_view.buffer<uint8_t>()));
+          break;
+        case Tensor::ElementType::kInt8:
+          MP_RETURN_IF_ERROR(SampleYuvImage(input, roi, output_dims,
+                                            transform.scale, transform.offset,
+                                            buffer_view.buffer<int8_t>()));
+          break;
+        default:
+          MP_RETURN_IF_ERROR(SampleYuvImage(input, roi, output_dims,
+                                            transform.scale, transform.offset,
+                                            buffer_view.buffer<float>()));
+          break;
+      }
+      return tensor;
+    }
+    const auto& input = image_packet.Get<mediapipe::ImageFrame>();
+    switch (tensor_type_) {
+      case Tensor::ElementType::kUInt8:
+        SampleImage(input, roi, output_dims, transform.scale, transform.offset,
+                    buffer_view.buffer<uint8_t>());
+        break;
+      case Tensor::ElementType::kInt8:
+        SampleImage(input, roi, output_dims, transform.scale, transform.offset,
+                    buffer_view.buffer<int8_t>());
+        break;
+      default:
+        SampleImage(input, roi, output_dims, transform.scale, transform.offset,
+                    buffer_view.buffer<float>());
+        break;
+    }
+    return tensor;
+  }
+
+ private:
+  const Tensor::ElementType tensor_type_;
+};
+
+}  // namespace
+
+::mediapipe::StatusOr<std::unique_ptr<ImageToTensorConverter>>
+CreateFusedCpuConverter(CalculatorContext* cc,
+                        Tensor::ElementType tensor_type) {
+  RET_CHECK(tensor_type == Tensor::ElementType::kFloat32 ||
+            tensor_type == Tensor::ElementType::kUInt8 ||
+            tensor_type == Tensor::ElementType::kInt8)
+      << "Unsupported tensor type: " << static_cast<int>(tensor_type);
+  return std::unique_ptr<ImageToTensorConverter>(
+      absl::make_unique<FusedCpuProcessor>(tensor_type));
+}
+
+}  // namespace mediapipe
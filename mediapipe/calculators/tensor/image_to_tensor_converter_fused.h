@@ -0,0 +1,42 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_CONVERTER_FUSED_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_CONVERTER_FUSED_H_
+
+#include <memory>
+
+#include "mediapipe/calculators/tensor/image_to_tensor_converter.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/statusor.h"
+
+namespace mediapipe {
+
+// Creates a CPU image-to-tensor converter that samples the ROI, drops the
+// alpha channel and converts the value range in a single pass, writing
+// straight into the output tensor. Produces the same geometry as the OpenCV
+// converter (bilinear interpolation, replicated border) without its
+// intermediate images. The converter outputs tensors of "tensor_type", which
+// must be kFloat32, kUInt8 or kInt8.
+//
+// Besides SRGB/SRGBA ImageFrames, the converter accepts 8-bit I420, YV12,
+// NV12 and NV21 YUVImages, and converts only the sampled pixels to RGB.
+::mediapipe::StatusOr<std::unique_ptr<ImageToTensorConverter>>
+CreateFusedCpuConverter(CalculatorContext* cc,
+                        Tensor::ElementType tensor_type);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_CONVERTER_FUSED_H_
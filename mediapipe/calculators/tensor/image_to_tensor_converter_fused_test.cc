@@ -0,0 +1,363 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/image_to_tensor_converter_fused.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_converter.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_converter_opencv.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+// Returns an image whose channel c of pixel (x, y) is 10 * (x + 4 * y) + c.
+Packet MakeImage(ImageFormat::Format format, int width, int height) {
+  auto image = absl::make_unique<ImageFrame>(format, width, height);
+  const int channels = image->NumberOfChannels();
+  for (int y = 0; y < height; ++y) {
+    uint8* row = image->MutablePixelData() + y * image->WidthStep();
+    for (int x = 0; x < width; ++x) {
+      for (int c = 0; c < channels; ++c) {
+        row[x * channels + c] = 10 * (x + 4 * y) + c;
+      }
+    }
+  }
+  return Adopt(image.release());
+}
+
+template <typename T>
+std::vector<T> ConvertImage(const Packet& image, const RotatedRect& roi,
+                            const Size& output_dims, float range_min,
+                            float range_max, Tensor::ElementType type) {
+  auto converter = CreateFusedCpuConverter(nullptr, type).ValueOrDie();
+  auto tensor_or = converter->Convert(image, roi, output_dims, range_min,
+                                      range_max);
+  MEDIAPIPE_CHECK_OK(tensor_or.status());
+  const Tensor& tensor = tensor_or.ValueOrDie();
+  EXPECT_EQ(type, tensor.element_type());
+  EXPECT_EQ(std::vector<int>({1, output_dims.height, output_dims.width, 3}),
+            tensor.shape().dims);
+  auto view = tensor.GetCpuReadView();
+  const T* data = view.buffer<T>();
+  return std::vector<T>(data,
+                        data + output_dims.width * output_dims.height * 3);
+}
+
+TEST(ImageToTensorConverterFusedTest, CopiesFullImageAndDropsAlpha) {
+  Packet image = MakeImage(ImageFormat::SRGBA, 4, 3);
+  RotatedRect roi{/*center_x=*/2.0f, /*center_y=*/1.5f, /*width=*/4.0f,
+                  /*height=*/3.0f, /*rotation=*/0.0f};
+  std::vector<float> values =
+      ConvertImage<float>(image, roi, {4, 3}, 0.0f, 255.0f,
+                          Tensor::ElementType::kFloat32);
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 4; ++x) {
+      for (int c = 0; c < 3; ++c) {
+        EXPECT_FLOAT_EQ(10 * (x + 4 * y) + c, values[(y * 4 + x) * 3 + c]);
+      }
+    }
+  }
+}
+
+TEST(ImageToTensorConverterFusedTest, ConvertsRange) {
+  Packet image = MakeImage(ImageFormat::SRGB, 2, 2);
+  RotatedRect roi{1.0f, 1.0f, 2.0f, 2.0f, 0.0f};
+  std::vector<float> floats = ConvertImage<float>(
+      image, roi, {2, 2}, -1.0f, 1.0f, Tensor::ElementType::kFloat32);
+  EXPECT_FLOAT_EQ(-1.0f, floats[0]);
+  EXPECT_FLOAT_EQ(51.0f / 127.5f - 1.0f, floats[9 + 1]);
+
+  std::vector<uint8_t> uints = ConvertImage<uint8_t>(
+      image, roi, {2, 2}, 0.0f, 255.0f, Tensor::ElementType::kUInt8);
+  EXPECT_THAT(uints, testing::ElementsAre(0, 1, 2, 10, 11, 12, 40, 41, 42, 50,
+                                          51, 52));
+
+  std::vector<int8_t> ints = ConvertImage<int8_t>(
+      image, roi, {2, 2}, -128.0f, 127.0f, Tensor::ElementType::kInt8);
+  EXPECT_EQ(-128, ints[0]);
+  EXPECT_EQ(52 - 128, ints[11]);
+}
+
+TEST(ImageToTensorConverterFusedTest, InterpolatesAndReplicatesBorder) {
+  Packet image = MakeImage(ImageFormat::SRGB, 2, 1);
+  // Samples the image at x = 0.5 and x = 1.5, which is past the last pixel.
+  RotatedRect roi{1.5f, 0.5f, 2.0f, 1.0f, 0.0f};
+  std::vector<float> values = ConvertImage<float>(
+      image, roi, {2, 1}, 0.0f, 255.0f, Tensor::ElementType::kFloat32);
+  EXPECT_THAT(values, testing::ElementsAre(5.0f, 6.0f, 7.0f, 10.0f, 11.0f,
+                                           12.0f));
+}
+
+TEST(ImageToTensorConverterFusedTest, RejectsUnsupportedFormat) {
+  auto converter =
+      CreateFusedCpuConverter(nullptr, Tensor::ElementType::kFloat32)
+          .ValueOrDie();
+  Packet image = MakeImage(ImageFormat::GRAY8, 2, 2);
+  EXPECT_FALSE(converter
+                   ->Convert(image, RotatedRect{1.0f, 1.0f, 2.0f, 2.0f, 0.0f},
+                             {2, 2}, 0.0f, 1.0f)
+                   .ok());
+  EXPECT_FALSE(
+      CreateFusedCpuConverter(nullptr, Tensor::ElementType::kInt32).ok());
+}
+
+// Returns an image whose channel c of pixel (x, y) is x + 2 * y + 30 * c.
+// The gradient is gentle, so that the fixed-point interpolation of
+// cv::warpPerspective() stays within a fraction of a level of the exact one.
+Packet MakeGradientImage(ImageFormat::Format format, int width, int height) {
+  auto image = absl::make_unique<ImageFrame>(format, width, height);
+  const int channels = image->NumberOfChannels();
+  for (int y = 0; y < height; ++y) {
+    uint8* row = image->MutablePixelData() + y * image->WidthStep();
+    for (int x = 0; x < width; ++x) {
+      for (int c = 0; c < channels; ++c) {
+        row[x * channels + c] = x + 2 * y + 30 * c;
+      }
+    }
+  }
+  return Adopt(image.release());
+}
+
+// Returns the elements of a tensor of "type" as floats.
+std::vector<float> TensorValues(const Tensor& tensor,
+                                Tensor::ElementType type) {
+  auto view = tensor.GetCpuReadView();
+  const int size = tensor.shape().num_elements();
+  switch (type) {
+    case Tensor::ElementType::kUInt8: {
+      const uint8_t* data = view.buffer<uint8_t>();
+      return std::vector<float>(data, data + size);
+    }
+    case Tensor::ElementType::kInt8: {
+      const int8_t* data = view.buffer<int8_t>();
+      return std::vector<float>(data, data + size);
+    }
+    default: {
+      const float* data = view.buffer<float>();
+      return std::vector<float>(data, data + size);
+    }
+  }
+}
+
+struct EquivalenceParam {
+  std::string name;
+  ImageFormat::Format format;
+  RotatedRect roi;
+  Tensor::ElementType type;
+  float range_min;
+  float range_max;
+};
+
+std::vector<EquivalenceParam> EquivalenceParams() {
+  // The converters replicate the border, so the ROIs that cross it check
+  // the clamping of the sample positions.
+  const std::vector<std::pair<std::string, RotatedRect>> rois = {
+      {"Inside", {32.0f, 24.0f, 40.0f, 30.0f, 0.0f}},
+      {"Rotated", {32.0f, 24.0f, 30.0f, 20.0f, 0.6f}},
+      {"CrossesBorder", {56.0f, 6.0f, 50.0f, 40.0f, 0.0f}},
+      {"RotatedCrossesBorder", {8.0f, 40.0f, 60.0f, 36.0f, -2.3f}},
+  };
+  const std::vector<std::pair<ImageFormat::Format, std::string>> formats = {
+      {ImageFormat::SRGB, "Rgb"}, {ImageFormat::SRGBA, "Rgba"}};
+  struct Range {
+    std::string name;
+    Tensor::ElementType type;
+    float min;
+    float max;
+  };
+  const std::vector<Range> ranges = {
+      {"Float0To255", Tensor::ElementType::kFloat32, 0.0f, 255.0f},
+      {"FloatMinus1To1", Tensor::ElementType::kFloat32, -1.0f, 1.0f},
+      {"Float0To1", Tensor::ElementType::kFloat32, 0.0f, 1.0f},
+      {"UInt0To255", Tensor::ElementType::kUInt8, 0.0f, 255.0f},
+      {"UInt20To200", Tensor::ElementType::kUInt8, 20.0f, 200.0f},
+      {"IntMinus128To127", Tensor::ElementType::kInt8, -128.0f, 127.0f},
+  };
+  std::vector<EquivalenceParam> params;
+  for (const auto& roi : rois) {
+    for (const auto& format : formats) {
+      for (const Range& range : ranges) {
+        params.push_back({roi.first + format.second + range.name, format.first,
+                          roi.second, range.type, range.min, range.max});
+      }
+    }
+  }
+  return params;
+}
+
+class FusedMatchesOpenCvTest
+    : public ::testing::TestWithParam<EquivalenceParam> {};
+
+INSTANTIATE_TEST_SUITE_P(
+    Equivalence, FusedMatchesOpenCvTest,
+    ::testing::ValuesIn(EquivalenceParams()),
+    [](const ::testing::TestParamInfo<EquivalenceParam>& info) {
+      return info.param.name;
+    });
+
+TEST_P(FusedMatchesOpenCvTest, ProducesSameTensor) {
+  const EquivalenceParam& param = GetParam();
+  Packet image = MakeGradientImage(param.format, 64, 48);
+  const Size output_dims = {24, 16};
+  auto fused = CreateFusedCpuConverter(nullptr, param.type).ValueOrDie();
+  auto opencv = CreateOpenCvConverter(nullptr, param.type).ValueOrDie();
+  auto fused_tensor = fused->Convert(image, param.roi, output_dims,
+                                     param.range_min, param.range_max);
+  auto opencv_tensor = opencv->Convert(image, param.roi, output_dims,
+                                       param.range_min, param.range_max);
+  MP_ASSERT_OK(fused_tensor.status());
+  MP_ASSERT_OK(opencv_tensor.status());
+  const std::vector<float> fused_values =
+      TensorValues(fused_tensor.ValueOrDie(), param.type);
+  const std::vector<float> opencv_values =
+      TensorValues(opencv_tensor.ValueOrDie(), param.type);
+  ASSERT_EQ(opencv_values.size(), fused_values.size());
+  // The OpenCV converter interpolates in fixed point and rounds to 8 bits
+  // before converting the range, which puts it within a level of the fused
+  // converter. Integer tensors are rounded once more by each converter.
+  const float level = (param.range_max - param.range_min) / 255.0f;
+  const float tolerance =
+      param.type == Tensor::ElementType::kFloat32 ? level : 1.0f;
+  for (int i = 0; i < fused_values.size(); ++i) {
+    EXPECT_NEAR(opencv_values[i], fused_values[i], tolerance) << i;
+  }
+}
+
+// Returns a 4x2 YUV image of a single color, with the chroma layout of
+// "fourcc".
+Packet MakeYuvImage(libyuv::FourCC fourcc, uint8 y, uint8 u, uint8 v,
+                    bool full_range = true) {
+  constexpr int kWidth = 4;
+  constexpr int kHeight = 2;
+  auto luma = absl::make_unique<uint8[]>(kWidth * kHeight);
+  std::fill_n(luma.get(), kWidth * kHeight, y);
+  // One row of two chroma samples, interleaved or in separate planes.
+  auto chroma = absl::make_unique<uint8[]>(4);
+  uint8* chroma1 = chroma.get();
+  uint8* chroma2 = nullptr;
+  switch (fourcc) {
+    case libyuv::FOURCC_NV12:
+      std::copy_n(std::array<uint8, 4>{u, v, u, v}.data(), 4, chroma1);
+      break;
+    case libyuv::FOURCC_NV21:
+      std::copy_n(std::array<uint8, 4>{v, u, v, u}.data(), 4, chroma1);
+      break;
+    case libyuv::FOURCC_YV12:
+      std::copy_n(std::array<uint8, 4>{v, v, u, u}.data(), 4, chroma1);
+      chroma2 = chroma1 + 2;
+      break;
+    default:
+      std::copy_n(std::array<uint8, 4>{u, u, v, v}.data(), 4, chroma1);
+      chroma2 = chroma1 + 2;
+      break;
+  }
+  const int chroma_stride = chroma2 ? 2 : 4;
+  auto image = absl::make_unique<YUVImage>();
+  uint8* luma_data = luma.release();
+  uint8* chroma_data = chroma.release();
+  image->Initialize(
+      fourcc,
+      [luma_data, chroma_data]() {
+        delete[] luma_data;
+        delete[] chroma_data;
+      },
+      luma_data, kWidth, chroma1, chroma_stride, chroma2, chroma_stride, kWidth,
+      kHeight);
+  image->set_full_range(full_range);
+  return Adopt(image.release());
+}
+
+TEST(ImageToTensorConverterFusedTest, ConvertsYuvToRgb) {
+  // BT.601 full range YCbCr of RGB (200, 100, 50).
+  constexpr uint8 kY = 124;
+  constexpr uint8 kU = 86;
+  constexpr uint8 kV = 182;
+  RotatedRect roi{/*center_x=*/2.0f, /*center_y=*/1.0f, /*width=*/4.0f,
+                  /*height=*/2.0f, /*rotation=*/0.0f};
+  for (libyuv::FourCC fourcc : {libyuv::FOURCC_I420, libyuv::FOURCC_YV12,
+                                libyuv::FOURCC_NV12, libyuv::FOURCC_NV21}) {
+    std::vector<float> values = ConvertImage<float>(
+        MakeYuvImage(fourcc, kY, kU, kV), roi, {2, 1}, 0.0f, 255.0f,
+        Tensor::ElementType::kFloat32);
+    for (int x = 0; x < 2; ++x) {
+      EXPECT_NEAR(200.0f, values[x * 3 + 0], 1.5f) << fourcc;
+      EXPECT_NEAR(100.0f, values[x * 3 + 1], 1.5f) << fourcc;
+      EXPECT_NEAR(50.0f, values[x * 3 + 2], 1.5f) << fourcc;
+    }
+  }
+}
+
+TEST(ImageToTensorConverterFusedTest, ConvertsLimitedRangeYuv) {
+  Packet image = MakeYuvImage(libyuv::FOURCC_NV12, 235, 128, 128,
+                              /*full_range=*/false);
+  RotatedRect roi{/*center_x=*/2.0f, /*center_y=*/1.0f, /*width=*/4.0f,
+                  /*height=*/2.0f, /*rotation=*/0.0f};
+  std::vector<uint8_t> values = ConvertImage<uint8_t>(
+      image, roi, {4, 2}, 0.0f, 255.0f, Tensor::ElementType::kUInt8);
+  EXPECT_THAT(values, testing::Each(255));
+}
+
+TEST(ImageToTensorConverterFusedTest, RejectsUnsupportedYuvLayout) {
+  Packet image = MakeYuvImage(libyuv::FOURCC_ANY, 0, 0, 0);
+  auto converter =
+      CreateFusedCpuConverter(nullptr, Tensor::ElementType::kFloat32)
+          .ValueOrDie();
+  RotatedRect roi{2.0f, 1.0f, 4.0f, 2.0f, 0.0f};
+  EXPECT_FALSE(converter->Convert(image, roi, {2, 1}, 0.0f, 1.0f).ok());
+}
+
+// Converts a centered, slightly rotated ROI of a 640x480 RGBA image to a
+// float tensor of the size given by the first argument, with the OpenCV
+// (second argument 0) or the fused (1) converter.
+void BM_Convert(benchmark::State& state) {
+  const int size = state.range(0);
+  auto converter =
+      (state.range(1) ? CreateFusedCpuConverter(nullptr,
+                                                Tensor::ElementType::kFloat32)
+                      : CreateOpenCvConverter(nullptr,
+                                              Tensor::ElementType::kFloat32))
+          .ValueOrDie();
+  Packet image = MakeGradientImage(ImageFormat::SRGBA, 640, 480);
+  const RotatedRect roi{320.0f, 240.0f, 400.0f, 400.0f, 0.1f};
+  for (auto _ : state) {
+    auto tensor = converter->Convert(image, roi, {size, size}, -1.0f, 1.0f);
+    benchmark::DoNotOptimize(tensor);
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_Convert)
+    ->ArgNames({"size", "fused"})
+    ->ArgsProduct({{128, 192, 256}, {0, 1}});
+
+}  // namespace
+}  // namespace mediapipe
@@ -27,6 +27,7 @@
 #include "mediapipe/framework/port/canonical_errors.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/statusor.h"
 
 namespace mediapipe {
@@ -35,6 +36,21 @@ namespace {
 
 class OpenCvProcessor : public ImageToTensorConverter {
  public:
+  explicit OpenCvProcessor(Tensor::ElementType tensor_type)
+      : tensor_type_(tensor_type) {
+    switch (tensor_type_) {
+      case Tensor::ElementType::kUInt8:
+        mat_type_ = CV_8UC3;
+        break;
+      case Tensor::ElementType::kInt8:
+        mat_type_ = CV_8SC3;
+        break;
+      default:
+        mat_type_ = CV_32FC3;
+        break;
+    }
+  }
+
   Size GetImageSize(const Packet& image_packet) override {
     const auto& image = image_packet.Get<mediapipe::ImageFrame>();
     return {image.Width(), image.Height()};
@@ -56,11 +72,11 @@ class OpenCvProcessor : public ImageToTensorConverter {
 
     constexpr int kNumChannels = 3;
     Tensor tensor(
-        Tensor::ElementType::kFloat32,
+        tensor_type_,
         Tensor::Shape{1, output_dims.height, output_dims.width, kNumChannels});
     auto buffer_view = tensor.GetCpuWriteView();
-    cv::Mat dst(output_dims.height, output_dims.width, CV_32FC3,
-                buffer_view.buffer<float>());
+    cv::Mat dst(output_dims.height, output_dims.width, mat_type_,
+                buffer_view.buffer<void>());
 
     const cv::RotatedRect rotated_rect(cv::Point2f(roi.center_x, roi.center_y),
                                        cv::Size2f(roi.width, roi.height),
@@ -80,6 +96,25 @@ class OpenCvProcessor : public ImageToTensorConverter {
     cv::Mat dst_points = cv::Mat(4, 2, CV_32F, dst_corners);
     cv::Mat projection_matrix =
         cv::getPerspectiveTransform(src_points, dst_points);
+
+    constexpr float kInputImageRangeMin = 0.0f;
+    constexpr float kInputImageRangeMax = 255.0f;
+    ASSIGN_OR_RETURN(
+        auto transform,
+        GetValueRangeTransformation(kInputImageRangeMin, kInputImageRangeMax,
+                                    range_min, range_max));
+
+    // An RGB image extracted into a uint8 tensor with the full [0, 255] range
+    // needs no conversion, so warp it directly into the tensor.
+    if (mat_type_ == CV_8UC3 && src.channels() == kNumChannels &&
+        transform.scale == 1.0f && transform.offset == 0.0f) {
+      cv::warpPerspective(src, dst, projection_matrix,
+                          cv::Size(dst_width, dst_height),
+                          /*flags=*/cv::INTER_LINEAR,
+                          /*borderMode=*/cv::BORDER_REPLICATE);
+      return tensor;
+    }
+
     cv::Mat transformed;
     cv::warpPerspective(src, transformed, projection_matrix,
                         cv::Size(dst_width, dst_height),
@@ -92,25 +127,27 @@ class OpenCvProcessor : public ImageToTensorConverter {
       transformed = proper_channels_mat;
     }
 
-    constexpr float kInputImageRangeMin = 0.0f;
-    constexpr float kInputImageRangeMax = 255.0f;
-    ASSIGN_OR_RETURN(
-        auto transform,
-        GetValueRangeTransformation(kInputImageRangeMin, kInputImageRangeMax,
-                                    range_min, range_max));
-    transformed.convertTo(dst, CV_32FC3, transform.scale, transform.offset);
+    transformed.convertTo(dst, mat_type_, transform.scale, transform.offset);
     return tensor;
   }
+
+ private:
+  const Tensor::ElementType tensor_type_;
+  int mat_type_;
 };
 
 }  // namespace
 
 ::mediapipe::StatusOr<std::unique_ptr<ImageToTensorConverter>>
-CreateOpenCvConverter(CalculatorContext* cc) {
+CreateOpenCvConverter(CalculatorContext* cc, Tensor::ElementType tensor_type) {
+  RET_CHECK(tensor_type == Tensor::ElementType::kFloat32 ||
+            tensor_type == Tensor::ElementType::kUInt8 ||
+            tensor_type == Tensor::ElementType::kInt8)
+      << "Unsupported tensor type: " << static_cast<int>(tensor_type);
   // Simply "return absl::make_unique<OpenCvProcessor>()" failed to build on
   // macOS with bazel.
   return std::unique_ptr<ImageToTensorConverter>(
-      absl::make_unique<OpenCvProcessor>());
+      absl::make_unique<OpenCvProcessor>(tensor_type));
 }
 
 }  // namespace mediapipe
@@ -19,13 +19,15 @@
 
 #include "mediapipe/calculators/tensor/image_to_tensor_converter.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/tensor.h"
 #include "mediapipe/framework/port/statusor.h"
 
 namespace mediapipe {
 
-// Creates OpenCV image-to-tensor converter.
+// Creates OpenCV image-to-tensor converter. The converter outputs tensors of
+// "tensor_type", which must be kFloat32, kUInt8 or kInt8.
 ::mediapipe::StatusOr<std::unique_ptr<ImageToTensorConverter>>
-CreateOpenCvConverter(CalculatorContext* cc);
+CreateOpenCvConverter(CalculatorContext* cc, Tensor::ElementType tensor_type);
 
 }  // namespace mediapipe
 
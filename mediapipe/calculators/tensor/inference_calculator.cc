@@ -12,16 +12,23 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdint>
 #include <cstring>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
 #include "mediapipe/calculators/tensor/inference_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/deps/clock.h"
+#include "mediapipe/framework/deps/monotonic_clock.h"
 #include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/tensor_buffer_pool.h"
 #include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_macros.h"
 #include "mediapipe/util/tflite/config.h"
 
 #if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
@@ -29,6 +36,7 @@
 #endif  // !__EMSCRIPTEN__ || __EMSCRIPTEN_PTHREADS__
 
 #include "mediapipe/util/resource_util.h"
+#include "mediapipe/util/tflite/tflite_model_pool.h"
 #include "tensorflow/lite/error_reporter.h"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/kernels/register.h"
@@ -88,6 +96,7 @@ bool ShouldUseGpu(const mediapipe::InferenceCalculatorOptions& options) {
 }
 
 constexpr char kTensorsTag[] = "TENSORS";
+constexpr char kBatchEndTag[] = "BATCH_END";
 }  // namespace
 
 #if defined(MEDIAPIPE_EDGE_TPU)
@@ -114,6 +123,46 @@ std::unique_ptr<tflite::Interpreter> BuildEdgeTpuInterpreter(
 
 namespace mediapipe {
 
+namespace {
+// Returns the Tensor element type that holds the data of a TfLite tensor.
+::mediapipe::StatusOr<Tensor::ElementType> ElementTypeFromTfLiteType(
+    TfLiteType type) {
+  switch (type) {
+    case kTfLiteFloat32:
+      return Tensor::ElementType::kFloat32;
+    case kTfLiteFloat16:
+      return Tensor::ElementType::kFloat16;
+    case kTfLiteUInt8:
+      return Tensor::ElementType::kUInt8;
+    case kTfLiteInt8:
+      return Tensor::ElementType::kInt8;
+    case kTfLiteInt32:
+      return Tensor::ElementType::kInt32;
+    default:
+      return ::mediapipe::InvalidArgumentError(absl::StrCat(
+          "Unsupported TfLite tensor type: ", static_cast<int>(type)));
+  }
+}
+
+Tensor::Shape ShapeFromTfLiteTensor(const TfLiteTensor& tensor) {
+  return Tensor::Shape{std::vector<int>{
+      tensor.dims->data, tensor.dims->data + tensor.dims->size}};
+}
+
+// Returns true if the interpreter can use an external buffer for the tensor
+// instead of its own memory.
+bool CanBindExternalBuffer(const TfLiteTensor& tensor) {
+  return tensor.allocation_type == kTfLiteArenaRw ||
+         tensor.allocation_type == kTfLiteArenaRwPersistent ||
+         tensor.allocation_type == kTfLiteCustom;
+}
+
+bool IsCpuBufferAligned(const void* buffer) {
+  return reinterpret_cast<uintptr_t>(buffer) % Tensor::kCpuBufferAlignment ==
+         0;
+}
+}  // namespace
+
 #if MEDIAPIPE_TFLITE_METAL_INFERENCE
 namespace {
 tflite::gpu::BHWC BhwcFromTensorShape(const Tensor::Shape& shape) {
@@ -182,6 +231,7 @@ int GetXnnpackNumThreads(const mediapipe::InferenceCalculatorOptions& opts) {
 //
 // Input:
 //  TENSORS - Vector of Tensors
+//  BATCH_END (optional) - Timestamp. Flushes the pending batch, see below.
 //
 // Output:
 //  TENSORS - Vector of Tensors
@@ -192,6 +242,8 @@ int GetXnnpackNumThreads(const mediapipe::InferenceCalculatorOptions& opts) {
 //  MODEL (optional) - Use to specify TfLite model
 //                     (std::unique_ptr<tflite::FlatBufferModel,
 //                       std::function<void(tflite::FlatBufferModel*)>>)
+//  CLOCK (optional) - std::shared_ptr<mediapipe::Clock> that times
+//                     max_batch_wait_us. A monotonic clock by default.
 //
 // Example use:
 // node {
@@ -223,6 +275,40 @@ int GetXnnpackNumThreads(const mediapipe::InferenceCalculatorOptions& opts) {
 // IMPORTANT Notes:
 //  Tensors are assumed to be ordered correctly (sequentially added to model).
 //  Input tensors are assumed to be of the correct size and already normalized.
+//
+// Batching:
+//  When max_batch_size is greater than 1, the inputs of consecutive timestamps
+//  are collected and run in a single invocation, and each output is emitted
+//  at the timestamp of its input. The model must have a batch dimension of 1,
+//  which is resized to max_batch_size; smaller batches are padded with zeros.
+//  A batch is run when it is full, when a BATCH_END packet arrives, when an
+//  input or a timestamp bound arrives max_batch_wait_us after the first input
+//  of the batch, or when the calculator is closed. Inside a
+//  BeginLoopCalculator/EndLoopCalculator pair, connect the BATCH_END stream
+//  of the BeginLoopCalculator so that all ROIs of a frame are run together:
+//
+// node {
+//   calculator: "InferenceCalculator"
+//   input_stream: "TENSORS:single_roi_tensors"
+//   input_stream: "BATCH_END:batch_end"
+//   output_stream: "TENSORS:single_roi_output_tensors"
+//   options: {
+//     [mediapipe.InferenceCalculatorOptions.ext] {
+//       model_path: "modelname.tflite"
+//       delegate { xnnpack {} }
+//       max_batch_size: 2
+//     }
+//   }
+// }
+//
+// Parallel inference:
+//  When max_in_flight is greater than 1, the calculator declares that up to
+//  that many timestamps may be processed concurrently, so that a slow model
+//  does not limit the frame rate of the graph to 1 / latency. Each
+//  CalculatorContext builds its own interpreter on first use (or borrows one
+//  from the TfLiteModelPool service, if it is set), and the outputs are
+//  reordered by timestamp by the framework. Each interpreter uses
+//  cpu_num_thread threads, so the total is max_in_flight times that.
 
 class InferenceCalculator : public CalculatorBase {
  public:
@@ -245,6 +331,18 @@ class InferenceCalculator : public CalculatorBase {
   ::mediapipe::StatusOr<Packet> GetModelAsPacket(const CalculatorContext& cc);
   ::mediapipe::Status LoadDelegate(CalculatorContext* cc);
   ::mediapipe::Status InitTFLiteGPURunner(CalculatorContext* cc);
+  ::mediapipe::Status InitZeroCopyCpuTensors(CalculatorContext* cc);
+  ::mediapipe::Status BindCpuOutputs(std::vector<Tensor>* output_tensors);
+  ::mediapipe::Status UnbindCpuTensors();
+  ::mediapipe::Status ProcessBatched(CalculatorContext* cc);
+  bool CanUsePooledInterpreters(CalculatorContext* cc);
+  ::mediapipe::Status InitPooledInterpreters(CalculatorContext* cc);
+  ::mediapipe::Status ProcessPooled(CalculatorContext* cc);
+  ::mediapipe::Status ProcessInParallel(CalculatorContext* cc);
+  ::mediapipe::Status RunCpuInterpreter(
+      CalculatorContext* cc, const std::vector<Tensor>& input_tensors,
+      tflite::Interpreter* interpreter);
+  ::mediapipe::Status RunBatch(CalculatorContext* cc);
 
   Packet model_packet_;
   std::unique_ptr<tflite::Interpreter> interpreter_;
@@ -275,6 +373,47 @@ class InferenceCalculator : public CalculatorBase {
 
   bool use_kernel_caching_ = false;
   std::string cached_kernel_filename_;
+
+  // Zero-copy CPU inference, see use_zero_copy_cpu_tensors in the options.
+  bool use_zero_copy_cpu_tensors_ = false;
+  // Interpreter inputs and outputs that can be bound to tensor buffers.
+  std::vector<bool> bind_inputs_;
+  std::vector<bool> bind_outputs_;
+  // Provides the output tensors, and staging buffers for inputs that can't be
+  // bound as they are.
+  std::unique_ptr<TensorBufferPool> tensor_pool_;
+  // Buffers owned for the life of the interpreter, one per bindable input and
+  // output. The interpreter is pointed back at them after each run, so that it
+  // never refers to the buffer of a released packet.
+  std::vector<Tensor> unbound_inputs_;
+  std::vector<Tensor> unbound_outputs_;
+
+  // Batched CPU inference, see "Batching" above.
+  int max_batch_size_ = 1;
+  absl::Duration max_batch_wait_;
+  // The inputs of the batch, in timestamp order.
+  std::vector<Packet> pending_inputs_;
+  absl::Time batch_start_time_;
+  // Times max_batch_wait_. Unlike absl::Now(), it never goes backward.
+  std::shared_ptr<::mediapipe::Clock> clock_;
+
+  // The pool shared with other graphs, if any. Plain CPU inference borrows an
+  // interpreter from it for each run instead of owning one.
+  TfLiteModelPool* model_pool_ = nullptr;
+  bool use_pooled_interpreters_ = false;
+  std::string pooled_model_path_;
+  TfLiteModelPool::InterpreterOptions pooled_interpreter_options_;
+
+  // Parallel CPU inference, see "Parallel inference" above. Without a model
+  // pool, each CalculatorContext keeps its own ContextInterpreter.
+  struct ContextInterpreter {
+    // Keeps the model alive for as long as the interpreter uses it.
+    Packet model_packet;
+    TfLiteDelegatePtr delegate;
+    std::unique_ptr<tflite::Interpreter> interpreter;
+  };
+  bool run_in_parallel_ = false;
+  tflite::ops::builtin::BuiltinOpResolver op_resolver_;
 };
 REGISTER_CALCULATOR(InferenceCalculator);
 
@@ -283,8 +422,26 @@ REGISTER_CALCULATOR(InferenceCalculator);
   cc->Inputs().Tag(kTensorsTag).Set<std::vector<Tensor>>();
   RET_CHECK(cc->Outputs().HasTag(kTensorsTag));
   cc->Outputs().Tag(kTensorsTag).Set<std::vector<Tensor>>();
+  if (cc->Inputs().HasTag(kBatchEndTag)) {
+    cc->Inputs().Tag(kBatchEndTag).Set<Timestamp>();
+  }
+  cc->UseService(kTfLiteModelPoolService).Optional();
 
   const auto& options = cc->Options<::mediapipe::InferenceCalculatorOptions>();
+  RET_CHECK_GE(options.max_batch_size(), 1);
+  RET_CHECK_GE(options.max_in_flight(), 1);
+  if (options.max_in_flight() > 1) {
+    RET_CHECK(!ShouldUseGpu(options) && options.max_batch_size() == 1 &&
+              !options.use_zero_copy_cpu_tensors())
+        << "Parallel inference is only supported for CPU inference without "
+           "batching or zero-copy tensors.";
+    cc->SetMaxInFlight(options.max_in_flight());
+  }
+  if (options.max_batch_size() > 1 && options.max_batch_wait_us() > 0) {
+    // Timestamp bounds also run Process, so that an expired batch is run even
+    // when no more inputs arrive.
+    cc->SetProcessTimestampBounds(true);
+  }
   RET_CHECK(!options.model_path().empty() ^
             cc->InputSidePackets().HasTag("MODEL"))
       << "Either model as side packet or model path in options is required.";
@@ -297,6 +454,11 @@ REGISTER_CALCULATOR(InferenceCalculator);
   if (cc->InputSidePackets().HasTag("MODEL")) {
     cc->InputSidePackets().Tag("MODEL").Set<TfLiteModelPtr>();
   }
+  if (cc->InputSidePackets().HasTag("CLOCK")) {
+    cc->InputSidePackets()
+        .Tag("CLOCK")
+        .Set<std::shared_ptr<::mediapipe::Clock>>();
+  }
 
   if (ShouldUseGpu(options)) {
 #if MEDIAPIPE_TFLITE_GL_INFERENCE
@@ -309,10 +471,22 @@ REGISTER_CALCULATOR(InferenceCalculator);
 }
 
 ::mediapipe::Status InferenceCalculator::Open(CalculatorContext* cc) {
-  cc->SetOffset(TimestampDiff(0));
+  const auto& options = cc->Options<::mediapipe::InferenceCalculatorOptions>();
+  max_batch_size_ = options.max_batch_size();
+  max_batch_wait_ = absl::Microseconds(options.max_batch_wait_us());
+  // Batched outputs are emitted after later inputs have arrived.
+  if (max_batch_size_ == 1) {
+    cc->SetOffset(TimestampDiff(0));
+  } else if (cc->InputSidePackets().HasTag("CLOCK")) {
+    clock_ = cc->InputSidePackets()
+                 .Tag("CLOCK")
+                 .Get<std::shared_ptr<::mediapipe::Clock>>();
+  } else {
+    clock_.reset(
+        ::mediapipe::MonotonicClock::CreateSynchronizedMonotonicClock());
+  }
 
 #if MEDIAPIPE_TFLITE_GL_INFERENCE || MEDIAPIPE_TFLITE_METAL_INFERENCE
-  const auto& options = cc->Options<::mediapipe::InferenceCalculatorOptions>();
   if (ShouldUseGpu(options)) {
 #if MEDIAPIPE_TFLITE_GL_INFERENCE
     use_advanced_gpu_api_ = options.has_delegate() &&
@@ -332,6 +506,36 @@ REGISTER_CALCULATOR(InferenceCalculator);
 #endif  // MEDIAPIPE_TFLITE_GL_INFERENCE && MEDIAPIPE_ANDROID
   }
 
+  RET_CHECK(max_batch_size_ == 1 ||
+            (!use_gpu_delegate_ && !use_advanced_gpu_api_ &&
+             !options.use_zero_copy_cpu_tensors()))
+      << "Batching is only supported for CPU inference without zero-copy "
+         "tensors.";
+
+  if (cc->Service(kTfLiteModelPoolService).IsAvailable()) {
+    model_pool_ = &cc->Service(kTfLiteModelPoolService).GetObject();
+  }
+  if (model_pool_ && CanUsePooledInterpreters(cc)) {
+    return InitPooledInterpreters(cc);
+  }
+
+  if (options.max_in_flight() > 1) {
+#if defined(MEDIAPIPE_EDGE_TPU)
+    return ::mediapipe::UnimplementedError(
+        "Parallel inference is not supported with Edge TPU.");
+#else
+    // The interpreters are built by the contexts that run them.
+    ASSIGN_OR_RETURN(model_packet_, GetModelAsPacket(*cc));
+    if (cc->InputSidePackets().HasTag("CUSTOM_OP_RESOLVER")) {
+      op_resolver_ = cc->InputSidePackets()
+                         .Tag("CUSTOM_OP_RESOLVER")
+                         .Get<tflite::ops::builtin::BuiltinOpResolver>();
+    }
+    run_in_parallel_ = true;
+    return ::mediapipe::OkStatus();
+#endif  // MEDIAPIPE_EDGE_TPU
+  }
+
   // When use_advanced_gpu_api_, model loading is handled in InitTFLiteGPURunner
   // for everything.
   if (!use_advanced_gpu_api_) {
@@ -353,11 +557,21 @@ REGISTER_CALCULATOR(InferenceCalculator);
 #endif
   } else {
     MP_RETURN_IF_ERROR(LoadDelegate(cc));
+    MP_RETURN_IF_ERROR(InitZeroCopyCpuTensors(cc));
   }
   return ::mediapipe::OkStatus();
 }
 
 ::mediapipe::Status InferenceCalculator::Process(CalculatorContext* cc) {
+  if (max_batch_size_ > 1) {
+    return ProcessBatched(cc);
+  }
+  if (use_pooled_interpreters_) {
+    return ProcessPooled(cc);
+  }
+  if (run_in_parallel_) {
+    return ProcessInParallel(cc);
+  }
   if (cc->Inputs().Tag(kTensorsTag).IsEmpty()) {
     return ::mediapipe::OkStatus();
   }
@@ -365,6 +579,8 @@ REGISTER_CALCULATOR(InferenceCalculator);
       cc->Inputs().Tag(kTensorsTag).Get<std::vector<Tensor>>();
   RET_CHECK(!input_tensors.empty());
   auto output_tensors = absl::make_unique<std::vector<Tensor>>();
+  // Inputs copied for zero-copy CPU inference, see below.
+  std::vector<Tensor> staged_inputs;
 
   if (use_gpu_delegate_ || use_advanced_gpu_api_) {
 #if MEDIAPIPE_TFLITE_GL_INFERENCE
@@ -421,14 +637,55 @@ REGISTER_CALCULATOR(InferenceCalculator);
     [command_buffer commit];
 #endif  // MEDIAPIPE_TFLITE_GL_INFERENCE
   } else {
-    // Read CPU input into tensors.
+    // Read CPU input into tensors. Inputs are copied once all buffers are
+    // bound, as AllocateTensors() may move the interpreter's own buffers.
+    std::vector<int> copied_inputs;
     for (int i = 0; i < input_tensors.size(); ++i) {
       const Tensor* input_tensor = &input_tensors[i];
+      TfLiteTensor* local_tensor = interpreter_->input_tensor(i);
+      ASSIGN_OR_RETURN(auto local_element_type,
+                       ElementTypeFromTfLiteType(local_tensor->type));
+      RET_CHECK(input_tensor->element_type() == local_element_type)
+          << "Input tensor " << i << " has type "
+          << static_cast<int>(input_tensor->element_type())
+          << ", but the model expects " << static_cast<int>(local_element_type);
+      RET_CHECK_LE(input_tensor->bytes(), local_tensor->bytes);
+      if (!use_zero_copy_cpu_tensors_ || !bind_inputs_[i]) {
+        copied_inputs.push_back(i);
+        continue;
+      }
       auto input_tensor_view = input_tensor->GetCpuReadView();
-      auto input_tensor_buffer = input_tensor_view.buffer<float>();
-      float* local_tensor_buffer = interpreter_->typed_input_tensor<float>(i);
-      std::memcpy(local_tensor_buffer, input_tensor_buffer,
-                  input_tensor->bytes());
+      const void* buffer = input_tensor_view.buffer<void>();
+      // The input packet keeps the buffer alive while the interpreter reads
+      // it. The view isn't held for that long, so that other calculators
+      // can read the tensor concurrently.
+      if (input_tensor->bytes() != local_tensor->bytes ||
+          !IsCpuBufferAligned(buffer)) {
+        // A buffer of another size or alignment can't be bound, so the input
+        // is staged in one that can.
+        staged_inputs.push_back(tensor_pool_->GetTensor(
+            Tensor::ElementType::kUInt8,
+            Tensor::Shape{static_cast<int>(local_tensor->bytes)}));
+        auto staged_view = staged_inputs.back().GetCpuWriteView();
+        std::memcpy(staged_view.buffer<void>(), buffer, input_tensor->bytes());
+        buffer = staged_view.buffer<void>();
+      }
+      TfLiteCustomAllocation allocation{const_cast<void*>(buffer),
+                                        local_tensor->bytes};
+      RET_CHECK_EQ(interpreter_->SetCustomAllocationForTensor(
+                       interpreter_->inputs()[i], allocation),
+                   kTfLiteOk);
+    }
+    if (use_zero_copy_cpu_tensors_) {
+      MP_RETURN_IF_ERROR(BindCpuOutputs(output_tensors.get()));
+      // Custom allocations take effect on AllocateTensors(), which is cheap
+      // when the tensor sizes don't change.
+      RET_CHECK_EQ(interpreter_->AllocateTensors(), kTfLiteOk);
+    }
+    for (int i : copied_inputs) {
+      auto input_tensor_view = input_tensors[i].GetCpuReadView();
+      std::memcpy(interpreter_->input_tensor(i)->data.raw,
+                  input_tensor_view.buffer<void>(), input_tensors[i].bytes());
     }
   }
 
@@ -442,6 +699,9 @@ REGISTER_CALCULATOR(InferenceCalculator);
 #else
   RET_CHECK_EQ(interpreter_->Invoke(), kTfLiteOk);
 #endif  // MEDIAPIPE_TFLITE_GL_INFERENCE
+  if (use_zero_copy_cpu_tensors_) {
+    MP_RETURN_IF_ERROR(UnbindCpuTensors());
+  }
 
   if (use_gpu_delegate_ || use_advanced_gpu_api_) {
 #if MEDIAPIPE_TFLITE_GL_INFERENCE
@@ -493,14 +753,30 @@ REGISTER_CALCULATOR(InferenceCalculator);
     const auto& tensor_indexes = interpreter_->outputs();
     output_tensors->reserve(tensor_indexes.size());
     for (int i = 0; i < tensor_indexes.size(); ++i) {
+      if (use_zero_copy_cpu_tensors_ && bind_outputs_[i]) {
+        // The interpreter has written the output tensor directly.
+        continue;
+      }
       TfLiteTensor* tensor = interpreter_->tensor(tensor_indexes[i]);
-      output_tensors->emplace_back(
-          Tensor::ElementType::kFloat32,
-          Tensor::Shape{std::vector<int>{
-              tensor->dims->data, tensor->dims->data + tensor->dims->size}});
-      auto cpu_view = output_tensors->back().GetCpuWriteView();
-      std::memcpy(cpu_view.buffer<float>(), tensor->data.f,
-                  output_tensors->back().bytes());
+      ASSIGN_OR_RETURN(auto element_type,
+                       ElementTypeFromTfLiteType(tensor->type));
+      // Quantized outputs keep their integer data, along with the parameters
+      // needed to dequantize it.
+      const Tensor::QuantizationParameters quantization_parameters(
+          tensor->params.scale, tensor->params.zero_point);
+      if (use_zero_copy_cpu_tensors_) {
+        (*output_tensors)[i] = tensor_pool_->GetTensor(
+            element_type, ShapeFromTfLiteTensor(*tensor),
+            quantization_parameters);
+      } else {
+        output_tensors->emplace_back(element_type,
+                                     ShapeFromTfLiteTensor(*tensor),
+                                     quantization_parameters);
+      }
+      Tensor& output_tensor = (*output_tensors)[i];
+      auto cpu_view = output_tensor.GetCpuWriteView();
+      std::memcpy(cpu_view.buffer<void>(), tensor->data.raw,
+                  output_tensor.bytes());
     }
   }
   cc->Outputs()
@@ -509,6 +785,231 @@ REGISTER_CALCULATOR(InferenceCalculator);
   return ::mediapipe::OkStatus();
 }
 
+bool InferenceCalculator::CanUsePooledInterpreters(CalculatorContext* cc) {
+#if defined(MEDIAPIPE_EDGE_TPU)
+  return false;
+#else
+  const auto& options = cc->Options<mediapipe::InferenceCalculatorOptions>();
+  // Interpreters are shared by model path, and are built with the builtin op
+  // resolver. Batching and zero-copy tensors rely on interpreter state kept
+  // between runs.
+  if (options.model_path().empty() || use_gpu_delegate_ ||
+      use_advanced_gpu_api_ || max_batch_size_ > 1 ||
+      options.use_zero_copy_cpu_tensors() ||
+      cc->InputSidePackets().HasTag("CUSTOM_OP_RESOLVER")) {
+    return false;
+  }
+#if defined(MEDIAPIPE_ANDROID)
+  const bool nnapi_requested = options.has_delegate()
+                                   ? options.delegate().has_nnapi()
+                                   : options.use_nnapi();
+  if (nnapi_requested) {
+    return false;
+  }
+#endif  // MEDIAPIPE_ANDROID
+  return true;
+#endif  // MEDIAPIPE_EDGE_TPU
+}
+
+::mediapipe::Status InferenceCalculator::InitPooledInterpreters(
+    CalculatorContext* cc) {
+  const auto& options = cc->Options<mediapipe::InferenceCalculatorOptions>();
+  pooled_model_path_ = options.model_path();
+#if defined(__EMSCRIPTEN__)
+  pooled_interpreter_options_.use_xnnpack = true;
+#else
+  pooled_interpreter_options_.use_xnnpack =
+      options.has_delegate() && options.delegate().has_xnnpack();
+#endif  // __EMSCRIPTEN__
+  pooled_interpreter_options_.num_threads =
+      pooled_interpreter_options_.use_xnnpack ? GetXnnpackNumThreads(options)
+                                              : options.cpu_num_thread();
+  use_pooled_interpreters_ = true;
+  // Load the model now, so that a bad model fails the graph on start.
+  return model_pool_->GetModel(pooled_model_path_).status();
+}
+
+::mediapipe::Status InferenceCalculator::ProcessPooled(CalculatorContext* cc) {
+  if (cc->Inputs().Tag(kTensorsTag).IsEmpty()) {
+    return ::mediapipe::OkStatus();
+  }
+  const auto& input_tensors =
+      cc->Inputs().Tag(kTensorsTag).Get<std::vector<Tensor>>();
+  RET_CHECK(!input_tensors.empty());
+  // The interpreter goes back to the pool when this returns.
+  ASSIGN_OR_RETURN(auto interpreter,
+                   model_pool_->AcquireInterpreter(
+                       pooled_model_path_, pooled_interpreter_options_));
+  return RunCpuInterpreter(cc, input_tensors, interpreter.get());
+}
+
+::mediapipe::Status InferenceCalculator::ProcessInParallel(
+    CalculatorContext* cc) {
+  if (cc->Inputs().Tag(kTensorsTag).IsEmpty()) {
+    return ::mediapipe::OkStatus();
+  }
+  const auto& input_tensors =
+      cc->Inputs().Tag(kTensorsTag).Get<std::vector<Tensor>>();
+  RET_CHECK(!input_tensors.empty());
+  ContextInterpreter* state = cc->ContextState<ContextInterpreter>();
+  if (state == nullptr) {
+#if !defined(MEDIAPIPE_EDGE_TPU)
+    const auto& options = cc->Options<mediapipe::InferenceCalculatorOptions>();
+    auto new_state = absl::make_unique<ContextInterpreter>();
+    new_state->model_packet = model_packet_;
+    tflite::InterpreterBuilder(*model_packet_.Get<TfLiteModelPtr>(),
+                               op_resolver_)(&new_state->interpreter);
+    RET_CHECK(new_state->interpreter);
+#if defined(__EMSCRIPTEN__)
+    new_state->interpreter->SetNumThreads(1);
+    const bool xnnpack_requested = true;
+#else
+    new_state->interpreter->SetNumThreads(options.cpu_num_thread());
+    const bool xnnpack_requested =
+        options.has_delegate() && options.delegate().has_xnnpack();
+#endif  // __EMSCRIPTEN__
+    if (xnnpack_requested) {
+      TfLiteXNNPackDelegateOptions xnnpack_opts{};
+      xnnpack_opts.num_threads = GetXnnpackNumThreads(options);
+      new_state->delegate =
+          TfLiteDelegatePtr(TfLiteXNNPackDelegateCreate(&xnnpack_opts),
+                            &TfLiteXNNPackDelegateDelete);
+      RET_CHECK_EQ(new_state->interpreter->ModifyGraphWithDelegate(
+                       new_state->delegate.get()),
+                   kTfLiteOk);
+    }
+    RET_CHECK_EQ(new_state->interpreter->AllocateTensors(), kTfLiteOk);
+    cc->SetContextState(std::move(new_state));
+    state = cc->ContextState<ContextInterpreter>();
+#endif  // !MEDIAPIPE_EDGE_TPU
+  }
+  RET_CHECK(state);
+  return RunCpuInterpreter(cc, input_tensors, state->interpreter.get());
+}
+
+// Copies the inputs into "interpreter", runs it, and emits a copy of its
+// outputs. Used when the interpreter is not owned by the calculator.
+::mediapipe::Status InferenceCalculator::RunCpuInterpreter(
+    CalculatorContext* cc, const std::vector<Tensor>& input_tensors,
+    tflite::Interpreter* interpreter) {
+  RET_CHECK_EQ(input_tensors.size(), interpreter->inputs().size());
+  for (int i = 0; i < input_tensors.size(); ++i) {
+    const Tensor& input_tensor = input_tensors[i];
+    TfLiteTensor* local_tensor = interpreter->input_tensor(i);
+    ASSIGN_OR_RETURN(auto local_element_type,
+                     ElementTypeFromTfLiteType(local_tensor->type));
+    RET_CHECK(input_tensor.element_type() == local_element_type);
+    RET_CHECK_LE(input_tensor.bytes(), local_tensor->bytes);
+    auto input_tensor_view = input_tensor.GetCpuReadView();
+    std::memcpy(local_tensor->data.raw, input_tensor_view.buffer<void>(),
+                input_tensor.bytes());
+  }
+
+  RET_CHECK_EQ(interpreter->Invoke(), kTfLiteOk);
+
+  auto output_tensors = absl::make_unique<std::vector<Tensor>>();
+  output_tensors->reserve(interpreter->outputs().size());
+  for (int index : interpreter->outputs()) {
+    const TfLiteTensor* tensor = interpreter->tensor(index);
+    ASSIGN_OR_RETURN(auto element_type,
+                     ElementTypeFromTfLiteType(tensor->type));
+    output_tensors->emplace_back(
+        element_type, ShapeFromTfLiteTensor(*tensor),
+        Tensor::QuantizationParameters(tensor->params.scale,
+                                       tensor->params.zero_point));
+    auto cpu_view = output_tensors->back().GetCpuWriteView();
+    std::memcpy(cpu_view.buffer<void>(), tensor->data.raw,
+                output_tensors->back().bytes());
+  }
+  cc->Outputs()
+      .Tag(kTensorsTag)
+      .Add(output_tensors.release(), cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status InferenceCalculator::ProcessBatched(CalculatorContext* cc) {
+  if (!cc->Inputs().Tag(kTensorsTag).IsEmpty()) {
+    if (pending_inputs_.empty()) {
+      batch_start_time_ = clock_->TimeNow();
+    }
+    pending_inputs_.push_back(cc->Inputs().Tag(kTensorsTag).Value());
+  }
+  const bool batch_end = cc->Inputs().HasTag(kBatchEndTag) &&
+                         !cc->Inputs().Tag(kBatchEndTag).IsEmpty();
+  const bool batch_expired =
+      max_batch_wait_ > absl::ZeroDuration() && !pending_inputs_.empty() &&
+      clock_->TimeNow() - batch_start_time_ >= max_batch_wait_;
+  if (pending_inputs_.size() >= max_batch_size_ || batch_end ||
+      batch_expired) {
+    return RunBatch(cc);
+  }
+  return ::mediapipe::OkStatus();
+}
+
+// Gathers the pending inputs into the batched input tensors, runs the
+// interpreter, and scatters the batched outputs to the input timestamps.
+::mediapipe::Status InferenceCalculator::RunBatch(CalculatorContext* cc) {
+  if (pending_inputs_.empty()) {
+    return ::mediapipe::OkStatus();
+  }
+  const int batch_size = pending_inputs_.size();
+  const auto& input_indexes = interpreter_->inputs();
+  for (int i = 0; i < input_indexes.size(); ++i) {
+    TfLiteTensor* local_tensor = interpreter_->tensor(input_indexes[i]);
+    ASSIGN_OR_RETURN(auto local_element_type,
+                     ElementTypeFromTfLiteType(local_tensor->type));
+    const int item_bytes = local_tensor->bytes / max_batch_size_;
+    for (int b = 0; b < batch_size; ++b) {
+      const auto& input_tensors =
+          pending_inputs_[b].Get<std::vector<Tensor>>();
+      RET_CHECK_EQ(input_tensors.size(), input_indexes.size());
+      const Tensor& input_tensor = input_tensors[i];
+      RET_CHECK(input_tensor.element_type() == local_element_type);
+      RET_CHECK_EQ(input_tensor.bytes(), item_bytes);
+      auto input_tensor_view = input_tensor.GetCpuReadView();
+      std::memcpy(local_tensor->data.raw + b * item_bytes,
+                  input_tensor_view.buffer<void>(), item_bytes);
+    }
+    // The padding of a partial batch would otherwise hold stale inputs.
+    std::memset(local_tensor->data.raw + batch_size * item_bytes, 0,
+                (max_batch_size_ - batch_size) * item_bytes);
+  }
+
+  RET_CHECK_EQ(interpreter_->Invoke(), kTfLiteOk);
+
+  std::vector<std::unique_ptr<std::vector<Tensor>>> output_tensors(batch_size);
+  for (auto& tensors : output_tensors) {
+    tensors = absl::make_unique<std::vector<Tensor>>();
+  }
+  for (int index : interpreter_->outputs()) {
+    const TfLiteTensor* tensor = interpreter_->tensor(index);
+    ASSIGN_OR_RETURN(auto element_type,
+                     ElementTypeFromTfLiteType(tensor->type));
+    Tensor::Shape item_shape = ShapeFromTfLiteTensor(*tensor);
+    RET_CHECK(!item_shape.dims.empty() &&
+              item_shape.dims[0] == max_batch_size_)
+        << "Batched outputs must have a batch dimension.";
+    item_shape.dims[0] = 1;
+    const int item_bytes = tensor->bytes / max_batch_size_;
+    for (int b = 0; b < batch_size; ++b) {
+      output_tensors[b]->emplace_back(
+          element_type, item_shape,
+          Tensor::QuantizationParameters(tensor->params.scale,
+                                         tensor->params.zero_point));
+      auto cpu_view = output_tensors[b]->back().GetCpuWriteView();
+      std::memcpy(cpu_view.buffer<void>(), tensor->data.raw + b * item_bytes,
+                  item_bytes);
+    }
+  }
+  for (int b = 0; b < batch_size; ++b) {
+    cc->Outputs()
+        .Tag(kTensorsTag)
+        .Add(output_tensors[b].release(), pending_inputs_[b].Timestamp());
+  }
+  pending_inputs_.clear();
+  return ::mediapipe::OkStatus();
+}
+
 ::mediapipe::Status InferenceCalculator::WriteKernelsToFile() {
 #if MEDIAPIPE_TFLITE_GL_INFERENCE && defined(MEDIAPIPE_ANDROID)
   if (use_kernel_caching_) {
@@ -524,6 +1025,10 @@ REGISTER_CALCULATOR(InferenceCalculator);
 }
 
 ::mediapipe::Status InferenceCalculator::Close(CalculatorContext* cc) {
+  // Run the last inputs, unless the graph is failing.
+  if (cc->GraphStatus().ok()) {
+    MP_RETURN_IF_ERROR(RunBatch(cc));
+  }
   MP_RETURN_IF_ERROR(WriteKernelsToFile());
 #if MEDIAPIPE_TFLITE_GL_INFERENCE
   if (use_gpu_delegate_) {
@@ -604,6 +1109,107 @@ REGISTER_CALCULATOR(InferenceCalculator);
   return ::mediapipe::OkStatus();
 }
 
+::mediapipe::Status InferenceCalculator::InitZeroCopyCpuTensors(
+    CalculatorContext* cc) {
+  const auto& options = cc->Options<mediapipe::InferenceCalculatorOptions>();
+  use_zero_copy_cpu_tensors_ = options.use_zero_copy_cpu_tensors();
+  if (!use_zero_copy_cpu_tensors_) {
+    return ::mediapipe::OkStatus();
+  }
+  const int pool_size = options.output_tensor_pool_size();
+  RET_CHECK_GT(pool_size, 0);
+  const auto& input_indexes = interpreter_->inputs();
+  const auto& output_indexes = interpreter_->outputs();
+  tensor_pool_ = absl::make_unique<TensorBufferPool>(
+      pool_size * (input_indexes.size() + output_indexes.size()));
+
+  // Returns a buffer that a tensor can stay bound to between runs.
+  auto unbound_buffer = [](const TfLiteTensor& tensor) {
+    if (!CanBindExternalBuffer(tensor)) {
+      return Tensor(Tensor::ElementType::kNone, Tensor::Shape{});
+    }
+    // Tensors allocate their CPU buffers with Tensor::kCpuBufferAlignment.
+    return Tensor(Tensor::ElementType::kUInt8,
+                  Tensor::Shape{static_cast<int>(tensor.bytes)});
+  };
+  bind_inputs_.resize(input_indexes.size());
+  for (int i = 0; i < input_indexes.size(); ++i) {
+    const TfLiteTensor* tensor = interpreter_->tensor(input_indexes[i]);
+    bind_inputs_[i] = CanBindExternalBuffer(*tensor);
+    unbound_inputs_.push_back(unbound_buffer(*tensor));
+  }
+  bind_outputs_.resize(output_indexes.size());
+  for (int i = 0; i < output_indexes.size(); ++i) {
+    const TfLiteTensor* tensor = interpreter_->tensor(output_indexes[i]);
+    bind_outputs_[i] = CanBindExternalBuffer(*tensor);
+    unbound_outputs_.push_back(unbound_buffer(*tensor));
+    if (bind_outputs_[i]) {
+      // Allocate the output tensors of the first runs up front.
+      ASSIGN_OR_RETURN(auto element_type,
+                       ElementTypeFromTfLiteType(tensor->type));
+      tensor_pool_->Reserve(element_type, ShapeFromTfLiteTensor(*tensor),
+                            pool_size);
+    }
+  }
+  return ::mediapipe::OkStatus();
+}
+
+// Takes the output tensors from the pool and binds them to the interpreter,
+// so that it writes its outputs into them. Outputs that can't be bound are
+// left empty, and are copied into pooled tensors after inference.
+::mediapipe::Status InferenceCalculator::BindCpuOutputs(
+    std::vector<Tensor>* output_tensors) {
+  const auto& output_indexes = interpreter_->outputs();
+  output_tensors->reserve(output_indexes.size());
+  for (int i = 0; i < output_indexes.size(); ++i) {
+    const TfLiteTensor* tensor = interpreter_->tensor(output_indexes[i]);
+    if (!bind_outputs_[i]) {
+      output_tensors->emplace_back(Tensor::ElementType::kNone,
+                                   Tensor::Shape{});
+      continue;
+    }
+    ASSIGN_OR_RETURN(auto element_type,
+                     ElementTypeFromTfLiteType(tensor->type));
+    output_tensors->push_back(tensor_pool_->GetTensor(
+        element_type, ShapeFromTfLiteTensor(*tensor),
+        Tensor::QuantizationParameters(tensor->params.scale,
+                                       tensor->params.zero_point)));
+    void* buffer = output_tensors->back().GetCpuWriteView().buffer<void>();
+    TfLiteCustomAllocation allocation{buffer, tensor->bytes};
+    RET_CHECK_EQ(interpreter_->SetCustomAllocationForTensor(output_indexes[i],
+                                                            allocation),
+                 kTfLiteOk);
+  }
+  return ::mediapipe::OkStatus();
+}
+
+// Binds the bindable inputs and outputs back to the buffers owned by the
+// calculator, as the buffers bound for the last run are released along with
+// their packets. Interpreters lent by a TfLiteModelPool are never bound, see
+// CanUsePooledInterpreters().
+::mediapipe::Status InferenceCalculator::UnbindCpuTensors() {
+  auto unbind = [this](const std::vector<int>& indexes,
+                       const std::vector<bool>& bound,
+                       std::vector<Tensor>* buffers) -> ::mediapipe::Status {
+    for (int i = 0; i < indexes.size(); ++i) {
+      if (!bound[i]) {
+        continue;
+      }
+      Tensor& buffer = (*buffers)[i];
+      TfLiteCustomAllocation allocation{
+          buffer.GetCpuWriteView().buffer<void>(),
+          static_cast<size_t>(buffer.bytes())};
+      RET_CHECK_EQ(
+          interpreter_->SetCustomAllocationForTensor(indexes[i], allocation),
+          kTfLiteOk);
+    }
+    return ::mediapipe::OkStatus();
+  };
+  MP_RETURN_IF_ERROR(
+      unbind(interpreter_->inputs(), bind_inputs_, &unbound_inputs_));
+  return unbind(interpreter_->outputs(), bind_outputs_, &unbound_outputs_);
+}
+
 ::mediapipe::Status InferenceCalculator::LoadModel(CalculatorContext* cc) {
   ASSIGN_OR_RETURN(model_packet_, GetModelAsPacket(*cc));
   const auto& model = *model_packet_.Get<TfLiteModelPtr>();
@@ -629,10 +1235,23 @@ REGISTER_CALCULATOR(InferenceCalculator);
       cc->Options<mediapipe::InferenceCalculatorOptions>().cpu_num_thread());
 #endif  // __EMSCRIPTEN__
 
+  // Delegates generally don't support resizing tensors after they are
+  // applied, so batched models always run with the maximum batch size.
+  const int max_batch_size =
+      cc->Options<mediapipe::InferenceCalculatorOptions>().max_batch_size();
+  if (max_batch_size > 1) {
+    for (int index : interpreter_->inputs()) {
+      const TfLiteIntArray* dims = interpreter_->tensor(index)->dims;
+      RET_CHECK(dims->size > 0 && dims->data[0] == 1)
+          << "Batching requires model inputs with a batch dimension of 1.";
+      std::vector<int> batched_dims(dims->data, dims->data + dims->size);
+      batched_dims[0] = max_batch_size;
+      RET_CHECK_EQ(interpreter_->ResizeInputTensor(index, batched_dims),
+                   kTfLiteOk);
+    }
+  }
+
   RET_CHECK_EQ(interpreter_->AllocateTensors(), kTfLiteOk);
-  // TODO: Support quantized tensors.
-  CHECK(interpreter_->tensor(interpreter_->inputs()[0])->quantization.type !=
-        kTfLiteAffineQuantization);
 
   return ::mediapipe::OkStatus();
 }
@@ -641,14 +1260,24 @@ REGISTER_CALCULATOR(InferenceCalculator);
     const CalculatorContext& cc) {
   const auto& options = cc.Options<mediapipe::InferenceCalculatorOptions>();
   if (!options.model_path().empty()) {
-    std::string model_path = options.model_path();
-
-    ASSIGN_OR_RETURN(model_path, mediapipe::PathToResourceAsFile(model_path));
+    if (model_pool_) {
+      // Share the model loaded by the pool; the packet keeps it alive.
+      ASSIGN_OR_RETURN(auto model, model_pool_->GetModel(options.model_path()));
+      return MakePacket<TfLiteModelPtr>(TfLiteModelPtr(
+          model.get(), [model](tflite::FlatBufferModel*) mutable {
+            model.reset();
+          }));
+    }
 
-    auto model = tflite::FlatBufferModel::BuildFromFile(model_path.c_str());
+    // The model is built on the mapped file, without copying it.
+    ASSIGN_OR_RETURN(std::shared_ptr<ResourceContents> contents,
+                     mediapipe::MapResourceContents(options.model_path()));
+    auto model = tflite::FlatBufferModel::BuildFromBuffer(
+        contents->data().data(), contents->data().size());
     RET_CHECK(model) << "Failed to load model from path.";
     return MakePacket<TfLiteModelPtr>(TfLiteModelPtr(
-        model.release(), [](tflite::FlatBufferModel* model) { delete model; }));
+        model.release(),
+        [contents](tflite::FlatBufferModel* model) { delete model; }));
   }
   if (cc.InputSidePackets().HasTag("MODEL")) {
     return cc.InputSidePackets().Tag("MODEL");
@@ -12,15 +12,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "mediapipe/calculators/tensor/inference_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/deps/clock.h"
 #include "mediapipe/framework/deps/file_path.h"
 #include "mediapipe/framework/formats/tensor.h"
 #include "mediapipe/framework/port/gmock.h"
@@ -29,6 +33,7 @@
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"  // NOLINT
 #include "mediapipe/framework/tool/validate_type.h"
+#include "mediapipe/util/tflite/tflite_model_pool.h"
 #include "tensorflow/lite/error_reporter.h"
 #include "tensorflow/lite/kernels/register.h"
 #include "tensorflow/lite/model.h"
@@ -116,6 +121,15 @@ TEST(InferenceCalculatorTest, SmokeTest) {
   DoSmokeTest(/*graph_proto=*/absl::StrReplaceAll(
       graph_proto,
       {{"$delegate", "delegate { xnnpack { num_threads: 10 } }"}}));
+  // Test binding the input and output tensors to the interpreter.
+  DoSmokeTest(/*graph_proto=*/absl::StrReplaceAll(
+      graph_proto,
+      {{"$delegate",
+        "delegate { tflite {} } use_zero_copy_cpu_tensors: true"}}));
+  DoSmokeTest(/*graph_proto=*/absl::StrReplaceAll(
+      graph_proto,
+      {{"$delegate",
+        "delegate { xnnpack {} } use_zero_copy_cpu_tensors: true"}}));
 }
 
 TEST(InferenceCalculatorTest, SmokeTest_ModelAsInputSidePacket) {
@@ -159,4 +173,210 @@ TEST(InferenceCalculatorTest, SmokeTest_ModelAsInputSidePacket) {
   DoSmokeTest(graph_proto);
 }
 
+// Returns a packet with an 8x8x3 tensor filled with "value".
+Packet MakeInputTensorsPacket(float value, Timestamp timestamp) {
+  auto input_vec = absl::make_unique<std::vector<Tensor>>();
+  input_vec->emplace_back(Tensor::ElementType::kFloat32,
+                          Tensor::Shape{1, 8, 8, 3});
+  auto view = input_vec->back().GetCpuWriteView();
+  std::fill_n(view.buffer<float>(), 8 * 8 * 3, value);
+  return Adopt(input_vec.release()).At(timestamp);
+}
+
+TEST(InferenceCalculatorTest, BatchesInputs) {
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: "tensor_in"
+        input_stream: "batch_end"
+        node {
+          calculator: "InferenceCalculator"
+          input_stream: "TENSORS:tensor_in"
+          input_stream: "BATCH_END:batch_end"
+          output_stream: "TENSORS:tensor_out"
+          options {
+            [mediapipe.InferenceCalculatorOptions.ext] {
+              model_path: "mediapipe/calculators/tensor/testdata/add.bin"
+              delegate { tflite {} }
+              max_batch_size: 4
+            }
+          }
+        }
+      )");
+  std::vector<Packet> output_packets;
+  tool::AddVectorSink("tensor_out", &graph_config, &output_packets);
+  CalculatorGraph graph(graph_config);
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  // The first three inputs are run together when BATCH_END arrives.
+  for (int i = 0; i < 3; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "tensor_in", MakeInputTensorsPacket(i + 1, Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.AddPacketToInputStream(
+      "batch_end", MakePacket<Timestamp>(Timestamp(100)).At(Timestamp(2))));
+  MP_ASSERT_OK(graph.WaitUntilIdle());
+  ASSERT_EQ(3, output_packets.size());
+
+  // The last two inputs are run when the graph is closed.
+  for (int i = 3; i < 5; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "tensor_in", MakeInputTensorsPacket(i + 1, Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+  ASSERT_EQ(5, output_packets.size());
+
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(Timestamp(i), output_packets[i].Timestamp());
+    const std::vector<Tensor>& result_vec =
+        output_packets[i].Get<std::vector<Tensor>>();
+    ASSERT_EQ(1, result_vec.size());
+    EXPECT_THAT(result_vec[0].shape().dims, testing::ElementsAre(1, 8, 8, 3));
+    auto view = result_vec[0].GetCpuReadView();
+    EXPECT_EQ(2 * (i + 1), view.buffer<float>()[0]);
+  }
+}
+
+// Passes through the first input packet, and only advances the timestamp
+// bound for the others.
+class FirstPacketOnlyCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).SetAny();
+    cc->Outputs().Index(0).SetSameAs(&cc->Inputs().Index(0));
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(TimestampDiff(0));
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Process(CalculatorContext* cc) override {
+    if (!passed_) {
+      cc->Outputs().Index(0).AddPacket(cc->Inputs().Index(0).Value());
+      passed_ = true;
+    }
+    return ::mediapipe::OkStatus();
+  }
+
+ private:
+  bool passed_ = false;
+};
+REGISTER_CALCULATOR(FirstPacketOnlyCalculator);
+
+// A Clock that only advances when told to.
+class ManualClock : public ::mediapipe::Clock {
+ public:
+  absl::Time TimeNow() override { return now_; }
+  void Sleep(absl::Duration d) override { now_ += d; }
+  void SleepUntil(absl::Time wakeup_time) override {
+    now_ = std::max(now_, wakeup_time);
+  }
+
+ private:
+  absl::Time now_ = absl::UnixEpoch();
+};
+
+TEST(InferenceCalculatorTest, RunsExpiredBatchOnTimestampBound) {
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: "tensor_in"
+        node {
+          calculator: "FirstPacketOnlyCalculator"
+          input_stream: "tensor_in"
+          output_stream: "first_tensor"
+        }
+        node {
+          calculator: "InferenceCalculator"
+          input_side_packet: "CLOCK:clock"
+          input_stream: "TENSORS:first_tensor"
+          output_stream: "TENSORS:tensor_out"
+          options {
+            [mediapipe.InferenceCalculatorOptions.ext] {
+              model_path: "mediapipe/calculators/tensor/testdata/add.bin"
+              delegate { tflite {} }
+              max_batch_size: 4
+              max_batch_wait_us: 1000
+            }
+          }
+        }
+      )");
+  std::vector<Packet> output_packets;
+  tool::AddVectorSink("tensor_out", &graph_config, &output_packets);
+  CalculatorGraph graph(graph_config);
+  auto clock = std::make_shared<ManualClock>();
+  MP_ASSERT_OK(graph.StartRun(
+      {{"clock", MakePacket<std::shared_ptr<::mediapipe::Clock>>(clock)}}));
+
+  MP_ASSERT_OK(graph.AddPacketToInputStream(
+      "tensor_in", MakeInputTensorsPacket(1, Timestamp(0))));
+  MP_ASSERT_OK(graph.WaitUntilIdle());
+  EXPECT_TRUE(output_packets.empty());
+
+  // The next input only advances the timestamp bound, which runs the batch
+  // once it has waited long enough.
+  clock->Sleep(absl::Milliseconds(1));
+  MP_ASSERT_OK(graph.AddPacketToInputStream(
+      "tensor_in", MakeInputTensorsPacket(2, Timestamp(1))));
+  MP_ASSERT_OK(graph.WaitUntilIdle());
+  ASSERT_EQ(1, output_packets.size());
+  EXPECT_EQ(Timestamp(0), output_packets[0].Timestamp());
+  auto view = output_packets[0].Get<std::vector<Tensor>>()[0].GetCpuReadView();
+  EXPECT_EQ(2, view.buffer<float>()[0]);
+
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+TEST(InferenceCalculatorTest, SharesPooledInterpreters) {
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: "tensor_in"
+        node {
+          calculator: "InferenceCalculator"
+          input_stream: "TENSORS:tensor_in"
+          output_stream: "TENSORS:tensor_out"
+          options {
+            [mediapipe.InferenceCalculatorOptions.ext] {
+              model_path: "mediapipe/calculators/tensor/testdata/add.bin"
+              delegate { tflite {} }
+            }
+          }
+        }
+      )");
+  std::vector<Packet> output_packets;
+  tool::AddVectorSink("tensor_out", &graph_config, &output_packets);
+  auto pool = std::make_shared<TfLiteModelPool>(/*max_threads=*/1);
+
+  // Both graphs run the model with the single interpreter in the pool.
+  std::vector<std::unique_ptr<CalculatorGraph>> graphs;
+  for (int i = 0; i < 2; ++i) {
+    graphs.push_back(absl::make_unique<CalculatorGraph>());
+    MP_ASSERT_OK(
+        graphs.back()->SetServiceObject(kTfLiteModelPoolService, pool));
+    MP_ASSERT_OK(graphs.back()->Initialize(graph_config));
+    MP_ASSERT_OK(graphs.back()->StartRun({}));
+  }
+  for (int i = 0; i < 2; ++i) {
+    MP_ASSERT_OK(graphs[i]->AddPacketToInputStream(
+        "tensor_in", MakeInputTensorsPacket(i + 1, Timestamp(i))));
+    MP_ASSERT_OK(graphs[i]->WaitUntilIdle());
+  }
+  EXPECT_EQ(1, pool->interpreter_count());
+  for (auto& graph : graphs) {
+    MP_ASSERT_OK(graph->CloseAllInputStreams());
+    MP_ASSERT_OK(graph->WaitUntilDone());
+  }
+
+  ASSERT_EQ(2, output_packets.size());
+  for (int i = 0; i < 2; ++i) {
+    const std::vector<Tensor>& result_vec =
+        output_packets[i].Get<std::vector<Tensor>>();
+    ASSERT_EQ(1, result_vec.size());
+    auto view = result_vec[0].GetCpuReadView();
+    EXPECT_EQ(2 * (i + 1), view.buffer<float>()[0]);
+  }
+}
+
 }  // namespace mediapipe
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
 
@@ -26,6 +27,7 @@
 #include "mediapipe/framework/formats/tensor.h"
 #include "mediapipe/framework/port.h"
 #include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/statusor.h"
 
 // Note: On Apple platforms MEDIAPIPE_DISABLE_GL_COMPUTE is automatically
 // defined in mediapipe/framework/port.h. Therefore,
@@ -51,6 +53,42 @@ constexpr char kDetectionsTag[] = "DETECTIONS";
 constexpr char kTensorsTag[] = "TENSORS";
 constexpr char kAnchorsTag[] = "ANCHORS";
 
+// Returns the values of a CPU tensor as floats. The values of a quantized
+// tensor are dequantized into "dequantized", which backs the returned pointer.
+template <typename T>
+const float* DequantizeValues(const T* values, int num_values,
+                              const mediapipe::Tensor& tensor,
+                              std::vector<float>* dequantized) {
+  const auto& params = tensor.quantization_parameters();
+  dequantized->resize(num_values);
+  for (int i = 0; i < num_values; ++i) {
+    (*dequantized)[i] =
+        params.scale * (static_cast<int>(values[i]) - params.zero_point);
+  }
+  return dequantized->data();
+}
+
+::mediapipe::StatusOr<const float*> GetFloatValues(
+    const mediapipe::Tensor& tensor,
+    const mediapipe::Tensor::CpuReadView& view,
+    std::vector<float>* dequantized) {
+  const int num_values = tensor.shape().num_elements();
+  switch (tensor.element_type()) {
+    case mediapipe::Tensor::ElementType::kFloat32:
+      return view.buffer<float>();
+    case mediapipe::Tensor::ElementType::kUInt8:
+      return DequantizeValues(view.buffer<uint8_t>(), num_values, tensor,
+                              dequantized);
+    case mediapipe::Tensor::ElementType::kInt8:
+      return DequantizeValues(view.buffer<int8_t>(), num_values, tensor,
+                              dequantized);
+    default:
+      return ::mediapipe::InvalidArgumentError(absl::StrFormat(
+          "Unsupported tensor element type: %d",
+          static_cast<int>(tensor.element_type())));
+  }
+}
+
 bool CanUseGpu() {
 #if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE) || MEDIAPIPE_METAL_ENABLED
   // TODO: Configure GPU usage policy in individual calculators.
@@ -279,10 +317,18 @@ REGISTER_CALCULATOR(TensorsToDetectionsCalculator);
     RET_CHECK_EQ(raw_score_tensor->shape().dims[0], 1);
     RET_CHECK_EQ(raw_score_tensor->shape().dims[1], num_boxes_);
     RET_CHECK_EQ(raw_score_tensor->shape().dims[2], num_classes_);
+    // Quantized models output integer boxes and scores, which are
+    // dequantized here.
+    std::vector<float> dequantized_boxes;
+    std::vector<float> dequantized_scores;
     auto raw_box_view = raw_box_tensor->GetCpuReadView();
-    auto raw_boxes = raw_box_view.buffer<float>();
+    ASSIGN_OR_RETURN(
+        const float* raw_boxes,
+        GetFloatValues(*raw_box_tensor, raw_box_view, &dequantized_boxes));
     auto raw_scores_view = raw_score_tensor->GetCpuReadView();
-    auto raw_scores = raw_scores_view.buffer<float>();
+    ASSIGN_OR_RETURN(const float* raw_scores,
+                     GetFloatValues(*raw_score_tensor, raw_scores_view,
+                                    &dequantized_scores));
 
     // TODO: Support other options to load anchors.
     if (!anchors_init_) {
@@ -0,0 +1,171 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/parallel_for.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/util/segmentation_mask_converter.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kTensorsTag[] = "TENSORS";
+constexpr char kSizeImageTag[] = "REFERENCE_IMAGE";
+constexpr char kMaskTag[] = "MASK";
+constexpr char kPrevMaskTag[] = "PREV_MASK";
+
+}  // namespace
+
+// Converts Tensors from a two-class segmentation model, such as the hair or
+// selfie segmentation models, to an image mask on the CPU.
+//
+// Performs optional upscale to REFERENCE_IMAGE dimensions if provided,
+// otherwise the mask is the same size as input tensor.
+//
+// Produces result as an RGBA image, with the mask in both R & A channels. The
+// value of each pixel is the probability of the specified class after softmax,
+// scaled to 255. The class can be specified through the |output_layer_index|
+// option.
+//
+// Inputs:
+//   TENSORS: Vector of Tensors of type kFloat32. Only the first tensor will be
+//            used. Its shape is [1, height, width, 2].
+//   REFERENCE_IMAGE (optional): An ImageFrame input image,
+//                               used only for output dimensions.
+//   PREV_MASK (optional): An ImageFrame input mask, Gray, RGB or RGBA, [0-255].
+// Output:
+//   MASK: An ImageFrame output mask, RGBA.
+//
+// Usage example:
+// node {
+//   calculator: "TensorsToSegmentationCalculator"
+//   input_stream: "TENSORS:tensors"
+//   input_stream: "REFERENCE_IMAGE:input_video"
+//   input_stream: "PREV_MASK:previous_hair_mask"
+//   output_stream: "MASK:hair_mask"
+//   options: {
+//     [mediapipe.TensorsToSegmentationCalculatorOptions.ext] {
+//       combine_with_previous_ratio: 0.9
+//       output_layer_index: 1
+//     }
+//   }
+// }
+class TensorsToSegmentationCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc);
+
+  ::mediapipe::Status Open(CalculatorContext* cc) override;
+
+  ::mediapipe::Status Process(CalculatorContext* cc) override;
+
+ private:
+  ::mediapipe::TensorsToSegmentationCalculatorOptions options_;
+};
+REGISTER_CALCULATOR(TensorsToSegmentationCalculator);
+
+::mediapipe::Status TensorsToSegmentationCalculator::GetContract(
+    CalculatorContract* cc) {
+  RET_CHECK(cc->Inputs().HasTag(kTensorsTag));
+  RET_CHECK(cc->Outputs().HasTag(kMaskTag));
+
+  cc->Inputs().Tag(kTensorsTag).Set<std::vector<Tensor>>();
+  if (cc->Inputs().HasTag(kPrevMaskTag)) {
+    cc->Inputs().Tag(kPrevMaskTag).Set<ImageFrame>();
+  }
+  if (cc->Inputs().HasTag(kSizeImageTag)) {
+    cc->Inputs().Tag(kSizeImageTag).Set<ImageFrame>();
+  }
+  cc->Outputs().Tag(kMaskTag).Set<ImageFrame>();
+  cc->UseService(kParallelForService).Optional();
+
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status TensorsToSegmentationCalculator::Open(
+    CalculatorContext* cc) {
+  cc->SetOffset(TimestampDiff(0));
+
+  options_ = cc->Options<::mediapipe::TensorsToSegmentationCalculatorOptions>();
+  RET_CHECK(options_.output_layer_index() == 0 ||
+            options_.output_layer_index() == 1)
+      << "output_layer_index must be 0 or 1";
+
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status TensorsToSegmentationCalculator::Process(
+    CalculatorContext* cc) {
+  if (cc->Inputs().Tag(kTensorsTag).IsEmpty()) {
+    return ::mediapipe::OkStatus();
+  }
+
+  const auto& input_tensors =
+      cc->Inputs().Tag(kTensorsTag).Get<std::vector<Tensor>>();
+  RET_CHECK(!input_tensors.empty());
+  const Tensor& input_tensor = input_tensors[0];
+  RET_CHECK(input_tensor.element_type() == Tensor::ElementType::kFloat32);
+  const std::vector<int>& dims = input_tensor.shape().dims;
+  RET_CHECK_GE(dims.size(), 3);
+  RET_CHECK_EQ(dims.back(), 2)
+      << "Only 2 channel segmentation tensor currently supported";
+  const int tensor_height = dims[dims.size() - 3];
+  const int tensor_width = dims[dims.size() - 2];
+  RET_CHECK_EQ(input_tensor.shape().num_elements(),
+               tensor_width * tensor_height * 2);
+
+  const ImageFrame* input_mask = nullptr;
+  if (cc->Inputs().HasTag(kPrevMaskTag) &&
+      !cc->Inputs().Tag(kPrevMaskTag).IsEmpty()) {
+    input_mask = &cc->Inputs().Tag(kPrevMaskTag).Get<ImageFrame>();
+    RET_CHECK_EQ(input_mask->ByteDepth(), 1);
+  }
+  int output_width = tensor_width, output_height = tensor_height;
+  if (cc->Inputs().HasTag(kSizeImageTag)) {
+    const auto& input_image = cc->Inputs().Tag(kSizeImageTag).Get<ImageFrame>();
+    output_width = input_image.Width();
+    output_height = input_image.Height();
+  }
+
+  // Run softmax over tensor output, blend with previous mask, and upsample
+  // into the output mask, all in one pass over the output rows.
+  auto output_mask = absl::make_unique<ImageFrame>(
+      ImageFormat::SRGBA, output_width, output_height);
+  SegmentationMaskConverter::Options converter_options;
+  converter_options.output_layer_index = options_.output_layer_index();
+  converter_options.combine_with_previous_ratio =
+      options_.combine_with_previous_ratio();
+  converter_options.flip_vertically = options_.flip_vertically();
+  auto view = input_tensor.GetCpuReadView();
+  const SegmentationMaskConverter converter(
+      view.buffer<float>(), tensor_width, tensor_height, input_mask,
+      converter_options, output_mask.get());
+  ForEachRowBand(cc, output_height, output_mask->WidthStep(),
+                 [&converter](int begin_row, int end_row) {
+                   converter.ConvertRows(begin_row, end_row);
+                 });
+
+  cc->Outputs().Tag(kMaskTag).Add(output_mask.release(), cc->InputTimestamp());
+
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace mediapipe
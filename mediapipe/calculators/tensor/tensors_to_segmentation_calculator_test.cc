@@ -0,0 +1,137 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+using Node = ::mediapipe::CalculatorGraphConfig::Node;
+
+// Returns a packet with a tensor of "height" x "width" pairs of logits.
+Packet MakeTensorsPacket(int width, int height,
+                         const std::vector<float>& logits) {
+  auto tensors = absl::make_unique<std::vector<Tensor>>();
+  tensors->emplace_back(Tensor::ElementType::kFloat32,
+                        Tensor::Shape{1, height, width, 2});
+  auto view = tensors->back().GetCpuWriteView();
+  float* buffer = view.buffer<float>();
+  for (int i = 0; i < logits.size(); ++i) {
+    buffer[i] = logits[i];
+  }
+  return Adopt(tensors.release()).At(Timestamp(0));
+}
+
+// Returns the R channel of row "y" of "mask", after checking that the A
+// channel matches it.
+std::vector<int> MaskRow(const ImageFrame& mask, int y) {
+  std::vector<int> values;
+  const uint8* row = mask.PixelData() + y * mask.WidthStep();
+  for (int x = 0; x < mask.Width(); ++x) {
+    EXPECT_EQ(row[4 * x], row[4 * x + 3]);
+    values.push_back(row[4 * x]);
+  }
+  return values;
+}
+
+TEST(TensorsToSegmentationCalculatorTest, OutputsSoftmaxOfTensor) {
+  CalculatorRunner runner(ParseTextProtoOrDie<Node>(R"(
+    calculator: "TensorsToSegmentationCalculator"
+    input_stream: "TENSORS:tensors"
+    output_stream: "MASK:mask"
+  )"));
+  const float kLog3 = std::log(3.0f);
+  runner.MutableInputs()->Tag("TENSORS").packets.push_back(
+      MakeTensorsPacket(2, 1, {0.0f, kLog3, kLog3, 0.0f}));
+  MP_ASSERT_OK(runner.Run());
+
+  const std::vector<Packet>& output = runner.Outputs().Tag("MASK").packets;
+  ASSERT_EQ(1, output.size());
+  const ImageFrame& mask = output[0].Get<ImageFrame>();
+  ASSERT_EQ(ImageFormat::SRGBA, mask.Format());
+  ASSERT_EQ(2, mask.Width());
+  ASSERT_EQ(1, mask.Height());
+  // Probabilities 0.75 and 0.25 of class 1.
+  EXPECT_EQ(std::vector<int>({191, 64}), MaskRow(mask, 0));
+}
+
+TEST(TensorsToSegmentationCalculatorTest, FlipsAndUpsamplesToReferenceImage) {
+  CalculatorRunner runner(ParseTextProtoOrDie<Node>(R"(
+    calculator: "TensorsToSegmentationCalculator"
+    input_stream: "TENSORS:tensors"
+    input_stream: "REFERENCE_IMAGE:image"
+    output_stream: "MASK:mask"
+    options {
+      [mediapipe.TensorsToSegmentationCalculatorOptions.ext] {
+        flip_vertically: true
+      }
+    }
+  )"));
+  // A column of two pixels, certainly of class 1 at the top and of class 0
+  // at the bottom.
+  runner.MutableInputs()->Tag("TENSORS").packets.push_back(
+      MakeTensorsPacket(1, 2, {-20.0f, 20.0f, 20.0f, -20.0f}));
+  runner.MutableInputs()->Tag("REFERENCE_IMAGE").packets.push_back(
+      MakePacket<ImageFrame>(ImageFormat::SRGB, 1, 4).At(Timestamp(0)));
+  MP_ASSERT_OK(runner.Run());
+
+  const std::vector<Packet>& output = runner.Outputs().Tag("MASK").packets;
+  ASSERT_EQ(1, output.size());
+  const ImageFrame& mask = output[0].Get<ImageFrame>();
+  ASSERT_EQ(1, mask.Width());
+  ASSERT_EQ(4, mask.Height());
+  const int expected[] = {0, 64, 191, 255};
+  for (int y = 0; y < 4; ++y) {
+    EXPECT_EQ(std::vector<int>({expected[y]}), MaskRow(mask, y)) << y;
+  }
+}
+
+// The previous mask is kept where the model is uncertain, and ignored where
+// it is certain.
+TEST(TensorsToSegmentationCalculatorTest, BlendsPreviousMask) {
+  CalculatorRunner runner(ParseTextProtoOrDie<Node>(R"(
+    calculator: "TensorsToSegmentationCalculator"
+    input_stream: "TENSORS:tensors"
+    input_stream: "PREV_MASK:prev_mask"
+    output_stream: "MASK:mask"
+  )"));
+  runner.MutableInputs()->Tag("TENSORS").packets.push_back(
+      MakeTensorsPacket(2, 1, {0.0f, 0.0f, -20.0f, 20.0f}));
+  auto prev_mask = absl::make_unique<ImageFrame>(ImageFormat::GRAY8, 2, 1);
+  prev_mask->MutablePixelData()[0] = 200;
+  prev_mask->MutablePixelData()[1] = 0;
+  runner.MutableInputs()->Tag("PREV_MASK").packets.push_back(
+      Adopt(prev_mask.release()).At(Timestamp(0)));
+  MP_ASSERT_OK(runner.Run());
+
+  const std::vector<Packet>& output = runner.Outputs().Tag("MASK").packets;
+  ASSERT_EQ(1, output.size());
+  const std::vector<int> mask = MaskRow(output[0].Get<ImageFrame>(), 0);
+  EXPECT_NEAR(200, mask[0], 1);
+  EXPECT_EQ(255, mask[1]);
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -818,14 +818,15 @@ bool ShouldUseGpu(CC* cc) {
   const auto& options =
       cc.Options<mediapipe::TfLiteInferenceCalculatorOptions>();
   if (!options.model_path().empty()) {
-    std::string model_path = options.model_path();
-
-    ASSIGN_OR_RETURN(model_path, mediapipe::PathToResourceAsFile(model_path));
-
-    auto model = tflite::FlatBufferModel::BuildFromFile(model_path.c_str());
+    // The model is built on the mapped file, without copying it.
+    ASSIGN_OR_RETURN(std::shared_ptr<ResourceContents> contents,
+                     mediapipe::MapResourceContents(options.model_path()));
+    auto model = tflite::FlatBufferModel::BuildFromBuffer(
+        contents->data().data(), contents->data().size());
     RET_CHECK(model) << "Failed to load model from path.";
     return MakePacket<TfLiteModelPtr>(TfLiteModelPtr(
-        model.release(), [](tflite::FlatBufferModel* model) { delete model; }));
+        model.release(),
+        [contents](tflite::FlatBufferModel* model) { delete model; }));
   }
   if (cc.InputSidePackets().HasTag("MODEL")) {
     return cc.InputSidePackets().Tag("MODEL");
@@ -19,19 +19,23 @@
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/packet.h"
 #include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/util/resource_util.h"
 #include "tensorflow/lite/model.h"
 
 namespace mediapipe {
 
-// Loads TfLite model from model blob specified as input side packet and outputs
-// corresponding side packet.
+// Loads TfLite model from model blob or resource path specified as input side
+// packet and outputs corresponding side packet.
 //
-// Input side packets:
+// Input side packets (exactly one of):
 //   MODEL_BLOB - TfLite model blob/file-contents (std::string). You can read
 //                model blob from file (using whatever APIs you have) and pass
 //                it to the graph as input side packet or you can use some of
 //                calculators like LocalFileContentsCalculator to get model
 //                blob and use it as input here.
+//   MODEL_PATH - Path to the TfLite model resource (std::string). The model is
+//                memory-mapped rather than read, which avoids copying it and
+//                lets processes share its pages. Prefer this for files.
 //
 // Output side packets:
 //   MODEL - TfLite model. (std::unique_ptr<tflite::FlatBufferModel,
@@ -52,12 +56,22 @@ class TfLiteModelCalculator : public CalculatorBase {
                       std::function<void(tflite::FlatBufferModel*)>>;
 
   static ::mediapipe::Status GetContract(CalculatorContract* cc) {
-    cc->InputSidePackets().Tag("MODEL_BLOB").Set<std::string>();
+    RET_CHECK(cc->InputSidePackets().HasTag("MODEL_BLOB") ^
+              cc->InputSidePackets().HasTag("MODEL_PATH"))
+        << "Exactly one of MODEL_BLOB and MODEL_PATH must be specified.";
+    if (cc->InputSidePackets().HasTag("MODEL_BLOB")) {
+      cc->InputSidePackets().Tag("MODEL_BLOB").Set<std::string>();
+    } else {
+      cc->InputSidePackets().Tag("MODEL_PATH").Set<std::string>();
+    }
     cc->OutputSidePackets().Tag("MODEL").Set<TfLiteModelPtr>();
     return ::mediapipe::OkStatus();
   }
 
   ::mediapipe::Status Open(CalculatorContext* cc) override {
+    if (cc->InputSidePackets().HasTag("MODEL_PATH")) {
+      return LoadFromPath(cc);
+    }
     const Packet& model_packet = cc->InputSidePackets().Tag("MODEL_BLOB");
     const std::string& model_blob = model_packet.Get<std::string>();
     std::unique_ptr<tflite::FlatBufferModel> model =
@@ -80,6 +94,28 @@ class TfLiteModelCalculator : public CalculatorBase {
   ::mediapipe::Status Process(CalculatorContext* cc) override {
     return ::mediapipe::OkStatus();
   }
+
+ private:
+  ::mediapipe::Status LoadFromPath(CalculatorContext* cc) {
+    const auto& path =
+        cc->InputSidePackets().Tag("MODEL_PATH").Get<std::string>();
+    ASSIGN_OR_RETURN(std::shared_ptr<ResourceContents> contents,
+                     MapResourceContents(path));
+    std::unique_ptr<tflite::FlatBufferModel> model =
+        tflite::FlatBufferModel::BuildFromBuffer(contents->data().data(),
+                                                 contents->data().size());
+    RET_CHECK(model) << "Failed to load TfLite model from path " << path;
+
+    cc->OutputSidePackets().Tag("MODEL").Set(
+        MakePacket<TfLiteModelPtr>(TfLiteModelPtr(
+            model.release(), [contents](tflite::FlatBufferModel* model) {
+              // Keeping contents in order to keep the mapping, which can be
+              // released only after TfLite model is not needed anymore.
+              delete model;
+            })));
+
+    return ::mediapipe::OkStatus();
+  }
 };
 REGISTER_CALCULATOR(TfLiteModelCalculator);
 
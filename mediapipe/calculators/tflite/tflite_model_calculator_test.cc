@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <memory>
+#include <string>
 
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_runner.h"
@@ -24,35 +25,10 @@
 
 namespace mediapipe {
 
-TEST(TfLiteModelCalculatorTest, SmokeTest) {
+void ExpectModelLoaded(const std::string& graph_proto) {
   // Prepare single calculator graph to and wait for packets.
-  CalculatorGraphConfig graph_config = ParseTextProtoOrDie<
-      CalculatorGraphConfig>(
-      R"(
-        node {
-          calculator: "ConstantSidePacketCalculator"
-          output_side_packet: "PACKET:model_path"
-          options: {
-            [mediapipe.ConstantSidePacketCalculatorOptions.ext]: {
-              packet {
-                string_value: "mediapipe/calculators/tflite/testdata/add.bin"
-              }
-            }
-          }
-        }
-
-        node {
-          calculator: "LocalFileContentsCalculator"
-          input_side_packet: "FILE_PATH:model_path"
-          output_side_packet: "CONTENTS:model_blob"
-        }
-
-        node {
-          calculator: "TfLiteModelCalculator"
-          input_side_packet: "MODEL_BLOB:model_blob"
-          output_side_packet: "MODEL:model"
-        }
-      )");
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(graph_proto);
   CalculatorGraph graph(graph_config);
   MP_ASSERT_OK(graph.StartRun({}));
   MP_ASSERT_OK(graph.WaitUntilIdle());
@@ -85,4 +61,54 @@ TEST(TfLiteModelCalculatorTest, SmokeTest) {
   }
 }
 
+TEST(TfLiteModelCalculatorTest, SmokeTest) {
+  ExpectModelLoaded(R"(
+        node {
+          calculator: "ConstantSidePacketCalculator"
+          output_side_packet: "PACKET:model_path"
+          options: {
+            [mediapipe.ConstantSidePacketCalculatorOptions.ext]: {
+              packet {
+                string_value: "mediapipe/calculators/tflite/testdata/add.bin"
+              }
+            }
+          }
+        }
+
+        node {
+          calculator: "LocalFileContentsCalculator"
+          input_side_packet: "FILE_PATH:model_path"
+          output_side_packet: "CONTENTS:model_blob"
+        }
+
+        node {
+          calculator: "TfLiteModelCalculator"
+          input_side_packet: "MODEL_BLOB:model_blob"
+          output_side_packet: "MODEL:model"
+        }
+      )");
+}
+
+TEST(TfLiteModelCalculatorTest, LoadsModelFromPath) {
+  ExpectModelLoaded(R"(
+        node {
+          calculator: "ConstantSidePacketCalculator"
+          output_side_packet: "PACKET:model_path"
+          options: {
+            [mediapipe.ConstantSidePacketCalculatorOptions.ext]: {
+              packet {
+                string_value: "mediapipe/calculators/tflite/testdata/add.bin"
+              }
+            }
+          }
+        }
+
+        node {
+          calculator: "TfLiteModelCalculator"
+          input_side_packet: "MODEL_PATH:model_path"
+          output_side_packet: "MODEL:model"
+        }
+      )");
+}
+
 }  // namespace mediapipe
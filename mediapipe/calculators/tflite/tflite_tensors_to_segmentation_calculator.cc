@@ -14,17 +14,17 @@
 
 #include <vector>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/str_format.h"
 #include "absl/types/span.h"
 #include "mediapipe/calculators/tflite/tflite_tensors_to_segmentation_calculator.pb.h"
 #include "mediapipe/framework/calculator_context.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
-#include "mediapipe/framework/formats/image_frame_opencv.h"
-#include "mediapipe/framework/port/opencv_imgcodecs_inc.h"
-#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/parallel_for.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/util/resource_util.h"
+#include "mediapipe/util/segmentation_mask_converter.h"
 #include "tensorflow/lite/interpreter.h"
 
 #if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
@@ -45,9 +45,6 @@ enum { ATTRIB_VERTEX, ATTRIB_TEXTURE_POSITION, NUM_ATTRIBUTES };
 int NumGroups(const int size, const int group_size) {  // NOLINT
   return (size + group_size - 1) / group_size;
 }
-float Clamp(float val, float min, float max) {
-  return std::min(std::max(val, min), max);
-}
 
 constexpr char kTensorsTag[] = "TENSORS";
 constexpr char kTensorsGpuTag[] = "TENSORS_GPU";
@@ -189,6 +186,7 @@ REGISTER_CALCULATOR(TfLiteTensorsToSegmentationCalculator);
   // Outputs.
   if (cc->Outputs().HasTag(kMaskTag)) {
     cc->Outputs().Tag(kMaskTag).Set<ImageFrame>();
+    cc->UseService(kParallelForService).Optional();
   }
 #if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
   if (cc->Outputs().HasTag(kMaskGpuTag)) {
@@ -274,12 +272,12 @@ REGISTER_CALCULATOR(TfLiteTensorsToSegmentationCalculator);
   // Get input streams.
   const auto& input_tensors =
       cc->Inputs().Tag(kTensorsTag).Get<std::vector<TfLiteTensor>>();
-  const bool has_prev_mask = cc->Inputs().HasTag(kPrevMaskTag) &&
-                             !cc->Inputs().Tag(kPrevMaskTag).IsEmpty();
-  const ImageFrame placeholder;
-  const auto& input_mask =
-      has_prev_mask ? cc->Inputs().Tag(kPrevMaskTag).Get<ImageFrame>()
-                    : placeholder;
+  const ImageFrame* input_mask = nullptr;
+  if (cc->Inputs().HasTag(kPrevMaskTag) &&
+      !cc->Inputs().Tag(kPrevMaskTag).IsEmpty()) {
+    input_mask = &cc->Inputs().Tag(kPrevMaskTag).Get<ImageFrame>();
+    RET_CHECK_EQ(input_mask->ByteDepth(), 1);
+  }
   int output_width = tensor_width_, output_height = tensor_height_;
   if (cc->Inputs().HasTag(kSizeImageTag)) {
     const auto& input_image = cc->Inputs().Tag(kSizeImageTag).Get<ImageFrame>();
@@ -287,83 +285,29 @@ REGISTER_CALCULATOR(TfLiteTensorsToSegmentationCalculator);
     output_height = input_image.Height();
   }
   RET_CHECK_EQ(input_tensors.size(), 1);
-
-  // Create initial working mask.
-  cv::Mat small_mask_mat(cv::Size(tensor_width_, tensor_height_), CV_8UC4);
-
-  // Get input previous mask.
-  cv::Mat input_mask_mat;
-  if (has_prev_mask) {
-    cv::Mat temp_mask_mat = formats::MatView(&input_mask);
-    if (temp_mask_mat.channels() != 4) {
-      cv::Mat converted_mat;
-      cv::cvtColor(temp_mask_mat, converted_mat,
-                   temp_mask_mat.channels() == 1 ? cv::COLOR_GRAY2RGBA
-                                                 : cv::COLOR_RGB2RGBA);
-      temp_mask_mat = converted_mat.clone();
-    }
-    cv::resize(temp_mask_mat, input_mask_mat, small_mask_mat.size());
-  }
-
-  // Copy input tensor.
   const TfLiteTensor* raw_input_tensor = &input_tensors[0];
-  const float* raw_input_data = raw_input_tensor->data.f;
-  cv::Mat tensor_mat(cv::Size(tensor_width_, tensor_height_),
-                     CV_MAKETYPE(CV_32F, tensor_channels_));
-  float* tensor_mat_ptr = tensor_mat.ptr<float>();
-  memcpy(tensor_mat_ptr, raw_input_data, raw_input_tensor->bytes);
+  RET_CHECK_EQ(raw_input_tensor->bytes,
+               tensor_width_ * tensor_height_ * tensor_channels_ *
+                   sizeof(float));
 
-  // Process mask tensor.
-  // Run softmax over tensor output and blend with previous mask.
-  const int output_layer_index = options_.output_layer_index();
-  const float combine_with_prev_ratio = options_.combine_with_previous_ratio();
-  for (int i = 0; i < tensor_height_; ++i) {
-    for (int j = 0; j < tensor_width_; ++j) {
-      // Only two channel input tensor is supported.
-      const cv::Vec2f input_pix = tensor_mat.at<cv::Vec2f>(i, j);
-      const float shift = std::max(input_pix[0], input_pix[1]);
-      const float softmax_denom =
-          std::exp(input_pix[0] - shift) + std::exp(input_pix[1] - shift);
-      float new_mask_value =
-          std::exp(input_pix[output_layer_index] - shift) / softmax_denom;
-      // Combine previous value with current using uncertainty^2 as mixing coeff
-      if (has_prev_mask) {
-        const float prev_mask_value =
-            input_mask_mat.at<cv::Vec4b>(i, j)[0] / 255.0f;
-        const float eps = 0.001;
-        float uncertainty_alpha =
-            1.0 +
-            (new_mask_value * std::log(new_mask_value + eps) +
-             (1.0 - new_mask_value) * std::log(1.0 - new_mask_value + eps)) /
-                std::log(2.0f);
-        uncertainty_alpha = Clamp(uncertainty_alpha, 0.0f, 1.0f);
-        // Equivalent to: a = 1 - (1 - a) * (1 - a);  (squaring the uncertainty)
-        uncertainty_alpha *= 2.0 - uncertainty_alpha;
-        const float mixed_mask_value =
-            new_mask_value * uncertainty_alpha +
-            prev_mask_value * (1.0f - uncertainty_alpha);
-        new_mask_value = mixed_mask_value * combine_with_prev_ratio +
-                         (1.0f - combine_with_prev_ratio) * new_mask_value;
-      }
-      const uchar mask_value = static_cast<uchar>(new_mask_value * 255);
-      // Set both R and A channels for convenience.
-      const cv::Vec4b out_value = {mask_value, 0, 0, mask_value};
-      small_mask_mat.at<cv::Vec4b>(i, j) = out_value;
-    }
-  }
-
-  if (options_.flip_vertically()) cv::flip(small_mask_mat, small_mask_mat, 0);
-
-  // Upsample small mask into output.
-  cv::Mat large_mask_mat;
-  cv::resize(small_mask_mat, large_mask_mat,
-             cv::Size(output_width, output_height));
-
-  // Send out image as CPU packet.
+  // Run softmax over tensor output, blend with previous mask, and upsample
+  // into the output mask, all in one pass over the output rows.
   std::unique_ptr<ImageFrame> output_mask = absl::make_unique<ImageFrame>(
       ImageFormat::SRGBA, output_width, output_height);
-  cv::Mat output_mat = formats::MatView(output_mask.get());
-  large_mask_mat.copyTo(output_mat);
+  SegmentationMaskConverter::Options converter_options;
+  converter_options.output_layer_index = options_.output_layer_index();
+  converter_options.combine_with_previous_ratio =
+      options_.combine_with_previous_ratio();
+  converter_options.flip_vertically = options_.flip_vertically();
+  const SegmentationMaskConverter converter(
+      raw_input_tensor->data.f, tensor_width_, tensor_height_, input_mask,
+      converter_options, output_mask.get());
+  ForEachRowBand(cc, output_height, output_mask->WidthStep(),
+                 [&converter](int begin_row, int end_row) {
+                   converter.ConvertRows(begin_row, end_row);
+                 });
+
+  // Send out image as CPU packet.
   cc->Outputs().Tag(kMaskTag).Add(output_mask.release(), cc->InputTimestamp());
 
   return ::mediapipe::OkStatus();
@@ -530,6 +474,9 @@ void TfLiteTensorsToSegmentationCalculator::GlRender() {
   tensor_channels_ = options_.tensor_channels();
   RET_CHECK_EQ(tensor_channels_, 2)
       << "Only 2 channel segmentation tensor currently supported";
+  RET_CHECK(options_.output_layer_index() == 0 ||
+            options_.output_layer_index() == 1)
+      << "output_layer_index must be 0 or 1";
 
   return ::mediapipe::OkStatus();
 }
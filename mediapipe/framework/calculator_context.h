@@ -28,8 +28,10 @@
 #include "mediapipe/framework/packet_set.h"
 #include "mediapipe/framework/port.h"
 #include "mediapipe/framework/port/any_proto.h"
+#include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/timestamp.h"
+#include "mediapipe/framework/tool/type_util.h"
 
 namespace mediapipe {
 
@@ -131,6 +133,32 @@ class CalculatorContext {
     return ServiceBinding<T>(calculator_state_, service);
   }
 
+  // Returns the state attached to this context with SetContextState, or
+  // nullptr if none is attached.
+  //
+  // When a calculator declares CalculatorContract::SetMaxInFlight, its
+  // Process method runs concurrently on several contexts. Each context serves
+  // one Process call at a time and is reused for later timestamps, so a
+  // resource that is not thread-safe, such as an inference interpreter, can be
+  // created once per context and kept here instead of in the calculator.
+  // The state is released when the graph run ends.
+  template <typename T>
+  T* ContextState() const {
+    if (context_state_ == nullptr) {
+      return nullptr;
+    }
+    CHECK_EQ(context_state_type_, tool::GetTypeHash<T>())
+        << "ContextState requested with a different type than it was set.";
+    return static_cast<T*>(context_state_.get());
+  }
+
+  // Attaches "state" to this context, replacing any previous state.
+  template <typename T>
+  void SetContextState(std::unique_ptr<T> state) {
+    context_state_type_ = tool::GetTypeHash<T>();
+    context_state_ = std::shared_ptr<T>(std::move(state));
+  }
+
  private:
   int NumberOfTimestamps() const {
     return static_cast<int>(input_timestamps_.size());
@@ -169,6 +197,10 @@ class CalculatorContext {
   // The status of the graph run. Only used when Close() is called.
   ::mediapipe::Status graph_status_;
 
+  // The calculator state attached to this context, see ContextState().
+  std::shared_ptr<void> context_state_;
+  size_t context_state_type_ = 0;
+
   // Accesses CalculatorContext for setting input timestamp.
   friend class CalculatorContextManager;
 };
@@ -130,6 +130,16 @@ class CalculatorContract {
   void SetTimestampOffset(TimestampDiff offset) { timestamp_offset_ = offset; }
   TimestampDiff GetTimestampOffset() const { return timestamp_offset_; }
 
+  // Declares that Process may run concurrently for up to "max_in_flight"
+  // different input timestamps. The calculator must then be stateless across
+  // timestamps: anything Process mutates must either be thread-safe or be
+  // kept per CalculatorContext, using CalculatorContext::ContextState. The
+  // output packets are reordered by timestamp by the default
+  // InOrderOutputStreamHandler before they reach downstream calculators.
+  // A max_in_flight set in the node config takes precedence over this value.
+  void SetMaxInFlight(int max_in_flight) { max_in_flight_ = max_in_flight; }
+  int GetMaxInFlight() const { return max_in_flight_; }
+
   class GraphServiceRequest {
    public:
     // APIs that should be used by calculators.
@@ -175,6 +185,7 @@ class CalculatorContract {
   std::map<std::string, GraphServiceRequest> service_requests_;
   bool process_timestamps_ = false;
   TimestampDiff timestamp_offset_ = TimestampDiff::Unset();
+  int max_in_flight_ = 1;
 };
 
 }  // namespace mediapipe
@@ -42,6 +42,7 @@
 #include "mediapipe/framework/packet_generator.pb.h"
 #include "mediapipe/framework/packet_set.h"
 #include "mediapipe/framework/packet_type.h"
+#include "mediapipe/framework/parallel_for.h"
 #include "mediapipe/framework/port.h"
 #include "mediapipe/framework/port/canonical_errors.h"
 #include "mediapipe/framework/port/core_proto_inc.h"
@@ -50,11 +51,13 @@
 #include "mediapipe/framework/port/source_location.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/status_builder.h"
+#include "mediapipe/framework/profiler/latency_histogram.h"
 #include "mediapipe/framework/status_handler.h"
 #include "mediapipe/framework/status_handler.pb.h"
 #include "mediapipe/framework/thread_pool_executor.h"
 #include "mediapipe/framework/thread_pool_executor.pb.h"
 #include "mediapipe/framework/tool/fill_packet_set.h"
+#include "mediapipe/framework/tool/name_util.h"
 #include "mediapipe/framework/tool/status_util.h"
 #include "mediapipe/framework/tool/tag_map.h"
 #include "mediapipe/framework/tool/validate.h"
@@ -128,6 +131,7 @@ CalculatorGraph::CalculatorGraph(const CalculatorGraphConfig& config)
 // they only need to be fully visible here, where their destructor is
 // instantiated.
 CalculatorGraph::~CalculatorGraph() {
+  metrics_reporter_.reset();
   // Stop periodic profiler output to ublock Executor destructors.
   ::mediapipe::Status status = profiler()->Stop();
   if (!status.ok()) {
@@ -267,6 +271,31 @@ CalculatorGraph::~CalculatorGraph() {
   return ::mediapipe::OkStatus();
 }
 
+::mediapipe::Status CalculatorGraph::InitializeMetricsSinks() {
+  const ProfilerConfig& profiler_config =
+      validated_graph_->Config().profiler_config();
+  if (profiler_config.metrics_interval_usec() <= 0) {
+    return ::mediapipe::OkStatus();
+  }
+  if (!profiler_config.metrics_file_path().empty()) {
+    metrics_sinks_.push_back(std::make_shared<PrometheusFileSink>(
+        profiler_config.metrics_file_path()));
+  }
+  if (profiler_config.metrics_http_port() > 0) {
+    RET_CHECK(MetricsSinkRegistry::IsRegistered("HttpMetricsSink"))
+        << "metrics_http_port requires linking "
+           "//mediapipe/framework/profiler:http_metrics_sink.";
+  }
+  for (const std::string& name : MetricsSinkRegistry::GetRegisteredNames()) {
+    ASSIGN_OR_RETURN(std::unique_ptr<MetricsSink> sink,
+                     MetricsSinkRegistry::CreateByName(name, profiler_config));
+    if (sink) {
+      metrics_sinks_.push_back(std::move(sink));
+    }
+  }
+  return ::mediapipe::OkStatus();
+}
+
 ::mediapipe::Status CalculatorGraph::InitializeExecutors() {
   // If the ExecutorConfig for the default executor leaves the executor type
   // unspecified, default_executor_options points to the
@@ -378,6 +407,7 @@ CalculatorGraph::~CalculatorGraph() {
 #ifdef MEDIAPIPE_PROFILER_AVAILABLE
   MP_RETURN_IF_ERROR(InitializeProfiler());
 #endif
+  MP_RETURN_IF_ERROR(InitializeMetricsSinks());
 
   initialized_ = true;
   return ::mediapipe::OkStatus();
@@ -502,6 +532,16 @@ CalculatorGraph::AddOutputStreamPoller(const std::string& stream_name) {
       << "CalculatorGraph is not initialized.";
   MP_RETURN_IF_ERROR(PrepareForRun(extra_side_packets, stream_headers));
   MP_RETURN_IF_ERROR(profiler_->Start(executors_[""].get()));
+  int64 metrics_interval_usec =
+      validated_graph_->Config().profiler_config().metrics_interval_usec();
+  metrics_reporter_.reset();
+  if (metrics_interval_usec > 0 && !metrics_sinks_.empty()) {
+    metrics_reporter_ = absl::make_unique<MetricsReporter>(
+        absl::Microseconds(metrics_interval_usec),
+        [this](GraphMetrics* metrics) { CollectMetrics(metrics); },
+        metrics_sinks_);
+    metrics_reporter_->Start();
+  }
   scheduler_.Start();
   return ::mediapipe::OkStatus();
 }
@@ -611,6 +651,46 @@ CalculatorGraph::PrepareGpu(const std::map<std::string, Packet>& side_packets) {
   ASSIGN_OR_RETURN(additional_side_packets, PrepareGpu(extra_side_packets));
 #endif  // !defined(MEDIAPIPE_DISABLE_GPU)
 
+  // With a latency budget, the graph tracks the arrival of input timestamps,
+  // unless the application has provided its own tracker.
+  const int64 latency_budget_usec =
+      validated_graph_->Config().latency_budget_usec();
+  RET_CHECK_GE(latency_budget_usec, 0);
+  if (latency_budget_usec > 0 &&
+      !::mediapipe::ContainsKey(service_packets_,
+                                kDeadlineTrackerService.key)) {
+    MP_RETURN_IF_ERROR(SetServiceObject(
+        kDeadlineTrackerService,
+        std::make_shared<DeadlineTracker>(latency_budget_usec)));
+  }
+  deadline_tracker_ = GetServiceObject(kDeadlineTrackerService);
+  if (deadline_tracker_ != nullptr) {
+    deadline_tracker_->Reset();
+  }
+
+  // Calculators can spread the work of a Process call over the default
+  // executor, unless the graph runs on the application thread. Helper tasks
+  // that start once all blocks are taken return at once, so the parallelism
+  // need not match the number of executor threads.
+  if (!use_application_thread_ &&
+      !::mediapipe::ContainsKey(service_packets_, kParallelForService.key)) {
+    MP_RETURN_IF_ERROR(SetServiceObject(
+        kParallelForService, std::make_shared<ParallelForRunner>(
+                                 executors_[""], NumCPUCores())));
+  }
+
+  // Create the default objects of requested services that allow it, unless
+  // the application has provided them.
+  for (const auto& node_type_info : validated_graph_->CalculatorInfos()) {
+    for (const auto& request : node_type_info.Contract().ServiceRequests()) {
+      const GraphServiceBase& service = request.second.Service();
+      if (service.create_default_object != nullptr &&
+          !::mediapipe::ContainsKey(service_packets_, service.key)) {
+        service_packets_[service.key] = service.create_default_object();
+      }
+    }
+  }
+
   const std::map<std::string, Packet>* input_side_packets;
   if (!additional_side_packets.empty()) {
     additional_side_packets.insert(extra_side_packets.begin(),
@@ -654,6 +734,7 @@ CalculatorGraph::PrepareGpu(const std::map<std::string, Packet>& side_packets) {
     RET_CHECK(default_executor);
   }
   scheduler_.Reset();
+  scheduler_.SetDeadlineTracker(deadline_tracker_.get());
 
   {
     absl::MutexLock lock(&full_input_streams_mutex_);
@@ -852,6 +933,10 @@ template <typename T>
                           .set_packet_ts(packet.Timestamp())
                           .set_packet_data_id(&packet));
 
+  if (deadline_tracker_ != nullptr) {
+    deadline_tracker_->RecordArrival(packet.Timestamp());
+  }
+
   // InputStreamManager is thread safe. GraphInputStream is not, so this method
   // should not be called by multiple threads concurrently. Note that this could
   // potentially lead to the max queue size being exceeded by one packet at most
@@ -1066,6 +1151,9 @@ void CalculatorGraph::UpdateThrottledNodes(InputStreamManager* stream,
         }
 
         bool is_throttled = !full_input_streams_[node_id].empty();
+        if (!was_throttled && is_throttled) {
+          ++num_throttle_events_;
+        }
         bool is_graph_input_stream =
             node_id >= validated_graph_->CalculatorInfos().size();
         if (is_graph_input_stream) {
@@ -1204,6 +1292,15 @@ Packet CalculatorGraph::GetServicePacket(const GraphServiceBase& service) {
   return ::mediapipe::OkStatus();
 }
 
+::mediapipe::Status CalculatorGraph::AddMetricsSink(
+    std::shared_ptr<MetricsSink> sink) {
+  RET_CHECK(!metrics_reporter_)
+      << "AddMetricsSink must be called before StartRun().";
+  RET_CHECK(sink);
+  metrics_sinks_.push_back(std::move(sink));
+  return ::mediapipe::OkStatus();
+}
+
 ::mediapipe::Status CalculatorGraph::SetExecutor(
     const std::string& name, std::shared_ptr<Executor> executor) {
   RET_CHECK(!initialized_)
@@ -1241,6 +1338,11 @@ bool CalculatorGraph::IsReservedExecutorName(const std::string& name) {
   // Check for any errors that may have occurred.
   ::mediapipe::Status status = ::mediapipe::OkStatus();
   MP_RETURN_IF_ERROR(profiler_->Stop());
+  if (metrics_reporter_) {
+    // Reports the final snapshot of the run.
+    metrics_reporter_->Stop();
+    metrics_reporter_.reset();
+  }
   GetCombinedErrors(&status);
   CleanupAfterRun(&status);
   return status;
@@ -1313,6 +1415,62 @@ bool MetricElementComparator(const std::pair<std::string, int64>& e1,
 }
 }  // namespace
 
+void CalculatorGraph::CollectMetrics(GraphMetrics* metrics) {
+  // Calculator runtimes, which are also summed up per executor.
+  std::vector<CalculatorProfile> profiles;
+  if (profiler_->GetCalculatorProfiles(&profiles).ok()) {
+    std::map<std::string, int64> executor_busy_usec;
+    for (int node_id = 0; node_id < profiles.size() && node_id < nodes_->size();
+         ++node_id) {
+      const CalculatorProfile& profile = profiles[node_id];
+      CalculatorMetrics calculator;
+      calculator.name = profile.name();
+      for (int64 count : profile.process_runtime().count()) {
+        calculator.process_count += count;
+      }
+      calculator.process_runtime_total_usec = profile.process_runtime().total();
+      calculator.process_runtime =
+          GetLatencyPercentiles(profile.process_runtime_histogram());
+      metrics->calculators.push_back(std::move(calculator));
+      const std::string& executor = (*nodes_)[node_id].Executor();
+      executor_busy_usec[executor.empty() ? "default" : executor] +=
+          profile.process_runtime().total();
+    }
+    for (const auto& entry : executor_busy_usec) {
+      ExecutorMetrics executor;
+      executor.name = entry.first;
+      executor.busy_usec = entry.second;
+      metrics->executors.push_back(std::move(executor));
+    }
+  }
+
+  // Input stream queues.
+  const std::vector<EdgeInfo>& input_stream_infos =
+      validated_graph_->InputStreamInfos();
+  for (int index = 0; index < input_stream_infos.size(); ++index) {
+    const InputStreamManager& manager = input_stream_managers_[index];
+    InputStreamMetrics stream;
+    stream.name = manager.Name();
+    stream.calculator = tool::CanonicalNodeName(
+        validated_graph_->Config(),
+        input_stream_infos[index].parent_node.index);
+    stream.queue_size = manager.QueueSize();
+    stream.max_queue_size = manager.MaxQueueSize();
+    metrics->input_streams.push_back(std::move(stream));
+  }
+
+  // Throttling.
+  {
+    absl::MutexLock lock(&full_input_streams_mutex_);
+    for (const auto& full_streams : full_input_streams_) {
+      if (!full_streams.empty()) {
+        ++metrics->throttled_nodes;
+      }
+    }
+  }
+  metrics->throttle_events = num_throttle_events_;
+}
+
 ::mediapipe::Status CalculatorGraph::GetCalculatorProfiles(
     std::vector<CalculatorProfile>* profiles) const {
   return profiler_->GetCalculatorProfiles(profiles);
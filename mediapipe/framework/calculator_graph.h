@@ -35,6 +35,7 @@
 #include "mediapipe/framework/calculator_base.h"
 #include "mediapipe/framework/calculator_node.h"
 #include "mediapipe/framework/counter_factory.h"
+#include "mediapipe/framework/deadline_tracker.h"
 #include "mediapipe/framework/executor.h"
 #include "mediapipe/framework/graph_output_stream.h"
 #include "mediapipe/framework/graph_service.h"
@@ -50,6 +51,8 @@
 #include "mediapipe/framework/port.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/profiler/metrics_reporter.h"
+#include "mediapipe/framework/profiler/metrics_sink.h"
 #include "mediapipe/framework/scheduler.h"
 #include "mediapipe/framework/thread_pool_executor.pb.h"
 
@@ -341,6 +344,12 @@ class CalculatorGraph {
   ::mediapipe::Status SetExecutor(const std::string& name,
                                   std::shared_ptr<Executor> executor);
 
+  // Adds a sink that receives the metrics snapshots taken every
+  // ProfilerConfig::metrics_interval_usec while the graph runs. The sinks
+  // named in the ProfilerConfig are added when the graph is initialized.
+  // Must be called before StartRun().
+  ::mediapipe::Status AddMetricsSink(std::shared_ptr<MetricsSink> sink);
+
   // WARNING: the following public methods are exposed to Scheduler only.
 
   // Return true if all the graph input streams have been closed.
@@ -490,6 +499,7 @@ class CalculatorGraph {
       const std::map<std::string, Packet>& side_packets);
   ::mediapipe::Status InitializeStreams();
   ::mediapipe::Status InitializeProfiler();
+  ::mediapipe::Status InitializeMetricsSinks();
   ::mediapipe::Status InitializeCalculatorNodes();
 
   // Iterates through all nodes and schedules any that can be opened.
@@ -532,6 +542,12 @@ class CalculatorGraph {
   // status before taking any action.
   void UpdateThrottledNodes(InputStreamManager* stream, bool* stream_was_full);
 
+  // Fills in a metrics snapshot of the calculator runtimes, input stream
+  // queue sizes, throttled nodes and executor runtimes. Called periodically
+  // by the MetricsReporter while the graph runs.
+  void CollectMetrics(GraphMetrics* metrics)
+      ABSL_LOCKS_EXCLUDED(full_input_streams_mutex_);
+
   Packet GetServicePacket(const GraphServiceBase& service);
 #ifndef MEDIAPIPE_DISABLE_GPU
   // Owns the legacy GpuSharedData if we need to create one for backwards
@@ -637,6 +653,18 @@ class CalculatorGraph {
   // TODO: update this comment.
   std::atomic<unsigned int> num_closed_graph_input_streams_;
 
+  // The number of times a source node or graph input stream has become
+  // throttled, for the metrics snapshots.
+  std::atomic<int64> num_throttle_events_{0};
+
+  // The sinks for the metrics snapshots.
+  std::vector<std::shared_ptr<MetricsSink>> metrics_sinks_;
+
+  // Records the arrival of input timestamps during a run, if the graph has a
+  // latency budget or the application provided kDeadlineTrackerService. It is
+  // declared before the Scheduler, whose queues read it.
+  std::shared_ptr<DeadlineTracker> deadline_tracker_;
+
   // The graph tracing and profiling interface.  It is owned by the
   // CalculatorGraph using a shared_ptr in order to allow threadsafe access
   // to the ProfilingContext from clients that may outlive the CalculatorGraph
@@ -645,6 +673,11 @@ class CalculatorGraph {
   std::shared_ptr<ProfilingContext> profiler_;
 
   internal::Scheduler scheduler_;
+
+  // Takes the periodic metrics snapshots during a run. It is declared after
+  // the Scheduler so that it stops before the nodes and streams it reads are
+  // destroyed.
+  std::unique_ptr<MetricsReporter> metrics_reporter_;
 };
 
 }  // namespace mediapipe
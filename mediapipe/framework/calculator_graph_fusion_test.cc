@@ -0,0 +1,240 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/thread_pool_executor.h"
+#include "mediapipe/framework/tool/sink.h"
+#include "mediapipe/framework/validated_graph_config.h"
+
+namespace mediapipe {
+namespace {
+
+using ThreadIds = std::vector<std::thread::id>;
+
+// Appends the id of the thread running Process() to the input ThreadIds.
+class AppendThreadIdCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).Set<ThreadIds>();
+    cc->Outputs().Index(0).Set<ThreadIds>();
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Process(CalculatorContext* cc) final {
+    auto thread_ids =
+        absl::make_unique<ThreadIds>(cc->Inputs().Index(0).Get<ThreadIds>());
+    thread_ids->push_back(std::this_thread::get_id());
+    cc->Outputs().Index(0).Add(thread_ids.release(), cc->InputTimestamp());
+    return ::mediapipe::OkStatus();
+  }
+};
+REGISTER_CALCULATOR(AppendThreadIdCalculator);
+
+// Counts the tasks added by the scheduler.
+class CountingExecutor : public ThreadPoolExecutor {
+ public:
+  explicit CountingExecutor(int num_threads)
+      : ThreadPoolExecutor(num_threads) {}
+
+  void AddTask(TaskQueue* task_queue) override {
+    ++num_tasks_;
+    ThreadPoolExecutor::AddTask(task_queue);
+  }
+
+  int num_tasks() const { return num_tasks_; }
+
+ private:
+  std::atomic<int> num_tasks_{0};
+};
+
+CalculatorGraphConfig FusionCandidatesConfig() {
+  return ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+    input_stream: "in"
+    enable_node_fusion: true
+    executor { name: "other" type: "ThreadPoolExecutor" }
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "in"
+      output_stream: "a"
+    }
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "a"
+      output_stream: "b"
+    }
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "b"
+      output_stream: "c"
+    }
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "c"
+      output_stream: "d"
+      disable_fusion: true
+    }
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "d"
+      output_stream: "e"
+      input_stream_handler {
+        input_stream_handler: "ImmediateInputStreamHandler"
+      }
+    }
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "e"
+      output_stream: "f"
+    }
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "e"
+      output_stream: "g"
+    }
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "f"
+      input_stream: "g"
+      output_stream: "h1"
+      output_stream: "h2"
+    }
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "h1"
+      output_stream: "i"
+    }
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "i"
+      output_stream: "j"
+      max_in_flight: 2
+    }
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "j"
+      output_stream: "k"
+      executor: "other"
+    }
+  )");
+}
+
+TEST(CalculatorGraphFusionTest, FusesLinearChains) {
+  ValidatedGraphConfig validated_graph;
+  MP_ASSERT_OK(validated_graph.Initialize(FusionCandidatesConfig()));
+  std::vector<int> fused_predecessors;
+  for (int i = 0; i < validated_graph.CalculatorInfos().size(); ++i) {
+    fused_predecessors.push_back(validated_graph.FusedPredecessor(i));
+  }
+  // Only "b" and "c" are fused. The other nodes read a graph input stream,
+  // opt out, use another input stream handler, read a stream with two
+  // consumers, have two inputs or outputs, read a stream of a node with two
+  // outputs, run in parallel or run on another executor.
+  EXPECT_THAT(fused_predecessors,
+              testing::ElementsAre(-1, 0, 1, -1, -1, -1, -1, -1, -1, -1, -1));
+}
+
+TEST(CalculatorGraphFusionTest, FusionIsOptIn) {
+  CalculatorGraphConfig config = FusionCandidatesConfig();
+  config.clear_enable_node_fusion();
+  ValidatedGraphConfig validated_graph;
+  MP_ASSERT_OK(validated_graph.Initialize(config));
+  for (int i = 0; i < validated_graph.CalculatorInfos().size(); ++i) {
+    EXPECT_EQ(-1, validated_graph.FusedPredecessor(i));
+  }
+}
+
+TEST(CalculatorGraphFusionTest, RunsFusedNodesOnProducerThread) {
+  CalculatorGraphConfig config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: "in"
+        enable_node_fusion: true
+        node {
+          calculator: "AppendThreadIdCalculator"
+          input_stream: "in"
+          output_stream: "a"
+        }
+        node {
+          calculator: "AppendThreadIdCalculator"
+          input_stream: "a"
+          output_stream: "b"
+        }
+        node {
+          calculator: "AppendThreadIdCalculator"
+          input_stream: "b"
+          output_stream: "out"
+        }
+        profiler_config { enable_profiler: true }
+      )");
+  std::vector<Packet> outputs;
+  tool::AddVectorSink("out", &config, &outputs);
+  // Fusion is best effort. With more than one thread, a fused node that
+  // finishes after its predecessor's next output may be queued, and run on
+  // another thread.
+  auto executor = std::make_shared<CountingExecutor>(/*num_threads=*/1);
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.SetExecutor("", executor));
+  MP_ASSERT_OK(graph.Initialize(config));
+  MP_ASSERT_OK(graph.StartRun({}));
+  constexpr int kNumPackets = 20;
+  for (int i = 0; i < kNumPackets; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "in", MakePacket<ThreadIds>().At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  ASSERT_EQ(kNumPackets, outputs.size());
+  for (int i = 0; i < kNumPackets; ++i) {
+    EXPECT_EQ(Timestamp(i), outputs[i].Timestamp());
+    const ThreadIds& thread_ids = outputs[i].Get<ThreadIds>();
+    ASSERT_EQ(3, thread_ids.size());
+    EXPECT_EQ(thread_ids[0], thread_ids[1]);
+    EXPECT_EQ(thread_ids[1], thread_ids[2]);
+  }
+  // Without fusion, each of the four nodes, including the sink, would need a
+  // task per packet. With fusion, the whole chain runs in the task of the
+  // first node, and only opening the nodes and closing the first one take
+  // more tasks.
+  EXPECT_LT(executor->num_tasks(), 2 * kNumPackets);
+
+  // Fused nodes are still profiled separately.
+  std::vector<CalculatorProfile> profiles;
+  MP_ASSERT_OK(graph.profiler()->GetCalculatorProfiles(&profiles));
+  int num_profiles = 0;
+  for (const CalculatorProfile& profile : profiles) {
+    if (profile.name().find("AppendThreadIdCalculator") == std::string::npos) {
+      continue;
+    }
+    ++num_profiles;
+    const auto& counts = profile.process_runtime().count();
+    EXPECT_EQ(kNumPackets, std::accumulate(counts.begin(), counts.end(), 0));
+  }
+  EXPECT_EQ(3, num_profiles);
+}
+
+}  // namespace
+}  // namespace mediapipe
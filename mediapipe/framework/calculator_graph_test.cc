@@ -16,11 +16,14 @@
 
 #include <pthread.h>
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <ctime>
 #include <deque>
 #include <map>
 #include <memory>
+#include <thread>  // NOLINT(build/c++11)
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -44,6 +47,7 @@
 #include "mediapipe/framework/output_stream_poller.h"
 #include "mediapipe/framework/packet_set.h"
 #include "mediapipe/framework/packet_type.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/canonical_errors.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
@@ -4231,6 +4235,197 @@ TEST(CalculatorGraph, NumThreadsAndNonDefaultExecutorConfig) {
   MP_EXPECT_OK(graph.Initialize(config));
 }
 
+// An executor can be pinned to the CPUs of a NUMA node, which must exist.
+TEST(CalculatorGraph, ExecutorOnMissingNumaNode) {
+  CalculatorGraph graph;
+  CalculatorGraphConfig config =
+      ::mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: 'in'
+        executor {
+          name: 'socket1000'
+          type: 'ThreadPoolExecutor'
+          options {
+            [mediapipe.ThreadPoolExecutorOptions.ext] {
+              num_threads: 2
+              numa_node: 1000
+              pin_each_thread: true
+            }
+          }
+        }
+        node {
+          calculator: 'PassThroughCalculator'
+          executor: 'socket1000'
+          input_stream: 'in'
+          output_stream: 'out'
+        }
+      )");
+  ::mediapipe::Status status = graph.Initialize(config);
+  EXPECT_EQ(status.code(), ::mediapipe::StatusCode::kInvalidArgument);
+  EXPECT_THAT(status.message(), testing::HasSubstr("NUMA node 1000"));
+}
+
+TEST(CalculatorGraph, ExecutorWithCpuIdsAndNumaNode) {
+  CalculatorGraph graph;
+  CalculatorGraphConfig config =
+      ::mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: 'in'
+        executor {
+          name: 'xyz'
+          type: 'ThreadPoolExecutor'
+          options {
+            [mediapipe.ThreadPoolExecutorOptions.ext] {
+              num_threads: 1
+              cpu_ids: 0
+              numa_node: 0
+            }
+          }
+        }
+        node {
+          calculator: 'PassThroughCalculator'
+          executor: 'xyz'
+          input_stream: 'in'
+          output_stream: 'out'
+        }
+      )");
+  ::mediapipe::Status status = graph.Initialize(config);
+  EXPECT_EQ(status.code(), ::mediapipe::StatusCode::kInvalidArgument);
+  EXPECT_THAT(status.message(), testing::HasSubstr("cpu_ids and numa_node"));
+}
+
+// Busy-waits for 100 microseconds on each packet, like a compute-bound
+// calculator.
+class BusyWaitCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).SetAny();
+    cc->Outputs().Index(0).SetSameAs(&cc->Inputs().Index(0));
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Process(CalculatorContext* cc) final {
+    const absl::Time end = absl::Now() + absl::Microseconds(100);
+    while (absl::Now() < end) {
+    }
+    cc->Outputs().Index(0).AddPacket(cc->Inputs().Index(0).Value());
+    return ::mediapipe::OkStatus();
+  }
+};
+REGISTER_CALCULATOR(BusyWaitCalculator);
+
+// Returns a graph of four BusyWaitCalculators in a chain, run by two threads.
+// If "cpu_ids" is not empty, each thread is pinned to one of them.
+CalculatorGraphConfig BusyWaitGraphConfig(const std::vector<int>& cpu_ids) {
+  CalculatorGraphConfig config =
+      ::mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: 'in'
+        executor {
+          type: 'ThreadPoolExecutor'
+          options {
+            [mediapipe.ThreadPoolExecutorOptions.ext] { num_threads: 2 }
+          }
+        }
+        node {
+          calculator: 'BusyWaitCalculator'
+          input_stream: 'in'
+          output_stream: 'a'
+        }
+        node {
+          calculator: 'BusyWaitCalculator'
+          input_stream: 'a'
+          output_stream: 'b'
+        }
+        node {
+          calculator: 'BusyWaitCalculator'
+          input_stream: 'b'
+          output_stream: 'c'
+        }
+        node {
+          calculator: 'BusyWaitCalculator'
+          input_stream: 'c'
+          output_stream: 'out'
+        }
+      )");
+  ThreadPoolExecutorOptions* options =
+      config.mutable_executor(0)->mutable_options()->MutableExtension(
+          ThreadPoolExecutorOptions::ext);
+  for (int cpu : cpu_ids) {
+    options->add_cpu_ids(cpu);
+  }
+  options->set_pin_each_thread(!cpu_ids.empty());
+  return config;
+}
+
+// Measures the latency of packets through one graph while a second graph runs
+// concurrently. With "pinned", the threads of each graph are pinned to CPUs
+// of their own, as far as there are enough CPUs. Reports the mean and the
+// standard deviation of the latency in microseconds.
+void BM_TwoGraphsLatency(benchmark::State& state) {
+  const bool pinned = state.range(0);
+  const int num_cpus = std::max<int>(std::thread::hardware_concurrency(), 1);
+  CalculatorGraph graphs[2];
+  std::vector<OutputStreamPoller> pollers;
+  for (int g = 0; g < 2; ++g) {
+    std::vector<int> cpu_ids;
+    if (pinned) {
+      cpu_ids = {(2 * g) % num_cpus, (2 * g + 1) % num_cpus};
+    }
+    CHECK(graphs[g].Initialize(BusyWaitGraphConfig(cpu_ids)).ok());
+    auto status_or_poller = graphs[g].AddOutputStreamPoller("out");
+    CHECK(status_or_poller.ok());
+    pollers.push_back(std::move(status_or_poller.ValueOrDie()));
+    CHECK(graphs[g].StartRun({}).ok());
+  }
+
+  // The second graph processes packets until the benchmark is done.
+  std::atomic<bool> done(false);
+  std::thread background([&graphs, &pollers, &done] {
+    Packet packet;
+    for (int64 i = 0; !done; ++i) {
+      CHECK(graphs[1]
+                .AddPacketToInputStream("in",
+                                        MakePacket<int>(0).At(Timestamp(i)))
+                .ok());
+      CHECK(pollers[1].Next(&packet));
+    }
+  });
+
+  std::vector<double> latencies_us;
+  Packet packet;
+  int64 timestamp = 0;
+  for (auto _ : state) {
+    const absl::Time start = absl::Now();
+    CHECK(graphs[0]
+              .AddPacketToInputStream(
+                  "in", MakePacket<int>(0).At(Timestamp(timestamp++)))
+              .ok());
+    CHECK(pollers[0].Next(&packet));
+    latencies_us.push_back(absl::ToDoubleMicroseconds(absl::Now() - start));
+  }
+  done = true;
+  background.join();
+  for (CalculatorGraph& graph : graphs) {
+    CHECK(graph.CloseAllInputStreams().ok());
+    CHECK(graph.WaitUntilDone().ok());
+  }
+
+  double sum = 0.0;
+  double sum_of_squares = 0.0;
+  for (double latency : latencies_us) {
+    sum += latency;
+    sum_of_squares += latency * latency;
+  }
+  const double count = std::max<size_t>(latencies_us.size(), 1);
+  const double mean = sum / count;
+  state.counters["mean_us"] = mean;
+  state.counters["stddev_us"] =
+      std::sqrt(std::max(sum_of_squares / count - mean * mean, 0.0));
+}
+BENCHMARK(BM_TwoGraphsLatency)
+    ->ArgName("pinned")
+    ->Arg(0)
+    ->Arg(1)
+    ->UseRealTime();
+
 // Verifies that the application thread is used only when
 // "ApplicationThreadExecutor" is specified.  In this test
 // "ApplicationThreadExecutor" is specified in the ExecutorConfig for the
@@ -88,12 +88,12 @@ Timestamp CalculatorNode::SourceProcessOrder(
       validated_graph_->Config().node(node_id_);
   name_ = tool::CanonicalNodeName(validated_graph_->Config(), node_id_);
 
-  max_in_flight_ = node_config.max_in_flight();
-  max_in_flight_ = max_in_flight_ ? max_in_flight_ : 1;
+  max_in_flight_ = validated_graph_->MaxInFlight(node_id_);
   if (!node_config.executor().empty()) {
     executor_ = node_config.executor();
   }
   source_layer_ = node_config.source_layer();
+  fused_predecessor_id_ = validated_graph_->FusedPredecessor(node_id_);
 
   const NodeTypeInfo& node_type_info =
       validated_graph_->CalculatorInfos()[node_id_];
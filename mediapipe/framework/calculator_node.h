@@ -160,6 +160,15 @@ class CalculatorNode {
 
   int source_layer() const { return source_layer_; }
 
+  // Returns the maximum number of invocations of the node that can be
+  // scheduled at the same time.
+  int max_in_flight() const { return max_in_flight_; }
+
+  // Returns the id of the node that this node is fused with, or -1. While the
+  // fused predecessor runs, invocations of this node that it makes ready are
+  // run on the same thread right after it, instead of being queued.
+  int fused_predecessor_id() const { return fused_predecessor_id_; }
+
   // Checks if the node can be scheduled; if so, increases current_in_flight_
   // and returns true; otherwise, returns false.
   // If true is returned, the scheduler must commit to executing the node, and
@@ -295,6 +304,8 @@ class CalculatorNode {
   std::string executor_;
   // The layer a source calculator operates on.
   int source_layer_ = 0;
+  // The id of the node this node is fused with, or -1 if it is not fused.
+  int fused_predecessor_id_ = -1;
   // The status of the current Calculator that this CalculatorNode
   // is wrapping.  kStateActive is currently used only for source nodes.
   enum NodeStatus {
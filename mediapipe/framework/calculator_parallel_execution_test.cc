@@ -19,6 +19,7 @@
 //
 // TODO: Add more tests to verify the correctness of parallel execution.
 
+#include <atomic>
 #include <memory>
 #include <random>
 #include <string>
@@ -77,6 +78,52 @@ class SlowPlusOneCalculator : public CalculatorBase {
 
 REGISTER_CALCULATOR(SlowPlusOneCalculator);
 
+// Counts concurrent Process calls of StatelessParallelCalculator.
+std::atomic<int> num_running(0);
+std::atomic<int> max_num_running(0);
+std::atomic<int> num_context_states(0);
+
+// Scratch space that may be used by only one Process call at a time.
+struct ContextScratch {
+  std::atomic<bool> in_use{false};
+};
+
+// Declares its own parallelism, and finishes later timestamps sooner so that
+// its outputs need to be reordered.
+class StatelessParallelCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).Set<int>();
+    cc->Outputs().Index(0).Set<int>();
+    cc->SetTimestampOffset(TimestampDiff(0));
+    cc->SetMaxInFlight(4);
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Process(CalculatorContext* cc) override {
+    ContextScratch* scratch = cc->ContextState<ContextScratch>();
+    if (scratch == nullptr) {
+      cc->SetContextState(absl::make_unique<ContextScratch>());
+      scratch = cc->ContextState<ContextScratch>();
+      ++num_context_states;
+    }
+    RET_CHECK(!scratch->in_use.exchange(true));
+    int running = ++num_running;
+    int max_running = max_num_running.load();
+    while (running > max_running &&
+           !max_num_running.compare_exchange_weak(max_running, running)) {
+    }
+    const int value = cc->Inputs().Index(0).Get<int>();
+    absl::SleepFor(absl::Milliseconds(4 * (4 - value % 4)));
+    cc->Outputs().Index(0).AddPacket(cc->Inputs().Index(0).Value());
+    --num_running;
+    scratch->in_use.store(false);
+    return ::mediapipe::OkStatus();
+  }
+};
+
+REGISTER_CALCULATOR(StatelessParallelCalculator);
+
 class ParallelExecutionTest : public testing::Test {
  public:
   void AddThreadSafeVectorSink(const Packet& packet) {
@@ -153,5 +200,52 @@ TEST_F(ParallelExecutionTest, SlowPlusOneCalculatorsTest) {
   }
 }
 
+TEST_F(ParallelExecutionTest, ContractMaxInFlightOrdersOutput) {
+  CalculatorGraphConfig graph_config =
+      ::mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: "input"
+        node {
+          calculator: "StatelessParallelCalculator"
+          input_stream: "input"
+          output_stream: "output"
+        }
+        node {
+          calculator: "CallbackCalculator"
+          input_stream: "output"
+          input_side_packet: "CALLBACK:callback"
+        }
+        num_threads: 4
+      )");
+  num_running = 0;
+  max_num_running = 0;
+  num_context_states = 0;
+
+  CalculatorGraph graph(graph_config);
+  MP_ASSERT_OK(graph.StartRun(
+      {{"callback", MakePacket<std::function<void(const Packet&)>>(std::bind(
+                        &ParallelExecutionTest::AddThreadSafeVectorSink, this,
+                        std::placeholders::_1))}}));
+  const int kTotalNums = 40;
+  for (int i = 0; i < kTotalNums; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "input", MakePacket<int>(i).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.CloseInputStream("input"));
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  absl::ReaderMutexLock lock(&output_packets_mutex_);
+  ASSERT_EQ(kTotalNums, output_packets_.size());
+  for (int i = 0; i < kTotalNums; ++i) {
+    EXPECT_EQ(i, output_packets_[i].Get<int>());
+    EXPECT_EQ(Timestamp(i), output_packets_[i].Timestamp());
+  }
+  EXPECT_GT(max_num_running, 1);
+  EXPECT_LE(max_num_running, 4);
+  // Contexts, and the state attached to them, are reused across timestamps.
+  // A context is recycled once its outputs are released in timestamp order,
+  // so there may be more contexts than concurrent calls.
+  EXPECT_LT(num_context_states, kTotalNums);
+}
+
 }  // namespace
 }  // namespace mediapipe
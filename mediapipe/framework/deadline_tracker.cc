@@ -0,0 +1,127 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/deadline_tracker.h"
+
+#include <utility>
+
+#include "absl/time/time.h"
+#include "mediapipe/framework/deps/monotonic_clock.h"
+
+namespace mediapipe {
+
+const GraphService<DeadlineTracker> kDeadlineTrackerService(
+    "kDeadlineTrackerService");
+
+constexpr int DeadlineTracker::kNumSlots;
+constexpr int DeadlineTracker::kSlotsPerSet;
+constexpr int64 DeadlineTracker::kUnknownArrival;
+constexpr int64 DeadlineTracker::kEmpty;
+
+DeadlineTracker::DeadlineTracker(int64 latency_budget_usec,
+                                 std::shared_ptr<Clock> clock)
+    : latency_budget_usec_(latency_budget_usec), clock_(std::move(clock)) {
+  if (clock_ == nullptr) {
+    clock_.reset(MonotonicClock::CreateSynchronizedMonotonicClock());
+  }
+}
+
+int64 DeadlineTracker::NowUsec() const {
+  return absl::ToUnixMicros(clock_->TimeNow());
+}
+
+// Timestamps are often evenly spaced, so they are spread over the sets by
+// multiplicative hashing.
+int DeadlineTracker::SetIndex(Timestamp timestamp) {
+  constexpr int kSetBits = 9;
+  static_assert((kSlotsPerSet << kSetBits) == kNumSlots,
+                "kSetBits must match.");
+  const uint64 hash =
+      static_cast<uint64>(timestamp.Value()) * uint64{0x9E3779B97F4A7C15};
+  return static_cast<int>(hash >> (64 - kSetBits)) * kSlotsPerSet;
+}
+
+int64 DeadlineTracker::ReadArrival(const Slot& slot, int64 timestamp) {
+  if (slot.timestamp.load(std::memory_order_acquire) != timestamp) {
+    return kUnknownArrival;
+  }
+  const int64 arrival_usec = slot.arrival_usec.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot.timestamp.load(std::memory_order_relaxed) != timestamp) {
+    return kUnknownArrival;
+  }
+  return arrival_usec;
+}
+
+void DeadlineTracker::RecordArrival(Timestamp timestamp) {
+  if (!timestamp.IsRangeValue()) {
+    return;
+  }
+  // Replaces the oldest timestamp of the set. Empty slots hold kEmpty, which
+  // is older than any timestamp.
+  Slot* set = &slots_[SetIndex(timestamp)];
+  Slot* oldest = nullptr;
+  int64 oldest_timestamp = kint64max;
+  for (int i = 0; i < kSlotsPerSet; ++i) {
+    const int64 slot_timestamp =
+        set[i].timestamp.load(std::memory_order_acquire);
+    if (slot_timestamp == timestamp.Value()) {
+      return;
+    }
+    if (slot_timestamp < oldest_timestamp) {
+      oldest = &set[i];
+      oldest_timestamp = slot_timestamp;
+    }
+  }
+  // Two timestamps that share a set may be recorded concurrently, in which
+  // case they may pick the same slot, and one of them may get the arrival of
+  // the other or be lost. Both arrived at about the same time, so this is
+  // harmless.
+  Slot& slot = *oldest;
+  slot.timestamp.store(kEmpty, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.arrival_usec.store(NowUsec(), std::memory_order_relaxed);
+  slot.timestamp.store(timestamp.Value(), std::memory_order_release);
+}
+
+int64 DeadlineTracker::ArrivalUsec(Timestamp timestamp) const {
+  if (!timestamp.IsRangeValue()) {
+    return kUnknownArrival;
+  }
+  const Slot* set = &slots_[SetIndex(timestamp)];
+  for (int i = 0; i < kSlotsPerSet; ++i) {
+    const int64 arrival_usec = ReadArrival(set[i], timestamp.Value());
+    if (arrival_usec != kUnknownArrival) {
+      return arrival_usec;
+    }
+  }
+  return kUnknownArrival;
+}
+
+int64 DeadlineTracker::RemainingUsec(Timestamp timestamp) const {
+  const int64 arrival_usec = ArrivalUsec(timestamp);
+  if (arrival_usec == kUnknownArrival) {
+    return kint64max;
+  }
+  return arrival_usec + latency_budget_usec_ - NowUsec();
+}
+
+void DeadlineTracker::Reset() {
+  for (Slot& slot : slots_) {
+    slot.timestamp.store(kEmpty, std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,120 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_DEADLINE_TRACKER_H_
+#define MEDIAPIPE_FRAMEWORK_DEADLINE_TRACKER_H_
+
+#include <atomic>
+#include <memory>
+
+#include "mediapipe/framework/deps/clock.h"
+#include "mediapipe/framework/graph_service.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/timestamp.h"
+
+namespace mediapipe {
+
+// Records the wall-clock time at which each input timestamp arrived in the
+// graph, and the deadline by which it should have been processed.
+//
+// When CalculatorGraphConfig.latency_budget_usec is set, the graph records
+// the arrival of the first packet added at each timestamp with
+// CalculatorGraph::AddPacketToInputStream(). The scheduler then runs
+// invocations for older timestamps first, and calculators such as
+// FlowLimiterCalculator can drop timestamps that can no longer meet their
+// deadline. Calculators get the tracker through kDeadlineTrackerService:
+//
+//   static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+//     cc->UseService(kDeadlineTrackerService).Optional();
+//     ...
+//   }
+//   ::mediapipe::Status Process(CalculatorContext* cc) {
+//     auto deadlines = cc->Service(kDeadlineTrackerService);
+//     if (deadlines.IsAvailable() &&
+//         deadlines.GetObject().RemainingUsec(cc->InputTimestamp()) < 0) {
+//       return ::mediapipe::OkStatus();  // Too late to be useful.
+//     }
+//     ...
+//   }
+//
+// Arrivals are kept in a fixed number of slots. Each timestamp hashes to a
+// set of kSlotsPerSet slots, and a new arrival replaces the oldest timestamp
+// of its set. A lookup can therefore miss a recent timestamp when more than
+// kSlotsPerSet recent timestamps hash to the same set, and then reports it as
+// unknown. All methods are thread-safe and lock-free.
+class DeadlineTracker {
+ public:
+  // The number of timestamps whose arrival can be remembered at once.
+  static constexpr int kNumSlots = 1024;
+  static constexpr int kSlotsPerSet = 2;
+
+  // Returned by ArrivalUsec() for timestamps without a recorded arrival.
+  static constexpr int64 kUnknownArrival = kint64max;
+
+  // Measures arrivals with "clock", or with a monotonic clock if it is null.
+  explicit DeadlineTracker(int64 latency_budget_usec,
+                           std::shared_ptr<Clock> clock = nullptr);
+  DeadlineTracker(const DeadlineTracker&) = delete;
+  DeadlineTracker& operator=(const DeadlineTracker&) = delete;
+
+  int64 latency_budget_usec() const { return latency_budget_usec_; }
+
+  // Returns the current time of the tracker's clock, in microseconds.
+  int64 NowUsec() const;
+
+  // Records that a packet at "timestamp" arrived now, unless an arrival was
+  // already recorded for it.
+  void RecordArrival(Timestamp timestamp);
+
+  // Returns the arrival time of "timestamp", in microseconds, or
+  // kUnknownArrival if it was not recorded or has been forgotten.
+  int64 ArrivalUsec(Timestamp timestamp) const;
+
+  // Returns the time left before the deadline of "timestamp", in
+  // microseconds. This is negative once the deadline has passed, and
+  // kint64max if the arrival of "timestamp" is unknown.
+  int64 RemainingUsec(Timestamp timestamp) const;
+
+  // Forgets all arrivals. Called by the graph at the start of each run.
+  void Reset();
+
+ private:
+  // Slot::timestamp is set to kEmpty while Slot::arrival_usec is written, so
+  // that readers can detect a torn read by loading the timestamp twice.
+  struct Slot {
+    std::atomic<int64> timestamp{kEmpty};
+    std::atomic<int64> arrival_usec{0};
+  };
+  static constexpr int64 kEmpty = kint64min;
+
+  // Returns the index of the first slot of the set of "timestamp".
+  static int SetIndex(Timestamp timestamp);
+  // Returns the arrival recorded for "timestamp" in "slot", or
+  // kUnknownArrival.
+  static int64 ReadArrival(const Slot& slot, int64 timestamp);
+
+  const int64 latency_budget_usec_;
+  std::shared_ptr<Clock> clock_;
+  Slot slots_[kNumSlots];
+};
+
+// The graph provides a DeadlineTracker through this service when
+// CalculatorGraphConfig.latency_budget_usec is set, unless one was set with
+// CalculatorGraph::SetServiceObject(). Calculators should request it as
+// optional.
+extern const GraphService<DeadlineTracker> kDeadlineTrackerService;
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_DEADLINE_TRACKER_H_
@@ -0,0 +1,154 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/deadline_tracker.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/deps/clock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+// A clock that advances only when told to.
+class ManualClock : public Clock {
+ public:
+  absl::Time TimeNow() override { return now_; }
+  void Sleep(absl::Duration d) override { now_ += d; }
+  void SleepUntil(absl::Time wakeup_time) override {
+    now_ = std::max(now_, wakeup_time);
+  }
+
+ private:
+  absl::Time now_ = absl::UnixEpoch();
+};
+
+TEST(DeadlineTrackerTest, KeepsFirstArrival) {
+  auto clock = std::make_shared<ManualClock>();
+  DeadlineTracker tracker(/*latency_budget_usec=*/1000, clock);
+  tracker.RecordArrival(Timestamp(5));
+  clock->Sleep(absl::Microseconds(300));
+  tracker.RecordArrival(Timestamp(5));
+  tracker.RecordArrival(Timestamp(6));
+
+  EXPECT_EQ(0, tracker.ArrivalUsec(Timestamp(5)));
+  EXPECT_EQ(300, tracker.ArrivalUsec(Timestamp(6)));
+  EXPECT_EQ(700, tracker.RemainingUsec(Timestamp(5)));
+  clock->Sleep(absl::Microseconds(1000));
+  EXPECT_EQ(-300, tracker.RemainingUsec(Timestamp(5)));
+}
+
+TEST(DeadlineTrackerTest, UnknownArrivals) {
+  DeadlineTracker tracker(/*latency_budget_usec=*/1000);
+  tracker.RecordArrival(Timestamp::PreStream());
+  EXPECT_EQ(DeadlineTracker::kUnknownArrival,
+            tracker.ArrivalUsec(Timestamp::PreStream()));
+  EXPECT_EQ(DeadlineTracker::kUnknownArrival,
+            tracker.ArrivalUsec(Timestamp(1)));
+  EXPECT_EQ(kint64max, tracker.RemainingUsec(Timestamp(1)));
+
+  tracker.RecordArrival(Timestamp(1));
+  EXPECT_NE(DeadlineTracker::kUnknownArrival,
+            tracker.ArrivalUsec(Timestamp(1)));
+  tracker.Reset();
+  EXPECT_EQ(DeadlineTracker::kUnknownArrival,
+            tracker.ArrivalUsec(Timestamp(1)));
+}
+
+// Evenly spaced timestamps, as from a 30 fps camera, do not evict each other.
+TEST(DeadlineTrackerTest, RemembersRecentFrames) {
+  auto clock = std::make_shared<ManualClock>();
+  DeadlineTracker tracker(/*latency_budget_usec=*/100000, clock);
+  constexpr int kNumFrames = 32;
+  for (int i = 0; i < kNumFrames; ++i) {
+    tracker.RecordArrival(Timestamp(i * 33333));
+    clock->Sleep(absl::Microseconds(33333));
+  }
+  for (int i = 0; i < kNumFrames; ++i) {
+    EXPECT_EQ(i * 33333, tracker.ArrivalUsec(Timestamp(i * 33333)));
+  }
+}
+
+// Irregular timestamps may hash to the same set, but a new arrival replaces
+// the oldest timestamp of its set, so recent timestamps are kept.
+TEST(DeadlineTrackerTest, EvictsOldestTimestamps) {
+  auto clock = std::make_shared<ManualClock>();
+  DeadlineTracker tracker(/*latency_budget_usec=*/100000, clock);
+  constexpr int kNumTimestamps = 4 * DeadlineTracker::kNumSlots;
+  constexpr int kNumRecent = 64;
+  std::vector<int64> timestamps;
+  int64 timestamp = 0;
+  for (int i = 0; i < kNumTimestamps; ++i) {
+    // Steps between 1 and 65536 microseconds.
+    timestamp += 1 + (i * 40503) % 65536;
+    timestamps.push_back(timestamp);
+    tracker.RecordArrival(Timestamp(timestamp));
+    clock->Sleep(absl::Microseconds(1));
+  }
+  for (int i = kNumTimestamps - kNumRecent; i < kNumTimestamps; ++i) {
+    EXPECT_EQ(i, tracker.ArrivalUsec(Timestamp(timestamps[i])));
+  }
+}
+
+TEST(DeadlineTrackerTest, GraphRecordsArrivals) {
+  CalculatorGraphConfig config = ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+    input_stream: "input"
+    latency_budget_usec: 5000
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "input"
+      output_stream: "output"
+    }
+  )");
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  MP_ASSERT_OK(graph.StartRun({}));
+  std::shared_ptr<DeadlineTracker> tracker =
+      graph.GetServiceObject(kDeadlineTrackerService);
+  ASSERT_NE(nullptr, tracker);
+  EXPECT_EQ(5000, tracker->latency_budget_usec());
+  MP_ASSERT_OK(graph.AddPacketToInputStream(
+      "input", MakePacket<int>(1).At(Timestamp(7))));
+  EXPECT_NE(DeadlineTracker::kUnknownArrival,
+            tracker->ArrivalUsec(Timestamp(7)));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+TEST(DeadlineTrackerTest, NoTrackerWithoutBudget) {
+  CalculatorGraphConfig config = ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+    input_stream: "input"
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "input"
+      output_stream: "output"
+    }
+  )");
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  MP_ASSERT_OK(graph.StartRun({}));
+  EXPECT_EQ(nullptr, graph.GetServiceObject(kDeadlineTrackerService));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+}  // namespace
+}  // namespace mediapipe
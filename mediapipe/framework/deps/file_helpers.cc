@@ -19,6 +19,9 @@
 #include <direct.h>
 #else
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #endif  // _WIN32
 #include <stdio.h>
 #include <string.h>
@@ -178,6 +181,86 @@ class DirectoryListing {
   return ::mediapipe::OkStatus();
 }
 
+#ifndef _WIN32
+::mediapipe::Status MapContents(absl::string_view file_name,
+                                absl::string_view* contents) {
+  int fd = open(std::string(file_name).c_str(), O_RDONLY);
+  if (fd < 0) {
+    return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+           << "Can't find file: " << file_name;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return ::mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+           << "Error while reading file: " << file_name;
+  }
+  const size_t size = file_stat.st_size;
+  void* data = nullptr;
+  // Empty files cannot be mapped.
+  if (size > 0) {
+    data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  // The mapping stays valid after the file is closed.
+  close(fd);
+  if (data == MAP_FAILED) {
+    return ::mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+           << "Error while mapping file: " << file_name
+           << ". Error message: " << strerror(errno);
+  }
+  *contents = absl::string_view(static_cast<const char*>(data), size);
+  return ::mediapipe::OkStatus();
+}
+
+void UnmapContents(absl::string_view contents) {
+  if (!contents.empty()) {
+    munmap(const_cast<char*>(contents.data()), contents.size());
+  }
+}
+#else
+::mediapipe::Status MapContents(absl::string_view file_name,
+                                absl::string_view* contents) {
+  HANDLE file = CreateFileA(std::string(file_name).c_str(), GENERIC_READ,
+                            FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+           << "Can't find file: " << file_name;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return ::mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+           << "Error while reading file: " << file_name;
+  }
+  void* data = nullptr;
+  // Empty files cannot be mapped.
+  if (size.QuadPart > 0) {
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping != nullptr) {
+      data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      // The view keeps the mapping alive.
+      CloseHandle(mapping);
+    }
+  }
+  CloseHandle(file);
+  if (size.QuadPart > 0 && data == nullptr) {
+    return ::mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+           << "Error while mapping file: " << file_name;
+  }
+  *contents = absl::string_view(static_cast<const char*>(data),
+                                static_cast<size_t>(size.QuadPart));
+  return ::mediapipe::OkStatus();
+}
+
+void UnmapContents(absl::string_view contents) {
+  if (!contents.empty()) {
+    UnmapViewOfFile(contents.data());
+  }
+}
+#endif  // _WIN32
+
 ::mediapipe::Status MatchInTopSubdirectories(
     const std::string& parent_directory, const std::string& file_name,
     std::vector<std::string>* results) {
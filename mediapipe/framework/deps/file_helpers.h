@@ -26,6 +26,14 @@ namespace file {
 ::mediapipe::Status SetContents(absl::string_view file_name,
                                 absl::string_view content);
 
+// Maps the contents of a file into memory, read-only, without reading them.
+// Pages are loaded on demand and are shared with other processes that map the
+// same file. The mapping must be released with UnmapContents.
+::mediapipe::Status MapContents(absl::string_view file_name,
+                                absl::string_view* contents);
+
+void UnmapContents(absl::string_view contents);
+
 ::mediapipe::Status MatchInTopSubdirectories(
     const std::string& parent_directory, const std::string& file_name,
     std::vector<std::string>* results);
@@ -0,0 +1,137 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_DEPS_MPMC_BOUNDED_QUEUE_H_
+#define MEDIAPIPE_DEPS_MPMC_BOUNDED_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace mediapipe {
+
+// A bounded, lock-free, multi-producer multi-consumer FIFO queue (Vyukov).
+//
+// Each slot carries a sequence number that tells producers and consumers
+// whether the slot is free for the current lap of the ring. TryPush() and
+// TryPop() never block; they return false if the queue is full or empty
+// respectively. A TryPop() may also return false while a concurrent
+// TryPush() has claimed a slot but not yet published its value, so callers
+// that know an item is available must retry.
+//
+// T must be default constructible and move assignable.
+template <typename T>
+class MpmcBoundedQueue {
+ public:
+  // The capacity is rounded up to a power of two, and is at least 2.
+  explicit MpmcBoundedQueue(size_t capacity)
+      : mask_(RoundUpToPowerOfTwo(capacity) - 1),
+        slots_(new Slot[mask_ + 1]) {
+    for (size_t i = 0; i <= mask_; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  MpmcBoundedQueue(const MpmcBoundedQueue&) = delete;
+  MpmcBoundedQueue& operator=(const MpmcBoundedQueue&) = delete;
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Moves from "value" only if it returns true.
+  bool TryPush(T&& value) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[pos & mask_];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) -
+                      static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // Full.
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value = std::move(value);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T* value) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[pos & mask_];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) -
+                      static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // Empty, or the next value is not yet published.
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    *value = std::move(slot->value);
+    slot->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns true if no push has claimed a slot beyond the last pop. The result
+  // is only a hint while other threads are active.
+  bool Empty() const {
+    return enqueue_pos_.load(std::memory_order_seq_cst) ==
+           dequeue_pos_.load(std::memory_order_seq_cst);
+  }
+
+  // Returns the number of claimed slots. The result is only a hint while
+  // other threads are active.
+  size_t SizeHint() const {
+    size_t enqueue_pos = enqueue_pos_.load(std::memory_order_acquire);
+    size_t dequeue_pos = dequeue_pos_.load(std::memory_order_acquire);
+    return enqueue_pos >= dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  static size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t capacity = 2;
+    while (capacity < n) capacity <<= 1;
+    return capacity;
+  }
+
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  // Producer and consumer positions on separate cache lines.
+  alignas(64) std::atomic<size_t> enqueue_pos_{0};
+  alignas(64) std::atomic<size_t> dequeue_pos_{0};
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_DEPS_MPMC_BOUNDED_QUEUE_H_
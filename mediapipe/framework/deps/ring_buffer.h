@@ -0,0 +1,113 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_DEPS_RING_BUFFER_H_
+#define MEDIAPIPE_DEPS_RING_BUFFER_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace mediapipe {
+
+// A FIFO queue stored in a single contiguous ring of slots, as a replacement
+// for std::deque in hot paths. Unlike std::deque, which allocates and frees
+// blocks as elements pass through it, the ring only allocates when it grows
+// beyond its largest size so far, so a queue in steady state does not touch
+// the heap. The capacity is always a power of two.
+//
+// T must be default constructible and movable. Popped slots are reset to T(),
+// so that the ring does not keep popped values alive. Not thread-safe.
+template <typename T>
+class RingBuffer {
+ public:
+  explicit RingBuffer(size_t initial_capacity = 16)
+      : slots_(RoundUpToPowerOfTwo(initial_capacity)) {}
+  RingBuffer(const RingBuffer&) = delete;
+  RingBuffer& operator=(const RingBuffer&) = delete;
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+  size_t capacity() const { return slots_.size(); }
+
+  // Returns the i-th element from the front. Requires i < size().
+  T& operator[](size_t i) { return slots_[Index(i)]; }
+  const T& operator[](size_t i) const { return slots_[Index(i)]; }
+
+  T& front() { return slots_[head_]; }
+  const T& front() const { return slots_[head_]; }
+  T& back() { return (*this)[size_ - 1]; }
+  const T& back() const { return (*this)[size_ - 1]; }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    if (size_ == slots_.size()) {
+      Grow(slots_.size() * 2);
+    }
+    T& slot = slots_[Index(size_)];
+    slot = T(std::forward<Args>(args)...);
+    ++size_;
+    return slot;
+  }
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+
+  // Requires !empty().
+  void pop_front() {
+    slots_[head_] = T();
+    head_ = (head_ + 1) & (slots_.size() - 1);
+    --size_;
+  }
+
+  // Removes all elements, keeping the capacity.
+  void clear() {
+    while (!empty()) pop_front();
+    head_ = 0;
+  }
+
+  // Ensures that "capacity" elements fit without growing.
+  void reserve(size_t capacity) {
+    if (capacity > slots_.size()) {
+      Grow(RoundUpToPowerOfTwo(capacity));
+    }
+  }
+
+ private:
+  static size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t capacity = 1;
+    while (capacity < n) capacity *= 2;
+    return capacity;
+  }
+
+  size_t Index(size_t i) const { return (head_ + i) & (slots_.size() - 1); }
+
+  // Moves the elements into a new ring of the given capacity, front first.
+  void Grow(size_t capacity) {
+    std::vector<T> slots(capacity);
+    for (size_t i = 0; i < size_; ++i) {
+      slots[i] = std::move(slots_[Index(i)]);
+    }
+    slots_.swap(slots);
+    head_ = 0;
+  }
+
+  std::vector<T> slots_;
+  // The slot of the front element.
+  size_t head_ = 0;
+  size_t size_ = 0;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_DEPS_RING_BUFFER_H_
@@ -0,0 +1,83 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/deps/ring_buffer.h"
+
+#include <memory>
+
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(RingBufferTest, IsFifo) {
+  RingBuffer<int> ring(/*initial_capacity=*/4);
+  EXPECT_TRUE(ring.empty());
+  for (int i = 0; i < 3; ++i) ring.push_back(i);
+  EXPECT_EQ(3, ring.size());
+  EXPECT_EQ(0, ring.front());
+  EXPECT_EQ(2, ring.back());
+  EXPECT_EQ(1, ring[1]);
+  ring.pop_front();
+  EXPECT_EQ(1, ring.front());
+  EXPECT_EQ(2, ring.size());
+}
+
+TEST(RingBufferTest, WrapsAroundWithoutGrowing) {
+  RingBuffer<int> ring(/*initial_capacity=*/4);
+  for (int i = 0; i < 100; ++i) {
+    ring.push_back(i);
+    ring.push_back(i + 1000);
+    EXPECT_EQ(i, ring.front());
+    ring.pop_front();
+    EXPECT_EQ(i + 1000, ring.front());
+    ring.pop_front();
+  }
+  EXPECT_TRUE(ring.empty());
+  EXPECT_EQ(4, ring.capacity());
+}
+
+TEST(RingBufferTest, GrowsInOrder) {
+  RingBuffer<int> ring(/*initial_capacity=*/3);
+  EXPECT_EQ(4, ring.capacity());
+  // Start the contents in the middle of the ring.
+  ring.push_back(-1);
+  ring.push_back(-1);
+  ring.pop_front();
+  ring.pop_front();
+  for (int i = 0; i < 10; ++i) ring.push_back(i);
+  EXPECT_EQ(16, ring.capacity());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, ring[i]);
+  }
+  ring.reserve(17);
+  EXPECT_EQ(32, ring.capacity());
+  EXPECT_EQ(9, ring.back());
+}
+
+TEST(RingBufferTest, ReleasesPoppedValues) {
+  RingBuffer<std::shared_ptr<int>> ring;
+  auto value = std::make_shared<int>(1);
+  ring.push_back(value);
+  ring.push_back(value);
+  EXPECT_EQ(3, value.use_count());
+  ring.pop_front();
+  EXPECT_EQ(2, value.use_count());
+  ring.clear();
+  EXPECT_EQ(1, value.use_count());
+  EXPECT_TRUE(ring.empty());
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -17,6 +17,7 @@
 
 #include <stddef.h>
 
+#include <iterator>
 #include <set>
 #include <string>
 
@@ -26,7 +27,8 @@ namespace mediapipe {
 // the field descriptions.
 class ThreadOptions {
  public:
-  ThreadOptions() : stack_size_(0), nice_priority_level_(0) {}
+  ThreadOptions()
+      : stack_size_(0), nice_priority_level_(0), pin_each_thread_(false) {}
 
   // Set the thread stack size (in bytes).  Passing stack_size==0 resets
   // the stack size to the default value for the system. The system default
@@ -46,6 +48,14 @@ class ThreadOptions {
     return *this;
   }
 
+  // When true, each worker thread of a pool is pinned to a single CPU of
+  // cpu_set, assigned round-robin in increasing order, instead of every
+  // thread being allowed to run on all of cpu_set.
+  ThreadOptions& set_pin_each_thread(bool pin_each_thread) {
+    pin_each_thread_ = pin_each_thread;
+    return *this;
+  }
+
   ThreadOptions& set_name_prefix(const std::string& name_prefix) {
     name_prefix_ = name_prefix;
     return *this;
@@ -57,12 +67,27 @@ class ThreadOptions {
 
   const std::set<int>& cpu_set() const { return cpu_set_; }
 
+  bool pin_each_thread() const { return pin_each_thread_; }
+
+  // Returns the CPUs that the worker thread with index "worker_index" in a
+  // pool may run on: all of cpu_set(), or a single one of them if
+  // pin_each_thread() is true. An empty set means no restriction.
+  std::set<int> WorkerCpuSet(int worker_index) const {
+    if (!pin_each_thread_ || cpu_set_.empty()) {
+      return cpu_set_;
+    }
+    auto it = cpu_set_.begin();
+    std::advance(it, worker_index % cpu_set_.size());
+    return {*it};
+  }
+
   std::string name_prefix() const { return name_prefix_; }
 
  private:
   size_t stack_size_;        // Size of thread stack
   int nice_priority_level_;  // Nice priority level of the workers
   std::set<int> cpu_set_;    // CPU set for affinity setting
+  bool pin_each_thread_;     // Pin each thread to one CPU of cpu_set_
   std::string name_prefix_;  // Name of the thread
 };
 
@@ -27,8 +27,9 @@ namespace mediapipe {
 
 class ThreadPool::WorkerThread {
  public:
-  // Creates and starts a thread that runs pool->RunWorker().
-  WorkerThread(ThreadPool* pool, const std::string& name_prefix);
+  // Creates and starts a thread that runs pool->RunWorker(). "index" is the
+  // position of the thread in the pool.
+  WorkerThread(ThreadPool* pool, const std::string& name_prefix, int index);
 
   // REQUIRES: Join() must have been called.
   ~WorkerThread();
@@ -41,12 +42,14 @@ class ThreadPool::WorkerThread {
 
   ThreadPool* pool_;
   std::string name_prefix_;
+  int index_;
   pthread_t thread_;
 };
 
 ThreadPool::WorkerThread::WorkerThread(ThreadPool* pool,
-                                       const std::string& name_prefix)
-    : pool_(pool), name_prefix_(name_prefix) {
+                                       const std::string& name_prefix,
+                                       int index)
+    : pool_(pool), name_prefix_(name_prefix), index_(index) {
   int res = pthread_create(&thread_, nullptr, ThreadBody, this);
   CHECK_EQ(res, 0) << "pthread_create failed";
 }
@@ -59,7 +62,8 @@ void* ThreadPool::WorkerThread::ThreadBody(void* arg) {
   auto thread = reinterpret_cast<WorkerThread*>(arg);
   int nice_priority_level =
       thread->pool_->thread_options().nice_priority_level();
-  const std::set<int> selected_cpus = thread->pool_->thread_options().cpu_set();
+  const std::set<int> selected_cpus =
+      thread->pool_->thread_options().WorkerCpuSet(thread->index_);
 #if defined(__linux__)
   const std::string name =
       internal::CreateThreadName(thread->name_prefix_, syscall(SYS_gettid));
@@ -143,7 +147,7 @@ ThreadPool::~ThreadPool() {
 
 void ThreadPool::StartWorkers() {
   for (int i = 0; i < num_threads_; ++i) {
-    threads_.push_back(new WorkerThread(this, name_prefix_));
+    threads_.push_back(new WorkerThread(this, name_prefix_, i));
   }
 }
 
@@ -14,8 +14,14 @@
 
 #include "mediapipe/framework/deps/threadpool.h"
 
+#if defined(__linux__)
+#include <sched.h>
+#endif  // __linux__
+
 #include <set>
+#include <vector>
 
+#include "absl/synchronization/blocking_counter.h"
 #include "absl/synchronization/mutex.h"
 #include "mediapipe/framework/port/gtest.h"
 
@@ -91,6 +97,66 @@ TEST(ThreadPoolTest, CreateWithCPUAffinity) {
   thread_pool.StartWorkers();
 }
 
+TEST(ThreadPoolTest, WorkerCpuSet) {
+  ThreadOptions thread_options = ThreadOptions().set_cpu_set({2, 5, 7});
+  EXPECT_EQ(std::set<int>({2, 5, 7}),
+            thread_options.WorkerCpuSet(/*worker_index=*/1));
+  thread_options.set_pin_each_thread(true);
+  EXPECT_EQ(std::set<int>({2}), thread_options.WorkerCpuSet(0));
+  EXPECT_EQ(std::set<int>({7}), thread_options.WorkerCpuSet(2));
+  EXPECT_EQ(std::set<int>({5}), thread_options.WorkerCpuSet(4));
+  EXPECT_TRUE(
+      ThreadOptions().set_pin_each_thread(true).WorkerCpuSet(0).empty());
+}
+
+#if defined(__linux__)
+TEST(ThreadPoolTest, PinsEachThread) {
+  cpu_set_t allowed;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  std::set<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE && cpus.size() < 2; ++cpu) {
+    if (CPU_ISSET(cpu, &allowed)) {
+      cpus.insert(cpu);
+    }
+  }
+  const int num_threads = cpus.size();
+  absl::Mutex mu;
+  std::vector<std::set<int>> thread_cpus;
+  {
+    ThreadPool thread_pool(
+        ThreadOptions().set_cpu_set(cpus).set_pin_each_thread(true),
+        "testpool", num_threads);
+    thread_pool.StartWorkers();
+    // Every task waits for the others, so each runs on a different thread.
+    absl::BlockingCounter started(num_threads);
+    for (int i = 0; i < num_threads; ++i) {
+      thread_pool.Schedule([&]() {
+        started.DecrementCount();
+        started.Wait();
+        cpu_set_t affinity;
+        CPU_ZERO(&affinity);
+        sched_getaffinity(0, sizeof(affinity), &affinity);
+        std::set<int> thread_cpu_set;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+          if (CPU_ISSET(cpu, &affinity)) {
+            thread_cpu_set.insert(cpu);
+          }
+        }
+        absl::MutexLock l(&mu);
+        thread_cpus.push_back(thread_cpu_set);
+      });
+    }
+  }
+
+  std::set<int> used_cpus;
+  for (const std::set<int>& thread_cpu_set : thread_cpus) {
+    ASSERT_EQ(1, thread_cpu_set.size());
+    used_cpus.insert(*thread_cpu_set.begin());
+  }
+  EXPECT_EQ(cpus, used_cpus);
+}
+#endif  // __linux__
+
 TEST(ThreadPoolTest, CreateThreadName) {
   ASSERT_EQ("name_prefix/123", internal::CreateThreadName("name_prefix", 1234));
   ASSERT_EQ("name_prefix/123",
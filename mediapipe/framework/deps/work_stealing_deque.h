@@ -0,0 +1,163 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_DEPS_WORK_STEALING_DEQUE_H_
+#define MEDIAPIPE_DEPS_WORK_STEALING_DEQUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mediapipe {
+
+// A lock-free single-owner, multi-thief deque of pointers (Chase-Lev), using
+// the memory orderings from "Correct and Efficient Work-Stealing for Weak
+// Memory Models" (Le et al., PPoPP 2013).
+//
+// Only the owning thread may call Push() and Pop(), which operate on the
+// bottom end (LIFO). Any thread may call Steal(), which takes from the top
+// end (FIFO). The deque does not own the pointed-to objects.
+//
+// The ring buffer grows on demand. Retired buffers are kept alive until the
+// deque is destroyed, since a concurrent thief may still be reading from them.
+template <typename T>
+class WorkStealingDeque {
+ public:
+  explicit WorkStealingDeque(int64_t initial_capacity = 256)
+      : buffer_(new Buffer(RoundUpToPowerOfTwo(initial_capacity))) {
+    retired_buffers_.emplace_back(buffer_.load(std::memory_order_relaxed));
+  }
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  // Owner only. Pushes "item" onto the bottom of the deque.
+  void Push(T* item) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    if (bottom - top > buffer->capacity() - 1) {
+      buffer = Grow(buffer, top, bottom);
+    }
+    buffer->Put(bottom, item);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  // Owner only. Pops the most recently pushed item, or returns nullptr if the
+  // deque is empty.
+  T* Pop() {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      // Empty.
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T* item = buffer->Get(bottom);
+    if (top == bottom) {
+      // Last item: race against thieves for it.
+      if (!top_.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // Any thread. Takes the least recently pushed item. Returns nullptr if the
+  // deque is empty or if another thread won the race for the item.
+  T* Steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return nullptr;
+    }
+    Buffer* buffer = buffer_.load(std::memory_order_acquire);
+    T* item = buffer->Get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return item;
+  }
+
+  // Any thread. Returns true if the deque appeared empty at some point during
+  // the call. The result is only a hint while other threads are active.
+  bool Empty() const {
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    int64_t top = top_.load(std::memory_order_acquire);
+    return top >= bottom;
+  }
+
+ private:
+  class Buffer {
+   public:
+    explicit Buffer(int64_t capacity)
+        : capacity_(capacity),
+          mask_(capacity - 1),
+          slots_(new std::atomic<T*>[capacity]) {}
+
+    int64_t capacity() const { return capacity_; }
+
+    T* Get(int64_t index) const {
+      return slots_[index & mask_].load(std::memory_order_relaxed);
+    }
+    void Put(int64_t index, T* item) {
+      slots_[index & mask_].store(item, std::memory_order_relaxed);
+    }
+
+   private:
+    const int64_t capacity_;
+    const int64_t mask_;
+    std::unique_ptr<std::atomic<T*>[]> slots_;
+  };
+
+  static int64_t RoundUpToPowerOfTwo(int64_t n) {
+    int64_t capacity = 1;
+    while (capacity < n) capacity <<= 1;
+    return capacity;
+  }
+
+  // Owner only. Replaces "buffer" with one of twice the capacity holding the
+  // items in [top, bottom).
+  Buffer* Grow(Buffer* buffer, int64_t top, int64_t bottom) {
+    Buffer* grown = new Buffer(buffer->capacity() * 2);
+    for (int64_t i = top; i < bottom; ++i) {
+      grown->Put(i, buffer->Get(i));
+    }
+    retired_buffers_.emplace_back(grown);
+    buffer_.store(grown, std::memory_order_release);
+    return grown;
+  }
+
+  // Owner end and thief end on separate cache lines.
+  alignas(64) std::atomic<int64_t> top_{0};
+  alignas(64) std::atomic<int64_t> bottom_{0};
+  std::atomic<Buffer*> buffer_;
+  // All buffers ever allocated, including the current one. Only touched by
+  // the owner.
+  std::vector<std::unique_ptr<Buffer>> retired_buffers_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_DEPS_WORK_STEALING_DEQUE_H_
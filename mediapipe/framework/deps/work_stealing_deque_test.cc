@@ -0,0 +1,100 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/deps/work_stealing_deque.h"
+
+#include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(WorkStealingDequeTest, PopIsLifo) {
+  WorkStealingDeque<int> deque;
+  int items[3] = {0, 1, 2};
+  for (int& item : items) deque.Push(&item);
+  EXPECT_EQ(&items[2], deque.Pop());
+  EXPECT_EQ(&items[1], deque.Pop());
+  EXPECT_EQ(&items[0], deque.Pop());
+  EXPECT_EQ(nullptr, deque.Pop());
+  EXPECT_TRUE(deque.Empty());
+}
+
+TEST(WorkStealingDequeTest, StealIsFifo) {
+  WorkStealingDeque<int> deque;
+  int items[3] = {0, 1, 2};
+  for (int& item : items) deque.Push(&item);
+  EXPECT_EQ(&items[0], deque.Steal());
+  EXPECT_EQ(&items[1], deque.Steal());
+  EXPECT_EQ(&items[2], deque.Pop());
+  EXPECT_EQ(nullptr, deque.Steal());
+}
+
+TEST(WorkStealingDequeTest, GrowsPastInitialCapacity) {
+  WorkStealingDeque<int> deque(/*initial_capacity=*/2);
+  std::vector<int> items(100);
+  for (int& item : items) deque.Push(&item);
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(&items[i], deque.Steal());
+  }
+  for (int i = 99; i >= 50; --i) {
+    EXPECT_EQ(&items[i], deque.Pop());
+  }
+  EXPECT_TRUE(deque.Empty());
+}
+
+// Every pushed item is taken exactly once, by the owner or by a thief.
+TEST(WorkStealingDequeTest, ConcurrentStealers) {
+  constexpr int kNumItems = 100000;
+  constexpr int kNumThieves = 4;
+  WorkStealingDeque<int> deque(/*initial_capacity=*/16);
+  std::vector<int> items(kNumItems);
+  std::vector<std::atomic<int>> taken(kNumItems);
+  for (auto& count : taken) count = 0;
+  std::atomic<bool> done(false);
+
+  std::vector<std::thread> thieves;
+  for (int t = 0; t < kNumThieves; ++t) {
+    thieves.emplace_back([&] {
+      while (!done.load()) {
+        int* item = deque.Steal();
+        if (item != nullptr) ++taken[item - items.data()];
+      }
+    });
+  }
+  for (int i = 0; i < kNumItems; ++i) {
+    deque.Push(&items[i]);
+    if (i % 3 == 0) {
+      int* item = deque.Pop();
+      if (item != nullptr) ++taken[item - items.data()];
+    }
+  }
+  while (int* item = deque.Pop()) {
+    ++taken[item - items.data()];
+  }
+  while (!deque.Empty()) {
+  }
+  done = true;
+  for (auto& thief : thieves) thief.join();
+
+  for (int i = 0; i < kNumItems; ++i) {
+    EXPECT_EQ(1, taken[i].load()) << "item " << i;
+  }
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,185 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
+
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <list>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port/aligned_malloc_and_free.h"
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+const GraphService<ImageFrameBufferPool> kImageFrameBufferPoolService(
+    "kImageFrameBufferPoolService", kAllowDefaultInitialization);
+
+constexpr int64 ImageFrameBufferPool::kDefaultMaxAvailableBytes;
+
+namespace {
+
+// Buffers are always allocated with at least this alignment, so that all of
+// them can be freed with aligned_free.
+constexpr uint32 kMinBufferAlignment = 16;
+
+// Buffers are interchangeable if they have the same key.
+using BufferKey = std::tuple<ImageFormat::Format, int, int, uint32>;
+
+}  // namespace
+
+class ImageFrameBufferPool::Shared {
+ public:
+  explicit Shared(int64 max_available_bytes)
+      : max_available_bytes_(max_available_bytes) {}
+
+  ~Shared() { Trim(0); }
+
+  // Returns an idle buffer with the given key, or nullptr if there is none.
+  // The most recently released buffer is preferred, as it is the most likely
+  // to still be in the cache.
+  uint8* Take(const BufferKey& key) {
+    absl::MutexLock lock(&mutex_);
+    auto it = by_key_.find(key);
+    if (it == by_key_.end()) return nullptr;
+    auto buffer = it->second.back();
+    it->second.pop_back();
+    if (it->second.empty()) by_key_.erase(it);
+    uint8* data = buffer->data;
+    available_bytes_ -= buffer->bytes;
+    lru_.erase(buffer);
+    return data;
+  }
+
+  // Takes back a buffer, and frees the least recently released buffers if the
+  // idle buffers exceed the byte budget.
+  void Return(const BufferKey& key, uint8* data, int64 bytes) {
+    std::vector<uint8*> trimmed;
+    {
+      absl::MutexLock lock(&mutex_);
+      lru_.push_front({key, data, bytes});
+      by_key_[key].push_back(lru_.begin());
+      available_bytes_ += bytes;
+      TrimLocked(max_available_bytes_, &trimmed);
+    }
+    // Free the trimmed buffers without holding the lock.
+    for (uint8* buffer : trimmed) aligned_free(buffer);
+  }
+
+  void Trim(int64 max_bytes) {
+    std::vector<uint8*> trimmed;
+    {
+      absl::MutexLock lock(&mutex_);
+      TrimLocked(max_bytes, &trimmed);
+    }
+    for (uint8* buffer : trimmed) aligned_free(buffer);
+  }
+
+  int available_count() {
+    absl::MutexLock lock(&mutex_);
+    return lru_.size();
+  }
+
+  int64 available_bytes() {
+    absl::MutexLock lock(&mutex_);
+    return available_bytes_;
+  }
+
+ private:
+  struct Buffer {
+    BufferKey key;
+    uint8* data;
+    int64 bytes;
+  };
+  using BufferList = std::list<Buffer>;
+
+  void TrimLocked(int64 max_bytes, std::vector<uint8*>* trimmed)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    while (available_bytes_ > max_bytes) {
+      auto oldest = std::prev(lru_.end());
+      // The oldest buffer overall is also the oldest one for its key.
+      auto it = by_key_.find(oldest->key);
+      it->second.pop_front();
+      if (it->second.empty()) by_key_.erase(it);
+      available_bytes_ -= oldest->bytes;
+      trimmed->push_back(oldest->data);
+      lru_.erase(oldest);
+    }
+  }
+
+  const int64 max_available_bytes_;
+
+  absl::Mutex mutex_;
+  // Idle buffers, most recently released first.
+  BufferList lru_ ABSL_GUARDED_BY(mutex_);
+  // Idle buffers by key, most recently released last.
+  std::map<BufferKey, std::deque<BufferList::iterator>> by_key_
+      ABSL_GUARDED_BY(mutex_);
+  int64 available_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+ImageFrameBufferPool::ImageFrameBufferPool(int64 max_available_bytes)
+    : shared_(std::make_shared<Shared>(max_available_bytes)) {}
+
+ImageFrameBufferPool::~ImageFrameBufferPool() = default;
+
+std::unique_ptr<ImageFrame> ImageFrameBufferPool::GetFrame(
+    ImageFormat::Format format, int width, int height,
+    uint32 alignment_boundary) {
+  CHECK_NE(ImageFormat::UNKNOWN, format);
+  CHECK(alignment_boundary > 0 &&
+        (alignment_boundary & (alignment_boundary - 1)) == 0)
+      << "Invalid alignment boundary: " << alignment_boundary;
+  // Lay out rows as ImageFrame::Reset() does.
+  int width_step = width * ImageFrame::NumberOfChannelsForFormat(format) *
+                   ImageFrame::ByteDepthForFormat(format);
+  width_step = ((width_step - 1) | (alignment_boundary - 1)) + 1;
+  const int64 bytes = static_cast<int64>(height) * width_step;
+
+  const BufferKey key(format, width, height, alignment_boundary);
+  uint8* data = shared_->Take(key);
+  if (data == nullptr) {
+    data = reinterpret_cast<uint8*>(aligned_malloc(
+        bytes, std::max(alignment_boundary, kMinBufferAlignment)));
+  }
+
+  std::weak_ptr<Shared> weak_shared(shared_);
+  auto frame = absl::make_unique<ImageFrame>();
+  frame->AdoptPixelData(format, width, height, width_step, data,
+                        [weak_shared, key, bytes](uint8* data) {
+                          if (auto shared = weak_shared.lock()) {
+                            shared->Return(key, data, bytes);
+                          } else {
+                            aligned_free(data);
+                          }
+                        });
+  return frame;
+}
+
+void ImageFrameBufferPool::Clear() { shared_->Trim(0); }
+
+int ImageFrameBufferPool::available_count() {
+  return shared_->available_count();
+}
+
+int64 ImageFrameBufferPool::available_bytes() {
+  return shared_->available_bytes();
+}
+
+}  // namespace mediapipe
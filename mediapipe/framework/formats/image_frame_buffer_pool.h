@@ -0,0 +1,104 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_BUFFER_POOL_H_
+#define MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_BUFFER_POOL_H_
+
+#include <memory>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/graph_service.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+// Recycles ImageFrame pixel buffers of any shape. Unlike ImageFramePool, which
+// serves a single size and format, buffers are kept per (format, width,
+// height, alignment), so a graph that resizes, crops and converts frames can
+// share one pool for all of its intermediate images.
+//
+// A frame returned by GetFrame() gives its pixel buffer back to the pool when
+// it is destroyed (or when the buffer is otherwise released). Idle buffers are
+// kept up to a byte budget; when it is exceeded, the least recently released
+// buffers are freed first. Frames may outlive the pool, in which case their
+// buffers are simply freed.
+//
+// Calculators get the graph's pool through kImageFrameBufferPoolService:
+//
+//   static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+//     cc->UseService(kImageFrameBufferPoolService).Optional();
+//     ...
+//   }
+//   ::mediapipe::Status Process(CalculatorContext* cc) {
+//     std::unique_ptr<ImageFrame> output = ImageFrameBufferPool::NewFrame(
+//         cc->Service(kImageFrameBufferPoolService), format, width, height);
+//     ...
+//   }
+class ImageFrameBufferPool {
+ public:
+  // The default byte budget for idle buffers: enough for a few dozen
+  // 1080p RGB frames.
+  static constexpr int64 kDefaultMaxAvailableBytes = 256 << 20;
+
+  ImageFrameBufferPool() : ImageFrameBufferPool(kDefaultMaxAvailableBytes) {}
+  explicit ImageFrameBufferPool(int64 max_available_bytes);
+  ~ImageFrameBufferPool();
+  ImageFrameBufferPool(const ImageFrameBufferPool&) = delete;
+  ImageFrameBufferPool& operator=(const ImageFrameBufferPool&) = delete;
+
+  // Returns a frame with the given shape. Its pixel data is reused from a
+  // released frame of the same shape when possible, and is not cleared.
+  std::unique_ptr<ImageFrame> GetFrame(
+      ImageFormat::Format format, int width, int height,
+      uint32 alignment_boundary = ImageFrame::kDefaultAlignmentBoundary);
+
+  // Returns a frame from the pool bound to "service" if it is available, or a
+  // newly allocated frame otherwise.
+  template <typename ServiceBinding>
+  static std::unique_ptr<ImageFrame> NewFrame(
+      ServiceBinding service, ImageFormat::Format format, int width,
+      int height,
+      uint32 alignment_boundary = ImageFrame::kDefaultAlignmentBoundary) {
+    if (service.IsAvailable()) {
+      return service.GetObject().GetFrame(format, width, height,
+                                          alignment_boundary);
+    }
+    return absl::make_unique<ImageFrame>(format, width, height,
+                                         alignment_boundary);
+  }
+
+  // Frees all idle buffers.
+  void Clear();
+
+  // Returns the number and total size of the idle buffers.
+  int available_count();
+  int64 available_bytes();
+
+ private:
+  // The pool state that released buffers refer to. It is shared so that
+  // buffers can outlive the pool.
+  class Shared;
+
+  std::shared_ptr<Shared> shared_;
+};
+
+// The graph provides an ImageFrameBufferPool through this service to any node
+// that requests it, unless one was set with
+// CalculatorGraph::SetServiceObject().
+extern const GraphService<ImageFrameBufferPool> kImageFrameBufferPoolService;
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_BUFFER_POOL_H_
@@ -0,0 +1,120 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
+
+#include <memory>
+
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(ImageFrameBufferPoolTest, ReusesBuffers) {
+  ImageFrameBufferPool pool;
+  auto frame = pool.GetFrame(ImageFormat::SRGB, 300, 200);
+  EXPECT_EQ(ImageFormat::SRGB, frame->Format());
+  EXPECT_EQ(300, frame->Width());
+  EXPECT_EQ(200, frame->Height());
+  EXPECT_TRUE(frame->IsAligned(ImageFrame::kDefaultAlignmentBoundary));
+  const uint8* pixel_data = frame->PixelData();
+  EXPECT_EQ(0, pool.available_count());
+
+  frame.reset();
+  EXPECT_EQ(1, pool.available_count());
+  EXPECT_EQ(200 * 912, pool.available_bytes());
+
+  frame = pool.GetFrame(ImageFormat::SRGB, 300, 200);
+  EXPECT_EQ(pixel_data, frame->PixelData());
+  EXPECT_EQ(0, pool.available_count());
+}
+
+TEST(ImageFrameBufferPoolTest, KeysBuffersByShape) {
+  ImageFrameBufferPool pool;
+  pool.GetFrame(ImageFormat::SRGB, 300, 200);
+  pool.GetFrame(ImageFormat::SRGBA, 300, 200);
+  pool.GetFrame(ImageFormat::SRGB, 200, 300);
+  pool.GetFrame(ImageFormat::SRGB, 300, 200, /*alignment_boundary=*/1);
+  EXPECT_EQ(4, pool.available_count());
+
+  auto frame = pool.GetFrame(ImageFormat::SRGB, 300, 200, 1);
+  EXPECT_TRUE(frame->IsContiguous());
+  EXPECT_EQ(3, pool.available_count());
+  auto other = pool.GetFrame(ImageFormat::SRGB, 300, 200, 1);
+  EXPECT_EQ(3, pool.available_count());
+}
+
+TEST(ImageFrameBufferPoolTest, TrimsLeastRecentlyReleased) {
+  // Room for two 100x100 SRGBA buffers.
+  ImageFrameBufferPool pool(/*max_available_bytes=*/2 * 100 * 400);
+  auto first = pool.GetFrame(ImageFormat::SRGBA, 100, 100);
+  auto second = pool.GetFrame(ImageFormat::SRGBA, 100, 100);
+  auto third = pool.GetFrame(ImageFormat::SRGBA, 100, 100);
+  const uint8* second_data = second->PixelData();
+  const uint8* third_data = third->PixelData();
+  first.reset();
+  second.reset();
+  third.reset();
+  EXPECT_EQ(2, pool.available_count());
+  EXPECT_EQ(2 * 100 * 400, pool.available_bytes());
+
+  // The most recently released buffer is reused first.
+  auto frame = pool.GetFrame(ImageFormat::SRGBA, 100, 100);
+  EXPECT_EQ(third_data, frame->PixelData());
+  frame = pool.GetFrame(ImageFormat::SRGBA, 100, 100);
+  EXPECT_EQ(second_data, frame->PixelData());
+
+  pool.Clear();
+  EXPECT_EQ(0, pool.available_count());
+  EXPECT_EQ(0, pool.available_bytes());
+}
+
+TEST(ImageFrameBufferPoolTest, ReleasedPixelDataReturnsToPool) {
+  ImageFrameBufferPool pool;
+  auto frame = pool.GetFrame(ImageFormat::GRAY8, 64, 64);
+  auto pixel_data = frame->Release();
+  frame.reset();
+  EXPECT_EQ(0, pool.available_count());
+  pixel_data.reset();
+  EXPECT_EQ(1, pool.available_count());
+}
+
+TEST(ImageFrameBufferPoolTest, FramesOutliveThePool) {
+  auto pool = absl::make_unique<ImageFrameBufferPool>();
+  auto frame = pool->GetFrame(ImageFormat::GRAY8, 64, 64);
+  pool.reset();
+  frame->SetToZero();
+  frame.reset();
+}
+
+void BM_NewImageFrame(benchmark::State& state) {
+  const bool pooled = state.range(0);
+  ImageFrameBufferPool pool;
+  for (auto _ : state) {
+    std::unique_ptr<ImageFrame> frame =
+        pooled ? pool.GetFrame(ImageFormat::SRGB, 1920, 1080)
+               : absl::make_unique<ImageFrame>(ImageFormat::SRGB, 1920, 1080);
+    // Touch every page, so that newly mapped memory is faulted in.
+    uint8* pixel_data = frame->MutablePixelData();
+    for (int i = 0; i < frame->PixelDataSize(); i += 4096) pixel_data[i] = 1;
+    benchmark::DoNotOptimize(frame->MutablePixelData());
+  }
+}
+BENCHMARK(BM_NewImageFrame)->ArgName("pooled")->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace mediapipe
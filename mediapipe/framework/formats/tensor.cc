@@ -25,11 +25,13 @@
 #include <mach/mach_init.h>
 #include <mach/vm_map.h>
 #else
-#include <cstdlib>
+#include "mediapipe/framework/port/aligned_malloc_and_free.h"
 #endif  // MEDIAPIPE_METAL_ENABLED
 
 namespace mediapipe {
 
+constexpr int Tensor::kCpuBufferAlignment;
+
 int BhwcBatchFromShape(const Tensor::Shape& shape) {
   LOG_IF(FATAL, shape.dims.empty())
       << "Tensor::Shape must be non-empty to retrieve a named dimension";
@@ -117,7 +119,15 @@ void Tensor::AllocateMtlBuffer(id<MTLDevice> device) const {
     // It also means that the metal buffer is not allocated yet.
     cpu_buffer_ = AllocateVirtualMemory(bytes());
   }
-  if (!metal_buffer_) {
+  if (!metal_buffer_ && release_cpu_buffer_) {
+    // The buffer is released by its owner.
+    metal_buffer_ =
+        [device_ newBufferWithBytesNoCopy:cpu_buffer_
+                                   length:AlignToPageSize(bytes())
+                                  options:MTLResourceStorageModeShared |
+                                          MTLResourceCPUCacheModeDefaultCache
+                              deallocator:nil];
+  } else if (!metal_buffer_) {
     metal_buffer_ =
         [device_ newBufferWithBytesNoCopy:cpu_buffer_
                                    length:AlignToPageSize(bytes())
@@ -254,8 +264,11 @@ void Tensor::Move(Tensor* src) {
   shape_ = src->shape();
   element_type_ = src->element_type();
   src->element_type_ = ElementType::kNone;  // Mark as invalidated.
+  quantization_parameters_ = src->quantization_parameters_;
   cpu_buffer_ = src->cpu_buffer_;
   src->cpu_buffer_ = nullptr;
+  release_cpu_buffer_ = std::move(src->release_cpu_buffer_);
+  src->release_cpu_buffer_ = nullptr;
 #if MEDIAPIPE_METAL_ENABLED
   device_ = src->device_;
   command_buffer_ = src->command_buffer_;
@@ -277,21 +290,41 @@ void Tensor::Move(Tensor* src) {
 Tensor::Tensor(ElementType element_type, const Shape& shape)
     : element_type_(element_type), shape_(shape) {}
 
+Tensor::Tensor(ElementType element_type, const Shape& shape,
+               const QuantizationParameters& quantization_parameters)
+    : element_type_(element_type),
+      shape_(shape),
+      quantization_parameters_(quantization_parameters) {}
+
+Tensor::Tensor(ElementType element_type, const Shape& shape,
+               const QuantizationParameters& quantization_parameters,
+               void* cpu_buffer, std::function<void(void*)> release_cpu_buffer)
+    : element_type_(element_type),
+      shape_(shape),
+      quantization_parameters_(quantization_parameters),
+      cpu_buffer_(cpu_buffer),
+      release_cpu_buffer_(std::move(release_cpu_buffer)) {}
+
 void Tensor::Invalidate() {
   absl::MutexLock lock(&view_mutex_);
 #if MEDIAPIPE_METAL_ENABLED
   // If memory is allocated and not owned by the metal buffer.
   // TODO: Re-design cpu buffer memory management.
-  if (cpu_buffer_ && !metal_buffer_) {
+  if (cpu_buffer_ && release_cpu_buffer_) {
+    release_cpu_buffer_(cpu_buffer_);
+  } else if (cpu_buffer_ && !metal_buffer_) {
     DeallocateVirtualMemory(cpu_buffer_, AlignToPageSize(bytes()));
   }
   metal_buffer_ = nil;
 #else
-  if (cpu_buffer_) {
-    free(cpu_buffer_);
+  if (cpu_buffer_ && release_cpu_buffer_) {
+    release_cpu_buffer_(cpu_buffer_);
+  } else if (cpu_buffer_) {
+    aligned_free(cpu_buffer_);
   }
 #endif  // MEDIAPIPE_METAL_ENABLED
   cpu_buffer_ = nullptr;
+  release_cpu_buffer_ = nullptr;
 
   // Don't need to wait for the resource to be deleted bacause if will be
   // released on last reference deletion inside the OpenGL driver.
@@ -423,7 +456,7 @@ void Tensor::AllocateCpuBuffer() const {
 #if MEDIAPIPE_METAL_ENABLED
     cpu_buffer_ = AllocateVirtualMemory(bytes());
 #else
-    cpu_buffer_ = malloc(bytes());
+    cpu_buffer_ = aligned_malloc(bytes(), kCpuBufferAlignment);
 #endif  // MEDIAPIPE_METAL_ENABLED
   }
 }
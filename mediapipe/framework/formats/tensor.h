@@ -16,6 +16,8 @@
 #define MEDIAPIPE_FRAMEWORK_FORMATS_TENSOR_H_
 
 #include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <initializer_list>
 #include <tuple>
 #include <type_traits>
@@ -76,7 +78,7 @@ class Tensor {
 
  public:
   // No resources are allocated here.
-  enum class ElementType { kNone, kFloat16, kFloat32 };
+  enum class ElementType { kNone, kFloat16, kFloat32, kUInt8, kInt8, kInt32 };
   struct Shape {
     Shape() = default;
     Shape(std::initializer_list<int> dimensions) : dims(dimensions) {}
@@ -88,8 +90,27 @@ class Tensor {
     }
     std::vector<int> dims;
   };
+  // Affine quantization of uint8/int8 tensors, as in TfLite:
+  //   real_value = scale * (quantized_value - zero_point)
+  // A zero scale means the tensor is not quantized.
+  struct QuantizationParameters {
+    QuantizationParameters() = default;
+    QuantizationParameters(float scale, int zero_point)
+        : scale(scale), zero_point(zero_point) {}
+    float scale = 0.0f;
+    int zero_point = 0;
+  };
 
   Tensor(ElementType element_type, const Shape& shape);
+  Tensor(ElementType element_type, const Shape& shape,
+         const QuantizationParameters& quantization_parameters);
+  // Creates a tensor backed by an existing CPU buffer of at least bytes()
+  // bytes. When the tensor is destroyed, the buffer is passed to
+  // "release_cpu_buffer" instead of being freed. On Metal platforms the
+  // buffer must be page-aligned if the tensor is used on the GPU.
+  Tensor(ElementType element_type, const Shape& shape,
+         const QuantizationParameters& quantization_parameters,
+         void* cpu_buffer, std::function<void(void*)> release_cpu_buffer);
 
   // Non-copyable.
   Tensor(const Tensor&) = delete;
@@ -195,8 +216,15 @@ class Tensor {
   OpenGlBufferView GetOpenGlBufferWriteView() const;
 #endif  // MEDIAPIPE_OPENGL_ES_VERSION >= MEDIAPIPE_OPENGL_ES_31
 
+  // CPU buffers allocated by the tensor are aligned to at least this many
+  // bytes, so that they can be bound directly to TfLite tensors.
+  static constexpr int kCpuBufferAlignment = 64;
+
   const Shape& shape() const { return shape_; }
   ElementType element_type() const { return element_type_; }
+  const QuantizationParameters& quantization_parameters() const {
+    return quantization_parameters_;
+  }
   int element_size() const {
     switch (element_type_) {
       case ElementType::kNone:
@@ -205,6 +233,12 @@ class Tensor {
         return 2;
       case ElementType::kFloat32:
         return sizeof(float);
+      case ElementType::kUInt8:
+        return 1;
+      case ElementType::kInt8:
+        return 1;
+      case ElementType::kInt32:
+        return sizeof(int32_t);
     }
   }
   int bytes() const { return shape_.num_elements() * element_size(); }
@@ -226,6 +260,7 @@ class Tensor {
 
   ElementType element_type_;
   Shape shape_;
+  QuantizationParameters quantization_parameters_;
 
   // The flags describe the current source of truth resource type.
   enum {
@@ -242,6 +277,8 @@ class Tensor {
   mutable absl::Mutex view_mutex_;
 
   mutable void* cpu_buffer_ = nullptr;
+  // Set if cpu_buffer_ is not owned by the tensor.
+  std::function<void(void*)> release_cpu_buffer_;
   void AllocateCpuBuffer() const;
 #if MEDIAPIPE_METAL_ENABLED
   mutable id<MTLCommandBuffer> command_buffer_;
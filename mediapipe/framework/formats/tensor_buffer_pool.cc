@@ -0,0 +1,132 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/tensor_buffer_pool.h"
+
+#include <map>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port.h"
+#include "mediapipe/framework/port/aligned_malloc_and_free.h"
+
+#if MEDIAPIPE_METAL_ENABLED
+#include <unistd.h>
+#endif  // MEDIAPIPE_METAL_ENABLED
+
+namespace mediapipe {
+
+constexpr int TensorBufferPool::kDefaultMaxAvailableBuffers;
+
+namespace {
+
+void* AllocateBuffer(int bytes) {
+#if MEDIAPIPE_METAL_ENABLED
+  // Metal wraps CPU buffers in whole pages.
+  const int page_size = getpagesize();
+  return aligned_malloc((bytes + page_size - 1) / page_size * page_size,
+                        page_size);
+#else
+  return aligned_malloc(bytes, Tensor::kCpuBufferAlignment);
+#endif  // MEDIAPIPE_METAL_ENABLED
+}
+
+}  // namespace
+
+class TensorBufferPool::Shared {
+ public:
+  explicit Shared(int max_available_buffers)
+      : max_available_buffers_(max_available_buffers) {}
+
+  ~Shared() {
+    for (auto& entry : available_) {
+      for (void* buffer : entry.second) aligned_free(buffer);
+    }
+  }
+
+  // Returns an idle buffer of "bytes" bytes, or a new one if there is none.
+  void* Take(int bytes) {
+    {
+      absl::MutexLock lock(&mutex_);
+      auto it = available_.find(bytes);
+      if (it != available_.end() && !it->second.empty()) {
+        void* buffer = it->second.back();
+        it->second.pop_back();
+        return buffer;
+      }
+    }
+    return AllocateBuffer(bytes);
+  }
+
+  // Takes back a buffer, or frees it if enough buffers of its size are idle.
+  void Return(int bytes, void* buffer) {
+    {
+      absl::MutexLock lock(&mutex_);
+      std::vector<void*>& buffers = available_[bytes];
+      if (buffers.size() < max_available_buffers_) {
+        buffers.push_back(buffer);
+        return;
+      }
+    }
+    aligned_free(buffer);
+  }
+
+  int available_count() {
+    absl::MutexLock lock(&mutex_);
+    int count = 0;
+    for (const auto& entry : available_) count += entry.second.size();
+    return count;
+  }
+
+ private:
+  const int max_available_buffers_;
+
+  absl::Mutex mutex_;
+  // Idle buffers by size in bytes.
+  std::map<int, std::vector<void*>> available_ ABSL_GUARDED_BY(mutex_);
+};
+
+TensorBufferPool::TensorBufferPool(int max_available_buffers)
+    : shared_(std::make_shared<Shared>(max_available_buffers)) {}
+
+TensorBufferPool::~TensorBufferPool() = default;
+
+void TensorBufferPool::Reserve(Tensor::ElementType element_type,
+                               const Tensor::Shape& shape, int count) {
+  std::vector<Tensor> tensors;
+  tensors.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    tensors.push_back(GetTensor(element_type, shape));
+  }
+  // The buffers return to the pool as the tensors are destroyed.
+}
+
+Tensor TensorBufferPool::GetTensor(
+    Tensor::ElementType element_type, const Tensor::Shape& shape,
+    const Tensor::QuantizationParameters& quantization_parameters) {
+  const int bytes = Tensor(element_type, shape).bytes();
+  std::weak_ptr<Shared> weak_shared(shared_);
+  return Tensor(element_type, shape, quantization_parameters,
+                shared_->Take(bytes), [weak_shared, bytes](void* buffer) {
+                  if (auto shared = weak_shared.lock()) {
+                    shared->Return(bytes, buffer);
+                  } else {
+                    aligned_free(buffer);
+                  }
+                });
+}
+
+int TensorBufferPool::available_count() { return shared_->available_count(); }
+
+}  // namespace mediapipe
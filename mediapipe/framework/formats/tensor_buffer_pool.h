@@ -0,0 +1,70 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_FORMATS_TENSOR_BUFFER_POOL_H_
+#define MEDIAPIPE_FRAMEWORK_FORMATS_TENSOR_BUFFER_POOL_H_
+
+#include <memory>
+
+#include "mediapipe/framework/formats/tensor.h"
+
+namespace mediapipe {
+
+// Recycles the CPU buffers of tensors. A tensor returned by GetTensor() gives
+// its buffer back to the pool when it is destroyed, so a calculator that
+// emits tensors of the same shapes on every frame allocates only as many
+// buffers as there are tensors in flight downstream. Tensors may outlive the
+// pool, in which case their buffers are simply freed.
+//
+// Buffers are aligned to Tensor::kCpuBufferAlignment, so they can be bound
+// directly to TfLite tensors.
+class TensorBufferPool {
+ public:
+  // The default number of idle buffers kept per buffer size.
+  static constexpr int kDefaultMaxAvailableBuffers = 4;
+
+  TensorBufferPool() : TensorBufferPool(kDefaultMaxAvailableBuffers) {}
+  explicit TensorBufferPool(int max_available_buffers);
+  ~TensorBufferPool();
+  TensorBufferPool(const TensorBufferPool&) = delete;
+  TensorBufferPool& operator=(const TensorBufferPool&) = delete;
+
+  // Allocates idle buffers up front, so that the first "count" tensors of the
+  // given type and shape in flight need no allocation. Buffers beyond the
+  // pool's limit of idle buffers are freed again.
+  void Reserve(Tensor::ElementType element_type, const Tensor::Shape& shape,
+               int count);
+
+  // Returns a tensor whose CPU buffer is reused from a released tensor of the
+  // same byte size when possible. The buffer is not cleared, and the tensor
+  // must be written before it is read.
+  Tensor GetTensor(
+      Tensor::ElementType element_type, const Tensor::Shape& shape,
+      const Tensor::QuantizationParameters& quantization_parameters =
+          Tensor::QuantizationParameters());
+
+  // Returns the number of idle buffers.
+  int available_count();
+
+ private:
+  // The pool state that released buffers refer to. It is shared so that
+  // tensors can outlive the pool.
+  class Shared;
+
+  std::shared_ptr<Shared> shared_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_FORMATS_TENSOR_BUFFER_POOL_H_
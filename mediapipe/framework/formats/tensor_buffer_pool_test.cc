@@ -0,0 +1,114 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/tensor_buffer_pool.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+const void* CpuBuffer(const Tensor& tensor) {
+  return tensor.GetCpuWriteView().buffer<void>();
+}
+
+TEST(TensorBufferPoolTest, ReusesBuffers) {
+  TensorBufferPool pool;
+  auto tensor = absl::make_unique<Tensor>(
+      pool.GetTensor(Tensor::ElementType::kFloat32, Tensor::Shape{1, 16, 16}));
+  EXPECT_EQ(Tensor::ElementType::kFloat32, tensor->element_type());
+  EXPECT_EQ(16 * 16 * sizeof(float), tensor->bytes());
+  EXPECT_FALSE(tensor->ready_on_cpu());
+  const void* buffer = CpuBuffer(*tensor);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(buffer) %
+                   Tensor::kCpuBufferAlignment);
+  EXPECT_EQ(0, pool.available_count());
+
+  tensor.reset();
+  EXPECT_EQ(1, pool.available_count());
+
+  // Buffers of the same size are shared by all types and shapes.
+  Tensor other = pool.GetTensor(Tensor::ElementType::kInt32, Tensor::Shape{256},
+                                Tensor::QuantizationParameters(0.5f, 3));
+  EXPECT_EQ(buffer, CpuBuffer(other));
+  EXPECT_EQ(0.5f, other.quantization_parameters().scale);
+  EXPECT_EQ(3, other.quantization_parameters().zero_point);
+  EXPECT_EQ(0, pool.available_count());
+}
+
+TEST(TensorBufferPoolTest, KeysBuffersBySize) {
+  TensorBufferPool pool;
+  pool.GetTensor(Tensor::ElementType::kFloat32, Tensor::Shape{8});
+  EXPECT_EQ(1, pool.available_count());
+  Tensor tensor = pool.GetTensor(Tensor::ElementType::kUInt8, Tensor::Shape{8});
+  EXPECT_EQ(1, pool.available_count());
+}
+
+TEST(TensorBufferPoolTest, ReservesBuffers) {
+  TensorBufferPool pool;
+  pool.Reserve(Tensor::ElementType::kFloat32, Tensor::Shape{4, 4}, 3);
+  EXPECT_EQ(3, pool.available_count());
+  std::vector<Tensor> tensors;
+  for (int i = 0; i < 3; ++i) {
+    tensors.push_back(
+        pool.GetTensor(Tensor::ElementType::kFloat32, Tensor::Shape{4, 4}));
+  }
+  EXPECT_EQ(0, pool.available_count());
+  tensors.clear();
+  EXPECT_EQ(3, pool.available_count());
+}
+
+TEST(TensorBufferPoolTest, FreesExcessBuffers) {
+  TensorBufferPool pool(/*max_available_buffers=*/2);
+  std::vector<Tensor> tensors;
+  for (int i = 0; i < 3; ++i) {
+    tensors.push_back(
+        pool.GetTensor(Tensor::ElementType::kFloat32, Tensor::Shape{4}));
+  }
+  tensors.clear();
+  EXPECT_EQ(2, pool.available_count());
+}
+
+TEST(TensorBufferPoolTest, MovedTensorsKeepTheirBuffer) {
+  TensorBufferPool pool;
+  Tensor tensor =
+      pool.GetTensor(Tensor::ElementType::kFloat32, Tensor::Shape{4});
+  {
+    auto view = tensor.GetCpuWriteView();
+    view.buffer<float>()[3] = 42.0f;
+  }
+  Tensor moved(std::move(tensor));
+  EXPECT_EQ(0, pool.available_count());
+  EXPECT_EQ(42.0f, moved.GetCpuReadView().buffer<float>()[3]);
+  moved = Tensor(Tensor::ElementType::kFloat32, Tensor::Shape{4});
+  EXPECT_EQ(1, pool.available_count());
+}
+
+TEST(TensorBufferPoolTest, TensorsOutliveThePool) {
+  auto pool = absl::make_unique<TensorBufferPool>();
+  Tensor tensor =
+      pool->GetTensor(Tensor::ElementType::kFloat32, Tensor::Shape{64});
+  pool.reset();
+  tensor.GetCpuWriteView().buffer<float>()[63] = 1.0f;
+}
+
+}  // namespace
+}  // namespace mediapipe
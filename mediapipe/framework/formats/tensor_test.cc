@@ -23,6 +23,31 @@ TEST(General, TestDataTypes) {
 
   Tensor t2(Tensor::ElementType::kFloat16, Tensor::Shape{4, 3, 2, 3});
   EXPECT_EQ(t2.bytes(), t2.shape().num_elements() * 2);
+
+  Tensor t3(Tensor::ElementType::kUInt8, Tensor::Shape{1, 2, 3, 4});
+  EXPECT_EQ(t3.bytes(), t3.shape().num_elements());
+
+  Tensor t4(Tensor::ElementType::kInt8, Tensor::Shape{1, 2, 3, 4});
+  EXPECT_EQ(t4.bytes(), t4.shape().num_elements());
+
+  Tensor t5(Tensor::ElementType::kInt32, Tensor::Shape{1, 2, 3, 4});
+  EXPECT_EQ(t5.bytes(), t5.shape().num_elements() * sizeof(int32_t));
+}
+
+TEST(General, TestQuantizationParameters) {
+  Tensor t1(Tensor::ElementType::kFloat32, Tensor::Shape{1, 2});
+  EXPECT_EQ(t1.quantization_parameters().scale, 0.0f);
+  EXPECT_EQ(t1.quantization_parameters().zero_point, 0);
+
+  Tensor t2(Tensor::ElementType::kUInt8, Tensor::Shape{1, 2},
+            Tensor::QuantizationParameters(0.5f, 128));
+  EXPECT_EQ(t2.quantization_parameters().scale, 0.5f);
+  EXPECT_EQ(t2.quantization_parameters().zero_point, 128);
+
+  Tensor t3(std::move(t2));
+  EXPECT_EQ(t3.element_type(), Tensor::ElementType::kUInt8);
+  EXPECT_EQ(t3.quantization_parameters().scale, 0.5f);
+  EXPECT_EQ(t3.quantization_parameters().zero_point, 128);
 }
 
 TEST(Cpu, TestMemoryAllocation) {
@@ -17,6 +17,8 @@
 
 #include <memory>
 
+#include "mediapipe/framework/packet.h"
+
 namespace mediapipe {
 
 // The GraphService API can be used to define extensions to a graph's execution
@@ -28,17 +30,34 @@ namespace mediapipe {
 // if you want to use it. In most cases, you should use a side packet instead.
 
 struct GraphServiceBase {
-  constexpr GraphServiceBase(const char* key) : key(key) {}
+  constexpr GraphServiceBase(const char* key,
+                             Packet (*create_default_object)() = nullptr)
+      : key(key), create_default_object(create_default_object) {}
 
   const char* key;
+  // If not null, the graph calls this to create the service object when a
+  // node requests the service and the application has not provided it.
+  Packet (*create_default_object)();
 };
 
+// Passed to the GraphService constructor to let the graph create a
+// default-constructed service object when needed.
+struct GraphServiceDefaultInitialization {};
+constexpr GraphServiceDefaultInitialization kAllowDefaultInitialization{};
+
 template <typename T>
 struct GraphService : public GraphServiceBase {
   using type = T;
   using packet_type = std::shared_ptr<T>;
 
   constexpr GraphService(const char* key) : GraphServiceBase(key) {}
+  constexpr GraphService(const char* key, GraphServiceDefaultInitialization)
+      : GraphServiceBase(key, &CreateDefaultObject) {}
+
+ private:
+  static Packet CreateDefaultObject() {
+    return MakePacket<packet_type>(std::make_shared<T>());
+  }
 };
 
 }  // namespace mediapipe
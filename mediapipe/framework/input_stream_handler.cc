@@ -257,7 +257,7 @@ void LogQueuedPackets(CalculatorContext* context, InputStreamManager* stream,
 }
 
 void InputStreamHandler::AddPackets(CollectionItemId id,
-                                    const std::list<Packet>& packets) {
+                                    absl::Span<const Packet> packets) {
   LogQueuedPackets(GetCalculatorContext(calculator_context_manager_),
                    input_stream_managers_.Get(id), packets.back());
   bool notify = false;
@@ -272,9 +272,9 @@ void InputStreamHandler::AddPackets(CollectionItemId id,
 }
 
 void InputStreamHandler::MovePackets(CollectionItemId id,
-                                     std::list<Packet>* packets) {
+                                     absl::Span<Packet> packets) {
   LogQueuedPackets(GetCalculatorContext(calculator_context_manager_),
-                   input_stream_managers_.Get(id), packets->back());
+                   input_stream_managers_.Get(id), packets.back());
   bool notify = false;
   ::mediapipe::Status result =
       input_stream_managers_.Get(id)->MovePackets(packets, &notify);
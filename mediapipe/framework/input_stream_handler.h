@@ -17,13 +17,13 @@
 
 #include <atomic>
 #include <functional>
-#include <list>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 // TODO: Move protos in another CL after the C++ code migration.
+#include "absl/types/span.h"
 #include "mediapipe/framework/calculator_context.h"
 #include "mediapipe/framework/calculator_context_manager.h"
 #include "mediapipe/framework/collection.h"
@@ -131,12 +131,13 @@ class InputStreamHandler {
       InputStreamManager::QueueSizeCallback becomes_full_callback,
       InputStreamManager::QueueSizeCallback becomes_not_full_callback);
 
-  // Add packets into a particular stream.
+  // Add packets into a particular stream. "packets" must not be empty.
   virtual void AddPackets(CollectionItemId id,
-                          const std::list<Packet>& packets);
+                          absl::Span<const Packet> packets);
 
-  // Moves packets into a particular stream.
-  virtual void MovePackets(CollectionItemId id, std::list<Packet>* packets);
+  // Moves packets into a particular stream. "packets" must not be empty, and
+  // are left empty.
+  virtual void MovePackets(CollectionItemId id, absl::Span<Packet> packets);
 
   // Sets next timestamp bound in a particular stream.
   void SetNextTimestampBound(CollectionItemId id, Timestamp bound);
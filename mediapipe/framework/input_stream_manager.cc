@@ -80,18 +80,18 @@ Packet InputStreamManager::QueueHead() const {
 }
 
 ::mediapipe::Status InputStreamManager::AddPackets(
-    const std::list<Packet>& container, bool* notify) {
-  return AddOrMovePacketsInternal<const std::list<Packet>&>(container, notify);
+    absl::Span<const Packet> packets, bool* notify) {
+  return AddOrMovePacketsInternal(packets, notify);
 }
 
-::mediapipe::Status InputStreamManager::MovePackets(
-    std::list<Packet>* container, bool* notify) {
-  return AddOrMovePacketsInternal<std::list<Packet>&>(*container, notify);
+::mediapipe::Status InputStreamManager::MovePackets(absl::Span<Packet> packets,
+                                                    bool* notify) {
+  return AddOrMovePacketsInternal(packets, notify);
 }
 
-template <typename Container>
+template <typename T>
 ::mediapipe::Status InputStreamManager::AddOrMovePacketsInternal(
-    Container container, bool* notify) {
+    absl::Span<T> packets, bool* notify) {
   *notify = false;
   bool queue_became_non_empty = false;
   bool queue_became_full = false;
@@ -105,8 +105,8 @@ template <typename Container>
     bool was_queue_full =
         (max_queue_size_ != -1 && queue_.size() >= max_queue_size_);
     // Check if the queue becomes non-empty.
-    queue_became_non_empty = queue_.empty() && !container.empty();
-    for (auto& packet : container) {
+    queue_became_non_empty = queue_.empty() && !packets.empty();
+    for (T& packet : packets) {
       ::mediapipe::Status result = packet_type_->Validate(packet);
       if (!result.ok()) {
         return tool::AddStatusPrefix(
@@ -154,8 +154,7 @@ template <typename Container>
       ++num_packets_added_;
       VLOG(3) << "Input stream:" << name_
               << " has added packet at time: " << packet.Timestamp();
-      if (std::is_const<
-              typename std::remove_reference<Container>::type>::value) {
+      if (std::is_const<T>::value) {
         queue_.emplace_back(packet);
       } else {
         queue_.emplace_back(std::move(packet));
@@ -368,7 +367,8 @@ Timestamp InputStreamManager::GetMinTimestampAmongNLatest(int n) const {
   if (queue_.empty()) {
     return Timestamp::Unset();
   }
-  return (queue_.cend() - std::min((size_t)n, queue_.size()))->Timestamp();
+  return queue_[queue_.size() - std::min((size_t)n, queue_.size())]
+      .Timestamp();
 }
 
 void InputStreamManager::ErasePacketsEarlierThan(Timestamp timestamp) {
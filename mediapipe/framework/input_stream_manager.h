@@ -15,13 +15,13 @@
 #ifndef MEDIAPIPE_FRAMEWORK_INPUT_STREAM_MANAGER_H_
 #define MEDIAPIPE_FRAMEWORK_INPUT_STREAM_MANAGER_H_
 
-#include <deque>
 #include <functional>
-#include <list>
 #include <string>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/deps/ring_buffer.h"
 #include "mediapipe/framework/packet.h"
 #include "mediapipe/framework/packet_type.h"
 #include "mediapipe/framework/port.h"
@@ -75,7 +75,7 @@ class InputStreamManager {
   // image/video/audio).
   void PrepareForRun() ABSL_LOCKS_EXCLUDED(stream_mutex_);
 
-  // Adds a list of timestamped packets. Sets "notify" to true if the queue
+  // Adds a span of timestamped packets. Sets "notify" to true if the queue
   // becomes non-empty. Does nothing if the input stream is closed.
   //
   // The timestamp of each packet must satisfy Timestamp::IsAllowedInStream().
@@ -87,13 +87,13 @@ class InputStreamManager {
   //   Timestamp::PostStream(), the packet must be the only packet in the
   //   stream.
   // Violation of any of these conditions causes an error status.
-  ::mediapipe::Status AddPackets(const std::list<Packet>& container,
+  ::mediapipe::Status AddPackets(absl::Span<const Packet> packets,
                                  bool* notify);
 
-  // Move a list of timestamped packets. Sets "notify" to true if the queue
+  // Move a span of timestamped packets. Sets "notify" to true if the queue
   // becomes non-empty. Does nothing if the input stream is closed. After the
-  // move, all packets in the container must be empty.
-  ::mediapipe::Status MovePackets(std::list<Packet>* container, bool* notify);
+  // move, all packets in the span are empty.
+  ::mediapipe::Status MovePackets(absl::Span<Packet> packets, bool* notify);
 
   // Closes the input stream.  This function can be called multiple times.
   void Close() ABSL_LOCKS_EXCLUDED(stream_mutex_);
@@ -175,14 +175,13 @@ class InputStreamManager {
                              QueueSizeCallback becomes_not_full_callback);
 
  private:
-  // Adds or moves a list of timestamped packets. Sets "notify" to true if the
+  // Adds or moves a span of timestamped packets. Sets "notify" to true if the
   // queue becomes non-empty. Returns an error if the packets have errors. Does
   // nothing if the input stream is closed.
-  // If the caller is AddPackets(), Container must be const reference.
-  // Otherwise, the caller must be MovePackets() and Container should be
-  // non-const reference.
-  template <typename Container>
-  ::mediapipe::Status AddOrMovePacketsInternal(Container container,
+  // If the caller is AddPackets(), T must be const Packet, and the packets are
+  // copied. Otherwise, the caller must be MovePackets() and T should be Packet.
+  template <typename T>
+  ::mediapipe::Status AddOrMovePacketsInternal(absl::Span<T> packets,
                                                bool* notify)
       ABSL_LOCKS_EXCLUDED(stream_mutex_);
 
@@ -193,7 +192,9 @@ class InputStreamManager {
   Timestamp MinTimestampOrBoundHelper() const;
 
   mutable absl::Mutex stream_mutex_;
-  std::deque<Packet> queue_ ABSL_GUARDED_BY(stream_mutex_);
+  // Packets pass through a ring buffer, so that queueing a packet does not
+  // allocate once the queue has reached its usual size.
+  RingBuffer<Packet> queue_ ABSL_GUARDED_BY(stream_mutex_);
   // The number of packets added to queue_.  Used to verify a packet at
   // Timestamp::PostStream() is the only Packet in the stream.
   int64 num_packets_added_ ABSL_GUARDED_BY(stream_mutex_);
@@ -15,8 +15,10 @@
 #include "mediapipe/framework/input_stream_manager.h"
 
 #include <memory>
+#include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/types/span.h"
 #include "mediapipe/framework/input_stream_shard.h"
 #include "mediapipe/framework/lifetime_tracker.h"
 #include "mediapipe/framework/packet.h"
@@ -92,7 +94,7 @@ class InputStreamManagerTest : public ::testing::Test {
 TEST_F(InputStreamManagerTest, Init) {}
 
 TEST_F(InputStreamManagerTest, AddPackets) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   packets.push_back(MakePacket<std::string>("packet 3").At(Timestamp(30)));
@@ -109,14 +111,14 @@ TEST_F(InputStreamManagerTest, AddPackets) {
 }
 
 TEST_F(InputStreamManagerTest, MovePackets) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   packets.push_back(MakePacket<std::string>("packet 3").At(Timestamp(30)));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
 
-  MP_ASSERT_OK(
-      input_stream_manager_->MovePackets(&packets, &notify_));  // Notification
+  MP_ASSERT_OK(input_stream_manager_->MovePackets(
+      absl::MakeSpan(packets), &notify_));  // Notification
   EXPECT_TRUE(notify_);
   EXPECT_FALSE(input_stream_manager_->IsEmpty());
   // After MovePackets(), the original packets should become empty.
@@ -129,7 +131,7 @@ TEST_F(InputStreamManagerTest, MovePackets) {
 // a stream: Timestamp::Unset(), Timestamp::Unstarted(),
 // Timestamp::OneOverPostStream(), and Timestamp::Done().
 TEST_F(InputStreamManagerTest, AddPacketUnset) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp::Unset()));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
 
@@ -140,7 +142,7 @@ TEST_F(InputStreamManagerTest, AddPacketUnset) {
 }
 
 TEST_F(InputStreamManagerTest, AddPacketUnstarted) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(
       MakePacket<std::string>("packet 1").At(Timestamp::Unstarted()));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -152,7 +154,7 @@ TEST_F(InputStreamManagerTest, AddPacketUnstarted) {
 }
 
 TEST_F(InputStreamManagerTest, AddPacketOneOverPostStream) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(
       MakePacket<std::string>("packet 1").At(Timestamp::OneOverPostStream()));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -165,7 +167,7 @@ TEST_F(InputStreamManagerTest, AddPacketOneOverPostStream) {
 }
 
 TEST_F(InputStreamManagerTest, AddPacketDone) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp::Done()));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
 
@@ -176,7 +178,7 @@ TEST_F(InputStreamManagerTest, AddPacketDone) {
 }
 
 TEST_F(InputStreamManagerTest, AddPacketsOnlyPreStream) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(
       MakePacket<std::string>("packet 1").At(Timestamp::PreStream()));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -190,7 +192,7 @@ TEST_F(InputStreamManagerTest, AddPacketsOnlyPreStream) {
 // An attempt to add a packet after Timestamp::PreStream() should be rejected
 // because the next timestamp bound is Timestamp::OneOverPostStream().
 TEST_F(InputStreamManagerTest, AddPacketsAfterPreStream) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(
       MakePacket<std::string>("packet 1").At(Timestamp::PreStream()));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(10)));
@@ -204,7 +206,7 @@ TEST_F(InputStreamManagerTest, AddPacketsAfterPreStream) {
 }
 
 TEST_F(InputStreamManagerTest, AddPacketsOnlyPostStream) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(
       MakePacket<std::string>("packet 1").At(Timestamp::PostStream()));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -218,7 +220,7 @@ TEST_F(InputStreamManagerTest, AddPacketsOnlyPostStream) {
 // A packet at Timestamp::PostStream() must be the only Packet in an input
 // stream.
 TEST_F(InputStreamManagerTest, AddPacketsBeforePostStream) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(
       MakePacket<std::string>("packet 2").At(Timestamp::PostStream()));
@@ -231,7 +233,7 @@ TEST_F(InputStreamManagerTest, AddPacketsBeforePostStream) {
 }
 
 TEST_F(InputStreamManagerTest, AddPacketsReverseTimestamps) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(20)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 3").At(Timestamp(30)));
@@ -249,7 +251,7 @@ TEST_F(InputStreamManagerTest, PopPacketAtTimestamp) {
   std::string expected_value_at_10("packet 1");
   std::string expected_value_at_20("packet 2");
   std::string expected_value_at_30("packet 3");
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(
       MakePacket<std::string>(expected_value_at_10).At(Timestamp(10)));
   packets.push_back(
@@ -334,7 +336,7 @@ TEST_F(InputStreamManagerTest, PopQueueHead) {
   std::string expected_value_at_10("packet 1");
   std::string expected_value_at_20("packet 2");
   std::string expected_value_at_30("packet 3");
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(
       MakePacket<std::string>(expected_value_at_10).At(Timestamp(10)));
   packets.push_back(
@@ -394,7 +396,7 @@ TEST_F(InputStreamManagerTest, PopQueueHead) {
 }
 
 TEST_F(InputStreamManagerTest, BadPacketType) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<int>(10).At(Timestamp(10)));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
 
@@ -405,7 +407,7 @@ TEST_F(InputStreamManagerTest, BadPacketType) {
 }
 
 TEST_F(InputStreamManagerTest, Close) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   packets.push_back(MakePacket<std::string>("packet 3").At(Timestamp(30)));
@@ -428,7 +430,7 @@ TEST_F(InputStreamManagerTest, Close) {
 }
 
 TEST_F(InputStreamManagerTest, ReuseInputStreamManager) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   packets.push_back(MakePacket<std::string>("packet 3").At(Timestamp(30)));
@@ -481,7 +483,7 @@ TEST_F(InputStreamManagerTest, ReuseInputStreamManager) {
 }
 
 TEST_F(InputStreamManagerTest, MultipleNotifications) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -526,7 +528,7 @@ TEST_F(InputStreamManagerTest, SetHeader) {
 }
 
 TEST_F(InputStreamManagerTest, BackwardsInTime) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -593,7 +595,7 @@ TEST_F(InputStreamManagerTest, BackwardsInTime) {
 }
 
 TEST_F(InputStreamManagerTest, SelectBackwardsInTime) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -637,7 +639,7 @@ TEST_F(InputStreamManagerTest, SelectBackwardsInTime) {
 }
 
 TEST_F(InputStreamManagerTest, TimestampBound) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -747,7 +749,7 @@ TEST_F(InputStreamManagerTest, TimestampBound) {
 }
 
 TEST_F(InputStreamManagerTest, QueueSizeTest) {
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   int max_queue_size = 2;
   input_stream_manager_->SetMaxQueueSize(max_queue_size);
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
@@ -833,7 +835,7 @@ TEST_F(InputStreamManagerTest, InputReleaseTest) {
 // if packet timestamps don't need to be increasing.
 TEST_F(InputStreamManagerTest, AddPacketsAfterPreStreamUntimed) {
   input_stream_manager_->DisableTimestamps();
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(
       MakePacket<std::string>("packet 1").At(Timestamp::PreStream()));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(10)));
@@ -849,7 +851,7 @@ TEST_F(InputStreamManagerTest, AddPacketsAfterPreStreamUntimed) {
 // an input stream if packet timestamps don't need to be increasing.
 TEST_F(InputStreamManagerTest, AddPacketsBeforePostStreamUntimed) {
   input_stream_manager_->DisableTimestamps();
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(
       MakePacket<std::string>("packet 2").At(Timestamp::PostStream()));
@@ -863,7 +865,7 @@ TEST_F(InputStreamManagerTest, AddPacketsBeforePostStreamUntimed) {
 
 TEST_F(InputStreamManagerTest, BackwardsInTimeUntimed) {
   input_stream_manager_->DisableTimestamps();
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -15,6 +15,7 @@
 #include "mediapipe/framework/output_stream_manager.h"
 
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "mediapipe/framework/input_stream_handler.h"
 #include "mediapipe/framework/port/status_builder.h"
 
@@ -171,7 +172,8 @@ void OutputStreamManager::PropagateUpdatesToMirrors(
       next_timestamp_bound_ = next_timestamp_bound;
     }
   }
-  std::list<Packet>* packets_to_propagate = output_stream_shard->OutputQueue();
+  std::vector<Packet>* packets_to_propagate =
+      output_stream_shard->OutputQueue();
   VLOG(3) << "Output stream: " << Name()
           << " queue size: " << packets_to_propagate->size();
   VLOG(3) << "Output stream: " << Name()
@@ -189,8 +191,8 @@ void OutputStreamManager::PropagateUpdatesToMirrors(
       // If the stream is the last element in mirrors_, moves packets from
       // output_queue_. Otherwise, copies the packets.
       if (idx == mirror_count - 1) {
-        mirror.input_stream_handler->MovePackets(mirror.id,
-                                                 packets_to_propagate);
+        mirror.input_stream_handler->MovePackets(
+            mirror.id, absl::MakeSpan(*packets_to_propagate));
       } else {
         mirror.input_stream_handler->AddPackets(mirror.id,
                                                 *packets_to_propagate);
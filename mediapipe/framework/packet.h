@@ -17,11 +17,13 @@
 #ifndef MEDIAPIPE_FRAMEWORK_PACKET_H_
 #define MEDIAPIPE_FRAMEWORK_PACKET_H_
 
+#include <atomic>
 #include <cstddef>
 #include <memory>
 #include <string>
 #include <type_traits>
 #include <typeinfo>
+#include <utility>
 
 #include "absl/base/macros.h"
 #include "absl/memory/memory.h"
@@ -47,12 +49,61 @@ class Packet;
 
 namespace packet_internal {
 class HolderBase;
+template <typename T>
+class InlineHolder;
+
+// A reference-counting pointer to a HolderBase. The count is stored in the
+// holder itself, so sharing a holder among Packets needs no separate control
+// block, and a HolderPtr is a single pointer wide.
+class HolderPtr {
+ public:
+  HolderPtr() : holder_(nullptr) {}
+  // Adds a reference to "holder", which may be nullptr. A newly allocated
+  // holder has no references, so this takes ownership of it.
+  explicit HolderPtr(HolderBase* holder);
+  HolderPtr(const HolderPtr& other);
+  HolderPtr(HolderPtr&& other) noexcept : holder_(other.holder_) {
+    other.holder_ = nullptr;
+  }
+  HolderPtr& operator=(const HolderPtr& other) {
+    HolderPtr(other).swap(*this);
+    return *this;
+  }
+  HolderPtr& operator=(HolderPtr&& other) noexcept {
+    HolderPtr(std::move(other)).swap(*this);
+    return *this;
+  }
+  ~HolderPtr() { reset(); }
+
+  HolderBase* get() const { return holder_; }
+  HolderBase* operator->() const { return holder_; }
+  HolderBase& operator*() const { return *holder_; }
+  explicit operator bool() const { return holder_ != nullptr; }
+
+  // Returns true if this is the only reference to the holder.
+  bool unique() const;
+
+  // Drops the reference, deleting the holder if it was the last one.
+  void reset();
+
+  void swap(HolderPtr& other) noexcept { std::swap(holder_, other.holder_); }
+
+ private:
+  HolderBase* holder_;
+};
+
+inline bool operator==(const HolderPtr& ptr, std::nullptr_t) {
+  return ptr.get() == nullptr;
+}
+inline bool operator!=(const HolderPtr& ptr, std::nullptr_t) {
+  return ptr.get() != nullptr;
+}
 
 Packet Create(HolderBase* holder);
 Packet Create(HolderBase* holder, Timestamp timestamp);
-Packet Create(std::shared_ptr<HolderBase> holder, Timestamp timestamp);
+Packet Create(HolderPtr holder, Timestamp timestamp);
 const HolderBase* GetHolder(const Packet& packet);
-const std::shared_ptr<HolderBase>& GetHolderShared(const Packet& packet);
+const HolderPtr& GetHolderShared(const Packet& packet);
 ::mediapipe::StatusOr<Packet> PacketFromDynamicProto(
     const std::string& type_name, const std::string& serialized);
 }  // namespace packet_internal
@@ -207,15 +258,14 @@ class Packet {
   friend Packet packet_internal::Create(packet_internal::HolderBase* holder);
   friend Packet packet_internal::Create(packet_internal::HolderBase* holder,
                                         class Timestamp timestamp);
-  friend Packet packet_internal::Create(
-      std::shared_ptr<packet_internal::HolderBase> holder,
-      class Timestamp timestamp);
+  friend Packet packet_internal::Create(packet_internal::HolderPtr holder,
+                                        class Timestamp timestamp);
   friend const packet_internal::HolderBase* packet_internal::GetHolder(
       const Packet& packet);
-  friend const std::shared_ptr<packet_internal::HolderBase>&
-  packet_internal::GetHolderShared(const Packet& packet);
+  friend const packet_internal::HolderPtr& packet_internal::GetHolderShared(
+      const Packet& packet);
 
-  std::shared_ptr<packet_internal::HolderBase> holder_;
+  packet_internal::HolderPtr holder_;
   class Timestamp timestamp_;
 };
 
@@ -317,6 +367,16 @@ Packet MakePacket(Args&&... args) {  // NOLINT(build/c++11)
       new T{std::forward<typename std::remove_extent<T>::type>(args)...}));
 }
 
+// Like MakePacket, but stores the object inside the packet's holder, so that
+// the object, the holder and its reference count share a single allocation.
+// This is cheaper for small payloads created at high rates. Consume() on such
+// a packet moves the object into a new allocation. Arrays are not supported.
+template <typename T, typename... Args>
+Packet MakeInlinePacket(Args&&... args) {  // NOLINT(build/c++11)
+  return packet_internal::Create(
+      new packet_internal::InlineHolder<T>(std::forward<Args>(args)...));
+}
+
 // Returns a mutable pointer to the data in a unique_ptr in a packet. This
 // is useful in combination with AdoptAsUniquePtr.  The caller must
 // exercise caution when mutating the retrieved data, since the data
@@ -336,7 +396,7 @@ class ForeignHolder;
 
 class HolderBase {
  public:
-  HolderBase() {}
+  HolderBase() : ref_count_(0) {}
   HolderBase(const HolderBase&) = delete;
   HolderBase& operator=(const HolderBase&) = delete;
   virtual ~HolderBase();
@@ -376,9 +436,35 @@ class HolderBase {
   GetVectorOfProtoMessageLite() = 0;
 
  private:
+  friend class HolderPtr;
+
   size_t type_id_;
+  // The number of HolderPtrs referring to this holder.
+  mutable std::atomic<int> ref_count_;
 };
 
+inline HolderPtr::HolderPtr(HolderBase* holder) : holder_(holder) {
+  if (holder_ != nullptr) {
+    holder_->ref_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+inline HolderPtr::HolderPtr(const HolderPtr& other)
+    : HolderPtr(other.holder_) {}
+
+inline bool HolderPtr::unique() const {
+  return holder_ != nullptr &&
+         holder_->ref_count_.load(std::memory_order_acquire) == 1;
+}
+
+inline void HolderPtr::reset() {
+  if (holder_ != nullptr &&
+      holder_->ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete holder_;
+  }
+  holder_ = nullptr;
+}
+
 // Two helper functions to get the proto base pointers.
 template <typename T>
 const proto_ns::MessageLite* ConvertToProtoMessageLite(const T* data,
@@ -506,7 +592,10 @@ class Holder : public HolderBase {
           "Foreign holder can't release data ptr without ownership.");
     }
     // Casts away constness to make the data mutable after the release.
-    std::unique_ptr<T> data_ptr(const_cast<T*>(ptr_));
+    std::unique_ptr<T> data_ptr(const_cast<T*>(ReleasePtr()));
+    if (data_ptr == nullptr) {
+      return InternalError("Holder does not own a releasable pointer.");
+    }
     ptr_ = nullptr;
     return std::move(data_ptr);
   }
@@ -549,6 +638,10 @@ class Holder : public HolderBase {
     return ConvertToVectorOfProtoMessageLitePtrs(ptr_, is_proto_vector<T>());
   }
 
+  // Returns a pointer that the caller of Release() will own, or nullptr if
+  // the data can't be released.
+  virtual const T* ReleasePtr() { return ptr_; }
+
  private:
   // Call delete[] if T is an array, delete otherwise.
   template <typename U = T>
@@ -586,6 +679,38 @@ class ForeignHolder : public Holder<T> {
   }
 };
 
+// Like Holder, but stores its data as a member rather than in a separate
+// allocation. It keeps the type id of Holder<T>, so that Packet::Get() and
+// Consume() treat both alike.
+template <typename T>
+class InlineHolder : public Holder<T> {
+ public:
+  static_assert(!std::is_array<T>::value,
+                "Arrays can't be stored in an InlineHolder.");
+
+  template <typename... Args>
+  explicit InlineHolder(Args&&... args)  // NOLINT(build/c++11)
+      : Holder<T>(nullptr), data_(std::forward<Args>(args)...) {
+    this->ptr_ = &data_;
+  }
+  ~InlineHolder() override {
+    // Null out ptr_ so it doesn't get deleted by ~Holder.
+    this->ptr_ = nullptr;
+  }
+
+ protected:
+  // The data is freed along with the holder, so it is moved out instead.
+  const T* ReleasePtr() override {
+    return MoveData(std::is_move_constructible<T>());
+  }
+
+ private:
+  T* MoveData(std::true_type) { return new T(std::move(data_)); }
+  T* MoveData(std::false_type) { return nullptr; }
+
+  T data_;
+};
+
 template <typename T>
 Holder<T>* HolderBase::As() {
   if (HolderIsOfType<Holder<T>>() || HolderIsOfType<ForeignHolder<T>>()) {
@@ -656,11 +781,12 @@ inline ::mediapipe::StatusOr<std::unique_ptr<T>> Packet::ConsumeOrCopy(
     if (release_result.ok()) {
       VLOG(2) << "Setting " << DebugString() << " to empty.";
       holder_.reset();
+      if (was_copied) {
+        *was_copied = false;
+      }
+      return release_result;
     }
-    if (was_copied) {
-      *was_copied = false;
-    }
-    return release_result;
+    // An inline holder can't move out a non-movable T, so it is copied.
   }
   VLOG(2) << "Copying the data of " << DebugString();
   std::unique_ptr<T> data_ptr = absl::make_unique<T>(Get<T>());
@@ -717,10 +843,9 @@ inline ::mediapipe::StatusOr<std::unique_ptr<T>> Packet::ConsumeOrCopy(
   return ::mediapipe::InternalError("Unbounded array isn't supported.");
 }
 
-inline Packet::Packet(Packet&& packet) {
-  VLOG(4) << "Using move constructor of " << packet.DebugString();
-  holder_ = std::move(packet.holder_);
-  timestamp_ = packet.timestamp_;
+inline Packet::Packet(Packet&& packet)
+    : holder_(std::move(packet.holder_)), timestamp_(packet.timestamp_) {
+  VLOG(4) << "Using move constructor of " << DebugString();
   packet.timestamp_ = Timestamp::Unset();
 }
 
@@ -791,8 +916,7 @@ inline bool operator!=(const Packet& p1, const Packet& p2) {
 
 namespace packet_internal {
 
-inline const std::shared_ptr<HolderBase>& GetHolderShared(
-    const Packet& packet) {
+inline const HolderPtr& GetHolderShared(const Packet& packet) {
   return packet.holder_;
 }
 
@@ -0,0 +1,234 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/packet_allocator.h"
+
+#include <algorithm>
+#include <new>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/deps/no_destructor.h"
+
+namespace mediapipe {
+
+const GraphService<PacketAllocator> kPacketAllocatorService(
+    "kPacketAllocatorService", kAllowDefaultInitialization);
+
+namespace packet_internal {
+namespace {
+
+// Pooled blocks come in power-of-two size classes from kMinBlockSize to
+// kMaxPooledBlockSize bytes. Larger blocks go directly to the heap.
+constexpr size_t kMinBlockSize = 32;
+constexpr int kNumSizeClasses = 10;
+constexpr int kHeapSizeClass = -1;
+static_assert((kMinBlockSize << (kNumSizeClasses - 1)) == kMaxPooledBlockSize,
+              "Size classes must end at kMaxPooledBlockSize.");
+
+// Every block starts with a header recording its size class, so that it can
+// be freed without knowing its size. The header keeps the payload aligned.
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+// Bytes per size class that a thread keeps before spilling half of its free
+// blocks to the shared free list, and that the shared list keeps before
+// returning blocks to the heap.
+constexpr size_t kMaxThreadCacheBytes = 256 * 1024;
+constexpr size_t kMaxSharedBytes = 4 * 1024 * 1024;
+
+// Number of blocks a thread takes from the shared free list at once.
+constexpr int kRefillBatchSize = 32;
+
+struct BlockHeader {
+  int size_class;
+};
+static_assert(sizeof(BlockHeader) <= kHeaderSize, "Block header too large.");
+
+// A free block, linked through its own storage.
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+struct FreeList {
+  FreeBlock* head = nullptr;
+  int count = 0;
+
+  void Push(FreeBlock* block) {
+    block->next = head;
+    head = block;
+    ++count;
+  }
+  FreeBlock* Pop() {
+    FreeBlock* block = head;
+    head = block->next;
+    --count;
+    return block;
+  }
+};
+
+size_t BlockSize(int size_class) { return kMinBlockSize << size_class; }
+
+int MaxBlocks(int size_class, size_t max_bytes) {
+  return std::max<int>(8, max_bytes / BlockSize(size_class));
+}
+
+int SizeClassFor(size_t size) {
+  if (size > kMaxPooledBlockSize) return kHeapSizeClass;
+  int size_class = 0;
+  while (BlockSize(size_class) < size) ++size_class;
+  return size_class;
+}
+
+// Free blocks shared by all threads. Threads exchange blocks with it in
+// batches, so that blocks freed on one thread can be reused by another.
+class SharedFreeLists {
+ public:
+  void Push(int size_class, FreeList* blocks, int count) {
+    FreeList excess;
+    {
+      absl::MutexLock lock(&mutex_);
+      FreeList& list = lists_[size_class];
+      const int max_blocks = MaxBlocks(size_class, kMaxSharedBytes);
+      for (int i = 0; i < count; ++i) {
+        if (list.count < max_blocks) {
+          list.Push(blocks->Pop());
+        } else {
+          excess.Push(blocks->Pop());
+        }
+      }
+    }
+    while (excess.head != nullptr) {
+      ::operator delete(excess.Pop());
+    }
+  }
+
+  // Moves up to "max_count" blocks into "blocks".
+  void Pop(int size_class, int max_count, FreeList* blocks) {
+    absl::MutexLock lock(&mutex_);
+    FreeList& list = lists_[size_class];
+    while (list.head != nullptr && max_count-- > 0) {
+      blocks->Push(list.Pop());
+    }
+  }
+
+ private:
+  absl::Mutex mutex_;
+  FreeList lists_[kNumSizeClasses] ABSL_GUARDED_BY(mutex_);
+};
+
+SharedFreeLists& GetSharedFreeLists() {
+  static NoDestructor<SharedFreeLists> shared_free_lists;
+  return *shared_free_lists;
+}
+
+class ThreadCache {
+ public:
+  ~ThreadCache() {
+    for (int size_class = 0; size_class < kNumSizeClasses; ++size_class) {
+      FreeList& list = lists_[size_class];
+      GetSharedFreeLists().Push(size_class, &list, list.count);
+    }
+  }
+
+  void* Allocate(int size_class) {
+    FreeList& list = lists_[size_class];
+    if (list.head == nullptr) {
+      GetSharedFreeLists().Pop(size_class, kRefillBatchSize, &list);
+      if (list.head == nullptr) return nullptr;
+    }
+    return list.Pop();
+  }
+
+  void Free(int size_class, void* block) {
+    FreeList& list = lists_[size_class];
+    list.Push(static_cast<FreeBlock*>(block));
+    if (list.count > MaxBlocks(size_class, kMaxThreadCacheBytes)) {
+      GetSharedFreeLists().Push(size_class, &list, list.count / 2);
+    }
+  }
+
+ private:
+  FreeList lists_[kNumSizeClasses];
+};
+
+// The cache of the calling thread. It is null before first use and after the
+// thread has started exiting, when blocks go to the shared free lists.
+thread_local ThreadCache* thread_cache = nullptr;
+thread_local bool thread_cache_destroyed = false;
+thread_local PacketAllocationCounts thread_counts;
+
+struct ThreadCacheOwner {
+  ~ThreadCacheOwner() {
+    thread_cache = nullptr;
+    thread_cache_destroyed = true;
+  }
+  ThreadCache cache;
+};
+
+ThreadCache* GetThreadCache() {
+  if (thread_cache == nullptr && !thread_cache_destroyed) {
+    static thread_local ThreadCacheOwner owner;
+    thread_cache = &owner.cache;
+  }
+  return thread_cache;
+}
+
+}  // namespace
+
+void* AllocatePooledBlock(size_t size) {
+  ++thread_counts.allocations;
+  const int size_class = SizeClassFor(size + kHeaderSize);
+  void* block = nullptr;
+  if (size_class == kHeapSizeClass) {
+    ++thread_counts.heap_allocations;
+    block = ::operator new(size + kHeaderSize);
+  } else {
+    if (ThreadCache* cache = GetThreadCache()) {
+      block = cache->Allocate(size_class);
+    } else {
+      FreeList list;
+      GetSharedFreeLists().Pop(size_class, 1, &list);
+      block = list.head;
+    }
+    if (block == nullptr) {
+      ++thread_counts.heap_allocations;
+      block = ::operator new(BlockSize(size_class));
+    }
+  }
+  static_cast<BlockHeader*>(block)->size_class = size_class;
+  return static_cast<char*>(block) + kHeaderSize;
+}
+
+void FreePooledBlock(void* ptr) {
+  if (ptr == nullptr) return;
+  void* block = static_cast<char*>(ptr) - kHeaderSize;
+  const int size_class = static_cast<BlockHeader*>(block)->size_class;
+  if (size_class == kHeapSizeClass) {
+    ::operator delete(block);
+  } else if (ThreadCache* cache = GetThreadCache()) {
+    cache->Free(size_class, block);
+  } else {
+    FreeList list;
+    list.Push(static_cast<FreeBlock*>(block));
+    GetSharedFreeLists().Push(size_class, &list, 1);
+  }
+}
+
+void RecordHeapAllocation() { ++thread_counts.heap_allocations; }
+
+const PacketAllocationCounts& ThreadPacketAllocationCounts() {
+  return thread_counts;
+}
+
+}  // namespace packet_internal
+}  // namespace mediapipe
@@ -0,0 +1,296 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PACKET_ALLOCATOR_H_
+#define MEDIAPIPE_FRAMEWORK_PACKET_ALLOCATOR_H_
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/deps/no_destructor.h"
+#include "mediapipe/framework/graph_service.h"
+#include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/proto_ns.h"
+
+namespace mediapipe {
+
+// Counts of pooled packet allocations made by the calling thread.
+struct PacketAllocationCounts {
+  // Blocks handed out by the pool.
+  int64 allocations = 0;
+  // Blocks that could not be served from a free list and came from the heap.
+  int64 heap_allocations = 0;
+};
+
+namespace packet_internal {
+
+// Returns a block of at least "size" bytes, aligned like operator new. Blocks
+// of up to kMaxPooledBlockSize bytes are recycled through per-thread free
+// lists, which spill into and refill from a process-wide free list.
+void* AllocatePooledBlock(size_t size);
+// Returns a block to the free list of the calling thread. The block may have
+// been allocated on any thread.
+void FreePooledBlock(void* block);
+// Counts an allocation that NewMessage() could not serve from a free list.
+void RecordHeapAllocation();
+
+constexpr size_t kMaxPooledBlockSize = 16384;
+
+const PacketAllocationCounts& ThreadPacketAllocationCounts();
+
+// An InlineHolder whose storage comes from the pooled allocator.
+template <typename T>
+class PooledHolder : public InlineHolder<T> {
+ public:
+  using InlineHolder<T>::InlineHolder;
+
+  static void* operator new(size_t size) { return AllocatePooledBlock(size); }
+  static void operator delete(void* block) { FreePooledBlock(block); }
+};
+
+// Cleared messages of type T shared by all threads. Threads exchange
+// messages with it in batches, so that messages released on one thread can
+// be reused by another.
+template <typename T>
+class SharedMessageList {
+ public:
+  static constexpr int kMaxMessages = 1024;
+
+  // Moves the last "count" messages of "messages" into the list, and deletes
+  // those that do not fit.
+  void Push(std::vector<std::unique_ptr<T>>* messages, int count) {
+    std::vector<std::unique_ptr<T>> excess;
+    {
+      absl::MutexLock lock(&mutex_);
+      for (int i = 0; i < count; ++i) {
+        if (messages_.size() < kMaxMessages) {
+          messages_.push_back(std::move(messages->back()));
+        } else {
+          excess.push_back(std::move(messages->back()));
+        }
+        messages->pop_back();
+      }
+    }
+    // "excess" is deleted here, outside the lock.
+  }
+
+  // Moves up to "max_count" messages into "messages".
+  void Pop(int max_count, std::vector<std::unique_ptr<T>>* messages) {
+    absl::MutexLock lock(&mutex_);
+    while (!messages_.empty() && max_count-- > 0) {
+      messages->push_back(std::move(messages_.back()));
+      messages_.pop_back();
+    }
+  }
+
+  static SharedMessageList& Get() {
+    static NoDestructor<SharedMessageList> list;
+    return *list;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::unique_ptr<T>> messages_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Cleared messages of type T kept by the calling thread for reuse. A cleared
+// message keeps the capacity of its repeated fields and strings, so refilling
+// it with data of a similar shape needs no allocation. A thread that releases
+// more messages than it allocates, such as the consumer of a pipeline, spills
+// half of its messages to the SharedMessageList when it keeps more than
+// kMaxMessages, and a thread that runs out refills from it.
+template <typename T>
+class MessageFreeList {
+ public:
+  static constexpr int kMaxMessages = 64;
+  static constexpr int kRefillBatchSize = 16;
+
+  // Returns a cleared message, or nullptr if none is available.
+  static T* Pop() {
+    MessageFreeList* list = Get();
+    if (list == nullptr) {
+      std::vector<std::unique_ptr<T>> messages;
+      SharedMessageList<T>::Get().Pop(1, &messages);
+      return messages.empty() ? nullptr : messages.back().release();
+    }
+    if (list->messages_.empty()) {
+      SharedMessageList<T>::Get().Pop(kRefillBatchSize, &list->messages_);
+      if (list->messages_.empty()) return nullptr;
+    }
+    T* message = list->messages_.back().release();
+    list->messages_.pop_back();
+    return message;
+  }
+
+  // Clears "message" and keeps it for reuse.
+  static void Push(T* message) {
+    message->Clear();
+    MessageFreeList* list = Get();
+    if (list == nullptr) {
+      std::vector<std::unique_ptr<T>> messages;
+      messages.emplace_back(message);
+      SharedMessageList<T>::Get().Push(&messages, 1);
+      return;
+    }
+    list->messages_.emplace_back(message);
+    if (list->messages_.size() > kMaxMessages) {
+      SharedMessageList<T>::Get().Push(&list->messages_,
+                                       list->messages_.size() / 2);
+    }
+  }
+
+ private:
+  explicit MessageFreeList(bool* destroyed) : destroyed_(destroyed) {}
+  ~MessageFreeList() {
+    SharedMessageList<T>::Get().Push(&messages_, messages_.size());
+    *destroyed_ = true;
+  }
+
+  // Returns null once the thread has started exiting.
+  static MessageFreeList* Get() {
+    static thread_local bool destroyed = false;
+    if (destroyed) return nullptr;
+    static thread_local MessageFreeList list(&destroyed);
+    return &list;
+  }
+
+  bool* destroyed_;
+  std::vector<std::unique_ptr<T>> messages_;
+};
+
+// A pooled Holder that returns its message to the MessageFreeList instead of
+// deleting it.
+template <typename T>
+class RecycledMessageHolder : public Holder<T> {
+ public:
+  explicit RecycledMessageHolder(T* message) : Holder<T>(message) {}
+  ~RecycledMessageHolder() override {
+    if (this->ptr_ != nullptr) {
+      MessageFreeList<T>::Push(const_cast<T*>(this->ptr_));
+      // Null out ptr_ so it doesn't get deleted by ~Holder.
+      this->ptr_ = nullptr;
+    }
+  }
+
+  T* mutable_message() { return const_cast<T*>(this->ptr_); }
+
+  static void* operator new(size_t size) { return AllocatePooledBlock(size); }
+  static void operator delete(void* block) { FreePooledBlock(block); }
+};
+
+}  // namespace packet_internal
+
+// A protobuf message allocated by PacketAllocator::NewMessage(). The message
+// can be filled in through this handle, and then turned into a Packet.
+template <typename T>
+class PooledMessage {
+ public:
+  PooledMessage(PooledMessage&&) = default;
+  PooledMessage& operator=(PooledMessage&&) = default;
+
+  T* get() const { return message_; }
+  T* operator->() const { return message_; }
+  T& operator*() const { return *message_; }
+
+  // Returns the packet that owns the message. The message must not be
+  // modified through this handle afterwards.
+  Packet ToPacket() && {
+    message_ = nullptr;
+    return std::move(packet_);
+  }
+
+ private:
+  friend class PacketAllocator;
+
+  PooledMessage(Packet packet, T* message)
+      : packet_(std::move(packet)), message_(message) {}
+
+  Packet packet_;
+  T* message_;
+};
+
+// Allocates packet payloads from pooled memory. In a steady-state graph every
+// payload reuses a block or message freed by an earlier packet, so creating
+// packets does not call malloc. The free lists are kept per thread and shared
+// by all graphs in the process, so packets may safely outlive the graph and
+// be released on any thread.
+//
+// Calculators get the graph's allocator through kPacketAllocatorService:
+//
+//   static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+//     cc->UseService(kPacketAllocatorService);
+//     ...
+//   }
+//   ::mediapipe::Status Process(CalculatorContext* cc) {
+//     PacketAllocator& allocator =
+//         cc->Service(kPacketAllocatorService).GetObject();
+//     auto landmarks = allocator.NewMessage<NormalizedLandmarkList>();
+//     landmarks->add_landmark()->set_x(0.5);
+//     cc->Outputs().Index(0).AddPacket(
+//         std::move(landmarks).ToPacket().At(cc->InputTimestamp()));
+//     ...
+//   }
+//
+// When profiling is enabled, the GraphProfiler reports the number of pooled
+// allocations each calculator makes in Process().
+class PacketAllocator {
+ public:
+  PacketAllocator() = default;
+  PacketAllocator(const PacketAllocator&) = delete;
+  PacketAllocator& operator=(const PacketAllocator&) = delete;
+
+  // Returns a packet holding a T constructed from "args", allocated in a
+  // single pooled block along with its holder.
+  template <typename T, typename... Args>
+  Packet MakePacket(Args&&... args) const {  // NOLINT(build/c++11)
+    return packet_internal::Create(
+        new packet_internal::PooledHolder<T>(std::forward<Args>(args)...));
+  }
+
+  // Returns an empty message of type T. The message is reused from one that
+  // was released earlier when possible, preferably on this thread, and is
+  // returned for reuse when its last packet is destroyed.
+  template <typename T>
+  PooledMessage<T> NewMessage() const {
+    static_assert(std::is_base_of<proto_ns::MessageLite, T>::value,
+                  "NewMessage() requires a protobuf message type.");
+    T* message = packet_internal::MessageFreeList<T>::Pop();
+    if (message == nullptr) {
+      packet_internal::RecordHeapAllocation();
+      message = new T;
+    }
+    return PooledMessage<T>(
+        packet_internal::Create(
+            new packet_internal::RecycledMessageHolder<T>(message)),
+        message);
+  }
+
+  // Returns the allocation counts of the calling thread.
+  static const PacketAllocationCounts& ThreadCounts() {
+    return packet_internal::ThreadPacketAllocationCounts();
+  }
+};
+
+// The graph provides a PacketAllocator through this service to any node that
+// requests it, unless one was set with CalculatorGraph::SetServiceObject().
+extern const GraphService<PacketAllocator> kPacketAllocatorService;
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PACKET_ALLOCATOR_H_
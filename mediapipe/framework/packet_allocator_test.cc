@@ -0,0 +1,250 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/packet_allocator.h"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/notification.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/landmark.pb.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/tool/sink.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(PacketAllocatorTest, MakePacket) {
+  PacketAllocator allocator;
+  Packet packet = allocator.MakePacket<std::string>("pooled");
+  EXPECT_EQ("pooled", packet.Get<std::string>());
+  MP_EXPECT_OK(packet.ValidateAsType<std::string>());
+  Packet copy = packet.At(Timestamp(5));
+  EXPECT_EQ(&packet.Get<std::string>(), &copy.Get<std::string>());
+}
+
+TEST(PacketAllocatorTest, RecyclesBlocks) {
+  PacketAllocator allocator;
+  // Warm up the free list for this size.
+  allocator.MakePacket<float>(0.0f);
+  const PacketAllocationCounts before = PacketAllocator::ThreadCounts();
+  for (int i = 0; i < 100; ++i) {
+    Packet packet = allocator.MakePacket<float>(i);
+    EXPECT_EQ(i, packet.Get<float>());
+  }
+  const PacketAllocationCounts& after = PacketAllocator::ThreadCounts();
+  EXPECT_EQ(100, after.allocations - before.allocations);
+  EXPECT_EQ(0, after.heap_allocations - before.heap_allocations);
+}
+
+TEST(PacketAllocatorTest, LargePayloadsUseTheHeap) {
+  PacketAllocator allocator;
+  const PacketAllocationCounts before = PacketAllocator::ThreadCounts();
+  Packet packet = allocator.MakePacket<std::array<char, 1 << 16>>();
+  const PacketAllocationCounts& after = PacketAllocator::ThreadCounts();
+  EXPECT_EQ(1, after.allocations - before.allocations);
+  EXPECT_EQ(1, after.heap_allocations - before.heap_allocations);
+}
+
+TEST(PacketAllocatorTest, NewMessage) {
+  PacketAllocator allocator;
+  PooledMessage<NormalizedLandmarkList> landmarks =
+      allocator.NewMessage<NormalizedLandmarkList>();
+  for (int i = 0; i < 21; ++i) {
+    landmarks->add_landmark()->set_x(i);
+  }
+  Packet packet = std::move(landmarks).ToPacket();
+  const auto& list = packet.Get<NormalizedLandmarkList>();
+  ASSERT_EQ(21, list.landmark_size());
+  EXPECT_EQ(20, list.landmark(20).x());
+  EXPECT_EQ(&list, &packet.GetProtoMessageLite());
+
+  auto status_or_list = packet.Consume<NormalizedLandmarkList>();
+  MP_ASSERT_OK(status_or_list);
+  EXPECT_EQ(&list, status_or_list.ValueOrDie().get());
+  EXPECT_TRUE(packet.IsEmpty());
+}
+
+TEST(PacketAllocatorTest, RecyclesMessages) {
+  PacketAllocator allocator;
+  const NormalizedLandmarkList* first;
+  {
+    auto landmarks = allocator.NewMessage<NormalizedLandmarkList>();
+    landmarks->add_landmark()->set_y(1.0f);
+    first = landmarks.get();
+    Packet packet = std::move(landmarks).ToPacket();
+  }
+  const PacketAllocationCounts before = PacketAllocator::ThreadCounts();
+  auto landmarks = allocator.NewMessage<NormalizedLandmarkList>();
+  EXPECT_EQ(first, landmarks.get());
+  EXPECT_EQ(0, landmarks->landmark_size());
+  const PacketAllocationCounts& after = PacketAllocator::ThreadCounts();
+  EXPECT_EQ(0, after.heap_allocations - before.heap_allocations);
+}
+
+TEST(PacketAllocatorTest, ReleaseOnAnotherThread) {
+  PacketAllocator allocator;
+  std::vector<Packet> packets;
+  for (int i = 0; i < 1000; ++i) {
+    packets.push_back(allocator.MakePacket<int>(i));
+  }
+  std::thread thread([&packets] {
+    PacketAllocator allocator;
+    for (int i = 0; i < 1000; ++i) {
+      packets.push_back(allocator.MakePacket<int>(i));
+    }
+    packets.clear();
+  });
+  thread.join();
+  EXPECT_EQ(42, allocator.MakePacket<int>(42).Get<int>());
+}
+
+// Messages released on a consumer thread are reused by the producer thread,
+// once the consumer keeps more than it needs.
+TEST(PacketAllocatorTest, ReusesMessagesReleasedOnAnotherThread) {
+  constexpr int kNumMessages =
+      4 * packet_internal::MessageFreeList<LandmarkList>::kMaxMessages;
+  PacketAllocator allocator;
+  std::vector<Packet> packets;
+  for (int i = 0; i < kNumMessages; ++i) {
+    auto landmarks = allocator.NewMessage<LandmarkList>();
+    landmarks->add_landmark()->set_x(i);
+    packets.push_back(std::move(landmarks).ToPacket());
+  }
+  absl::Notification released;
+  absl::Notification done;
+  std::thread consumer([&packets, &released, &done] {
+    packets.clear();
+    released.Notify();
+    done.WaitForNotification();
+  });
+  released.WaitForNotification();
+
+  // The consumer thread is still alive, so its messages come back through
+  // the shared list rather than through the exit of the thread.
+  const PacketAllocationCounts before = PacketAllocator::ThreadCounts();
+  for (int i = 0; i < kNumMessages / 2; ++i) {
+    auto landmarks = allocator.NewMessage<LandmarkList>();
+    EXPECT_EQ(0, landmarks->landmark_size());
+    packets.push_back(std::move(landmarks).ToPacket());
+  }
+  const PacketAllocationCounts& after = PacketAllocator::ThreadCounts();
+  EXPECT_EQ(0, after.heap_allocations - before.heap_allocations);
+  done.Notify();
+  consumer.join();
+}
+
+// Outputs a NormalizedLandmarkList for each input packet, allocated through
+// the PacketAllocator service.
+class PooledLandmarksCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).SetAny();
+    cc->Outputs().Index(0).Set<NormalizedLandmarkList>();
+    cc->UseService(kPacketAllocatorService);
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Process(CalculatorContext* cc) override {
+    PacketAllocator& allocator =
+        cc->Service(kPacketAllocatorService).GetObject();
+    auto landmarks = allocator.NewMessage<NormalizedLandmarkList>();
+    landmarks->add_landmark()->set_z(1.0f);
+    cc->Outputs().Index(0).AddPacket(
+        std::move(landmarks).ToPacket().At(cc->InputTimestamp()));
+    return ::mediapipe::OkStatus();
+  }
+};
+REGISTER_CALCULATOR(PooledLandmarksCalculator);
+
+TEST(PacketAllocatorTest, GraphProvidesServiceAndProfilesAllocations) {
+  CalculatorGraphConfig config =
+      ::mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: "input"
+        node {
+          calculator: "PooledLandmarksCalculator"
+          input_stream: "input"
+          output_stream: "landmarks"
+        }
+        profiler_config { enable_profiler: true }
+      )");
+  std::vector<Packet> outputs;
+  tool::AddVectorSink("landmarks", &config, &outputs);
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  MP_ASSERT_OK(graph.StartRun({}));
+  for (int i = 0; i < 10; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "input", MakePacket<int>(i).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+  ASSERT_EQ(10, outputs.size());
+  EXPECT_EQ(1.0f, outputs[9].Get<NormalizedLandmarkList>().landmark(0).z());
+
+  std::vector<CalculatorProfile> profiles;
+  MP_ASSERT_OK(graph.profiler()->GetCalculatorProfiles(&profiles));
+  auto it = std::find_if(profiles.begin(), profiles.end(),
+                         [](const CalculatorProfile& profile) {
+                           return profile.name() == "PooledLandmarksCalculator";
+                         });
+  ASSERT_NE(profiles.end(), it);
+  EXPECT_EQ(10, it->packet_allocations());
+  EXPECT_LE(it->packet_heap_allocations(), 10);
+}
+
+// Compares building a small landmark list on the heap with refilling a
+// recycled one.
+void BM_NewLandmarkListPacket(benchmark::State& state) {
+  const bool pooled = state.range(0);
+  PacketAllocator allocator;
+  for (auto _ : state) {
+    Packet packet;
+    if (pooled) {
+      auto landmarks = allocator.NewMessage<NormalizedLandmarkList>();
+      for (int i = 0; i < 21; ++i) landmarks->add_landmark()->set_x(i);
+      packet = std::move(landmarks).ToPacket();
+    } else {
+      auto landmarks = absl::make_unique<NormalizedLandmarkList>();
+      for (int i = 0; i < 21; ++i) landmarks->add_landmark()->set_x(i);
+      packet = Adopt(landmarks.release());
+    }
+    benchmark::DoNotOptimize(packet);
+  }
+}
+BENCHMARK(BM_NewLandmarkListPacket)->ArgName("pooled")->Arg(0)->Arg(1);
+
+void BM_MakeFloatPacket(benchmark::State& state) {
+  const bool pooled = state.range(0);
+  PacketAllocator allocator;
+  for (auto _ : state) {
+    Packet packet = pooled ? allocator.MakePacket<float>(1.0f)
+                           : MakePacket<float>(1.0f);
+    benchmark::DoNotOptimize(packet);
+  }
+}
+BENCHMARK(BM_MakeFloatPacket)->ArgName("pooled")->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,103 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+const GraphService<ParallelForRunner> kParallelForService(
+    "kParallelForService");
+
+// The state of one Run call. It is shared with the executor tasks, which may
+// start after Run has returned.
+struct ParallelForRunner::Loop {
+  Loop(int size, int block_size, const std::function<void(int, int)>& fn)
+      : size(size),
+        block_size(block_size),
+        num_blocks((size + block_size - 1) / block_size),
+        fn(fn) {}
+
+  // Runs blocks until none are left to claim. "fn" is only used for claimed
+  // blocks, which Run waits for, so it may refer to the caller's stack.
+  void RunBlocks() {
+    int num_run = 0;
+    for (int block = next_block.fetch_add(1, std::memory_order_relaxed);
+         block < num_blocks;
+         block = next_block.fetch_add(1, std::memory_order_relaxed)) {
+      const int begin = block * block_size;
+      fn(begin, std::min(begin + block_size, size));
+      ++num_run;
+    }
+    if (num_run > 0) {
+      absl::MutexLock lock(&mutex);
+      num_done += num_run;
+    }
+  }
+
+  bool Done() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex) {
+    return num_done == num_blocks;
+  }
+
+  const int size;
+  const int block_size;
+  const int num_blocks;
+  const std::function<void(int, int)>& fn;
+  std::atomic<int> next_block{0};
+  absl::Mutex mutex;
+  int num_done ABSL_GUARDED_BY(mutex) = 0;
+};
+
+ParallelForRunner::ParallelForRunner(std::shared_ptr<Executor> executor,
+                                     int max_parallelism)
+    : executor_(std::move(executor)),
+      max_parallelism_(std::max(max_parallelism, 1)) {
+  CHECK(executor_ != nullptr);
+}
+
+void ParallelForRunner::Run(int size, int block_size,
+                            const std::function<void(int, int)>& fn) const {
+  CHECK_GT(block_size, 0);
+  if (size <= 0) {
+    return;
+  }
+  auto loop = std::make_shared<Loop>(size, block_size, fn);
+  const int num_helpers = std::min(loop->num_blocks, max_parallelism_) - 1;
+  for (int i = 0; i < num_helpers; ++i) {
+    executor_->Schedule([loop] { loop->RunBlocks(); });
+  }
+  loop->RunBlocks();
+  absl::MutexLock lock(&loop->mutex);
+  loop->mutex.Await(absl::Condition(loop.get(), &Loop::Done));
+}
+
+void ForEachRowBand(CalculatorContext* cc, int num_rows, int row_bytes,
+                    const std::function<void(int, int)>& fn) {
+  auto runner = cc->Service(kParallelForService);
+  const int band_rows = std::max(kRowBandBytes / std::max(row_bytes, 1), 1);
+  if (!runner.IsAvailable() || num_rows <= band_rows) {
+    fn(0, num_rows);
+    return;
+  }
+  runner.GetObject().Run(num_rows, band_rows, fn);
+}
+
+}  // namespace mediapipe
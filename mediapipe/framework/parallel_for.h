@@ -0,0 +1,81 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PARALLEL_FOR_H_
+#define MEDIAPIPE_FRAMEWORK_PARALLEL_FOR_H_
+
+#include <functional>
+#include <memory>
+
+#include "mediapipe/framework/calculator_context.h"
+#include "mediapipe/framework/executor.h"
+#include "mediapipe/framework/graph_service.h"
+
+namespace mediapipe {
+
+// Splits a loop into blocks and runs them on the threads of an executor.
+//
+// The graph provides a ParallelForRunner on its default executor through
+// kParallelForService, so that a calculator can spread the work of a single
+// Process call, such as a per-pixel pass over a large frame, over the cores
+// without adding nodes to the graph. Most calculators should call
+// ForEachRowBand() below rather than use the runner directly.
+class ParallelForRunner {
+ public:
+  // Runs blocks on "executor", with at most "max_parallelism" of them at a
+  // time, counting the calling thread.
+  ParallelForRunner(std::shared_ptr<Executor> executor, int max_parallelism);
+  ParallelForRunner(const ParallelForRunner&) = delete;
+  ParallelForRunner& operator=(const ParallelForRunner&) = delete;
+
+  int max_parallelism() const { return max_parallelism_; }
+
+  // Calls "fn(begin, end)" for the consecutive blocks of "block_size" items
+  // that make up [0, size), and returns once all of them are done. Blocks
+  // may run concurrently and in any order.
+  //
+  // The calling thread runs blocks too, and only waits for blocks that
+  // another thread has already started. This makes Run safe to call from a
+  // task of the same executor, even when all its threads are busy.
+  void Run(int size, int block_size,
+           const std::function<void(int, int)>& fn) const;
+
+ private:
+  struct Loop;
+
+  std::shared_ptr<Executor> executor_;
+  const int max_parallelism_;
+};
+
+// The graph provides a ParallelForRunner on its default executor through
+// this service, unless the graph runs on the application thread or one was
+// set with CalculatorGraph::SetServiceObject(). Calculators should request
+// it as optional.
+extern const GraphService<ParallelForRunner> kParallelForService;
+
+// The number of bytes that a band of rows should span, so that the rows a
+// thread reads and writes for one band stay in its cache.
+constexpr int kRowBandBytes = 64 * 1024;
+
+// Calls "fn(begin_row, end_row)" for bands of rows that make up
+// [0, num_rows), each spanning about kRowBandBytes of rows of "row_bytes".
+// The bands run in parallel when the calculator has requested
+// kParallelForService and the graph provides it. Otherwise "fn" is called
+// once for all rows.
+void ForEachRowBand(CalculatorContext* cc, int num_rows, int row_bytes,
+                    const std::function<void(int, int)>& fn);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PARALLEL_FOR_H_
@@ -0,0 +1,135 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/thread_pool_executor.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(ParallelForRunnerTest, RunsEachBlockOnce) {
+  ParallelForRunner runner(std::make_shared<ThreadPoolExecutor>(4),
+                           /*max_parallelism=*/4);
+  constexpr int kSize = 1000;
+  constexpr int kBlockSize = 7;
+  std::vector<std::atomic<int>> counts(kSize);
+  runner.Run(kSize, kBlockSize, [&](int begin, int end) {
+    EXPECT_EQ(0, begin % kBlockSize);
+    EXPECT_EQ(std::min(begin + kBlockSize, kSize), end);
+    for (int i = begin; i < end; ++i) {
+      ++counts[i];
+    }
+  });
+  for (int i = 0; i < kSize; ++i) {
+    EXPECT_EQ(1, counts[i]) << i;
+  }
+}
+
+// All blocks run on the calling thread if the executor is busy.
+TEST(ParallelForRunnerTest, DoesNotWaitForBusyExecutor) {
+  // Declared first, so it outlives the executor thread waiting on it.
+  absl::Notification unblock;
+  auto executor = std::make_shared<ThreadPoolExecutor>(1);
+  executor->Schedule([&unblock] { unblock.WaitForNotification(); });
+  ParallelForRunner runner(executor, /*max_parallelism=*/4);
+  int num_blocks = 0;
+  runner.Run(10, 1, [&num_blocks](int begin, int end) { ++num_blocks; });
+  EXPECT_EQ(10, num_blocks);
+  unblock.Notify();
+}
+
+// Outputs the number of bands ForEachRowBand splits "kNumRows" rows into, and
+// checks that they cover every row once.
+class RowBandCalculator : public CalculatorBase {
+ public:
+  static constexpr int kNumRows = 64;
+
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).Set<int>();
+    cc->Outputs().Index(0).Set<int>();
+    cc->UseService(kParallelForService).Optional();
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Process(CalculatorContext* cc) final {
+    const int row_bytes = cc->Inputs().Index(0).Get<int>();
+    std::vector<std::atomic<int>> counts(kNumRows);
+    std::atomic<int> num_bands(0);
+    ForEachRowBand(cc, kNumRows, row_bytes,
+                   [&counts, &num_bands](int begin, int end) {
+                     for (int row = begin; row < end; ++row) {
+                       ++counts[row];
+                     }
+                     ++num_bands;
+                   });
+    for (int row = 0; row < kNumRows; ++row) {
+      RET_CHECK_EQ(1, counts[row]);
+    }
+    cc->Outputs().Index(0).AddPacket(
+        MakePacket<int>(num_bands).At(cc->InputTimestamp()));
+    return ::mediapipe::OkStatus();
+  }
+};
+REGISTER_CALCULATOR(RowBandCalculator);
+
+// Returns the number of bands of rows of "row_bytes" in a graph with
+// "executor_config".
+int CountRowBands(const std::string& executor_config, int row_bytes) {
+  CalculatorGraphConfig config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(absl::StrCat(R"(
+        input_stream: "row_bytes"
+        node {
+          calculator: "RowBandCalculator"
+          input_stream: "row_bytes"
+          output_stream: "num_bands"
+        })",
+                                                              executor_config));
+  std::vector<Packet> output;
+  tool::AddVectorSink("num_bands", &config, &output);
+  CalculatorGraph graph;
+  MP_EXPECT_OK(graph.Initialize(config));
+  MP_EXPECT_OK(graph.StartRun({}));
+  MP_EXPECT_OK(graph.AddPacketToInputStream(
+      "row_bytes", MakePacket<int>(row_bytes).At(Timestamp(0))));
+  MP_EXPECT_OK(graph.CloseAllInputStreams());
+  MP_EXPECT_OK(graph.WaitUntilDone());
+  EXPECT_EQ(1, output.size());
+  return output.empty() ? 0 : output[0].Get<int>();
+}
+
+TEST(ParallelForRunnerTest, ForEachRowBandUsesGraphRunner) {
+  // Bands of 4 rows.
+  EXPECT_EQ(16, CountRowBands("", kRowBandBytes / 4));
+  // A single band for small images.
+  EXPECT_EQ(1, CountRowBands("", 16));
+  // No runner on the application thread.
+  EXPECT_EQ(1, CountRowBands(R"(
+        executor { type: "ApplicationThreadExecutor" })",
+                             kRowBandBytes / 4));
+}
+
+}  // namespace
+}  // namespace mediapipe
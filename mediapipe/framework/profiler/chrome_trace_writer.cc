@@ -0,0 +1,177 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/chrome_trace_writer.h"
+
+#include <fstream>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+
+namespace {
+
+// The process id of all events, as a trace shows a single graph.
+constexpr int kProcessId = 1;
+
+// The text of a trace file without events.
+constexpr char kFileStart[] =
+    "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+    "\"args\":{\"name\":\"MediaPipe graph\"}}";
+constexpr char kFileEnd[] = "\n]\n";
+constexpr int kFileEndSize = sizeof(kFileEnd) - 1;
+
+// Appends "text" as a quoted JSON string.
+void AppendJsonString(absl::string_view text, std::string* json) {
+  static const char kHexDigits[] = "0123456789abcdef";
+  json->push_back('"');
+  for (char c : text) {
+    switch (c) {
+      case '"':
+        json->append("\\\"");
+        break;
+      case '\\':
+        json->append("\\\\");
+        break;
+      case '\n':
+        json->append("\\n");
+        break;
+      case '\t':
+        json->append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          json->append("\\u00");
+          json->push_back(kHexDigits[c >> 4]);
+          json->push_back(kHexDigits[c & 0xf]);
+        } else {
+          json->push_back(c);
+        }
+    }
+  }
+  json->push_back('"');
+}
+
+// Appends the packets of one direction of a calculator run as a JSON array.
+void AppendStreamTraces(
+    const GraphTrace& trace,
+    const google::protobuf::RepeatedPtrField<GraphTrace::StreamTrace>&
+        stream_traces,
+    std::string* json) {
+  json->push_back('[');
+  for (int i = 0; i < stream_traces.size(); ++i) {
+    const GraphTrace::StreamTrace& stream_trace = stream_traces.Get(i);
+    if (i > 0) json->push_back(',');
+    json->append("{\"stream\":");
+    int stream_id = stream_trace.stream_id();
+    AppendJsonString(stream_id >= 0 && stream_id < trace.stream_name_size()
+                         ? trace.stream_name(stream_id)
+                         : absl::StrCat("stream ", stream_id),
+                     json);
+    absl::StrAppend(json, ",\"packet_timestamp\":",
+                    trace.base_timestamp() + stream_trace.packet_timestamp());
+    // For input packets, the time between the output from the producer and
+    // the start of the consumer.
+    if (stream_trace.has_start_time() && stream_trace.has_finish_time()) {
+      absl::StrAppend(json, ",\"latency_usec\":",
+                      stream_trace.finish_time() - stream_trace.start_time());
+    }
+    json->push_back('}');
+  }
+  json->push_back(']');
+}
+
+}  // namespace
+
+ChromeTraceWriter::ChromeTraceWriter(std::vector<std::string> calculator_names)
+    : calculator_names_(std::move(calculator_names)) {}
+
+void ChromeTraceWriter::AppendEvents(const GraphTrace& trace,
+                                     std::string* json) const {
+  for (const GraphTrace::CalculatorTrace& event : trace.calculator_trace()) {
+    json->append(",\n{\"name\":");
+    int node_id = event.node_id();
+    AppendJsonString(node_id >= 0 && node_id < calculator_names_.size()
+                         ? calculator_names_[node_id]
+                         : absl::StrCat("node ", node_id),
+                     json);
+    json->append(",\"cat\":");
+    AppendJsonString(GraphTrace::EventType_Name(event.event_type()), json);
+    if (event.has_start_time() && event.has_finish_time()) {
+      absl::StrAppend(json, ",\"ph\":\"X\",\"ts\":",
+                      trace.base_time() + event.start_time(), ",\"dur\":",
+                      event.finish_time() - event.start_time());
+    } else {
+      int64 time = event.has_start_time() ? event.start_time()
+                                          : event.finish_time();
+      absl::StrAppend(json, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":",
+                      trace.base_time() + time);
+    }
+    absl::StrAppend(json, ",\"pid\":", kProcessId,
+                    ",\"tid\":", event.thread_id(), ",\"args\":{");
+    bool has_args = false;
+    if (event.has_input_timestamp()) {
+      absl::StrAppend(json, "\"input_timestamp\":",
+                      trace.base_timestamp() + event.input_timestamp());
+      has_args = true;
+    }
+    if (event.input_trace_size() > 0) {
+      json->append(has_args ? ",\"inputs\":" : "\"inputs\":");
+      AppendStreamTraces(trace, event.input_trace(), json);
+      has_args = true;
+    }
+    if (event.output_trace_size() > 0) {
+      json->append(has_args ? ",\"outputs\":" : "\"outputs\":");
+      AppendStreamTraces(trace, event.output_trace(), json);
+    }
+    json->append("}}");
+  }
+}
+
+::mediapipe::Status ChromeTraceWriter::WriteEvents(const GraphTrace& trace,
+                                                   const std::string& path,
+                                                   bool is_new_file) const {
+  std::string json;
+  std::fstream file;
+  if (!is_new_file) {
+    // Overwrite the end of the array with the new events.
+    file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (file.is_open()) {
+      file.seekp(0, std::ios::end);
+      if (file.tellp() >= static_cast<std::streamoff>(sizeof(kFileStart) - 1 +
+                                                       kFileEndSize)) {
+        file.seekp(-kFileEndSize, std::ios::end);
+      } else {
+        file.close();
+      }
+    }
+  }
+  if (!file.is_open()) {
+    file.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    json.append(kFileStart);
+  }
+  RET_CHECK(file.is_open()) << "Could not open trace file: " << path;
+  AppendEvents(trace, &json);
+  json.append(kFileEnd);
+  file.write(json.data(), json.size());
+  file.close();
+  RET_CHECK(file.good()) << "Could not write trace file: " << path;
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,60 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PROFILER_CHROME_TRACE_WRITER_H_
+#define MEDIAPIPE_FRAMEWORK_PROFILER_CHROME_TRACE_WRITER_H_
+
+#include <string>
+#include <vector>
+
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+
+// Writes GraphTrace events to files in the Chrome trace-event JSON format,
+// which chrome://tracing and ui.perfetto.dev open directly.
+//
+// Each file holds a JSON array of trace events. Events are appended to the
+// file incrementally, and the array is closed after each append, so that the
+// file is valid JSON whenever it is read.
+//
+// Each CalculatorTrace becomes one event. Calculator runs with a start and a
+// finish time are complete ("X") events. Events with a single time, such as
+// those produced by trace_log_instant_events, are instant ("i") events. The
+// thread id is the tracer's thread id, and the input timestamp and the packet
+// timestamps and latencies of the input and output streams are recorded as
+// event args.
+class ChromeTraceWriter {
+ public:
+  // The calculator names are indexed by node id.
+  explicit ChromeTraceWriter(std::vector<std::string> calculator_names);
+
+  // Appends the events of "trace" as JSON array elements to "json". Each
+  // event is preceded by a comma.
+  void AppendEvents(const GraphTrace& trace, std::string* json) const;
+
+  // Writes the events of "trace" to the file at "path". If "is_new_file" is
+  // true, the file is replaced, otherwise the events are appended to it.
+  ::mediapipe::Status WriteEvents(const GraphTrace& trace,
+                                  const std::string& path,
+                                  bool is_new_file) const;
+
+ private:
+  const std::vector<std::string> calculator_names_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PROFILER_CHROME_TRACE_WRITER_H_
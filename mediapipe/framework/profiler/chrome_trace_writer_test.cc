@@ -0,0 +1,113 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/chrome_trace_writer.h"
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr char kFileStart[] =
+    "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+    "\"args\":{\"name\":\"MediaPipe graph\"}}";
+
+GraphTrace ProcessTrace() {
+  return ParseTextProtoOrDie<GraphTrace>(R"(
+    base_time: 1000000
+    base_timestamp: 500
+    stream_name: ""
+    stream_name: "in"
+    stream_name: "out"
+    calculator_trace {
+      node_id: 1
+      input_timestamp: 10
+      event_type: PROCESS
+      start_time: 100
+      finish_time: 150
+      input_trace {
+        start_time: 80
+        finish_time: 100
+        packet_timestamp: 10
+        stream_id: 1
+      }
+      output_trace { packet_timestamp: 10 stream_id: 2 }
+      thread_id: 3
+    }
+  )");
+}
+
+TEST(ChromeTraceWriterTest, AppendsCompleteEvents) {
+  ChromeTraceWriter writer({"Source", "Transform"});
+  std::string json;
+  writer.AppendEvents(ProcessTrace(), &json);
+  EXPECT_EQ(
+      ",\n{\"name\":\"Transform\",\"cat\":\"PROCESS\",\"ph\":\"X\","
+      "\"ts\":1000100,\"dur\":50,\"pid\":1,\"tid\":3,"
+      "\"args\":{\"input_timestamp\":510,"
+      "\"inputs\":[{\"stream\":\"in\",\"packet_timestamp\":510,"
+      "\"latency_usec\":20}],"
+      "\"outputs\":[{\"stream\":\"out\",\"packet_timestamp\":510}]}}",
+      json);
+}
+
+TEST(ChromeTraceWriterTest, AppendsInstantEvents) {
+  GraphTrace trace = ParseTextProtoOrDie<GraphTrace>(R"(
+    base_time: 1000000
+    calculator_trace { node_id: 0 event_type: OPEN start_time: 7 thread_id: 2 }
+    calculator_trace { node_id: 5 event_type: OPEN finish_time: 9 }
+  )");
+  ChromeTraceWriter writer({"Source \"A\""});
+  std::string json;
+  writer.AppendEvents(trace, &json);
+  EXPECT_EQ(
+      ",\n{\"name\":\"Source \\\"A\\\"\",\"cat\":\"OPEN\",\"ph\":\"i\","
+      "\"s\":\"t\",\"ts\":1000007,\"pid\":1,\"tid\":2,\"args\":{}}"
+      ",\n{\"name\":\"node 5\",\"cat\":\"OPEN\",\"ph\":\"i\","
+      "\"s\":\"t\",\"ts\":1000009,\"pid\":1,\"tid\":0,\"args\":{}}",
+      json);
+}
+
+TEST(ChromeTraceWriterTest, WritesAndAppendsFiles) {
+  std::string path = absl::StrCat(getenv("TEST_TMPDIR"), "/trace.json");
+  ChromeTraceWriter writer({"Source", "Transform"});
+  std::string events;
+  writer.AppendEvents(ProcessTrace(), &events);
+
+  // Each write leaves a complete JSON array.
+  MP_ASSERT_OK(writer.WriteEvents(ProcessTrace(), path, /*is_new_file=*/true));
+  std::string contents;
+  MP_ASSERT_OK(file::GetContents(path, &contents));
+  EXPECT_EQ(absl::StrCat(kFileStart, events, "\n]\n"), contents);
+
+  MP_ASSERT_OK(
+      writer.WriteEvents(ProcessTrace(), path, /*is_new_file=*/false));
+  MP_ASSERT_OK(file::GetContents(path, &contents));
+  EXPECT_EQ(absl::StrCat(kFileStart, events, events, "\n]\n"), contents);
+
+  // A new file replaces the previous one.
+  MP_ASSERT_OK(writer.WriteEvents(GraphTrace(), path, /*is_new_file=*/true));
+  MP_ASSERT_OK(file::GetContents(path, &contents));
+  EXPECT_EQ(absl::StrCat(kFileStart, "\n]\n"), contents);
+}
+
+}  // namespace
+}  // namespace mediapipe
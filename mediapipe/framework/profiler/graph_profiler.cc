@@ -26,6 +26,7 @@
 #include "mediapipe/framework/port/proto_ns.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/profiler/chrome_trace_writer.h"
 #include "mediapipe/framework/profiler/profiler_resource_util.h"
 #include "mediapipe/framework/tool/name_util.h"
 #include "mediapipe/framework/tool/tag_map.h"
@@ -152,9 +153,27 @@ void GraphProfiler::Initialize(
                              &profile);
     }
 
-    auto iter = calculator_profiles_.insert({node_name, profile});
-    CHECK(iter.second) << absl::Substitute(
-        "Calculator \"$0\" has already been added.", node_name);
+    CHECK(node_ids_by_name_.emplace(node_name, node_id).second)
+        << absl::Substitute("Calculator \"$0\" has already been added.",
+                            node_name);
+    node_profiles_.push_back(absl::make_unique<NodeProfile>());
+    NodeProfile* node_profile = node_profiles_.back().get();
+    node_profile->name = node_name;
+    if (IsProfilerEnabled(profiler_config_)) {
+      node_profile->process_runtime = absl::make_unique<LatencyRecorder>();
+      if (profiler_config_.enable_stream_latency()) {
+        node_profile->process_input_latency =
+            absl::make_unique<LatencyRecorder>();
+        node_profile->process_output_latency =
+            absl::make_unique<LatencyRecorder>();
+        for (int i = 0; i < profile.input_stream_profiles_size(); ++i) {
+          node_profile->input_stream_latency.push_back(
+              absl::make_unique<LatencyRecorder>());
+        }
+      }
+    }
+    absl::MutexLock node_lock(&node_profile->mutex);
+    node_profile->profile = std::move(profile);
   }
   is_initialized_ = true;
 }
@@ -185,9 +204,9 @@ void GraphProfiler::Resume() {
 
 void GraphProfiler::Reset() {
   absl::WriterMutexLock lock(&profiler_mutex_);
-  for (auto iter = calculator_profiles_.begin();
-       iter != calculator_profiles_.end(); ++iter) {
-    CalculatorProfile* calculator_profile = &iter->second;
+  for (auto& node_profile : node_profiles_) {
+    absl::MutexLock node_lock(&node_profile->mutex);
+    CalculatorProfile* calculator_profile = &node_profile->profile;
     ResetTimeHistogram(calculator_profile->mutable_process_runtime());
     ResetTimeHistogram(calculator_profile->mutable_process_input_latency());
     ResetTimeHistogram(calculator_profile->mutable_process_output_latency());
@@ -195,6 +214,16 @@ void GraphProfiler::Reset() {
          *(calculator_profile->mutable_input_stream_profiles())) {
       ResetTimeHistogram(input_stream_profile.mutable_latency());
     }
+    if (node_profile->process_runtime) {
+      node_profile->process_runtime->Reset();
+    }
+    if (node_profile->process_input_latency) {
+      node_profile->process_input_latency->Reset();
+      node_profile->process_output_latency->Reset();
+    }
+    for (auto& recorder : node_profile->input_stream_latency) {
+      recorder->Reset();
+    }
   }
 }
 
@@ -286,8 +315,30 @@ void GraphProfiler::AddPacketInfo(const TraceEvent& packet_info) {
   absl::ReaderMutexLock lock(&profiler_mutex_);
   RET_CHECK(is_initialized_)
       << "GetCalculatorProfiles can only be called after Initialize()";
-  for (auto& entry : calculator_profiles_) {
-    profiles->push_back(entry.second);
+  // Sets a log-linear histogram if it has samples.
+  auto set_histogram = [](const std::unique_ptr<LatencyRecorder>& recorder,
+                          LatencyHistogram* histogram) {
+    if (recorder && recorder->sample_count() > 0) {
+      recorder->Snapshot(histogram);
+    }
+  };
+  for (auto& node_profile : node_profiles_) {
+    {
+      absl::MutexLock node_lock(&node_profile->mutex);
+      profiles->push_back(node_profile->profile);
+    }
+    CalculatorProfile* profile = &profiles->back();
+    set_histogram(node_profile->process_runtime,
+                  profile->mutable_process_runtime_histogram());
+    set_histogram(node_profile->process_input_latency,
+                  profile->mutable_process_input_latency_histogram());
+    set_histogram(node_profile->process_output_latency,
+                  profile->mutable_process_output_latency_histogram());
+    for (int i = 0; i < node_profile->input_stream_latency.size(); ++i) {
+      set_histogram(node_profile->input_stream_latency[i],
+                    profile->mutable_input_stream_profiles(i)
+                        ->mutable_latency_histogram());
+    }
   }
   return ::mediapipe::OkStatus();
 }
@@ -375,10 +426,10 @@ void GraphProfiler::AddPacketInfoForOutputPackets(
 
 int64 GraphProfiler::AddStreamLatencies(
     const CalculatorContext& calculator_context, int64 start_time_usec,
-    int64 end_time_usec, CalculatorProfile* calculator_profile) {
+    int64 end_time_usec, NodeProfile* node_profile) {
   // Update input streams profiles.
   int64 min_source_process_start_usec = AddInputStreamTimeSamples(
-      calculator_context, start_time_usec, calculator_profile);
+      calculator_context, start_time_usec, node_profile);
 
   // Update output production times.
   AddPacketInfoForOutputPackets(calculator_context.Outputs(), end_time_usec,
@@ -393,18 +444,15 @@ void GraphProfiler::SetOpenRuntime(const CalculatorContext& calculator_context,
     return;
   }
 
-  const std::string& node_name = calculator_context.NodeName();
   int64 time_usec = end_time_usec - start_time_usec;
-  auto profile_iter = calculator_profiles_.find(node_name);
-  CHECK(profile_iter != calculator_profiles_.end()) << absl::Substitute(
-      "Calculator \"$0\" has not been added during initialization.",
-      calculator_context.NodeName());
-  CalculatorProfile* calculator_profile = &profile_iter->second;
+  NodeProfile* node_profile = GetNodeProfile(calculator_context);
+  absl::MutexLock node_lock(&node_profile->mutex);
+  CalculatorProfile* calculator_profile = &node_profile->profile;
   calculator_profile->set_open_runtime(time_usec);
 
   if (profiler_config_.enable_stream_latency()) {
     AddStreamLatencies(calculator_context, start_time_usec, end_time_usec,
-                       calculator_profile);
+                       node_profile);
   }
 }
 
@@ -415,23 +463,31 @@ void GraphProfiler::SetCloseRuntime(const CalculatorContext& calculator_context,
   if (!is_profiling_) {
     return;
   }
-  const std::string& node_name = calculator_context.NodeName();
   int64 time_usec = end_time_usec - start_time_usec;
-  auto profile_iter = calculator_profiles_.find(node_name);
-  CHECK(profile_iter != calculator_profiles_.end()) << absl::Substitute(
-      "Calculator \"$0\" has not been added during initialization.",
-      calculator_context.NodeName());
-  CalculatorProfile* calculator_profile = &profile_iter->second;
+  NodeProfile* node_profile = GetNodeProfile(calculator_context);
+  absl::MutexLock node_lock(&node_profile->mutex);
+  CalculatorProfile* calculator_profile = &node_profile->profile;
   calculator_profile->set_close_runtime(time_usec);
 
   if (profiler_config_.enable_stream_latency()) {
     AddStreamLatencies(calculator_context, start_time_usec, end_time_usec,
-                       calculator_profile);
+                       node_profile);
   }
 }
 
+GraphProfiler::NodeProfile* GraphProfiler::GetNodeProfile(
+    const CalculatorContext& calculator_context) {
+  const int node_id = calculator_context.NodeId();
+  CHECK(node_id >= 0 && node_id < node_profiles_.size()) << absl::Substitute(
+      "Calculator \"$0\" has not been added during initialization.",
+      calculator_context.NodeName());
+  DCHECK_EQ(node_profiles_[node_id]->name, calculator_context.NodeName());
+  return node_profiles_[node_id].get();
+}
+
 void GraphProfiler::AddTimeSample(int64 start_time_usec, int64 end_time_usec,
-                                  TimeHistogram* histogram) {
+                                  TimeHistogram* histogram,
+                                  LatencyRecorder* recorder) {
   if (end_time_usec < start_time_usec) {
     LOG(ERROR) << absl::Substitute(
         "end_time_usec ($0) is < start_time_usec ($1)", end_time_usec,
@@ -446,11 +502,15 @@ void GraphProfiler::AddTimeSample(int64 start_time_usec, int64 end_time_usec,
     interval_index = histogram->num_intervals() - 1;
   }
   histogram->set_count(interval_index, histogram->count(interval_index) + 1);
+  if (recorder) {
+    recorder->Record(time_usec);
+  }
 }
 
 int64 GraphProfiler::AddInputStreamTimeSamples(
     const CalculatorContext& calculator_context, int64 start_time_usec,
-    CalculatorProfile* calculator_profile) {
+    NodeProfile* node_profile) {
+  CalculatorProfile* calculator_profile = &node_profile->profile;
   int64 input_timestamp_usec = calculator_context.InputTimestamp().Value();
   int64 min_source_process_start_usec = start_time_usec;
   int64 input_stream_counter = -1;
@@ -477,7 +537,8 @@ int64 GraphProfiler::AddInputStreamTimeSamples(
     AddTimeSample(
         packet_info->production_time_usec, start_time_usec,
         calculator_profile->mutable_input_stream_profiles(input_stream_counter)
-            ->mutable_latency());
+            ->mutable_latency(),
+        node_profile->input_stream_latency[input_stream_counter].get());
 
     min_source_process_start_usec = std::min(
         min_source_process_start_usec, packet_info->source_process_start_usec);
@@ -488,31 +549,40 @@ int64 GraphProfiler::AddInputStreamTimeSamples(
 
 void GraphProfiler::AddProcessSample(
     const CalculatorContext& calculator_context, int64 start_time_usec,
-    int64 end_time_usec) {
+    int64 end_time_usec, const PacketAllocationCounts& packet_allocations) {
   absl::ReaderMutexLock lock(&profiler_mutex_);
   if (!is_profiling_) {
     return;
   }
 
-  const std::string& node_name = calculator_context.NodeName();
-  auto profile_iter = calculator_profiles_.find(node_name);
-  CHECK(profile_iter != calculator_profiles_.end()) << absl::Substitute(
-      "Calculator \"$0\" has not been added during initialization.",
-      calculator_context.NodeName());
-  CalculatorProfile* calculator_profile = &profile_iter->second;
+  NodeProfile* node_profile = GetNodeProfile(calculator_context);
+  absl::MutexLock node_lock(&node_profile->mutex);
+  CalculatorProfile* calculator_profile = &node_profile->profile;
 
   // Update Process() runtime.
   AddTimeSample(start_time_usec, end_time_usec,
-                calculator_profile->mutable_process_runtime());
+                calculator_profile->mutable_process_runtime(),
+                node_profile->process_runtime.get());
+  // Allocation counts are only reported for calculators that allocate.
+  if (packet_allocations.allocations > 0) {
+    calculator_profile->set_packet_allocations(
+        calculator_profile->packet_allocations() +
+        packet_allocations.allocations);
+    calculator_profile->set_packet_heap_allocations(
+        calculator_profile->packet_heap_allocations() +
+        packet_allocations.heap_allocations);
+  }
 
   if (profiler_config_.enable_stream_latency()) {
     int64 min_source_process_start_usec = AddStreamLatencies(
-        calculator_context, start_time_usec, end_time_usec, calculator_profile);
+        calculator_context, start_time_usec, end_time_usec, node_profile);
     // Update input and output trace latencies.
     AddTimeSample(min_source_process_start_usec, start_time_usec,
-                  calculator_profile->mutable_process_input_latency());
+                  calculator_profile->mutable_process_input_latency(),
+                  node_profile->process_input_latency.get());
     AddTimeSample(min_source_process_start_usec, end_time_usec,
-                  calculator_profile->mutable_process_output_latency());
+                  calculator_profile->mutable_process_output_latency(),
+                  node_profile->process_output_latency.get());
   }
 }
 
@@ -553,6 +623,20 @@ class OstreamStream : public proto_ns::io::ZeroCopyOutputStream {
   OstreamStream& operator=(const OstreamStream&) = delete;
 };
 
+namespace {
+
+// Returns the canonical node names indexed by node id.
+std::vector<std::string> CanonicalNodeNames(
+    const CalculatorGraphConfig& graph_config) {
+  std::vector<std::string> result;
+  for (int i = 0; i < graph_config.node().size(); ++i) {
+    result.push_back(CanonicalNodeName(graph_config, i));
+  }
+  return result;
+}
+
+}  // namespace
+
 // Sets the canonical node name in each CalculatorGraphConfig::Node
 // and also in GraphTrace.
 void AssignNodeNames(GraphProfile* profile) {
@@ -609,6 +693,19 @@ void AssignNodeNames(GraphProfile* profile) {
     return ::mediapipe::OkStatus();
   }
 
+  ++previous_log_index_;
+  bool is_new_file = (previous_log_index_ % log_interval_count == 0);
+  int log_index = previous_log_index_ / log_interval_count % log_file_count;
+
+  // Chrome traces hold only the trace events, so the CalculatorProfiles are
+  // left to accumulate.
+  if (profiler_config_.trace_log_format() ==
+      ProfilerConfig::CHROME_TRACE_JSON) {
+    ChromeTraceWriter writer(CanonicalNodeNames(validated_graph_->Config()));
+    return writer.WriteEvents(
+        *trace, absl::StrCat(trace_log_path, log_index, ".json"), is_new_file);
+  }
+
   // Record the latest CalculatorProfiles.
   Status status;
   std::vector<CalculatorProfile> profiles;
@@ -619,15 +716,12 @@ void AssignNodeNames(GraphProfile* profile) {
   this->Reset();
 
   // Record the CalculatorGraphConfig, once per log file.
-  ++previous_log_index_;
-  bool is_new_file = (previous_log_index_ % log_interval_count == 0);
   if (is_new_file) {
     *profile.mutable_config() = validated_graph_->Config();
     AssignNodeNames(&profile);
   }
 
   // Write the GraphProfile to the trace_log_path.
-  int log_index = previous_log_index_ / log_interval_count % log_file_count;
   std::string log_path = absl::StrCat(trace_log_path, log_index, ".binarypb");
   std::ofstream ofs;
   if (is_new_file) {
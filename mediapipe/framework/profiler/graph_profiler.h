@@ -17,11 +17,14 @@
 
 #include <atomic>
 #include <cstddef>
+#include <list>
 #include <memory>
 #include <set>
 #include <string>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/calculator_context.h"
@@ -29,8 +32,10 @@
 #include "mediapipe/framework/deps/clock.h"
 #include "mediapipe/framework/deps/monotonic_clock.h"
 #include "mediapipe/framework/executor.h"
+#include "mediapipe/framework/packet_allocator.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/profiler/graph_tracer.h"
+#include "mediapipe/framework/profiler/latency_histogram.h"
 #include "mediapipe/framework/profiler/sharded_map.h"
 #include "mediapipe/framework/validated_graph_config.h"
 
@@ -100,7 +105,6 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
   GraphProfiler()
       : is_initialized_(false),
         is_profiling_(false),
-        calculator_profiles_(1000),
         packets_info_(1000),
         is_running_(false),
         previous_log_end_time_(absl::InfinitePast()),
@@ -179,6 +183,7 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
           calculator_context_(*calculator_context),
           profiler_(profiler) {
       start_time_usec_ = profiler_->TimeNowUsec();
+      start_allocations_ = PacketAllocator::ThreadCounts();
       if (profiler_->is_tracing_) {
         absl::Time time_now = absl::FromUnixMicros(start_time_usec_);
         profiler_->packet_tracer_->LogInputEvents(
@@ -199,10 +204,18 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
                                       end_time_usec);
             break;
 
-          case GraphTrace::PROCESS:
+          case GraphTrace::PROCESS: {
+            const PacketAllocationCounts& end_allocations =
+                PacketAllocator::ThreadCounts();
+            PacketAllocationCounts allocations;
+            allocations.allocations =
+                end_allocations.allocations - start_allocations_.allocations;
+            allocations.heap_allocations = end_allocations.heap_allocations -
+                                           start_allocations_.heap_allocations;
             profiler_->AddProcessSample(calculator_context_, start_time_usec_,
-                                        end_time_usec);
+                                        end_time_usec, allocations);
             break;
+          }
 
           case GraphTrace::CLOSE:
             profiler_->SetCloseRuntime(calculator_context_, start_time_usec_,
@@ -224,9 +237,13 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
     const CalculatorContext& calculator_context_;
     GraphProfiler* profiler_;
     int64 start_time_usec_;
+    // Pooled packet allocations made by this thread before the call.
+    PacketAllocationCounts start_allocations_;
   };
 
  private:
+  struct NodeProfile;
+
   // This can be used to add packet info for the input streams to the graph.
   // It treats the stream defined by |stream_name| as a stream produced by a
   // source calculator and thus uses |timestamp_usec| for the packet production
@@ -239,9 +256,11 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
                                       int64 num_intervals,
                                       TimeHistogram* histogram);
   static void ResetTimeHistogram(TimeHistogram* histogram);
-  // Add a sample to a time histogram.
+  // Add a sample to a time histogram, and to a log-linear histogram if
+  // "recorder" is not null.
   static void AddTimeSample(int64 start_time_usec, int64 end_time_usec,
-                            TimeHistogram* histogram);
+                            TimeHistogram* histogram,
+                            LatencyRecorder* recorder = nullptr);
 
   // Add output streams to the stream consumer count map.
   // This is neeeded in case an output stream is not consumed by any calculator.
@@ -269,7 +288,7 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
   // Updates the production time for outputs and the stream profile for inputs.
   int64 AddStreamLatencies(const CalculatorContext& calculator_context,
                            int64 start_time_usec, int64 end_time_usec,
-                           CalculatorProfile* calculator_profile);
+                           NodeProfile* node_profile);
 
   void SetOpenRuntime(const CalculatorContext& calculator_context,
                       int64 start_time_usec, int64 end_time_usec)
@@ -283,12 +302,15 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
   // packets and back-edge packets. Returns -1 if there is no input packets.
   int64 AddInputStreamTimeSamples(const CalculatorContext& calculator_context,
                                   int64 start_time_usec,
-                                  CalculatorProfile* calculator_profile);
+                                  NodeProfile* node_profile);
 
-  // Updates the Process() data for calculator.
+  // Updates the Process() data for calculator, including the packet payloads
+  // it allocated through the PacketAllocator service.
   // Requires ReaderLock for is_profiling_.
-  void AddProcessSample(const CalculatorContext& calculator_context,
-                        int64 start_time_usec, int64 end_time_usec)
+  void AddProcessSample(
+      const CalculatorContext& calculator_context, int64 start_time_usec,
+      int64 end_time_usec,
+      const PacketAllocationCounts& packet_allocations = {})
       ABSL_LOCKS_EXCLUDED(profiler_mutex_);
 
   // Helper method to get trace_log_path.  If the trace_log_path is empty and
@@ -312,9 +334,31 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
   // If true, the tracer records timing events.
   std::atomic_bool is_tracing_;
 
-  // Stores all the calculator profiles with the calculator name as the key.
-  using CalculatorProfileMap = ShardedMap<std::string, CalculatorProfile>;
-  CalculatorProfileMap calculator_profiles_;
+  // The profile of a calculator. Each profile has its own mutex, so that
+  // calculators update their profiles without contending with each other.
+  struct NodeProfile {
+    std::string name;
+    absl::Mutex mutex;
+    CalculatorProfile profile ABSL_GUARDED_BY(mutex);
+    // The log-linear histograms of the profile, which are allocated only if
+    // the profiler is enabled. The input stream histograms are indexed like
+    // the input_stream_profiles, and are allocated only if stream latency is
+    // enabled. LatencyRecorders need no locking.
+    std::unique_ptr<LatencyRecorder> process_runtime;
+    std::unique_ptr<LatencyRecorder> process_input_latency;
+    std::unique_ptr<LatencyRecorder> process_output_latency;
+    std::vector<std::unique_ptr<LatencyRecorder>> input_stream_latency;
+  };
+
+  // Returns the profile of the calculator running in a context. The profile
+  // is found by node id, without hashing the calculator name.
+  NodeProfile* GetNodeProfile(const CalculatorContext& calculator_context)
+      ABSL_SHARED_LOCKS_REQUIRED(profiler_mutex_);
+
+  // Stores all the calculator profiles, indexed by node id.
+  std::vector<std::unique_ptr<NodeProfile>> node_profiles_;
+  // Stores the node id for each calculator name.
+  absl::flat_hash_map<std::string, int> node_ids_by_name_;
   // Stores the production time of a packet, based on profiler's clock.
   using PacketInfoMap =
       ShardedMap<std::string, std::list<std::pair<int64, PacketInfo>>>;
@@ -119,12 +119,13 @@ class GraphProfilerTestPeer : public testing::Test {
     return profiler_.profiler_config_.use_packet_timestamp_for_added_packet();
   }
 
-  GraphProfiler::CalculatorProfileMap* GetCalculatorProfilesMap() {
-    return &profiler_.calculator_profiles_;
-  }
+  int NumCalculatorProfiles() { return profiler_.node_profiles_.size(); }
 
   CalculatorProfile FindCalculatorProfile(const std::string& expected_name) {
-    return GetCalculatorProfilesMap()->find(expected_name)->second;
+    int node_id = profiler_.node_ids_by_name_.at(expected_name);
+    auto& node_profile = *profiler_.node_profiles_[node_id];
+    absl::MutexLock lock(&node_profile.mutex);
+    return node_profile.profile;
   }
 
   GraphProfiler::PacketInfoMap* GetPacketsInfoMap() {
@@ -192,8 +193,7 @@ class GraphProfilerTestPeer : public testing::Test {
   void CheckHasProfilesWithInputStreamName(
       const std::string& expected_name,
       const std::vector<std::string>& expected_stream_names) {
-    CalculatorProfile profile =
-        GetCalculatorProfilesMap()->find(expected_name)->second;
+    CalculatorProfile profile = FindCalculatorProfile(expected_name);
     ASSERT_EQ(profile.name(), expected_name);
     ASSERT_EQ(profile.input_stream_profiles().size(),
               expected_stream_names.size())
@@ -247,8 +247,7 @@ TEST_F(GraphProfilerTestPeer, InitializeConfig) {
   ASSERT_EQ(GetTraceLogDisabled(), true);
   ASSERT_EQ(GetUsePacketTimeStampForAddedPacket(), true);
   // Checks histogram_interval_size_usec and num_histogram_intervals.
-  CalculatorProfile actual =
-      GetCalculatorProfilesMap()->find(kDummyTestCalculatorName)->second;
+  CalculatorProfile actual = FindCalculatorProfile(kDummyTestCalculatorName);
   EXPECT_THAT(actual, EqualsProto(R"(
                 name: "DummyTestCalculator"
                 process_runtime {
@@ -311,8 +310,7 @@ TEST_F(GraphProfilerTestPeer, InitializeConfigWithoutStreamLatency) {
   ASSERT_EQ(GetIsProfilingStreamLatency(), false);
   ASSERT_EQ(GetUsePacketTimeStampForAddedPacket(), false);
   // Checks histogram_interval_size_usec and num_histogram_intervals.
-  CalculatorProfile actual =
-      GetCalculatorProfilesMap()->find(kDummyTestCalculatorName)->second;
+  CalculatorProfile actual = FindCalculatorProfile(kDummyTestCalculatorName);
   EXPECT_THAT(actual, EqualsProto(R"(
                 name: "DummyTestCalculator"
                 process_runtime {
@@ -395,8 +393,8 @@ TEST_F(GraphProfilerTestPeer, Initialize) {
       output_stream: "dangling_output_stream"
     })");
 
-  // Checks calculator_profiles_ map.
-  ASSERT_EQ(GetCalculatorProfilesMap()->size(), 7);
+  // Checks the calculator profiles.
+  ASSERT_EQ(NumCalculatorProfiles(), 7);
   CheckHasProfilesWithInputStreamName("A_Source_Calc", {});
   CheckHasProfilesWithInputStreamName("A_Normal_Calc",
                                       {"input_stream", "source_stream1"});
@@ -1013,7 +1011,16 @@ TEST_F(GraphProfilerTestPeer, AddProcessSample) {
                   num_intervals: 1
                   count: 1
                 }
+                process_runtime_histogram {
+                  total: 150
+                  sample_count: 1
+                  max_usec: 150
+                  bucket: 66
+                  count: 1
+                }
               )"));
+  EXPECT_EQ(150, LatencyPercentile(profiles[0].process_runtime_histogram(),
+                                   /*quantile=*/0.99));
   // Checks packets_info_ map hasn't changed.
   ASSERT_EQ(GetPacketsInfoMap()->size(), 0);
 }
@@ -1094,7 +1101,7 @@ TEST_F(GraphProfilerTestPeer, AddProcessSampleWithStreamLatency) {
             expected_packet_info);
 
   // Run process for consumer calculator and checks its profile.
-  TestContextBuilder consumer_context("consumer_calc", /*node_id=*/0,
+  TestContextBuilder consumer_context("consumer_calc", /*node_id=*/1,
                                       {"stream_0", "stream_1"}, {});
   consumer_context.AddInputs(
       {Packet(), MakePacket<std::string>("15").At(Timestamp(100))});
@@ -1127,8 +1134,13 @@ TEST_F(GraphProfilerTestPeer, AddProcessSampleWithStreamLatency) {
                 input_stream_profiles {
                   name: "stream_1"
                   latency { total: 850 }
+                  latency_histogram { total: 850 sample_count: 1 max_usec: 850 }
                 }
+                process_input_latency_histogram { total: 1000 sample_count: 1 }
+                process_output_latency_histogram { total: 1250 sample_count: 1 }
               )")));
+  EXPECT_FALSE(
+      consumer_profile.input_stream_profiles(0).has_latency_histogram());
 
   // Check packets_info_ map for PacketId({"stream_1", 100}) should not yet be
   // garbage collected.
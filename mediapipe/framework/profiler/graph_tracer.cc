@@ -14,6 +14,12 @@
 
 #include "mediapipe/framework/profiler/graph_tracer.h"
 
+#include <algorithm>
+#include <atomic>
+#include <tuple>
+#include <utility>
+
+#include "absl/memory/memory.h"
 #include "absl/time/time.h"
 #include "mediapipe/framework/calculator_context.h"
 #include "mediapipe/framework/calculator_profile.pb.h"
@@ -32,11 +38,50 @@ const absl::Duration kDefaultTraceLogInterval = absl::Milliseconds(500);
 
 // Returns a unique identifier for the current thread.
 inline int GetCurrentThreadId() {
-  static int next_thread_id = 0;
+  static std::atomic<int> next_thread_id(0);
   static thread_local int thread_id = next_thread_id++;
   return thread_id;
 }
 
+// Returns a unique identifier for a new GraphTracer.
+int64 NewTracerId() {
+  static std::atomic<int64> next_tracer_id(0);
+  return next_tracer_id++;
+}
+
+// The event ring last used by the current thread, and its GraphTracer.
+struct ThreadRingCache {
+  int64 tracer_id = -1;
+  void* ring = nullptr;
+};
+thread_local ThreadRingCache thread_ring_cache;
+
+// Merges the event sequences of the threads, indexed by ring, into one
+// sequence ordered by event_time, ring and sequence number.
+std::vector<TraceEvent> MergeByTime(
+    const std::vector<std::vector<SequencedEvent>>& sequences) {
+  std::vector<std::pair<int, const SequencedEvent*>> merged;
+  for (int i = 0; i < sequences.size(); ++i) {
+    for (const SequencedEvent& event : sequences[i]) {
+      merged.emplace_back(i, &event);
+    }
+  }
+  std::sort(merged.begin(), merged.end(),
+            [](const std::pair<int, const SequencedEvent*>& a,
+               const std::pair<int, const SequencedEvent*>& b) {
+              return std::make_tuple(a.second->event.event_time, a.first,
+                                     a.second->sequence) <
+                     std::make_tuple(b.second->event.event_time, b.first,
+                                     b.second->sequence);
+            });
+  std::vector<TraceEvent> result;
+  result.reserve(merged.size());
+  for (const auto& entry : merged) {
+    result.push_back(entry.second->event);
+  }
+  return result;
+}
+
 }  // namespace
 
 absl::Duration GraphTracer::GetTraceLogInterval() {
@@ -52,7 +97,7 @@ int64 GraphTracer::GetTraceLogCapacity() {
 }
 
 GraphTracer::GraphTracer(const ProfilerConfig& profiler_config)
-    : profiler_config_(profiler_config), trace_buffer_(GetTraceLogCapacity()) {
+    : profiler_config_(profiler_config), tracer_id_(NewTracerId()) {
   for (int disabled : profiler_config_.trace_event_types_disabled()) {
     EventType event_type = static_cast<EventType>(disabled);
     (*trace_event_registry())[event_type].set_enabled(false);
@@ -68,7 +113,39 @@ void GraphTracer::LogEvent(TraceEvent event) {
     return;
   }
   event.set_thread_id(GetCurrentThreadId());
-  trace_buffer_.push_back(event);
+  // Only this thread appends to its ring, so the ring size numbers its
+  // events without a counter shared between threads.
+  EventRing* ring = GetThreadRing();
+  ring->push_back({ring->size(), event});
+}
+
+GraphTracer::EventRing* GraphTracer::GetThreadRing() {
+  ThreadRingCache& cache = thread_ring_cache;
+  if (cache.tracer_id == tracer_id_) {
+    return static_cast<EventRing*>(cache.ring);
+  }
+  absl::MutexLock lock(&rings_mutex_);
+  auto inserted =
+      ring_indexes_.emplace(std::this_thread::get_id(), rings_.size());
+  if (inserted.second) {
+    rings_.push_back(absl::make_unique<EventRing>(GetTraceLogCapacity()));
+  }
+  EventRing* ring = rings_[inserted.first->second].get();
+  cache.tracer_id = tracer_id_;
+  cache.ring = ring;
+  return ring;
+}
+
+std::vector<TraceEvent> GraphTracer::GetEvents() {
+  std::vector<std::vector<SequencedEvent>> sequences;
+  {
+    absl::MutexLock lock(&rings_mutex_);
+    sequences.resize(rings_.size());
+    for (int i = 0; i < rings_.size(); ++i) {
+      rings_[i]->Snapshot(&sequences[i]);
+    }
+  }
+  return MergeByTime(sequences);
 }
 
 void GraphTracer::LogInputEvents(GraphTrace::EventType event_type,
@@ -114,23 +191,21 @@ void GraphTracer::LogOutputEvents(GraphTrace::EventType event_type,
 }
 
 Timestamp GraphTracer::TimestampAfter(absl::Time begin_time) {
-  return TraceBuilder::TimestampAfter(trace_buffer_, begin_time);
+  return TraceBuilder::TimestampAfter(GetEvents(), begin_time);
 }
 
 void GraphTracer::GetTrace(absl::Time begin_time, absl::Time end_time,
                            GraphTrace* result) {
-  trace_builder_.CreateTrace(trace_buffer_, begin_time, end_time, result);
+  trace_builder_.CreateTrace(GetEvents(), begin_time, end_time, result);
   trace_builder_.Clear();
 }
 
 void GraphTracer::GetLog(absl::Time begin_time, absl::Time end_time,
                          GraphTrace* result) {
-  trace_builder_.CreateLog(trace_buffer_, begin_time, end_time, result);
+  trace_builder_.CreateLog(GetEvents(), begin_time, end_time, result);
   trace_builder_.Clear();
 }
 
-const TraceBuffer& GraphTracer::GetTraceBuffer() { return trace_buffer_; }
-
 Timestamp GraphTracer::GetOutputTimestamp(const CalculatorContext* context) {
   for (const OutputStreamShard& out_stream : context->Outputs()) {
     for (const Packet& packet : *out_stream.OutputQueue()) {
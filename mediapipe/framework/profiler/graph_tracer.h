@@ -15,21 +15,37 @@
 #ifndef MEDIAPIPE_FRAMEWORK_PROFILER_GRAPH_TRACER_H_
 #define MEDIAPIPE_FRAMEWORK_PROFILER_GRAPH_TRACER_H_
 
+#include <memory>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <unordered_map>
+#include <vector>
 
+#include "absl/synchronization/mutex.h"
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/calculator_context.h"
 #include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/profiler/thread_ring_buffer.h"
 #include "mediapipe/framework/profiler/trace_buffer.h"
 #include "mediapipe/framework/profiler/trace_builder.h"
 
 namespace mediapipe {
 
+// A TraceEvent and its position in the logging order of its thread.
+struct SequencedEvent {
+  uint64 sequence;
+  TraceEvent event;
+};
+
 // GraphTracer records events when packets enter and exit the nodes of
 // a calculator graph.
 //
 // GraphTracer is thread-safe, and the Log* methods are also non-blocking
 // so they can be called during graph execution with mimimal overhead.
+// Each thread logs into its own fixed-size ring of recent events and numbers
+// them itself, so logging threads share no memory. The rings are merged by
+// event time when a trace is requested.
 //
 // The method GetTrace returns the events for a range of recent Timestamps.
 // The begin_ts should be the first timestamp completely enclosed in the
@@ -49,7 +65,7 @@ class GraphTracer {
   // Returns the interval between trace log output.
   absl::Duration GetTraceLogInterval();
 
-  // Returns the maximum number of trace events buffered in memory.
+  // Returns the maximum number of trace events buffered in memory per thread.
   int64 GetTraceLogCapacity();
 
   // Create a tracer to record up to |capacity| recent events.
@@ -58,14 +74,14 @@ class GraphTracer {
   // Returns the registry of trace event types.
   TraceEventRegistry* trace_event_registry();
 
-  // Append a TraceEvent to the TraceBuffer.
+  // Append a TraceEvent to the event ring of the calling thread.
   void LogEvent(TraceEvent event);
 
-  // Append TraceEvents to the TraceBuffer for task input.
+  // Append TraceEvents to the event ring for task input.
   void LogInputEvents(GraphTrace::EventType event_type,
                       const CalculatorContext* context, absl::Time event_time);
 
-  // Append TraceEvents to the TraceBuffer for task output.
+  // Append TraceEvents to the event ring for task output.
   void LogOutputEvents(GraphTrace::EventType event_type,
                        const CalculatorContext* context, absl::Time event_time);
 
@@ -78,18 +94,32 @@ class GraphTracer {
   // Returns trace events between begin_time and end_time exclusive.
   void GetLog(absl::Time begin_time, absl::Time end_time, GraphTrace* result);
 
-  // Returns the logged TraceEvents.
-  const TraceBuffer& GetTraceBuffer();
+  // Returns the buffered TraceEvents of all threads, ordered by event_time.
+  // Events with equal event_time are ordered by thread and then in the
+  // order in which they were logged.
+  std::vector<TraceEvent> GetEvents();
 
  private:
+  using EventRing = ThreadRingBuffer<SequencedEvent>;
+
   // Returns the timestamp of the first output packet.
   Timestamp GetOutputTimestamp(const CalculatorContext* context);
 
+  // Returns the event ring of the calling thread, creating it on first use.
+  EventRing* GetThreadRing();
+
   // The settings for this tracer.
   ProfilerConfig profiler_config_;
 
-  // The circular buffer of TraceEvents.
-  TraceBuffer trace_buffer_;
+  // Identifies this tracer in the per-thread cache of GetThreadRing.
+  const int64 tracer_id_;
+
+  // The event rings of the threads that have logged events, in the order of
+  // their first events, and the index of the ring of each thread.
+  absl::Mutex rings_mutex_;
+  std::vector<std::unique_ptr<EventRing>> rings_ ABSL_GUARDED_BY(rings_mutex_);
+  std::unordered_map<std::thread::id, int> ring_indexes_
+      ABSL_GUARDED_BY(rings_mutex_);
 
   // The builder for the GraphTrace protobuf.
   TraceBuilder trace_builder_;
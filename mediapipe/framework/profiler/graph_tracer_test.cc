@@ -18,6 +18,8 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <set>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 
@@ -28,6 +30,7 @@
 #include "mediapipe/framework/deps/clock.h"
 #include "mediapipe/framework/deps/message_matchers.h"
 #include "mediapipe/framework/port/advanced_proto_inc.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/file_helpers.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
@@ -37,6 +40,7 @@
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/status_matchers.h"
 #include "mediapipe/framework/profiler/graph_profiler.h"
+#include "mediapipe/framework/profiler/latency_histogram.h"
 #include "mediapipe/framework/profiler/test_context_builder.h"
 #include "mediapipe/framework/tool/simulation_clock.h"
 #include "mediapipe/framework/tool/simulation_clock_executor.h"
@@ -328,6 +332,70 @@ TEST_F(GraphTracerTest, GraphTrace) {
   EXPECT_EQ(4, trace.calculator_trace().size());
 }
 
+TEST_F(GraphTracerTest, MergesThreadEvents) {
+  SetUpGraphTracer();
+  constexpr int kNumThreads = 4;
+  constexpr int kNumEvents = 100;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([this, t] {
+      for (int i = 0; i < kNumEvents; ++i) {
+        tracer_->LogEvent(TraceEvent(GraphTrace::PROCESS)
+                              .set_event_time(start_time_ +
+                                              absl::Microseconds(
+                                                  i * kNumThreads + t))
+                              .set_node_id(t));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  // The events of all threads are merged by event_time, and the events of
+  // each thread stay in order.
+  std::vector<TraceEvent> events = tracer_->GetEvents();
+  ASSERT_EQ(kNumThreads * kNumEvents, events.size());
+  std::vector<int> event_counts(kNumThreads, 0);
+  std::set<int> thread_ids;
+  for (int i = 0; i < events.size(); ++i) {
+    const TraceEvent& event = events[i];
+    EXPECT_EQ(start_time_ + absl::Microseconds(i), event.event_time);
+    int t = event.node_id;
+    ASSERT_TRUE(t >= 0 && t < kNumThreads);
+    EXPECT_EQ(start_time_ + absl::Microseconds(event_counts[t] * kNumThreads +
+                                               t),
+              event.event_time);
+    ++event_counts[t];
+    thread_ids.insert(event.thread_id);
+  }
+  EXPECT_EQ(kNumThreads, thread_ids.size());
+}
+
+TEST_F(GraphTracerTest, OrdersEqualEventTimesByThread) {
+  SetUpGraphTracer();
+  constexpr int kNumThreads = 2;
+  constexpr int kNumEvents = 10;
+  for (int t = 0; t < kNumThreads; ++t) {
+    std::thread thread([this, t] {
+      for (int i = 0; i < kNumEvents; ++i) {
+        tracer_->LogEvent(TraceEvent(GraphTrace::PROCESS)
+                              .set_event_time(start_time_)
+                              .set_node_id(t * kNumEvents + i));
+      }
+    });
+    thread.join();
+  }
+
+  // Events with the same event_time are ordered by the thread that logged
+  // first, and then in logging order.
+  std::vector<TraceEvent> events = tracer_->GetEvents();
+  ASSERT_EQ(kNumThreads * kNumEvents, events.size());
+  for (int i = 0; i < events.size(); ++i) {
+    EXPECT_EQ(i, events[i].node_id);
+  }
+}
+
 // Tests showing GraphTracer logging packet latencies.
 class GraphTracerE2ETest : public ::testing::Test {
  protected:
@@ -614,6 +682,15 @@ void FillHistogram(const std::vector<int64>& values, TimeHistogram* result) {
   }
 }
 
+// Fills a log-linear histogram with values.
+void FillHistogram(const std::vector<int64>& values, LatencyHistogram* result) {
+  LatencyRecorder recorder;
+  for (int64 v : values) {
+    recorder.Record(v);
+  }
+  recorder.Snapshot(result);
+}
+
 // Verify profiler histograms with the PassThrough graph.
 TEST_F(GraphTracerE2ETest, PassThroughGraphProfile) {
   SetUpPassThroughGraph();
@@ -642,6 +719,15 @@ TEST_F(GraphTracerE2ETest, PassThroughGraphProfile) {
                 expected.mutable_process_output_latency());
   FillHistogram({0, 15000, 30000, 45000, 60000, 75000},
                 expected.mutable_input_stream_profiles(0)->mutable_latency());
+  FillHistogram({20001, 20001, 20001, 20001, 20001, 20001},
+                expected.mutable_process_runtime_histogram());
+  FillHistogram({0, 15000, 30000, 45000, 60000, 75000},
+                expected.mutable_process_input_latency_histogram());
+  FillHistogram({20001, 35001, 50001, 65001, 80001, 95001},
+                expected.mutable_process_output_latency_histogram());
+  FillHistogram(
+      {0, 15000, 30000, 45000, 60000, 75000},
+      expected.mutable_input_stream_profiles(0)->mutable_latency_histogram());
 
   EXPECT_THAT(profiles[0], EqualsProto(expected));
   EXPECT_EQ(GraphProfilerTestPeer::GetPacketsInfoMap(graph_.profiler())->size(),
@@ -1228,6 +1314,47 @@ TEST_F(GraphTracerE2ETest, DemuxGraphLogFiles) {
               )")));
 }
 
+TEST_F(GraphTracerE2ETest, DemuxGraphChromeTraceFiles) {
+  std::string log_path = absl::StrCat(getenv("TEST_TMPDIR"), "/chrome_files_");
+  SetUpDemuxInFlightGraph();
+  graph_config_.mutable_profiler_config()->set_trace_log_path(log_path);
+  graph_config_.mutable_profiler_config()->set_trace_log_count(100);
+  graph_config_.mutable_profiler_config()->set_trace_log_interval_count(5);
+  graph_config_.mutable_profiler_config()->set_trace_log_interval_usec(2500);
+  graph_config_.mutable_profiler_config()->set_trace_log_format(
+      ProfilerConfig::CHROME_TRACE_JSON);
+  RunDemuxInFlightGraph();
+
+  // The files hold the same events as the GraphProfile files, as complete
+  // JSON arrays.
+  std::vector<int> event_counts;
+  std::string all_contents;
+  for (int i = 0; i < 7; ++i) {
+    std::string contents;
+    if (!file::GetContents(absl::StrCat(log_path, i, ".json"), &contents)
+             .ok()) {
+      continue;
+    }
+    EXPECT_EQ("[\n", contents.substr(0, 2));
+    EXPECT_EQ("\n]\n", contents.substr(contents.size() - 3));
+    int count = 0;
+    for (size_t pos = contents.find(",\n{"); pos != std::string::npos;
+         pos = contents.find(",\n{", pos + 1)) {
+      ++count;
+    }
+    event_counts.push_back(count);
+    all_contents += contents;
+  }
+  std::vector<int> expected = {49, 64, 11};
+  EXPECT_EQ(event_counts, expected);
+  EXPECT_NE(std::string::npos,
+            all_contents.find("{\"name\":\"RoundRobinDemuxCalculator\","
+                              "\"cat\":\"PROCESS\",\"ph\":\"X\""));
+  GraphProfile profile;
+  EXPECT_FALSE(
+      ReadGraphProfile(absl::StrCat(log_path, 0, ".binarypb"), &profile).ok());
+}
+
 TEST_F(GraphTracerE2ETest, DisableLoggingToDisk) {
   std::string log_path =
       absl::StrCat(getenv("TEST_TMPDIR"), "/log_file_disabled_");
@@ -1416,5 +1543,49 @@ TEST_F(GraphTracerE2ETest, DestructGraph) {
   }
 }
 
+// Measures the cost of logging one trace event. With several threads, each
+// thread logs into its own ring.
+void BM_GraphTracerLogEvent(benchmark::State& state) {
+  static GraphTracer* tracer = [] {
+    ProfilerConfig profiler_config;
+    profiler_config.set_trace_enabled(true);
+    return new GraphTracer(profiler_config);
+  }();
+  static const std::string* stream_name = new std::string("stream");
+  const absl::Time event_time = absl::Now();
+  int64 ts = 0;
+  for (auto _ : state) {
+    tracer->LogEvent(TraceEvent(GraphTrace::PROCESS)
+                         .set_event_time(event_time)
+                         .set_input_ts(Timestamp(ts))
+                         .set_node_id(1)
+                         .set_stream_id(stream_name)
+                         .set_packet_ts(Timestamp(ts)));
+    ++ts;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GraphTracerLogEvent)->ThreadRange(1, 8);
+
+// Measures the cost of appending one trace event to a TraceBuffer shared by
+// all threads, for comparison.
+void BM_TraceBufferPushBack(benchmark::State& state) {
+  static TraceBuffer* buffer = new TraceBuffer(20000);
+  static const std::string* stream_name = new std::string("stream");
+  const absl::Time event_time = absl::Now();
+  int64 ts = 0;
+  for (auto _ : state) {
+    buffer->push_back(TraceEvent(GraphTrace::PROCESS)
+                          .set_event_time(event_time)
+                          .set_input_ts(Timestamp(ts))
+                          .set_node_id(1)
+                          .set_stream_id(stream_name)
+                          .set_packet_ts(Timestamp(ts)));
+    ++ts;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TraceBufferPushBack)->ThreadRange(1, 8);
+
 }  // namespace
 }  // namespace mediapipe
@@ -0,0 +1,194 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/http_metrics_sink.h"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+#include <cerrno>
+#include <cstring>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/canonical_errors.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/status_macros.h"
+
+namespace mediapipe {
+
+#ifndef _WIN32
+
+namespace {
+
+// How often the server thread checks whether the sink is being destroyed.
+constexpr int kAcceptTimeoutMsec = 100;
+// How long a client may take to send its request.
+constexpr int kRequestTimeoutMsec = 1000;
+// Requests are read up to this size, and the rest is ignored.
+constexpr int kMaxRequestSize = 8192;
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+}  // namespace
+
+// static
+::mediapipe::StatusOr<std::unique_ptr<HttpMetricsSink>>
+HttpMetricsSink::Create(int port) {
+  int listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_socket < 0) {
+    return ::mediapipe::InternalError(
+        absl::StrCat("Could not create a socket: ", strerror(errno)));
+  }
+  int reuse = 1;
+  setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#ifdef SO_NOSIGPIPE
+  setsockopt(listen_socket, SOL_SOCKET, SO_NOSIGPIPE, &reuse, sizeof(reuse));
+#endif
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  socklen_t address_size = sizeof(address);
+  if (bind(listen_socket, reinterpret_cast<sockaddr*>(&address),
+           address_size) != 0 ||
+      listen(listen_socket, /*backlog=*/8) != 0 ||
+      getsockname(listen_socket, reinterpret_cast<sockaddr*>(&address),
+                  &address_size) != 0) {
+    std::string error = strerror(errno);
+    close(listen_socket);
+    return ::mediapipe::UnavailableError(absl::StrCat(
+        "Could not listen for metrics requests on port ", port, ": ", error));
+  }
+  return absl::WrapUnique(
+      new HttpMetricsSink(listen_socket, ntohs(address.sin_port)));
+}
+
+HttpMetricsSink::HttpMetricsSink(int listen_socket, int port)
+    : listen_socket_(listen_socket), port_(port) {
+  server_thread_ = absl::make_unique<ThreadPool>("mediapipe_metrics_http", 1);
+  server_thread_->StartWorkers();
+  server_thread_->Schedule([this] { Serve(); });
+}
+
+HttpMetricsSink::~HttpMetricsSink() {
+  stopping_ = true;
+  server_thread_.reset();
+  close(listen_socket_);
+}
+
+::mediapipe::Status HttpMetricsSink::Write(const GraphMetrics& metrics) {
+  std::string text = FormatPrometheusText(metrics);
+  absl::MutexLock lock(&mutex_);
+  text_.swap(text);
+  return ::mediapipe::OkStatus();
+}
+
+void HttpMetricsSink::Serve() {
+  while (!stopping_) {
+    pollfd listen_poll = {listen_socket_, POLLIN, 0};
+    if (poll(&listen_poll, 1, kAcceptTimeoutMsec) <= 0) {
+      continue;
+    }
+    int connection = accept(listen_socket_, nullptr, nullptr);
+    if (connection < 0) {
+      continue;
+    }
+    Respond(connection);
+    close(connection);
+  }
+}
+
+void HttpMetricsSink::Respond(int connection) {
+  // Read the request headers, which end with an empty line.
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == std::string::npos &&
+         request.size() < kMaxRequestSize) {
+    pollfd request_poll = {connection, POLLIN, 0};
+    if (poll(&request_poll, 1, kRequestTimeoutMsec) <= 0) {
+      return;
+    }
+    ssize_t size = recv(connection, buffer, sizeof(buffer), 0);
+    if (size <= 0) {
+      return;
+    }
+    request.append(buffer, size);
+  }
+
+  std::string response;
+  {
+    absl::MutexLock lock(&mutex_);
+    response = absl::StrCat(
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: ",
+        text_.size(), "\r\nConnection: close\r\n\r\n", text_);
+  }
+  const char* data = response.data();
+  size_t remaining = response.size();
+  while (remaining > 0) {
+    ssize_t size = send(connection, data, remaining, kSendFlags);
+    if (size <= 0) {
+      LOG_EVERY_N(WARNING, 100)
+          << "Could not send metrics: " << strerror(errno);
+      return;
+    }
+    data += size;
+    remaining -= size;
+  }
+}
+
+#else  // _WIN32
+
+// static
+::mediapipe::StatusOr<std::unique_ptr<HttpMetricsSink>>
+HttpMetricsSink::Create(int port) {
+  return ::mediapipe::UnimplementedError(
+      "HttpMetricsSink is only available on POSIX platforms.");
+}
+
+HttpMetricsSink::~HttpMetricsSink() {}
+
+::mediapipe::Status HttpMetricsSink::Write(const GraphMetrics& metrics) {
+  return ::mediapipe::UnimplementedError(
+      "HttpMetricsSink is only available on POSIX platforms.");
+}
+
+#endif  // _WIN32
+
+// static
+::mediapipe::StatusOr<std::unique_ptr<MetricsSink>>
+HttpMetricsSink::CreateFromConfig(const ProfilerConfig& config) {
+  if (config.metrics_http_port() <= 0) {
+    return std::unique_ptr<MetricsSink>();
+  }
+  ASSIGN_OR_RETURN(std::unique_ptr<HttpMetricsSink> sink,
+                   Create(config.metrics_http_port()));
+  return std::unique_ptr<MetricsSink>(std::move(sink));
+}
+
+REGISTER_METRICS_SINK(HttpMetricsSink);
+
+}  // namespace mediapipe
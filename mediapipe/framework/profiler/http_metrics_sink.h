@@ -0,0 +1,73 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PROFILER_HTTP_METRICS_SINK_H_
+#define MEDIAPIPE_FRAMEWORK_PROFILER_HTTP_METRICS_SINK_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/framework/profiler/metrics_sink.h"
+
+namespace mediapipe {
+
+// Serves the latest GraphMetrics snapshot in the Prometheus text format over
+// HTTP on the loopback interface, so that a Prometheus server or a browser
+// on the same host can scrape a running graph. This is a minimal stand-in
+// for a metrics service: every request receives the latest snapshot,
+// whatever its path, and connections are served one at a time.
+//
+// Available on POSIX platforms only. Graphs serve their metrics at
+// ProfilerConfig::metrics_http_port only if they link this target.
+class HttpMetricsSink : public MetricsSink {
+ public:
+  // Listens on 127.0.0.1 at "port", or at an unused port if "port" is 0.
+  static ::mediapipe::StatusOr<std::unique_ptr<HttpMetricsSink>> Create(
+      int port);
+  // Returns a sink listening at config.metrics_http_port(), or null if it is
+  // not set.
+  static ::mediapipe::StatusOr<std::unique_ptr<MetricsSink>> CreateFromConfig(
+      const ProfilerConfig& config);
+  ~HttpMetricsSink() override;
+
+  ::mediapipe::Status Write(const GraphMetrics& metrics) override;
+
+  // Returns the port the sink listens on.
+  int port() const { return port_; }
+
+ private:
+  HttpMetricsSink(int listen_socket, int port);
+
+  // Accepts and answers connections until the sink is destroyed.
+  void Serve();
+  // Reads one request from "connection" and sends the latest snapshot.
+  void Respond(int connection);
+
+  const int listen_socket_;
+  const int port_;
+  std::atomic<bool> stopping_{false};
+  absl::Mutex mutex_;
+  std::string text_ ABSL_GUARDED_BY(mutex_);
+  // Runs Serve(). Declared last so that it is joined first.
+  std::unique_ptr<ThreadPool> server_thread_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PROFILER_HTTP_METRICS_SINK_H_
@@ -0,0 +1,165 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace mediapipe {
+
+namespace {
+
+// Durations below 2^kLinearBits usec each have a bucket. Larger durations
+// keep their kLinearBits - 1 most significant bits after the leading one.
+constexpr int kLinearBits = 5;
+constexpr int kSubBuckets = 1 << (kLinearBits - 1);
+constexpr int64 kMaxDuration = (int64{1} << 36) - 1;
+
+// Returns the index of the most significant set bit of a positive value.
+inline int HighestBit(uint64 value) {
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - __builtin_clzll(value);
+#else
+  int bit = 0;
+  while (value >>= 1) ++bit;
+  return bit;
+#endif
+}
+
+}  // namespace
+
+constexpr int LatencyRecorder::kNumBuckets;
+
+LatencyRecorder::LatencyRecorder() { Reset(); }
+
+int LatencyRecorder::BucketIndex(int64 duration_usec) {
+  if (duration_usec < (1 << kLinearBits)) {
+    return std::max<int64>(duration_usec, 0);
+  }
+  duration_usec = std::min(duration_usec, kMaxDuration);
+  int shift = HighestBit(duration_usec) - (kLinearBits - 1);
+  return shift * kSubBuckets + static_cast<int>(duration_usec >> shift);
+}
+
+int64 LatencyRecorder::BucketLowerBound(int bucket) {
+  if (bucket < (1 << kLinearBits)) {
+    return bucket;
+  }
+  int shift = bucket / kSubBuckets - 1;
+  return static_cast<int64>(bucket % kSubBuckets + kSubBuckets) << shift;
+}
+
+int64 LatencyRecorder::BucketUpperBound(int bucket) {
+  return BucketLowerBound(bucket + 1) - 1;
+}
+
+void LatencyRecorder::Record(int64 duration_usec) {
+  duration_usec = std::max<int64>(duration_usec, 0);
+  counts_[BucketIndex(duration_usec)].fetch_add(1, std::memory_order_relaxed);
+  total_.fetch_add(duration_usec, std::memory_order_relaxed);
+  int64 max = max_.load(std::memory_order_relaxed);
+  while (duration_usec > max &&
+         !max_.compare_exchange_weak(max, duration_usec,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+int64 LatencyRecorder::sample_count() const {
+  int64 result = 0;
+  for (const auto& count : counts_) {
+    result += count.load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+void LatencyRecorder::Snapshot(LatencyHistogram* histogram) const {
+  histogram->Clear();
+  int64 sample_count = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    int64 count = counts_[i].load(std::memory_order_relaxed);
+    if (count > 0) {
+      histogram->add_bucket(i);
+      histogram->add_count(count);
+      sample_count += count;
+    }
+  }
+  histogram->set_sample_count(sample_count);
+  histogram->set_total(total_.load(std::memory_order_relaxed));
+  histogram->set_max_usec(max_.load(std::memory_order_relaxed));
+}
+
+void LatencyRecorder::Reset() {
+  for (auto& count : counts_) {
+    count.store(0, std::memory_order_relaxed);
+  }
+  total_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+void MergeLatencyHistogram(const LatencyHistogram& histogram,
+                           LatencyHistogram* result) {
+  std::map<int, int64> counts;
+  for (int i = 0; i < result->bucket_size() && i < result->count_size(); ++i) {
+    counts[result->bucket(i)] += result->count(i);
+  }
+  for (int i = 0; i < histogram.bucket_size() && i < histogram.count_size();
+       ++i) {
+    counts[histogram.bucket(i)] += histogram.count(i);
+  }
+  result->clear_bucket();
+  result->clear_count();
+  for (const auto& entry : counts) {
+    result->add_bucket(entry.first);
+    result->add_count(entry.second);
+  }
+  result->set_sample_count(result->sample_count() + histogram.sample_count());
+  result->set_total(result->total() + histogram.total());
+  result->set_max_usec(std::max(result->max_usec(), histogram.max_usec()));
+}
+
+int64 LatencyPercentile(const LatencyHistogram& histogram, double quantile) {
+  int64 sample_count = 0;
+  for (int64 count : histogram.count()) {
+    sample_count += count;
+  }
+  if (sample_count == 0) {
+    return 0;
+  }
+  int64 rank = static_cast<int64>(std::ceil(quantile * sample_count));
+  rank = std::min(std::max<int64>(rank, 1), sample_count);
+  int64 seen = 0;
+  for (int i = 0; i < histogram.bucket_size() && i < histogram.count_size();
+       ++i) {
+    seen += histogram.count(i);
+    if (seen >= rank) {
+      int64 result = LatencyRecorder::BucketUpperBound(histogram.bucket(i));
+      return histogram.has_max_usec() ? std::min(result, histogram.max_usec())
+                                      : result;
+    }
+  }
+  return histogram.max_usec();
+}
+
+LatencyPercentiles GetLatencyPercentiles(const LatencyHistogram& histogram) {
+  LatencyPercentiles result;
+  result.p50 = LatencyPercentile(histogram, 0.5);
+  result.p90 = LatencyPercentile(histogram, 0.9);
+  result.p99 = LatencyPercentile(histogram, 0.99);
+  result.p999 = LatencyPercentile(histogram, 0.999);
+  return result;
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,89 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PROFILER_LATENCY_HISTOGRAM_H_
+#define MEDIAPIPE_FRAMEWORK_PROFILER_LATENCY_HISTOGRAM_H_
+
+#include <atomic>
+
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+// Records durations into a log-linear LatencyHistogram. Durations below 32
+// usec each have a bucket. Above that, each power of two is divided into 16
+// buckets, so that a bucket spans at most 1/16 of its lower bound. Durations
+// of 2^36 usec (about 19 hours) and more share the last bucket.
+//
+// Record() is thread-safe, lock-free and takes constant time, so that it can
+// be called from any thread running a calculator.
+class LatencyRecorder {
+ public:
+  static constexpr int kNumBuckets = 528;
+
+  LatencyRecorder();
+  LatencyRecorder(const LatencyRecorder&) = delete;
+  LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+  // Records one duration. Negative durations are recorded as 0.
+  void Record(int64 duration_usec);
+
+  // Returns the number of durations recorded.
+  int64 sample_count() const;
+
+  // Replaces "histogram" with the recorded durations. Durations recorded
+  // concurrently may be partly included.
+  void Snapshot(LatencyHistogram* histogram) const;
+
+  // Discards the recorded durations.
+  void Reset();
+
+  // Returns the bucket of a duration.
+  static int BucketIndex(int64 duration_usec);
+  // Returns the smallest and the largest duration in a bucket.
+  static int64 BucketLowerBound(int bucket);
+  static int64 BucketUpperBound(int bucket);
+
+ private:
+  std::atomic<int64> counts_[kNumBuckets];
+  std::atomic<int64> total_;
+  std::atomic<int64> max_;
+};
+
+// Adds the durations of "histogram" to "result".
+void MergeLatencyHistogram(const LatencyHistogram& histogram,
+                           LatencyHistogram* result);
+
+// Returns the duration below or at which the fraction "quantile" of the
+// durations lie, such as 0.99 for the 99th percentile. The result is the
+// largest duration of its bucket, and no more than the largest duration
+// recorded. Returns 0 for an empty histogram.
+int64 LatencyPercentile(const LatencyHistogram& histogram, double quantile);
+
+// Commonly reported percentiles of a LatencyHistogram, in microseconds.
+struct LatencyPercentiles {
+  int64 p50 = 0;
+  int64 p90 = 0;
+  int64 p99 = 0;
+  int64 p999 = 0;
+};
+
+// Returns the p50, p90, p99 and p99.9 durations of "histogram", such as the
+// process_runtime_histogram of a CalculatorProfile.
+LatencyPercentiles GetLatencyPercentiles(const LatencyHistogram& histogram);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PROFILER_LATENCY_HISTOGRAM_H_
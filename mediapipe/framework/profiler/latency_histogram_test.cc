@@ -0,0 +1,154 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/latency_histogram.h"
+
+#include <algorithm>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(LatencyHistogramTest, BucketsCoverAllDurations) {
+  EXPECT_EQ(0, LatencyRecorder::BucketLowerBound(0));
+  for (int i = 0; i + 1 < LatencyRecorder::kNumBuckets; ++i) {
+    int64 lower = LatencyRecorder::BucketLowerBound(i);
+    int64 upper = LatencyRecorder::BucketUpperBound(i);
+    ASSERT_LE(lower, upper) << "bucket " << i;
+    ASSERT_EQ(i, LatencyRecorder::BucketIndex(lower)) << "bucket " << i;
+    ASSERT_EQ(i, LatencyRecorder::BucketIndex(upper)) << "bucket " << i;
+    ASSERT_EQ(upper + 1, LatencyRecorder::BucketLowerBound(i + 1));
+    // Each bucket spans at most 1/16 of its lower bound.
+    ASSERT_LE((upper - lower) * 16, std::max<int64>(lower, 1))
+        << "bucket " << i;
+  }
+  EXPECT_EQ(LatencyRecorder::kNumBuckets - 1,
+            LatencyRecorder::BucketIndex(int64{1} << 50));
+  EXPECT_EQ(0, LatencyRecorder::BucketIndex(-5));
+}
+
+TEST(LatencyHistogramTest, SnapshotsRecordedDurations) {
+  LatencyRecorder recorder;
+  recorder.Record(3);
+  recorder.Record(150);
+  recorder.Record(150);
+  recorder.Record(-1);
+  EXPECT_EQ(4, recorder.sample_count());
+
+  LatencyHistogram histogram;
+  recorder.Snapshot(&histogram);
+  EXPECT_EQ(303, histogram.total());
+  EXPECT_EQ(4, histogram.sample_count());
+  EXPECT_EQ(150, histogram.max_usec());
+  ASSERT_EQ(3, histogram.bucket_size());
+  EXPECT_EQ(0, histogram.bucket(0));
+  EXPECT_EQ(3, histogram.bucket(1));
+  EXPECT_EQ(LatencyRecorder::BucketIndex(150), histogram.bucket(2));
+  EXPECT_EQ(2, histogram.count(2));
+
+  recorder.Reset();
+  EXPECT_EQ(0, recorder.sample_count());
+  recorder.Snapshot(&histogram);
+  EXPECT_EQ(0, histogram.bucket_size());
+  EXPECT_EQ(0, histogram.max_usec());
+}
+
+TEST(LatencyHistogramTest, ComputesPercentiles) {
+  LatencyRecorder recorder;
+  for (int64 i = 1; i <= 10000; ++i) {
+    recorder.Record(i);
+  }
+  LatencyHistogram histogram;
+  recorder.Snapshot(&histogram);
+  LatencyPercentiles percentiles = GetLatencyPercentiles(histogram);
+  // Each percentile is within the precision of its bucket.
+  EXPECT_GE(percentiles.p50, 5000);
+  EXPECT_LE(percentiles.p50, 5000 + 5000 / 16);
+  EXPECT_GE(percentiles.p90, 9000);
+  EXPECT_LE(percentiles.p90, 9000 + 9000 / 16);
+  EXPECT_GE(percentiles.p99, 9900);
+  EXPECT_LE(percentiles.p99, 10000);
+  EXPECT_GE(percentiles.p999, 9990);
+  EXPECT_LE(percentiles.p999, 10000);
+  EXPECT_EQ(10000, LatencyPercentile(histogram, 1.0));
+  EXPECT_EQ(1, LatencyPercentile(histogram, 0.0));
+
+  EXPECT_EQ(0, LatencyPercentile(LatencyHistogram(), 0.5));
+}
+
+TEST(LatencyHistogramTest, MergesHistograms) {
+  LatencyRecorder recorder_1;
+  LatencyRecorder recorder_2;
+  LatencyRecorder recorder_all;
+  for (int64 i = 0; i < 1000; ++i) {
+    int64 duration = i * i;
+    (i % 3 == 0 ? recorder_1 : recorder_2).Record(duration);
+    recorder_all.Record(duration);
+  }
+  LatencyHistogram merged;
+  LatencyHistogram histogram;
+  recorder_1.Snapshot(&histogram);
+  MergeLatencyHistogram(histogram, &merged);
+  recorder_2.Snapshot(&histogram);
+  MergeLatencyHistogram(histogram, &merged);
+
+  LatencyHistogram expected;
+  recorder_all.Snapshot(&expected);
+  EXPECT_EQ(expected.SerializeAsString(), merged.SerializeAsString());
+}
+
+TEST(LatencyHistogramTest, RecordsFromManyThreads) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumSamples = 10000;
+  LatencyRecorder recorder;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&recorder, t] {
+      for (int i = 0; i < kNumSamples; ++i) {
+        recorder.Record(t * kNumSamples + i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  LatencyHistogram histogram;
+  recorder.Snapshot(&histogram);
+  int64 n = kNumThreads * kNumSamples;
+  EXPECT_EQ(n, histogram.sample_count());
+  EXPECT_EQ(n * (n - 1) / 2, histogram.total());
+  EXPECT_EQ(n - 1, histogram.max_usec());
+}
+
+// Measures the cost of recording one duration. With several threads, all
+// threads record into the same histogram.
+void BM_LatencyRecorderRecord(benchmark::State& state) {
+  static LatencyRecorder* recorder = new LatencyRecorder();
+  int64 duration = state.thread_index;
+  for (auto _ : state) {
+    recorder->Record(duration);
+    duration = (duration * 7 + 13) % 100000;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LatencyRecorderRecord)->ThreadRange(1, 8);
+
+}  // namespace
+}  // namespace mediapipe
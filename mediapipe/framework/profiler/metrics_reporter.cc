@@ -0,0 +1,96 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/metrics_reporter.h"
+
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+
+MetricsReporter::MetricsReporter(
+    absl::Duration interval, CollectFunction collect,
+    std::vector<std::shared_ptr<MetricsSink>> sinks)
+    : interval_(interval),
+      collect_(std::move(collect)),
+      sinks_(std::move(sinks)) {}
+
+MetricsReporter::~MetricsReporter() {
+  if (thread_) {
+    Stop();
+  }
+}
+
+void MetricsReporter::Start() {
+  CHECK(!thread_) << "MetricsReporter has already been started.";
+  {
+    absl::MutexLock lock(&mutex_);
+    stop_requested_ = false;
+  }
+  previous_time_ = absl::Now();
+  previous_busy_usec_.clear();
+  thread_ = absl::make_unique<ThreadPool>("mediapipe_metrics", 1);
+  thread_->StartWorkers();
+  thread_->Schedule([this] { Run(); });
+}
+
+void MetricsReporter::Stop() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stop_requested_ = true;
+  }
+  // Waits for Run() to return.
+  thread_.reset();
+  Report();
+}
+
+void MetricsReporter::Run() {
+  while (true) {
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.AwaitWithTimeout(absl::Condition(&stop_requested_), interval_);
+      if (stop_requested_) {
+        return;
+      }
+    }
+    Report();
+  }
+}
+
+void MetricsReporter::Report() {
+  GraphMetrics metrics;
+  collect_(&metrics);
+  metrics.time = absl::Now();
+  double elapsed_usec =
+      absl::ToDoubleMicroseconds(metrics.time - previous_time_);
+  for (ExecutorMetrics& executor : metrics.executors) {
+    int64& previous_busy_usec = previous_busy_usec_[executor.name];
+    // The runtimes restart from 0 when the profiles are reset.
+    int64 busy_usec = executor.busy_usec >= previous_busy_usec
+                          ? executor.busy_usec - previous_busy_usec
+                          : executor.busy_usec;
+    executor.busy_threads = elapsed_usec > 0 ? busy_usec / elapsed_usec : 0;
+    previous_busy_usec = executor.busy_usec;
+  }
+  previous_time_ = metrics.time;
+  for (const auto& sink : sinks_) {
+    ::mediapipe::Status status = sink->Write(metrics);
+    LOG_IF(WARNING, !status.ok()) << "Could not write metrics: " << status;
+  }
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,77 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PROFILER_METRICS_REPORTER_H_
+#define MEDIAPIPE_FRAMEWORK_PROFILER_METRICS_REPORTER_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/framework/profiler/metrics_sink.h"
+
+namespace mediapipe {
+
+// Periodically collects GraphMetrics snapshots and writes them to
+// MetricsSinks on a background thread, so that a running graph can be
+// monitored without polling it.
+class MetricsReporter {
+ public:
+  // Fills in a snapshot. Called on the background thread.
+  using CollectFunction = std::function<void(GraphMetrics*)>;
+
+  MetricsReporter(absl::Duration interval, CollectFunction collect,
+                  std::vector<std::shared_ptr<MetricsSink>> sinks);
+  MetricsReporter(const MetricsReporter&) = delete;
+  MetricsReporter& operator=(const MetricsReporter&) = delete;
+  // Stops reporting if Stop() has not been called.
+  ~MetricsReporter();
+
+  // Starts the background thread, which reports a snapshot every interval.
+  void Start();
+
+  // Stops the background thread and reports a final snapshot.
+  void Stop();
+
+ private:
+  // Reports snapshots until Stop() is called.
+  void Run();
+
+  // Collects a snapshot, fills in the executor load since the previous
+  // snapshot, and writes it to each sink.
+  void Report();
+
+  const absl::Duration interval_;
+  const CollectFunction collect_;
+  const std::vector<std::shared_ptr<MetricsSink>> sinks_;
+
+  absl::Mutex mutex_;
+  bool stop_requested_ ABSL_GUARDED_BY(mutex_) = false;
+  std::unique_ptr<ThreadPool> thread_;
+
+  // The time and executor runtimes of the previous snapshot. Accessed only
+  // by Report(), which never runs concurrently.
+  absl::Time previous_time_;
+  std::map<std::string, int64> previous_busy_usec_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PROFILER_METRICS_REPORTER_H_
@@ -0,0 +1,150 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/metrics_sink.h"
+
+#include <cstdio>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+
+namespace {
+
+// Returns "text" quoted as a Prometheus label value.
+std::string LabelValue(absl::string_view text) {
+  std::string result = "\"";
+  for (char c : text) {
+    switch (c) {
+      case '\\':
+        result.append("\\\\");
+        break;
+      case '"':
+        result.append("\\\"");
+        break;
+      case '\n':
+        result.append("\\n");
+        break;
+      default:
+        result.push_back(c);
+    }
+  }
+  result.push_back('"');
+  return result;
+}
+
+// Appends the HELP and TYPE lines of a metric.
+void AppendHeader(absl::string_view name, absl::string_view type,
+                  absl::string_view help, std::string* text) {
+  absl::StrAppend(text, "# HELP ", name, " ", help, "\n# TYPE ", name, " ",
+                  type, "\n");
+}
+
+}  // namespace
+
+MetricsSink::~MetricsSink() {}
+
+std::string FormatPrometheusText(const GraphMetrics& metrics) {
+  std::string text;
+  if (!metrics.calculators.empty()) {
+    AppendHeader("mediapipe_calculator_process_runtime_usec", "summary",
+                 "Process() runtime of each calculator.", &text);
+    for (const CalculatorMetrics& calculator : metrics.calculators) {
+      std::string label =
+          absl::StrCat("calculator=", LabelValue(calculator.name));
+      const std::pair<const char*, int64> quantiles[] = {
+          {"0.5", calculator.process_runtime.p50},
+          {"0.9", calculator.process_runtime.p90},
+          {"0.99", calculator.process_runtime.p99},
+          {"0.999", calculator.process_runtime.p999}};
+      for (const auto& quantile : quantiles) {
+        absl::StrAppend(&text, "mediapipe_calculator_process_runtime_usec{",
+                        label, ",quantile=\"", quantile.first, "\"} ",
+                        quantile.second, "\n");
+      }
+      absl::StrAppend(&text, "mediapipe_calculator_process_runtime_usec_sum{",
+                      label, "} ", calculator.process_runtime_total_usec, "\n",
+                      "mediapipe_calculator_process_runtime_usec_count{",
+                      label, "} ", calculator.process_count, "\n");
+    }
+  }
+  if (!metrics.input_streams.empty()) {
+    AppendHeader("mediapipe_input_stream_queue_size", "gauge",
+                 "Packets queued on each calculator input stream.", &text);
+    for (const InputStreamMetrics& stream : metrics.input_streams) {
+      absl::StrAppend(&text, "mediapipe_input_stream_queue_size{stream=",
+                      LabelValue(stream.name),
+                      ",calculator=", LabelValue(stream.calculator), "} ",
+                      stream.queue_size, "\n");
+    }
+    AppendHeader("mediapipe_input_stream_max_queue_size", "gauge",
+                 "Queue size at which an input stream throttles its sources, "
+                 "or -1 if unlimited.",
+                 &text);
+    for (const InputStreamMetrics& stream : metrics.input_streams) {
+      absl::StrAppend(&text, "mediapipe_input_stream_max_queue_size{stream=",
+                      LabelValue(stream.name),
+                      ",calculator=", LabelValue(stream.calculator), "} ",
+                      stream.max_queue_size, "\n");
+    }
+  }
+  AppendHeader("mediapipe_graph_throttled_nodes", "gauge",
+               "Source nodes and graph input streams throttled by full input "
+               "streams.",
+               &text);
+  absl::StrAppend(&text, "mediapipe_graph_throttled_nodes ",
+                  metrics.throttled_nodes, "\n");
+  AppendHeader("mediapipe_graph_throttle_events_total", "counter",
+               "Times a source node or graph input stream became throttled.",
+               &text);
+  absl::StrAppend(&text, "mediapipe_graph_throttle_events_total ",
+                  metrics.throttle_events, "\n");
+  if (!metrics.executors.empty()) {
+    AppendHeader("mediapipe_executor_busy_usec_total", "counter",
+                 "Calculator runtime on each executor.", &text);
+    for (const ExecutorMetrics& executor : metrics.executors) {
+      absl::StrAppend(&text, "mediapipe_executor_busy_usec_total{executor=",
+                      LabelValue(executor.name), "} ", executor.busy_usec,
+                      "\n");
+    }
+    AppendHeader("mediapipe_executor_busy_threads", "gauge",
+                 "Average number of threads running calculators on each "
+                 "executor.",
+                 &text);
+    for (const ExecutorMetrics& executor : metrics.executors) {
+      absl::StrAppend(&text, "mediapipe_executor_busy_threads{executor=",
+                      LabelValue(executor.name), "} ", executor.busy_threads,
+                      "\n");
+    }
+  }
+  return text;
+}
+
+PrometheusFileSink::PrometheusFileSink(std::string path)
+    : path_(std::move(path)) {}
+
+::mediapipe::Status PrometheusFileSink::Write(const GraphMetrics& metrics) {
+  std::string temp_path = absl::StrCat(path_, ".tmp");
+  MP_RETURN_IF_ERROR(
+      file::SetContents(temp_path, FormatPrometheusText(metrics)));
+  RET_CHECK_EQ(0, std::rename(temp_path.c_str(), path_.c_str()))
+      << "Could not write metrics file: " << path_;
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace mediapipe
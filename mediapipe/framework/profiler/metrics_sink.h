@@ -0,0 +1,114 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PROFILER_METRICS_SINK_H_
+#define MEDIAPIPE_FRAMEWORK_PROFILER_METRICS_SINK_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/deps/registration.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/framework/profiler/latency_histogram.h"
+
+namespace mediapipe {
+
+// The Process() calls of one calculator since the profiles were last reset.
+// Reported only if the profiler is enabled.
+struct CalculatorMetrics {
+  std::string name;
+  int64 process_count = 0;
+  int64 process_runtime_total_usec = 0;
+  LatencyPercentiles process_runtime;
+};
+
+// The packets queued on one input stream of a calculator.
+struct InputStreamMetrics {
+  std::string name;
+  std::string calculator;
+  int queue_size = 0;
+  // -1 if the queue size is unlimited.
+  int max_queue_size = -1;
+};
+
+// The calculator runtime on one executor. Reported only if the profiler is
+// enabled.
+struct ExecutorMetrics {
+  // The default executor is named "default".
+  std::string name;
+  // The total Process() runtime of the calculators run by the executor.
+  int64 busy_usec = 0;
+  // The average number of threads running calculators since the previous
+  // snapshot.
+  double busy_threads = 0;
+};
+
+// A snapshot of the state of a running graph.
+struct GraphMetrics {
+  absl::Time time;
+  std::vector<CalculatorMetrics> calculators;
+  std::vector<InputStreamMetrics> input_streams;
+  // The number of source nodes and graph input streams currently throttled
+  // by full input streams.
+  int throttled_nodes = 0;
+  // The number of times a source node or graph input stream has become
+  // throttled.
+  int64 throttle_events = 0;
+  std::vector<ExecutorMetrics> executors;
+};
+
+// Receives periodic GraphMetrics snapshots of a running graph. Write() is
+// called from a single background thread.
+class MetricsSink {
+ public:
+  virtual ~MetricsSink();
+  virtual ::mediapipe::Status Write(const GraphMetrics& metrics) = 0;
+};
+
+// Creates the sinks that are configured in the ProfilerConfig but are built
+// in targets of their own, so that only graphs that use them link them. A
+// factory returns null if its sink is not configured.
+using MetricsSinkRegistry =
+    GlobalFactoryRegistry<::mediapipe::StatusOr<std::unique_ptr<MetricsSink>>,
+                          const ProfilerConfig&>;
+
+// Macro for registering a sink with a static CreateFromConfig() function.
+#define REGISTER_METRICS_SINK(name)                                      \
+  REGISTER_FACTORY_FUNCTION_QUALIFIED(::mediapipe::MetricsSinkRegistry, \
+                                      metrics_sink_registration, name,   \
+                                      name::CreateFromConfig)
+
+// Returns "metrics" in the Prometheus text exposition format.
+std::string FormatPrometheusText(const GraphMetrics& metrics);
+
+// Writes each snapshot in the Prometheus text format to a file, such as a
+// file read by the node_exporter textfile collector. The file is replaced
+// atomically, so that readers never see a partial snapshot.
+class PrometheusFileSink : public MetricsSink {
+ public:
+  explicit PrometheusFileSink(std::string path);
+  ::mediapipe::Status Write(const GraphMetrics& metrics) override;
+
+ private:
+  const std::string path_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PROFILER_METRICS_SINK_H_
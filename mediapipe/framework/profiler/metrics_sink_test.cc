@@ -0,0 +1,244 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/metrics_sink.h"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/profiler/http_metrics_sink.h"
+#include "mediapipe/framework/profiler/metrics_reporter.h"
+
+namespace mediapipe {
+namespace {
+
+GraphMetrics SampleMetrics() {
+  GraphMetrics metrics;
+  CalculatorMetrics calculator;
+  calculator.name = "detector";
+  calculator.process_count = 10;
+  calculator.process_runtime_total_usec = 52000;
+  calculator.process_runtime.p50 = 5000;
+  calculator.process_runtime.p90 = 6000;
+  calculator.process_runtime.p99 = 8000;
+  calculator.process_runtime.p999 = 8000;
+  metrics.calculators.push_back(calculator);
+  InputStreamMetrics stream;
+  stream.name = "frames";
+  stream.calculator = "detector";
+  stream.queue_size = 3;
+  stream.max_queue_size = 4;
+  metrics.input_streams.push_back(stream);
+  metrics.throttled_nodes = 1;
+  metrics.throttle_events = 7;
+  ExecutorMetrics executor;
+  executor.name = "default";
+  executor.busy_usec = 52000;
+  executor.busy_threads = 0.5;
+  metrics.executors.push_back(executor);
+  return metrics;
+}
+
+// Keeps every snapshot written to it.
+class RecordingSink : public MetricsSink {
+ public:
+  ::mediapipe::Status Write(const GraphMetrics& metrics) override {
+    absl::MutexLock lock(&mutex_);
+    snapshots_.push_back(metrics);
+    return ::mediapipe::OkStatus();
+  }
+
+  std::vector<GraphMetrics> snapshots() {
+    absl::MutexLock lock(&mutex_);
+    return snapshots_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<GraphMetrics> snapshots_ ABSL_GUARDED_BY(mutex_);
+};
+
+TEST(MetricsSinkTest, FormatsPrometheusText) {
+  std::string text = FormatPrometheusText(SampleMetrics());
+  EXPECT_TRUE(absl::StrContains(
+      text, "# TYPE mediapipe_calculator_process_runtime_usec summary\n"));
+  EXPECT_TRUE(absl::StrContains(
+      text,
+      "mediapipe_calculator_process_runtime_usec{calculator=\"detector\","
+      "quantile=\"0.99\"} 8000\n"));
+  EXPECT_TRUE(absl::StrContains(
+      text,
+      "mediapipe_calculator_process_runtime_usec_count{calculator="
+      "\"detector\"} 10\n"));
+  EXPECT_TRUE(absl::StrContains(
+      text,
+      "mediapipe_input_stream_queue_size{stream=\"frames\","
+      "calculator=\"detector\"} 3\n"));
+  EXPECT_TRUE(
+      absl::StrContains(text, "mediapipe_graph_throttled_nodes 1\n"));
+  EXPECT_TRUE(
+      absl::StrContains(text, "mediapipe_graph_throttle_events_total 7\n"));
+  EXPECT_TRUE(absl::StrContains(
+      text, "mediapipe_executor_busy_threads{executor=\"default\"} 0.5\n"));
+}
+
+TEST(MetricsSinkTest, EscapesLabelValues) {
+  GraphMetrics metrics;
+  CalculatorMetrics calculator;
+  calculator.name = "a\"b\\c";
+  metrics.calculators.push_back(calculator);
+  EXPECT_TRUE(absl::StrContains(FormatPrometheusText(metrics),
+                                "{calculator=\"a\\\"b\\\\c\","));
+}
+
+TEST(MetricsSinkTest, PrometheusFileSinkReplacesFile) {
+  std::string path = absl::StrCat(getenv("TEST_TMPDIR"), "/metrics.prom");
+  PrometheusFileSink sink(path);
+  GraphMetrics metrics = SampleMetrics();
+  MP_ASSERT_OK(sink.Write(metrics));
+  metrics.throttle_events = 8;
+  MP_ASSERT_OK(sink.Write(metrics));
+  std::string contents;
+  MP_ASSERT_OK(file::GetContents(path, &contents));
+  EXPECT_EQ(FormatPrometheusText(metrics), contents);
+}
+
+#ifndef _WIN32
+TEST(MetricsSinkTest, HttpMetricsSinkServesLatestSnapshot) {
+  auto status_or_sink = HttpMetricsSink::Create(/*port=*/0);
+  MP_ASSERT_OK(status_or_sink.status());
+  std::unique_ptr<HttpMetricsSink> sink =
+      std::move(status_or_sink).ValueOrDie();
+  MP_ASSERT_OK(sink->Write(SampleMetrics()));
+
+  int client = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(client, 0);
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(sink->port());
+  ASSERT_EQ(0, connect(client, reinterpret_cast<sockaddr*>(&address),
+                       sizeof(address)));
+  const char request[] = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  ASSERT_EQ(sizeof(request) - 1, send(client, request, sizeof(request) - 1, 0));
+  std::string response;
+  char buffer[1024];
+  ssize_t size;
+  while ((size = recv(client, buffer, sizeof(buffer), 0)) > 0) {
+    response.append(buffer, size);
+  }
+  close(client);
+
+  EXPECT_TRUE(absl::StartsWith(response, "HTTP/1.1 200 OK\r\n"));
+  EXPECT_TRUE(absl::EndsWith(response, FormatPrometheusText(SampleMetrics())));
+}
+#endif  // _WIN32
+
+TEST(MetricsSinkTest, HttpMetricsSinkIsCreatedOnlyIfConfigured) {
+  ASSERT_TRUE(MetricsSinkRegistry::IsRegistered("HttpMetricsSink"));
+  ProfilerConfig config;
+  auto status_or_sink =
+      MetricsSinkRegistry::CreateByName("HttpMetricsSink", config);
+  MP_ASSERT_OK(status_or_sink.status());
+  EXPECT_EQ(nullptr, status_or_sink.ValueOrDie());
+}
+
+TEST(MetricsReporterTest, ReportsPeriodicallyAndOnStop) {
+  auto sink = std::make_shared<RecordingSink>();
+  int64 busy_usec = 0;
+  MetricsReporter reporter(
+      absl::Milliseconds(10),
+      [&busy_usec](GraphMetrics* metrics) {
+        ExecutorMetrics executor;
+        executor.name = "default";
+        executor.busy_usec = (busy_usec += 1000);
+        metrics->executors.push_back(executor);
+      },
+      {sink});
+  reporter.Start();
+  absl::SleepFor(absl::Milliseconds(100));
+  reporter.Stop();
+
+  std::vector<GraphMetrics> snapshots = sink->snapshots();
+  ASSERT_GE(snapshots.size(), 2);
+  for (const GraphMetrics& snapshot : snapshots) {
+    ASSERT_EQ(1, snapshot.executors.size());
+    EXPECT_GT(snapshot.executors[0].busy_threads, 0);
+  }
+  // The final snapshot is taken by Stop().
+  EXPECT_EQ(busy_usec, snapshots.back().executors[0].busy_usec);
+}
+
+TEST(MetricsReporterTest, CalculatorGraphReportsFinalSnapshot) {
+  CalculatorGraphConfig config = ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+    input_stream: "input"
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "input"
+      output_stream: "output"
+    }
+    profiler_config {
+      enable_profiler: true
+      metrics_interval_usec: 3600000000
+    }
+  )");
+  auto sink = std::make_shared<RecordingSink>();
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  MP_ASSERT_OK(graph.AddMetricsSink(sink));
+  MP_ASSERT_OK(graph.StartRun({}));
+  for (int i = 0; i < 5; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "input", MakePacket<int>(i).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+  EXPECT_FALSE(graph.AddMetricsSink(nullptr).ok());
+
+  std::vector<GraphMetrics> snapshots = sink->snapshots();
+  ASSERT_EQ(1, snapshots.size());
+  const GraphMetrics& metrics = snapshots[0];
+  ASSERT_EQ(1, metrics.calculators.size());
+  EXPECT_EQ("PassThroughCalculator", metrics.calculators[0].name);
+  EXPECT_EQ(5, metrics.calculators[0].process_count);
+  ASSERT_EQ(1, metrics.input_streams.size());
+  EXPECT_EQ("input", metrics.input_streams[0].name);
+  EXPECT_EQ("PassThroughCalculator", metrics.input_streams[0].calculator);
+  EXPECT_EQ(0, metrics.input_streams[0].queue_size);
+  EXPECT_EQ(0, metrics.throttled_nodes);
+  ASSERT_EQ(1, metrics.executors.size());
+  EXPECT_EQ("default", metrics.executors[0].name);
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,107 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PROFILER_THREAD_RING_BUFFER_H_
+#define MEDIAPIPE_FRAMEWORK_PROFILER_THREAD_RING_BUFFER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+// A fixed-size ring buffer for event logging, written by a single thread and
+// read by any number of threads. When the ring is full, each new event
+// overwrites the oldest one.
+//
+// Writing is wait-free and touches no memory shared with other writers:
+// push_back stores the event and bumps two counters that only the writing
+// thread modifies. Readers never block the writer. A reader copies the
+// events and then discards any that the writer may have overwritten during
+// the copy, as in a sequence lock, so T must be trivially copyable.
+template <typename T>
+class ThreadRingBuffer {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "ThreadRingBuffer requires a trivially copyable type.");
+
+ public:
+  // Creates a ring holding the most recent |capacity| events, rounded up to
+  // a power of two.
+  explicit ThreadRingBuffer(size_t capacity)
+      : capacity_(RoundUpToPowerOfTwo(std::max<size_t>(capacity, 1))),
+        events_(new T[capacity_]) {}
+  ThreadRingBuffer(const ThreadRingBuffer&) = delete;
+  ThreadRingBuffer& operator=(const ThreadRingBuffer&) = delete;
+
+  size_t capacity() const { return capacity_; }
+
+  // Appends an event. Must only be called by the writing thread.
+  inline void push_back(const T& event) {
+    const uint64 index = end_.load(std::memory_order_relaxed);
+    // Announce the overwrite of the slot before touching it. See Snapshot.
+    begin_write_.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    events_[index & (capacity_ - 1)] = event;
+    end_.store(index + 1, std::memory_order_release);
+  }
+
+  // Returns the number of events appended so far, including overwritten ones.
+  uint64 size() const { return end_.load(std::memory_order_acquire); }
+
+  // Appends the retained events to |result|, oldest first.
+  void Snapshot(std::vector<T>* result) const {
+    const uint64 end = end_.load(std::memory_order_acquire);
+    const uint64 begin = end > capacity_ ? end - capacity_ : 0;
+    const size_t offset = result->size();
+    result->resize(offset + (end - begin));
+    for (uint64 i = begin; i < end; ++i) {
+      (*result)[offset + (i - begin)] = events_[i & (capacity_ - 1)];
+    }
+    // Any write that the copy above may have observed is announced by a
+    // begin_write_ value visible here. Event i is intact unless the writer
+    // began to write event i + capacity_.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64 begin_write = begin_write_.load(std::memory_order_relaxed);
+    const uint64 first_intact =
+        begin_write > capacity_ ? begin_write - capacity_ : 0;
+    if (first_intact > begin) {
+      const size_t num_torn = std::min(first_intact, end) - begin;
+      result->erase(result->begin() + offset,
+                    result->begin() + offset + num_torn);
+    }
+  }
+
+ private:
+  static size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t capacity = 1;
+    while (capacity < n) capacity *= 2;
+    return capacity;
+  }
+
+  const size_t capacity_;
+  std::unique_ptr<T[]> events_;
+  // One past the index of the last event written completely.
+  std::atomic<uint64> end_{0};
+  // One past the index of the last event whose write has begun.
+  std::atomic<uint64> begin_write_{0};
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PROFILER_THREAD_RING_BUFFER_H_
@@ -0,0 +1,95 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/thread_ring_buffer.h"
+
+#include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(ThreadRingBufferTest, SnapshotsEventsInOrder) {
+  ThreadRingBuffer<int> ring(8);
+  std::vector<int> events;
+  ring.Snapshot(&events);
+  EXPECT_TRUE(events.empty());
+
+  for (int i = 0; i < 5; ++i) {
+    ring.push_back(i);
+  }
+  EXPECT_EQ(5, ring.size());
+  events = {-1};
+  ring.Snapshot(&events);
+  EXPECT_EQ(std::vector<int>({-1, 0, 1, 2, 3, 4}), events);
+}
+
+TEST(ThreadRingBufferTest, OverwritesOldestEvents) {
+  ThreadRingBuffer<int> ring(5);
+  EXPECT_EQ(8, ring.capacity());
+  for (int i = 0; i < 20; ++i) {
+    ring.push_back(i);
+  }
+  EXPECT_EQ(20, ring.size());
+  std::vector<int> events;
+  ring.Snapshot(&events);
+  EXPECT_EQ(std::vector<int>({12, 13, 14, 15, 16, 17, 18, 19}), events);
+}
+
+// An event whose fields are written together, to detect torn copies.
+struct Event {
+  int64 value;
+  int64 check;
+};
+
+TEST(ThreadRingBufferTest, SnapshotsWhileWriting) {
+  constexpr int64 kNumEvents = 200000;
+  ThreadRingBuffer<Event> ring(64);
+  std::atomic<bool> done(false);
+  std::thread writer([&] {
+    for (int64 i = 0; i < kNumEvents; ++i) {
+      ring.push_back({i, ~i});
+    }
+    done = true;
+  });
+
+  // Each snapshot holds consecutive intact events, however the writer
+  // overwrites them meanwhile.
+  int num_snapshots = 0;
+  while (!done || num_snapshots == 0) {
+    std::vector<Event> events;
+    ring.Snapshot(&events);
+    ASSERT_LE(events.size(), ring.capacity());
+    for (int i = 0; i < events.size(); ++i) {
+      ASSERT_EQ(~events[i].value, events[i].check);
+      if (i > 0) {
+        ASSERT_EQ(events[i - 1].value + 1, events[i].value);
+      }
+    }
+    ++num_snapshots;
+  }
+  writer.join();
+
+  std::vector<Event> events;
+  ring.Snapshot(&events);
+  ASSERT_EQ(64, events.size());
+  EXPECT_EQ(kNumEvents - 1, events.back().value);
+}
+
+}  // namespace
+}  // namespace mediapipe
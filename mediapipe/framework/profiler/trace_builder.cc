@@ -148,6 +148,16 @@ std::vector<std::string> GetIdNames(StringIdMap id_map) {
   return result;
 }
 
+// Returns the events in a TraceBuffer, oldest first.
+std::vector<TraceEvent> ToVector(const TraceBuffer& buffer) {
+  std::vector<TraceEvent> result;
+  TraceBuffer::iterator buffer_end = buffer.end();
+  for (auto iter = buffer.begin(); iter < buffer_end; ++iter) {
+    result.push_back(*iter);
+  }
+  return result;
+}
+
 }  // namespace
 
 // Builds a GraphTrace for packets over a range of timestamps.
@@ -168,29 +178,21 @@ class TraceBuilder::Impl {
   // Returns the registry of trace event types.
   TraceEventRegistry* trace_event_registry() { return &trace_event_registry_; }
 
-  static Timestamp TimestampAfter(const TraceBuffer& buffer,
+  static Timestamp TimestampAfter(const std::vector<TraceEvent>& events,
                                   absl::Time begin_time) {
     Timestamp max_ts = Timestamp::Min();
-    for (auto iter = buffer.begin(); iter < buffer.end(); ++iter) {
-      TraceEvent event = *iter;
+    for (const TraceEvent& event : events) {
       if (event.event_time >= begin_time) break;
       max_ts = std::max(max_ts, event.input_ts);
     }
     return max_ts + 1;
   }
 
-  void CreateTrace(const TraceBuffer& buffer, absl::Time begin_time,
+  void CreateTrace(const std::vector<TraceEvent>& events, absl::Time begin_time,
                    absl::Time end_time, GraphTrace* result) {
     // Snapshot recent TraceEvents
-    std::vector<TraceEvent> snapshot;
-    snapshot.reserve(10000);
-    TraceBuffer::iterator buffer_end = buffer.end();
-    for (auto iter = buffer.begin(); iter < buffer_end; ++iter) {
-      TraceEvent event = *iter;
-      if (event.event_time >= begin_time && event.event_time < end_time) {
-        snapshot.push_back(event);
-      }
-    }
+    std::vector<TraceEvent> snapshot = EventsBetween(events, begin_time,
+                                                     end_time);
     SetBaseTime(snapshot);
 
     // Index TraceEvents by task-id and stream-hop-id.
@@ -230,18 +232,11 @@ class TraceBuilder::Impl {
     }
   }
 
-  void CreateLog(const TraceBuffer& buffer, absl::Time begin_time,
+  void CreateLog(const std::vector<TraceEvent>& events, absl::Time begin_time,
                  absl::Time end_time, GraphTrace* result) {
     // Snapshot recent TraceEvents
-    std::vector<TraceEvent> snapshot;
-    snapshot.reserve(10000);
-    TraceBuffer::iterator buffer_end = buffer.end();
-    for (auto iter = buffer.begin(); iter < buffer_end; ++iter) {
-      TraceEvent event = *iter;
-      if (event.event_time >= begin_time && event.event_time < end_time) {
-        snapshot.push_back(event);
-      }
-    }
+    std::vector<TraceEvent> snapshot = EventsBetween(events, begin_time,
+                                                     end_time);
     SetBaseTime(snapshot);
 
     // Log each TraceEvent.
@@ -262,6 +257,20 @@ class TraceBuilder::Impl {
   }
 
  private:
+  // Returns the events between begin_time and end_time exclusive.
+  static std::vector<TraceEvent> EventsBetween(
+      const std::vector<TraceEvent>& events, absl::Time begin_time,
+      absl::Time end_time) {
+    std::vector<TraceEvent> result;
+    result.reserve(events.size());
+    for (const TraceEvent& event : events) {
+      if (event.event_time >= begin_time && event.event_time < end_time) {
+        result.push_back(event);
+      }
+    }
+    return result;
+  }
+
   // Calculate the base timestamp and time.
   void SetBaseTime(const std::vector<TraceEvent>& snapshot) {
     if (base_time_ == std::numeric_limits<int64>::max()) {
@@ -400,15 +409,29 @@ TraceEventRegistry* TraceBuilder::trace_event_registry() {
 
 Timestamp TraceBuilder::TimestampAfter(const TraceBuffer& buffer,
                                        absl::Time begin_time) {
-  return Impl::TimestampAfter(buffer, begin_time);
+  return Impl::TimestampAfter(ToVector(buffer), begin_time);
+}
+Timestamp TraceBuilder::TimestampAfter(const std::vector<TraceEvent>& events,
+                                       absl::Time begin_time) {
+  return Impl::TimestampAfter(events, begin_time);
 }
 void TraceBuilder::CreateTrace(const TraceBuffer& buffer, absl::Time begin_time,
                                absl::Time end_time, GraphTrace* result) {
-  impl_->CreateTrace(buffer, begin_time, end_time, result);
+  impl_->CreateTrace(ToVector(buffer), begin_time, end_time, result);
+}
+void TraceBuilder::CreateTrace(const std::vector<TraceEvent>& events,
+                               absl::Time begin_time, absl::Time end_time,
+                               GraphTrace* result) {
+  impl_->CreateTrace(events, begin_time, end_time, result);
 }
 void TraceBuilder::CreateLog(const TraceBuffer& buffer, absl::Time begin_time,
                              absl::Time end_time, GraphTrace* result) {
-  impl_->CreateLog(buffer, begin_time, end_time, result);
+  impl_->CreateLog(ToVector(buffer), begin_time, end_time, result);
+}
+void TraceBuilder::CreateLog(const std::vector<TraceEvent>& events,
+                             absl::Time begin_time, absl::Time end_time,
+                             GraphTrace* result) {
+  impl_->CreateLog(events, begin_time, end_time, result);
 }
 void TraceBuilder::Clear() { impl_->Clear(); }
 
@@ -82,6 +82,15 @@ void Scheduler::SetExecutor(Executor* executor) {
   default_queue_.SetExecutor(executor);
 }
 
+void Scheduler::SetDeadlineTracker(const DeadlineTracker* tracker) {
+  CHECK_EQ(state_, STATE_NOT_STARTED)
+      << "SetDeadlineTracker must not be called after the scheduler has "
+         "started";
+  for (auto queue : scheduler_queues_) {
+    queue->SetDeadlineTracker(tracker);
+  }
+}
+
 // TODO: Consider renaming this method CreateNonDefaultQueue.
 ::mediapipe::Status Scheduler::SetNonDefaultExecutor(const std::string& name,
                                                      Executor* executor) {
@@ -446,6 +455,7 @@ void Scheduler::AssignNodeToSchedulerQueue(CalculatorNode* node) {
   } else {
     queue = &default_queue_;
   }
+  queue->RegisterNode(node);
   node->SetSchedulerQueue(queue);
 }
 
@@ -59,6 +59,11 @@ class Scheduler {
   ::mediapipe::Status SetNonDefaultExecutor(const std::string& name,
                                             Executor* executor);
 
+  // Sets the tracker whose arrival times order the invocations of non-source
+  // nodes on all queues, or restores the default order if it is null. Must
+  // be called before the scheduler is started.
+  void SetDeadlineTracker(const DeadlineTracker* tracker);
+
   // Resets the data members at the beginning of each graph run.
   void Reset();
 
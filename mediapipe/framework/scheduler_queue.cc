@@ -14,10 +14,13 @@
 
 #include "mediapipe/framework/scheduler_queue.h"
 
+#include <algorithm>
 #include <memory>
 #include <queue>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 
+#include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
 #include "mediapipe/framework/calculator_node.h"
 #include "mediapipe/framework/executor.h"
@@ -25,6 +28,10 @@
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/status.h"
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif  // _MSC_VER
+
 #ifdef __APPLE__
 #define AUTORELEASEPOOL @autoreleasepool
 #else
@@ -34,6 +41,35 @@
 namespace mediapipe {
 namespace internal {
 
+namespace {
+
+// Returns the index of the least significant set bit. "bits" must not be 0.
+inline int LowestSetBit(uint64 bits) {
+#ifdef _MSC_VER
+  unsigned long index;  // NOLINT(runtime/int)
+  _BitScanForward64(&index, bits);
+  return index;
+#else
+  return __builtin_ctzll(bits);
+#endif  // _MSC_VER
+}
+
+// Returns the index of the most significant set bit. "bits" must not be 0.
+inline int HighestSetBit(uint64 bits) {
+#ifdef _MSC_VER
+  unsigned long index;  // NOLINT(runtime/int)
+  _BitScanReverse64(&index, bits);
+  return index;
+#else
+  return 63 - __builtin_clzll(bits);
+#endif  // _MSC_VER
+}
+
+}  // namespace
+
+thread_local SchedulerQueue::FusionFrame*
+    SchedulerQueue::current_fusion_frame_ = nullptr;
+
 SchedulerQueue::Item::Item(CalculatorNode* node, CalculatorContext* cc)
     : node_(node), cc_(cc) {
   CHECK(node);
@@ -44,6 +80,7 @@ SchedulerQueue::Item::Item(CalculatorNode* node, CalculatorContext* cc)
     layer_ = node->source_layer();
     source_process_order_ = node->SourceProcessOrder(cc).Value();
   }
+  CachePriority();
 }
 
 SchedulerQueue::Item::Item(CalculatorNode* node)
@@ -55,56 +92,175 @@ SchedulerQueue::Item::Item(CalculatorNode* node)
     layer_ = node->source_layer();
     source_process_order_ = Timestamp::Unstarted().Value();
   }
+  CachePriority();
+}
+
+// From the most significant bit, priority_ holds:
+// - 2 bits: 3 for OpenNode(), 2 for non-sources and 1 for sources.
+// - 30 bits: for sources, the layer, inverted so that lower layers run first.
+// - 32 bits: for OpenNode(), the id, inverted so that lower ids run first.
+//   For non-sources, the id.
+void SchedulerQueue::Item::CachePriority() {
+  constexpr uint32 kMaxLayer = (1u << 30) - 1;
+  if (is_open_node_) {
+    priority_ = (uint64{3} << 62) | (~static_cast<uint32>(id_));
+  } else if (!is_source_) {
+    priority_ = (uint64{2} << 62) | static_cast<uint32>(id_);
+  } else {
+    const uint32 layer =
+        std::min(static_cast<uint32>(std::max(layer_, 0)), kMaxLayer);
+    priority_ = (uint64{1} << 62) | (static_cast<uint64>(kMaxLayer - layer)
+                                     << 32);
+  }
 }
 
 // Returning true means "this runs after that".
 bool SchedulerQueue::Item::operator<(const SchedulerQueue::Item& that) const {
-  if (is_open_node_ || that.is_open_node_) {
-    // OpenNode() runs before ProcessNode().
-    if (!that.is_open_node_) return false;
-    // ProcessNode() runs after OpenNode().
-    if (!is_open_node_) return true;
-    // If both are OpenNode(), higher ids run after lower ids.
-    return id_ > that.id_;
+  // Items of different kinds are ordered by kind.
+  if ((priority_ ^ that.priority_) >> 62 != 0) {
+    return priority_ < that.priority_;
   }
-  if (is_source_) {
-    // Sources run after non-sources.
-    if (!that.is_source_) return true;
-    // Higher layer sources run after lower layer sources.
-    if (layer_ != that.layer_) return layer_ > that.layer_;
-    // Higher SourceProcessOrder values run after lower values.
-    if (source_process_order_ != that.source_process_order_) {
-      return source_process_order_ > that.source_process_order_;
+  // Only non-sources have known arrival times. Later arrivals run after
+  // earlier arrivals, and unknown arrivals run last.
+  if (arrival_usec_ != that.arrival_usec_) {
+    return arrival_usec_ > that.arrival_usec_;
+  }
+  if (priority_ != that.priority_) {
+    return priority_ < that.priority_;
+  }
+  // Only two sources in the same layer, or two items of the same node, get
+  // here. Higher SourceProcessOrder values run after lower values.
+  if (source_process_order_ != that.source_process_order_) {
+    return source_process_order_ > that.source_process_order_;
+  }
+  // For sources, higher ids run after lower ids.
+  return id_ > that.id_;
+}
+
+void SchedulerQueue::BandSet::Resize(int id) {
+  if (id < bands.size()) {
+    return;
+  }
+  bands.resize(id + 1);
+  const int num_words = id / 64 + 1;
+  if (num_words > num_mask_words) {
+    auto new_mask = absl::make_unique<std::atomic<uint64>[]>(num_words);
+    for (int i = 0; i < num_words; ++i) {
+      new_mask[i].store(i < num_mask_words ? mask[i].load() : 0);
     }
-    // For sources, higher ids run after lower ids.
-    return id_ > that.id_;
-  } else {
-    // Non-sources run before sources.
-    if (that.is_source_) return false;
-    // For non-sources, higher ids run before lower ids.
-    return id_ < that.id_;
+    mask = std::move(new_mask);
+    num_mask_words = num_words;
+  }
+}
+
+bool SchedulerQueue::Band::Empty() const {
+  return items.Empty() && num_overflow.load(std::memory_order_seq_cst) == 0;
+}
+
+void SchedulerQueue::BandSet::Push(int id, Item&& item) {
+  CHECK(id < bands.size() && bands[id] != nullptr)
+      << item.Node()->DebugName() << " was not registered with the queue.";
+  Band* band = bands[id].get();
+  // Once items have spilled, new items follow them into the overflow deque.
+  if (band->num_overflow.load(std::memory_order_seq_cst) > 0 ||
+      !band->items.TryPush(std::move(item))) {
+    // The slow path decides between the ring and the deque under the lock.
+    // The count is raised before retrying the ring, so pushes that start
+    // meanwhile take the slow path too and queue up behind this one.
+    absl::MutexLock lock(&band->overflow_mutex);
+    const bool ring_open = band->overflow.empty();
+    band->num_overflow.fetch_add(1, std::memory_order_seq_cst);
+    if (ring_open && band->items.TryPush(std::move(item))) {
+      band->num_overflow.fetch_sub(1, std::memory_order_seq_cst);
+    } else {
+      band->overflow.push_back(std::move(item));
+    }
+  }
+  // Set the bit after the push. See TryPop.
+  mask[id / 64].fetch_or(uint64{1} << (id % 64), std::memory_order_seq_cst);
+}
+
+bool SchedulerQueue::BandSet::TryPop(int id, Item* item) {
+  Band* band = bands[id].get();
+  if (band->items.TryPop(item)) {
+    return true;
+  }
+  if (band->num_overflow.load(std::memory_order_seq_cst) > 0) {
+    absl::MutexLock lock(&band->overflow_mutex);
+    if (!band->overflow.empty()) {
+      *item = std::move(band->overflow.front());
+      band->overflow.pop_front();
+      band->num_overflow.fetch_sub(1, std::memory_order_seq_cst);
+      return true;
+    }
+  }
+  // The band looks empty. Clear its bit, then look again: a concurrent Push
+  // that was missed by TryPop sets the bit after this clears it, or is seen
+  // by the Empty check.
+  const uint64 bit = uint64{1} << (id % 64);
+  std::atomic<uint64>& word = mask[id / 64];
+  word.fetch_and(~bit, std::memory_order_seq_cst);
+  if (!band->Empty()) {
+    word.fetch_or(bit, std::memory_order_seq_cst);
+  }
+  return false;
+}
+
+void SchedulerQueue::BandSet::Drain(std::vector<Item>* items) {
+  for (auto& band : bands) {
+    if (band == nullptr) continue;
+    Item item;
+    while (band->items.TryPop(&item)) {
+      items->push_back(std::move(item));
+    }
+    absl::MutexLock lock(&band->overflow_mutex);
+    for (Item& overflow_item : band->overflow) {
+      items->push_back(std::move(overflow_item));
+    }
+    band->overflow.clear();
+    band->num_overflow.store(0);
+  }
+  for (int i = 0; i < num_mask_words; ++i) {
+    mask[i].store(0);
   }
 }
 
 void SchedulerQueue::Reset() {
-  absl::MutexLock lock(&mutex_);
-  num_pending_tasks_ = 0;
+  num_active_ = 0;
   num_tasks_to_add_ = 0;
   running_count_ = 0;
 }
 
 void SchedulerQueue::SetExecutor(Executor* executor) { executor_ = executor; }
 
-bool SchedulerQueue::IsIdle() {
-  VLOG(3) << "Scheduler queue empty: " << queue_.empty()
-          << ", # of pending tasks: " << num_pending_tasks_;
-  return queue_.empty() && num_pending_tasks_ == 0;
+void SchedulerQueue::SetDeadlineTracker(const DeadlineTracker* tracker) {
+  CHECK_EQ(running_count_.load(), 0);
+  CHECK_EQ(num_deadline_items_.load(), 0);
+  deadline_tracker_ = tracker;
+}
+
+void SchedulerQueue::RegisterNode(const CalculatorNode* node) {
+  const int id = node->Id();
+  open_items_.Resize(id);
+  if (open_items_.bands[id] == nullptr) {
+    // A node is opened once per run.
+    open_items_.bands[id] = absl::make_unique<Band>(1);
+  }
+  if (!node->IsSource()) {
+    process_items_.Resize(id);
+    if (process_items_.bands[id] == nullptr) {
+      // CalculatorNode::TryToBeginScheduling bounds the number of queued
+      // invocations of a node by its max_in_flight.
+      process_items_.bands[id] =
+          absl::make_unique<Band>(std::max(node->max_in_flight(), 1));
+    }
+  }
 }
 
 void SchedulerQueue::SetRunning(bool running) {
-  absl::MutexLock lock(&mutex_);
-  running_count_ += running ? 1 : -1;
-  DCHECK_LE(running_count_, 1);
+  const int delta = running ? 1 : -1;
+  const int running_count = running_count_.fetch_add(delta) + delta;
+  DCHECK_LE(running_count, 1);
 }
 
 void SchedulerQueue::AddNode(CalculatorNode* node, CalculatorContext* cc) {
@@ -120,7 +276,31 @@ void SchedulerQueue::AddNode(CalculatorNode* node, CalculatorContext* cc) {
     CHECK(node->IsSource()) << node->DebugName();
     return;
   }
-  AddItemToQueue(Item(node, cc));
+  Item item(node, cc);
+  if (deadline_tracker_ != nullptr && !node->IsSource()) {
+    item.SetArrivalUsec(deadline_tracker_->ArrivalUsec(cc->InputTimestamp()));
+  }
+  if (TryRunFused(&item)) {
+    return;
+  }
+  AddItemToQueue(std::move(item));
+}
+
+bool SchedulerQueue::TryRunFused(Item* item) {
+  FusionFrame* frame = current_fusion_frame_;
+  if (frame == nullptr || frame->queue != this || frame->node == nullptr ||
+      frame->node->Id() != item->Node()->fused_predecessor_id() ||
+      running_count_ == 0) {
+    return false;
+  }
+  // The item is counted like a queued item, so that the queue does not
+  // become idle before it runs. The running task is still counted, so the
+  // queue cannot be idle now.
+  ++num_active_;
+  VLOG(4) << item->Node()->DebugName() << " will run fused with "
+          << frame->node->DebugName() << ".";
+  frame->items.push_back(std::move(*item));
+  return true;
 }
 
 void SchedulerQueue::AddNodeForOpen(CalculatorNode* node) {
@@ -131,40 +311,47 @@ void SchedulerQueue::AddNodeForOpen(CalculatorNode* node) {
 }
 
 void SchedulerQueue::AddItemToQueue(Item&& item) {
-  const CalculatorNode* node = item.Node();
-  bool was_idle;
-  int tasks_to_add = 0;
-  {
-    absl::MutexLock lock(&mutex_);
-    was_idle = IsIdle();
-    queue_.push(item);
-    ++num_tasks_to_add_;
-    VLOG(4) << node->DebugName() << " was added to the scheduler queue.";
-
-    // Now grab the tasks to execute while still holding the lock. This will
-    // gather any waiting tasks, in addition to the one we just added.
-    if (running_count_ > 0) {
-      tasks_to_add = GetTasksToSubmitToExecutor();
-    }
-  }
+  CalculatorNode* node = item.Node();
+  // The item is counted before it can be popped, so that the queue cannot
+  // become idle while the item is still queued.
+  const bool was_idle = num_active_.fetch_add(1) == 0;
   if (was_idle && idle_callback_) {
     // Became not idle.
     idle_callback_(false);
   }
+  if (item.IsOpenNode()) {
+    open_items_.Push(node->Id(), std::move(item));
+  } else if (node->IsSource()) {
+    absl::MutexLock lock(&source_items_mutex_);
+    source_items_.push(std::move(item));
+    ++num_source_items_;
+  } else if (deadline_tracker_ != nullptr) {
+    absl::MutexLock lock(&deadline_items_mutex_);
+    deadline_items_.push(std::move(item));
+    ++num_deadline_items_;
+  } else {
+    process_items_.Push(node->Id(), std::move(item));
+  }
+  VLOG(4) << node->DebugName() << " was added to the scheduler queue.";
+  ++num_tasks_to_add_;
+
   // Note: this should be done after calling idle_callback_(false) above.
   // This ensures that we never get an idle_callback_(true) that is not
   // preceded by the corresponding idle_callback_(false). See the comments on
-  // SetIdleCallback for details.
-  while (tasks_to_add > 0) {
-    executor_->AddTask(this);
-    --tasks_to_add;
+  // SetIdleCallback for details. Any waiting tasks are submitted along with
+  // the one we just added.
+  if (running_count_ > 0) {
+    int tasks_to_add = GetTasksToSubmitToExecutor();
+    while (tasks_to_add > 0) {
+      executor_->AddTask(this);
+      --tasks_to_add;
+    }
   }
 }
 
 int SchedulerQueue::GetTasksToSubmitToExecutor() {
-  int tasks_to_add = num_tasks_to_add_;
-  num_tasks_to_add_ = 0;
-  num_pending_tasks_ += tasks_to_add;
+  int tasks_to_add = num_tasks_to_add_.exchange(0);
+  num_active_ += tasks_to_add;
   return tasks_to_add;
 }
 
@@ -173,11 +360,8 @@ void SchedulerQueue::SubmitWaitingTasksToExecutor() {
   // we do not immediately submit tasks to the executor. Here we check for any
   // such waiting tasks, and submit them.
   int tasks_to_add = 0;
-  {
-    absl::MutexLock lock(&mutex_);
-    if (running_count_ > 0) {
-      tasks_to_add = GetTasksToSubmitToExecutor();
-    }
+  if (running_count_ > 0) {
+    tasks_to_add = GetTasksToSubmitToExecutor();
   }
   while (tasks_to_add > 0) {
     executor_->AddTask(this);
@@ -185,30 +369,77 @@ void SchedulerQueue::SubmitWaitingTasksToExecutor() {
   }
 }
 
-void SchedulerQueue::RunNextTask() {
-  CalculatorNode* node;
-  CalculatorContext* calculator_context;
-  bool is_open_node;
-  {
-    absl::MutexLock lock(&mutex_);
-
-    CHECK(!queue_.empty()) << "Called RunNextTask when the queue is empty. "
-                              "This should not happen.";
-
-    node = queue_.top().Node();
-    calculator_context = queue_.top().Context();
-    is_open_node = queue_.top().IsOpenNode();
-    queue_.pop();
+bool SchedulerQueue::TryPopItem(Item* item) {
+  // OpenNode() items run first, lower node ids first.
+  for (int w = 0; w < open_items_.num_mask_words; ++w) {
+    uint64 bits = open_items_.mask[w].load(std::memory_order_acquire);
+    while (bits != 0) {
+      const int bit = LowestSetBit(bits);
+      if (open_items_.TryPop(w * 64 + bit, item)) return true;
+      bits &= bits - 1;
+    }
+  }
+  // Then non-sources, oldest arrivals first when deadlines are tracked.
+  if (num_deadline_items_ > 0) {
+    absl::MutexLock lock(&deadline_items_mutex_);
+    if (!deadline_items_.empty()) {
+      *item = deadline_items_.top();
+      deadline_items_.pop();
+      --num_deadline_items_;
+      return true;
+    }
+  }
+  // Otherwise higher node ids first.
+  for (int w = process_items_.num_mask_words - 1; w >= 0; --w) {
+    uint64 bits = process_items_.mask[w].load(std::memory_order_acquire);
+    while (bits != 0) {
+      const int bit = HighestSetBit(bits);
+      if (process_items_.TryPop(w * 64 + bit, item)) return true;
+      bits &= ~(uint64{1} << bit);
+    }
+  }
+  // Then sources.
+  if (num_source_items_ > 0) {
+    absl::MutexLock lock(&source_items_mutex_);
+    if (!source_items_.empty()) {
+      *item = source_items_.top();
+      source_items_.pop();
+      --num_source_items_;
+      return true;
+    }
+  }
+  return false;
+}
 
-    CHECK(!node->Closed())
-        << "Scheduled a node that was closed. This should not happen.";
+void SchedulerQueue::RunNextTask() {
+  Item item;
+  // Every task is submitted after its item is counted and pushed, so an item
+  // is available for this task. The pop can still miss it while another
+  // thread is in the middle of pushing or popping, so retry until it succeeds.
+  while (!TryPopItem(&item)) {
+    CHECK_GT(num_active_.load(), 0)
+        << "Called RunNextTask when the queue is empty. "
+           "This should not happen.";
+    std::this_thread::yield();
   }
+  CalculatorNode* node = item.Node();
+  CalculatorContext* calculator_context = item.Context();
+  bool is_open_node = item.IsOpenNode();
+
+  CHECK(!node->Closed())
+      << "Scheduled a node that was closed. This should not happen.";
 
   // On iOS, calculators may rely on the existence of an autorelease pool
   // (either directly, or because system code they call does). We do not
   // want to rely on executors setting up an autorelease pool for us (e.g.
   // an executor creating standard pthread will not, by default), so we
   // do it here to ensure all executors are covered.
+  // Nodes made ready while this node runs may be run on this thread after
+  // it. The previous frame is restored afterwards, in case an executor runs
+  // tasks of another queue from within this one.
+  FusionFrame frame{this, is_open_node ? nullptr : node, {}};
+  FusionFrame* const outer_frame = current_fusion_frame_;
+  current_fusion_frame_ = &frame;
   AUTORELEASEPOOL {
     if (is_open_node) {
       DCHECK(!calculator_context);
@@ -216,21 +447,33 @@ void SchedulerQueue::RunNextTask() {
     } else {
       RunCalculatorNode(node, calculator_context);
     }
+    RunFusedItems(&frame);
   }
+  current_fusion_frame_ = outer_frame;
 
-  bool is_idle;
-  {
-    absl::MutexLock lock(&mutex_);
-    DCHECK_GT(num_pending_tasks_, 0);
-    --num_pending_tasks_;
-    is_idle = IsIdle();
-  }
-  if (is_idle && idle_callback_) {
+  // Uncount the item and its task together.
+  const int num_active = num_active_.fetch_sub(2) - 2;
+  DCHECK_GE(num_active, 0);
+  if (num_active == 0 && idle_callback_) {
     // Became idle.
     idle_callback_(true);
   }
 }
 
+void SchedulerQueue::RunFusedItems(FusionFrame* frame) {
+  // Running an item may append the items of its own fused successors.
+  for (int i = 0; i < frame->items.size(); ++i) {
+    Item item = std::move(frame->items[i]);
+    frame->node = item.Node();
+    RunCalculatorNode(item.Node(), item.Context());
+    // Uncount the item. The task is still counted, so this cannot make the
+    // queue idle.
+    const int num_active = num_active_.fetch_sub(1) - 1;
+    DCHECK_GT(num_active, 0);
+  }
+  frame->items.clear();
+}
+
 void SchedulerQueue::RunCalculatorNode(CalculatorNode* node,
                                        CalculatorContext* cc) {
   VLOG(3) << "Running " << node->DebugName();
@@ -295,18 +538,30 @@ void SchedulerQueue::OpenCalculatorNode(CalculatorNode* node) {
 }
 
 void SchedulerQueue::CleanupAfterRun() {
-  bool was_idle;
+  std::vector<Item> items;
+  open_items_.Drain(&items);
+  process_items_.Drain(&items);
+  {
+    absl::MutexLock lock(&deadline_items_mutex_);
+    while (!deadline_items_.empty()) {
+      items.push_back(deadline_items_.top());
+      deadline_items_.pop();
+    }
+    num_deadline_items_ = 0;
+  }
   {
-    absl::MutexLock lock(&mutex_);
-    was_idle = IsIdle();
-    CHECK_EQ(num_pending_tasks_, 0);
-    CHECK_EQ(num_tasks_to_add_, queue_.size());
-    num_tasks_to_add_ = 0;
-    while (!queue_.empty()) {
-      queue_.pop();
+    absl::MutexLock lock(&source_items_mutex_);
+    while (!source_items_.empty()) {
+      items.push_back(source_items_.top());
+      source_items_.pop();
     }
+    num_source_items_ = 0;
   }
-  if (!was_idle && idle_callback_) {
+  // Only items that were never submitted to the executor can remain.
+  const int num_active = num_active_.exchange(0);
+  CHECK_EQ(num_active, items.size());
+  CHECK_EQ(num_tasks_to_add_.exchange(0), items.size());
+  if (num_active != 0 && idle_callback_) {
     // Became idle.
     idle_callback_(true);
   }
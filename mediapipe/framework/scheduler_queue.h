@@ -16,14 +16,18 @@
 #define MEDIAPIPE_FRAMEWORK_SCHEDULER_QUEUE_H_
 
 #include <atomic>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <queue>
 #include <utility>
+#include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/synchronization/mutex.h"
 #include "mediapipe/framework/calculator_context.h"
+#include "mediapipe/framework/deadline_tracker.h"
+#include "mediapipe/framework/deps/mpmc_bounded_queue.h"
 #include "mediapipe/framework/executor.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/scheduler_shared.h"
@@ -35,6 +39,29 @@ class CalculatorNode;
 namespace internal {
 
 // Manages a priority queue of nodes to be run on the associated executor.
+//
+// Adding and running nodes does not take a global lock. OpenNode() items and
+// ProcessNode() items of non-source nodes have a fixed priority per node, so
+// they are kept in one lock-free FIFO band per node, with an atomic bitmap
+// recording which bands may be non-empty. RunNextTask() scans the bitmap in
+// priority order. ProcessNode() items of source nodes are ordered by their
+// SourceProcessOrder, which changes from one item to the next, so they are
+// kept in a small priority queue under their own mutex. The idle state and
+// the executor task counts are tracked with atomic counters.
+//
+// A node that is fused with its predecessor (see
+// CalculatorNode::fused_predecessor_id) bypasses the queue when the
+// predecessor makes it ready: the item is kept by the task running the
+// predecessor and run right after it on the same thread. This is best effort.
+// A fused node that becomes ready in any other way, e.g. when it finishes a
+// run while its predecessor's next output is already waiting, is queued as
+// usual and may run on another thread.
+//
+// With a DeadlineTracker (see SetDeadlineTracker), ProcessNode() items of
+// non-source nodes are instead ordered by the arrival time of their input
+// timestamp, so that the oldest frames in the graph are processed first.
+// Their priority then changes from one item to the next, so they are kept in
+// a priority queue under their own mutex, like the items of sources.
 class SchedulerQueue : public TaskQueue {
  public:
   // Callback to be invoked when the queue's idle state changes.
@@ -45,6 +72,8 @@ class SchedulerQueue : public TaskQueue {
   // Item in the queue. Wraps a node pointer and helps with priority sorting.
   class Item {
    public:
+    // Constructs an empty item, for use as a placeholder in containers.
+    Item() : node_(nullptr), cc_(nullptr) {}
     Item(CalculatorNode* node, CalculatorContext* cc);
     // A null CalculatorContext indicates the task should run OpenNode().
     Item(CalculatorNode* node);
@@ -62,12 +91,24 @@ class SchedulerQueue : public TaskQueue {
     // - Sources are sorted by layer (lower layer numbers run first), then by
     //   Calculator::SourceProcessOrder (smaller values run first), then by
     //   node id: smaller ids run first, since they come earlier in the config.
-    // - Non-sources are sorted by node id: larger ids run first, because they
-    //   are closer to the leaves.
+    // - Non-sources are sorted by the arrival time of their input timestamp
+    //   (older timestamps run first), if known, then by node id: larger ids
+    //   run first, because they are closer to the leaves.
     bool operator<(const Item& that) const;
 
+    // Sets the arrival time of the input timestamp, in microseconds. Only
+    // used for ProcessNode() items of non-sources.
+    void SetArrivalUsec(int64 arrival_usec) { arrival_usec_ = arrival_usec; }
+
    private:
+    // Computes priority_ from the other fields.
+    void CachePriority();
+
+    // The ordering above, except for the SourceProcessOrder and the id of
+    // sources, packed into one integer. Larger values run first.
+    uint64 priority_ = 0;
     int64 source_process_order_ = 0;
+    int64 arrival_usec_ = DeadlineTracker::kUnknownArrival;
     CalculatorNode* node_;
     CalculatorContext* cc_;
     int id_ = 0;
@@ -78,6 +119,11 @@ class SchedulerQueue : public TaskQueue {
 
   explicit SchedulerQueue(SchedulerShared* shared) : shared_(shared) {}
 
+  // Allocates the per-node storage used for the items of "node". Must be
+  // called for every node before it is added to the queue, while the queue is
+  // not running. Calling it again for the same node has no effect.
+  void RegisterNode(const CalculatorNode* node);
+
   // Sets the executor that will run the nodes. Must be called before the
   // scheduler is started.
   void SetExecutor(Executor* executor);
@@ -96,6 +142,11 @@ class SchedulerQueue : public TaskQueue {
     idle_callback_ = std::move(callback);
   }
 
+  // Orders the ProcessNode() items of non-source nodes by the arrival times
+  // recorded in "tracker", or by node id if it is null. Must be called while
+  // the queue is empty and not running.
+  void SetDeadlineTracker(const DeadlineTracker* tracker);
+
   // Resets the data members at the beginning of each graph run.
   void Reset();
 
@@ -105,45 +156,96 @@ class SchedulerQueue : public TaskQueue {
   // NOTE: After calling SetRunning(true), the caller must call
   // SubmitWaitingTasksToExecutor since tasks may have been added while the
   // queue was not running.
-  void SetRunning(bool running) ABSL_LOCKS_EXCLUDED(mutex_);
+  void SetRunning(bool running);
 
   // Gets the number of tasks that need to be submitted to the executor, and
-  // updates num_pending_tasks_. If this method is called and returns a
-  // non-zero value, the executor's AddTask method *must* be called for each
-  // task returned, but it can be called without holding the lock.
-  int GetTasksToSubmitToExecutor() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // counts them as pending. If this method returns a non-zero value, the
+  // executor's AddTask method *must* be called for each task returned.
+  int GetTasksToSubmitToExecutor();
 
   // Submits tasks that are waiting (e.g. that were added while the queue was
   // not running) if the queue is running. The caller must not hold any mutex.
-  void SubmitWaitingTasksToExecutor() ABSL_LOCKS_EXCLUDED(mutex_);
+  void SubmitWaitingTasksToExecutor();
 
   // Adds a node and a calculator context to the scheduler queue if the node is
   // not already running. Note that if the node was running, then it will be
   // rescheduled upon completion (after checking dependencies), so this call is
   // not lost.
-  void AddNode(CalculatorNode* node, CalculatorContext* cc)
-      ABSL_LOCKS_EXCLUDED(mutex_);
+  void AddNode(CalculatorNode* node, CalculatorContext* cc);
 
   // Adds a node to the scheduler queue for an OpenNode() call.
-  void AddNodeForOpen(CalculatorNode* node) ABSL_LOCKS_EXCLUDED(mutex_);
+  void AddNodeForOpen(CalculatorNode* node);
 
-  // Adds an Item to queue_.
+  // Adds an Item to the queue.
   void AddItemToQueue(Item&& item);
 
-  void CleanupAfterRun() ABSL_LOCKS_EXCLUDED(mutex_);
+  void CleanupAfterRun();
 
  private:
+  // A lock-free FIFO of the items of one node. It is sized from the node's
+  // max_in_flight when the node is registered. Items that do not fit spill
+  // into a locked overflow deque, which is drained before the band takes
+  // new items again, so that the node's items stay in order. Pushes that
+  // overlap in time may land in either order.
+  struct Band {
+    explicit Band(int capacity) : items(capacity) {}
+    bool Empty() const;
+
+    MpmcBoundedQueue<Item> items;
+    // The number of items in "overflow", plus one while a push holding the
+    // lock retries "items". Readable without the lock.
+    std::atomic<int> num_overflow{0};
+    absl::Mutex overflow_mutex;
+    std::deque<Item> overflow ABSL_GUARDED_BY(overflow_mutex);
+  };
+
+  // One band per node id, plus a bitmap with a bit set for each band that
+  // may hold items.
+  struct BandSet {
+    std::vector<std::unique_ptr<Band>> bands;
+    std::unique_ptr<std::atomic<uint64>[]> mask;
+    int num_mask_words = 0;
+
+    // Grows the bands and the mask to hold node "id". Must not be called
+    // concurrently with any other method.
+    void Resize(int id);
+    void Push(int id, Item&& item);
+    // Pops the front item of band "id". If the band looks empty, clears its
+    // bit in the mask and returns false.
+    bool TryPop(int id, Item* item);
+    // Pops items from all bands, appending them to "items".
+    void Drain(std::vector<Item>* items);
+  };
+
+  // Pops the highest priority item, or returns false if none was found.
+  // RunNextTask() calls this until it succeeds: it may transiently fail
+  // while other threads are pushing or popping concurrently.
+  bool TryPopItem(Item* item);
+
+  // The items of fused nodes made ready by the task running on this thread.
+  struct FusionFrame {
+    SchedulerQueue* queue;
+    // The node whose ProcessNode() call is running, or null while running
+    // OpenNode().
+    CalculatorNode* node;
+    std::vector<Item> items;
+  };
+
+  // Runs "item" on this thread if its node is fused with the node running in
+  // the current task. Returns false if the item must be queued.
+  bool TryRunFused(Item* item);
+
+  // Used internally by RunNextTask. Runs the items collected in "frame",
+  // including any that they add in turn, in order.
+  void RunFusedItems(FusionFrame* frame);
+
   // Used internally by RunNextTask. Invokes ProcessNode or CloseNode, followed
   // by EndScheduling.
-  void RunCalculatorNode(CalculatorNode* node, CalculatorContext* cc)
-      ABSL_LOCKS_EXCLUDED(mutex_);
+  void RunCalculatorNode(CalculatorNode* node, CalculatorContext* cc);
 
   // Used internally by RunNextTask. Invokes OpenNode, followed by
   // CheckIfBecameReady.
-  void OpenCalculatorNode(CalculatorNode* node) ABSL_LOCKS_EXCLUDED(mutex_);
-
-  // Checks whether the queue has no queued nodes or pending tasks.
-  bool IsIdle() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void OpenCalculatorNode(CalculatorNode* node);
 
   Executor* executor_ = nullptr;
 
@@ -154,20 +256,42 @@ class SchedulerQueue : public TaskQueue {
   // decrements it. The queue is running if running_count_ > 0. A running
   // queue will submit tasks to the executor.
   // Invariant: running_count_ <= 1.
-  int running_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::atomic<int> running_count_{0};
 
-  // Number of tasks added to the Executor and not yet complete.
-  int num_pending_tasks_ ABSL_GUARDED_BY(mutex_);
+  // The number of queued items plus the number of tasks added to the Executor
+  // and not yet complete. The queue is idle when this is zero. An item is
+  // counted before it is pushed, and an item and its task are uncounted
+  // together when the task completes, so this never drops to zero while
+  // there is work left.
+  std::atomic<int> num_active_{0};
 
   // Number of tasks that need to be added to the Executor.
-  int num_tasks_to_add_ ABSL_GUARDED_BY(mutex_);
+  std::atomic<int> num_tasks_to_add_{0};
+
+  // OpenNode() items, indexed by node id. Lower ids run first.
+  BandSet open_items_;
+
+  // ProcessNode() items of non-source nodes, indexed by node id. Higher ids
+  // run first. Unused when deadline_tracker_ is set.
+  BandSet process_items_;
+
+  // ProcessNode() items of non-source nodes, when deadline_tracker_ is set.
+  const DeadlineTracker* deadline_tracker_ = nullptr;
+  absl::Mutex deadline_items_mutex_;
+  std::priority_queue<Item> deadline_items_
+      ABSL_GUARDED_BY(deadline_items_mutex_);
+  std::atomic<int> num_deadline_items_{0};
 
-  // Queue of nodes that need to be run.
-  std::priority_queue<Item> queue_ ABSL_GUARDED_BY(mutex_);
+  // ProcessNode() items of source nodes.
+  absl::Mutex source_items_mutex_;
+  std::priority_queue<Item> source_items_
+      ABSL_GUARDED_BY(source_items_mutex_);
+  std::atomic<int> num_source_items_{0};
 
   SchedulerShared* const shared_;
 
-  absl::Mutex mutex_;
+  // The frame of the task running on this thread, if any.
+  static thread_local FusionFrame* current_fusion_frame_;
 };
 
 }  // namespace internal
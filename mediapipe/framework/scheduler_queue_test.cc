@@ -0,0 +1,311 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Stress tests and benchmarks for the scheduler queue, using graphs with
+// hundreds of lightweight calculators.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/deadline_tracker.h"
+#include "mediapipe/framework/deps/clock.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/thread_pool_executor.pb.h"
+#include "mediapipe/framework/tool/sink.h"
+
+namespace mediapipe {
+namespace {
+
+// Adds one to an int packet.
+class AddOneCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).Set<int>();
+    cc->Outputs().Index(0).Set<int>();
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(TimestampDiff(0));
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Process(CalculatorContext* cc) override {
+    cc->Outputs().Index(0).AddPacket(
+        MakePacket<int>(cc->Inputs().Index(0).Get<int>() + 1)
+            .At(cc->InputTimestamp()));
+    return ::mediapipe::OkStatus();
+  }
+};
+REGISTER_CALCULATOR(AddOneCalculator);
+
+// Returns a graph in which the graph input stream "input" fans out into
+// "num_chains" chains of "chain_length" AddOneCalculators. The output of
+// chain i is the graph output stream "output_<i>".
+CalculatorGraphConfig ChainsConfig(int num_chains, int chain_length,
+                                   int max_in_flight) {
+  CalculatorGraphConfig config;
+  config.add_input_stream("input");
+  for (int chain = 0; chain < num_chains; ++chain) {
+    std::string previous = "input";
+    for (int i = 0; i < chain_length; ++i) {
+      std::string output = i + 1 == chain_length
+                               ? absl::StrCat("output_", chain)
+                               : absl::StrCat("chain_", chain, "_", i);
+      CalculatorGraphConfig::Node* node = config.add_node();
+      node->set_calculator("AddOneCalculator");
+      node->add_input_stream(previous);
+      node->add_output_stream(output);
+      if (max_in_flight > 1) {
+        node->set_max_in_flight(max_in_flight);
+      }
+      previous = output;
+    }
+  }
+  return config;
+}
+
+void SetNumThreads(int num_threads, CalculatorGraphConfig* config) {
+  ExecutorConfig* executor = config->add_executor();
+  executor->mutable_options()
+      ->MutableExtension(ThreadPoolExecutorOptions::ext)
+      ->set_num_threads(num_threads);
+}
+
+// Sends "num_packets" packets through the chains and checks that every chain
+// delivers all of them, in timestamp order, each incremented once per node.
+void RunChains(CalculatorGraphConfig config, int num_chains, int chain_length,
+               int num_packets) {
+  std::vector<std::vector<Packet>> outputs(num_chains);
+  for (int chain = 0; chain < num_chains; ++chain) {
+    tool::AddVectorSink(absl::StrCat("output_", chain), &config,
+                        &outputs[chain]);
+  }
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  MP_ASSERT_OK(graph.StartRun({}));
+  for (int i = 0; i < num_packets; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "input", MakePacket<int>(i).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  for (int chain = 0; chain < num_chains; ++chain) {
+    ASSERT_EQ(num_packets, outputs[chain].size()) << "chain " << chain;
+    for (int i = 0; i < num_packets; ++i) {
+      EXPECT_EQ(Timestamp(i), outputs[chain][i].Timestamp());
+      EXPECT_EQ(i + chain_length, outputs[chain][i].Get<int>());
+    }
+  }
+}
+
+TEST(SchedulerQueueTest, ManyChainsSingleThread) {
+  CalculatorGraphConfig config = ChainsConfig(8, 40, 1);
+  SetNumThreads(1, &config);
+  RunChains(config, 8, 40, 50);
+}
+
+TEST(SchedulerQueueTest, ManyChainsManyThreads) {
+  CalculatorGraphConfig config = ChainsConfig(8, 40, 1);
+  SetNumThreads(8, &config);
+  RunChains(config, 8, 40, 200);
+}
+
+TEST(SchedulerQueueTest, ManyChainsWithMaxInFlight) {
+  CalculatorGraphConfig config = ChainsConfig(4, 50, 3);
+  SetNumThreads(8, &config);
+  // InOrderOutputStreamHandler keeps the outputs of the parallel nodes in
+  // timestamp order.
+  std::vector<std::vector<Packet>> outputs(4);
+  for (int chain = 0; chain < 4; ++chain) {
+    tool::AddVectorSink(absl::StrCat("output_", chain), &config,
+                        &outputs[chain]);
+  }
+  for (auto& node : *config.mutable_node()) {
+    node.mutable_output_stream_handler()->set_output_stream_handler(
+        "InOrderOutputStreamHandler");
+  }
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  MP_ASSERT_OK(graph.StartRun({}));
+  for (int i = 0; i < 100; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "input", MakePacket<int>(i).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+  for (int chain = 0; chain < 4; ++chain) {
+    ASSERT_EQ(100, outputs[chain].size()) << "chain " << chain;
+    for (int i = 0; i < 100; ++i) {
+      EXPECT_EQ(Timestamp(i), outputs[chain][i].Timestamp())
+          << "chain " << chain;
+    }
+  }
+}
+
+// Repeated runs of the same graph reuse the per-node queue storage.
+TEST(SchedulerQueueTest, RepeatedRuns) {
+  CalculatorGraphConfig config = ChainsConfig(2, 100, 1);
+  SetNumThreads(4, &config);
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  for (int run = 0; run < 3; ++run) {
+    MP_ASSERT_OK(graph.StartRun({}));
+    for (int i = 0; i < 20; ++i) {
+      MP_ASSERT_OK(graph.AddPacketToInputStream(
+          "input", MakePacket<int>(i).At(Timestamp(i))));
+    }
+    MP_ASSERT_OK(graph.CloseAllInputStreams());
+    MP_ASSERT_OK(graph.WaitUntilDone());
+  }
+}
+
+// Records the input timestamps of all its instances, in the order in which
+// they are processed.
+class RecordTimestampCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).SetAny();
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Process(CalculatorContext* cc) override {
+    absl::MutexLock lock(&mutex_);
+    timestamps_->push_back(cc->InputTimestamp());
+    return ::mediapipe::OkStatus();
+  }
+
+  static std::vector<Timestamp> TakeTimestamps() {
+    absl::MutexLock lock(&mutex_);
+    std::vector<Timestamp> timestamps;
+    timestamps.swap(*timestamps_);
+    return timestamps;
+  }
+
+ private:
+  static absl::Mutex mutex_;
+  static std::vector<Timestamp>* const timestamps_;
+};
+absl::Mutex RecordTimestampCalculator::mutex_;
+std::vector<Timestamp>* const RecordTimestampCalculator::timestamps_ =
+    new std::vector<Timestamp>;
+REGISTER_CALCULATOR(RecordTimestampCalculator);
+
+// A clock that advances only when told to.
+class ManualClock : public Clock {
+ public:
+  absl::Time TimeNow() override { return now_; }
+  void Sleep(absl::Duration d) override { now_ += d; }
+  void SleepUntil(absl::Time wakeup_time) override {
+    now_ = std::max(now_, wakeup_time);
+  }
+
+ private:
+  absl::Time now_ = absl::UnixEpoch();
+};
+
+// Queues an invocation of each of two nodes, the later node with the later
+// timestamp, and returns the timestamps in the order they are processed.
+std::vector<Timestamp> RunTwoQueuedNodes(bool track_deadlines) {
+  CalculatorGraphConfig config = ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+    input_stream: "first"
+    input_stream: "second"
+    node { calculator: "RecordTimestampCalculator" input_stream: "first" }
+    node { calculator: "RecordTimestampCalculator" input_stream: "second" }
+  )");
+  SetNumThreads(1, &config);
+  auto clock = std::make_shared<ManualClock>();
+  CalculatorGraph graph;
+  MP_EXPECT_OK(graph.Initialize(config));
+  if (track_deadlines) {
+    MP_EXPECT_OK(graph.SetServiceObject(
+        kDeadlineTrackerService,
+        std::make_shared<DeadlineTracker>(/*latency_budget_usec=*/100000,
+                                          clock)));
+  }
+  MP_EXPECT_OK(graph.StartRun({}));
+  MP_EXPECT_OK(graph.WaitUntilIdle());
+  graph.Pause();
+  MP_EXPECT_OK(graph.AddPacketToInputStream(
+      "first", MakePacket<int>(0).At(Timestamp(1))));
+  clock->Sleep(absl::Microseconds(100));
+  MP_EXPECT_OK(graph.AddPacketToInputStream(
+      "second", MakePacket<int>(0).At(Timestamp(2))));
+  graph.Resume();
+  MP_EXPECT_OK(graph.CloseAllInputStreams());
+  MP_EXPECT_OK(graph.WaitUntilDone());
+  return RecordTimestampCalculator::TakeTimestamps();
+}
+
+// Without a deadline tracker, the node closer to the leaves runs first.
+TEST(SchedulerQueueTest, RunsNodesByIdWithoutDeadlines) {
+  EXPECT_EQ(RunTwoQueuedNodes(/*track_deadlines=*/false),
+            (std::vector<Timestamp>{Timestamp(2), Timestamp(1)}));
+}
+
+// With a deadline tracker, the timestamp that arrived first runs first.
+TEST(SchedulerQueueTest, RunsOldestArrivalFirstWithDeadlines) {
+  EXPECT_EQ(RunTwoQueuedNodes(/*track_deadlines=*/true),
+            (std::vector<Timestamp>{Timestamp(1), Timestamp(2)}));
+}
+
+// Measures node invocations per second through a graph with
+// num_chains * chain_length calculators.
+void BM_ChainsThroughput(benchmark::State& state) {
+  const int num_chains = state.range(0);
+  const int chain_length = state.range(1);
+  const int num_threads = state.range(2);
+  constexpr int kNumPackets = 100;
+  CalculatorGraphConfig config = ChainsConfig(num_chains, chain_length, 1);
+  SetNumThreads(num_threads, &config);
+  for (int chain = 0; chain < num_chains; ++chain) {
+    config.add_output_stream(absl::StrCat("output_", chain));
+  }
+  CalculatorGraph graph;
+  CHECK(graph.Initialize(config).ok());
+  for (auto _ : state) {
+    CHECK(graph.StartRun({}).ok());
+    for (int i = 0; i < kNumPackets; ++i) {
+      CHECK(graph
+                .AddPacketToInputStream("input",
+                                        MakePacket<int>(i).At(Timestamp(i)))
+                .ok());
+    }
+    CHECK(graph.CloseAllInputStreams().ok());
+    CHECK(graph.WaitUntilDone().ok());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPackets * num_chains *
+                          chain_length);
+}
+BENCHMARK(BM_ChainsThroughput)
+    ->ArgNames({"chains", "length", "threads"})
+    ->Args({1, 100, 1})
+    ->Args({4, 50, 4})
+    ->Args({8, 50, 8})
+    ->Args({16, 25, 16})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace mediapipe
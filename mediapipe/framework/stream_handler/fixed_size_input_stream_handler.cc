@@ -183,7 +183,7 @@ class FixedSizeInputStreamHandler : public DefaultInputStreamHandler {
   }
 
   void AddPackets(CollectionItemId id,
-                  const std::list<Packet>& packets) override {
+                  absl::Span<const Packet> packets) override {
     InputStreamHandler::AddPackets(id, packets);
     absl::MutexLock lock(&erase_mutex_);
     if (!pending_) {
@@ -191,7 +191,7 @@ class FixedSizeInputStreamHandler : public DefaultInputStreamHandler {
     }
   }
 
-  void MovePackets(CollectionItemId id, std::list<Packet>* packets) override {
+  void MovePackets(CollectionItemId id, absl::Span<Packet> packets) override {
     InputStreamHandler::MovePackets(id, packets);
     absl::MutexLock lock(&erase_mutex_);
     if (!pending_) {
@@ -13,7 +13,6 @@
 // limitations under the License.
 
 #include <functional>
-#include <list>
 #include <memory>
 #include <vector>
 
@@ -170,7 +169,7 @@ TEST_F(ImmediateInputStreamHandlerTest, EmptyPacketsNotReady) {
 // input streams has a packet available.
 TEST_F(ImmediateInputStreamHandlerTest, AnyPacketsReady) {
   Timestamp min_stream_timestamp;
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(Adopt(new std::string("packet 1")).At(Timestamp(10)));
   input_stream_handler_->AddPackets(name_to_id_["input_a"], packets);
   ASSERT_TRUE(input_stream_handler_->ScheduleInvocations(
@@ -182,7 +181,7 @@ TEST_F(ImmediateInputStreamHandlerTest, AnyPacketsReady) {
 // input streams has become done.
 TEST_F(ImmediateInputStreamHandlerTest, StreamDoneReady) {
   Timestamp min_stream_timestamp;
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
 
   // One packet arrives, ready for process.
   packets.push_back(Adopt(new std::string("packet 1")).At(Timestamp(10)));
@@ -235,7 +234,7 @@ TEST_F(ImmediateInputStreamHandlerTest, StreamDoneReady) {
 // This test checks that when any stream is done, the state is ready to close.
 TEST_F(ImmediateInputStreamHandlerTest, ReadyForClose) {
   Timestamp min_stream_timestamp;
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(Adopt(new std::string("packet 1")).At(Timestamp(1)));
   input_stream_handler_->AddPackets(name_to_id_["input_b"], packets);
   input_stream_handler_->SetNextTimestampBound(name_to_id_["input_b"],
@@ -279,7 +278,7 @@ TEST_F(ImmediateInputStreamHandlerTest, ProcessTimestampBounds) {
   const auto& input_b_id = name_to_id_["input_b"];
   const auto& input_c_id = name_to_id_["input_c"];
 
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(Adopt(new std::string("packet 1")).At(Timestamp(1)));
   input_stream_handler_->AddPackets(input_b_id, packets);
   input_stream_handler_->SetNextTimestampBound(input_b_id, Timestamp::Done());
@@ -365,7 +364,7 @@ TEST_F(ImmediateInputStreamHandlerTest,
   const auto& input_c_id = name_to_id_["input_c"];
 
   Timestamp min_stream_timestamp;
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(Adopt(new std::string("packet 1")).At(Timestamp(1)));
   input_stream_handler_->AddPackets(input_b_id, packets);
   ASSERT_TRUE(input_stream_handler_->ScheduleInvocations(
@@ -609,7 +608,7 @@ TEST_F(ImmediateInputStreamHandlerTest, VerifyPacketsReleaseOrder) {
 // stream handler and the associated input streams.
 TEST_F(ImmediateInputStreamHandlerTest, SimulateProcessNode) {
   Timestamp min_stream_timestamp;
-  std::list<Packet> packets;
+  std::vector<Packet> packets;
   packets.push_back(Adopt(new std::string("packet 1")).At(Timestamp(10)));
   packets.push_back(Adopt(new std::string("packet 2")).At(Timestamp(30)));
   packets.push_back(Adopt(new std::string("packet 3")).At(Timestamp(40)));
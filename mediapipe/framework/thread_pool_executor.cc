@@ -14,12 +14,14 @@
 
 #include "mediapipe/framework/thread_pool_executor.h"
 
+#include <set>
 #include <utility>
 
 #include "mediapipe/framework/port/canonical_errors.h"
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/status_builder.h"
 #include "mediapipe/framework/thread_pool_executor.pb.h"
+#include "mediapipe/framework/work_stealing_executor.h"
 #include "mediapipe/util/cpu_util.h"
 
 namespace mediapipe {
@@ -71,6 +73,34 @@ namespace mediapipe {
       break;
   }
 #endif
+  if (options.cpu_ids_size() > 0 && options.numa_node() >= 0) {
+    return ::mediapipe::InvalidArgumentError(
+        "At most one of cpu_ids and numa_node can be specified in "
+        "ThreadPoolExecutorOptions.");
+  }
+  if (options.cpu_ids_size() > 0) {
+    std::set<int> cpu_set;
+    for (int cpu : options.cpu_ids()) {
+      if (cpu < 0) {
+        return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+               << "Invalid CPU id in ThreadPoolExecutorOptions: " << cpu;
+      }
+      cpu_set.insert(cpu);
+    }
+    thread_options.set_cpu_set(cpu_set);
+  } else if (options.numa_node() >= 0) {
+    std::set<int> cpu_set = NumaNodeCoreIds(options.numa_node());
+    if (cpu_set.empty()) {
+      return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+             << "NUMA node " << options.numa_node()
+             << " in ThreadPoolExecutorOptions was not found.";
+    }
+    thread_options.set_cpu_set(cpu_set);
+  }
+  thread_options.set_pin_each_thread(options.pin_each_thread());
+  if (options.task_queue_mode() == ThreadPoolExecutorOptions::WORK_STEALING) {
+    return new WorkStealingExecutor(thread_options, options.num_threads());
+  }
   return new ThreadPoolExecutor(thread_options, options.num_threads());
 }
 
@@ -14,6 +14,8 @@
 
 #include "mediapipe/framework/validated_graph_config.h"
 
+#include <algorithm>
+
 #include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
@@ -422,6 +424,8 @@ std::string NodeTypeInfo::NodeTypeToString(NodeType node_type) {
 
   MP_RETURN_IF_ERROR(ValidateExecutors());
 
+  MP_RETURN_IF_ERROR(ComputeNodeFusion());
+
 #if !defined(MEDIAPIPE_MOBILE)
   VLOG(1) << "ValidatedGraphConfig produced canonical config:\n"
           << config_.DebugString();
@@ -957,6 +961,63 @@ NodeTypeInfo::NodeRef ValidatedGraphConfig::NodeForSorterIndex(
   return ::mediapipe::OkStatus();
 }
 
+int ValidatedGraphConfig::MaxInFlight(int node_index) const {
+  const int configured = config_.node(node_index).max_in_flight();
+  if (configured > 0) {
+    return configured;
+  }
+  return std::max(1, calculators_[node_index].Contract().GetMaxInFlight());
+}
+
+::mediapipe::Status ValidatedGraphConfig::ComputeNodeFusion() {
+  fused_predecessors_.assign(calculators_.size(), -1);
+  if (!config_.enable_node_fusion()) {
+    return ::mediapipe::OkStatus();
+  }
+  // The number of input streams reading each output stream.
+  std::vector<int> num_consumers(output_streams_.size(), 0);
+  for (const EdgeInfo& input_edge_info : input_streams_) {
+    if (input_edge_info.upstream >= 0) {
+      ++num_consumers[input_edge_info.upstream];
+    }
+  }
+  for (int node_index = 0; node_index < calculators_.size(); ++node_index) {
+    const NodeTypeInfo& node_type_info = calculators_[node_index];
+    const CalculatorGraphConfig::Node& node_config = config_.node(node_index);
+    if (node_config.disable_fusion() || MaxInFlight(node_index) > 1 ||
+        node_type_info.InputStreamTypes().NumEntries() != 1 ||
+        node_type_info.OutputStreamTypes().NumEntries() > 1) {
+      continue;
+    }
+    // The input stream handler is chosen as in CalculatorNode::Initialize.
+    std::string input_stream_handler =
+        node_config.input_stream_handler().has_input_stream_handler()
+            ? node_config.input_stream_handler().input_stream_handler()
+            : node_type_info.GetInputStreamHandler();
+    if (!input_stream_handler.empty() &&
+        input_stream_handler != "DefaultInputStreamHandler") {
+      continue;
+    }
+    const EdgeInfo& input_edge_info =
+        input_streams_[node_type_info.InputStreamBaseIndex()];
+    if (input_edge_info.back_edge || input_edge_info.upstream < 0 ||
+        num_consumers[input_edge_info.upstream] != 1) {
+      continue;
+    }
+    const NodeTypeInfo::NodeRef& upstream_node =
+        output_streams_[input_edge_info.upstream].parent_node;
+    if (upstream_node.type != NodeTypeInfo::NodeType::CALCULATOR ||
+        calculators_[upstream_node.index].OutputStreamTypes().NumEntries() !=
+            1 ||
+        config_.node(upstream_node.index).executor() !=
+            node_config.executor()) {
+      continue;
+    }
+    fused_predecessors_[node_index] = upstream_node.index;
+  }
+  return ::mediapipe::OkStatus();
+}
+
 // static
 bool ValidatedGraphConfig::IsReservedExecutorName(const std::string& name) {
   return name == "default" || name == "gpu" || absl::StartsWith(name, "__");
@@ -291,6 +291,20 @@ class ValidatedGraphConfig {
   // The namespace used for class name lookup.
   std::string Package() const { return config_.package(); }
 
+  // Returns the index of the calculator that the calculator at |node_index|
+  // is fused with, or -1 if it is not fused. A fused calculator runs on the
+  // thread of its predecessor, right after it. See
+  // CalculatorGraphConfig.enable_node_fusion.
+  int FusedPredecessor(int node_index) const {
+    return fused_predecessors_[node_index];
+  }
+
+  // Returns the maximum number of concurrent Process calls for the calculator
+  // at |node_index|. This is Node.max_in_flight if it is set, and otherwise
+  // the value declared by the calculator with
+  // CalculatorContract::SetMaxInFlight.
+  int MaxInFlight(int node_index) const;
+
   // Returns true if |name| is a reserved executor name.
   static bool IsReservedExecutorName(const std::string& name);
 
@@ -387,6 +401,9 @@ class ValidatedGraphConfig {
   // in an ExecutorConfig.
   ::mediapipe::Status ValidateExecutors();
 
+  // Computes fused_predecessors_ if the graph enables node fusion.
+  ::mediapipe::Status ComputeNodeFusion();
+
   bool initialized_ = false;
 
   CalculatorGraphConfig config_;
@@ -399,6 +416,9 @@ class ValidatedGraphConfig {
   // NodeTypeInfo's of generators and calculators, topologically sorted.
   std::vector<NodeTypeInfo*> sorted_nodes_;
 
+  // For each calculator, the index of the calculator it is fused with, or -1.
+  std::vector<int> fused_predecessors_;
+
   // Mapping from stream name to the output_streams_ index which produces it.
   std::map<std::string, int> stream_to_producer_;
   // Mapping from side packet name to the output_side_packets_ index
@@ -0,0 +1,200 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/work_stealing_executor.h"
+
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/thread_pool_executor.h"
+#include "mediapipe/framework/thread_pool_executor.pb.h"
+
+namespace mediapipe {
+
+namespace {
+
+// The executor and worker index of the current thread, if it is a worker
+// thread of a WorkStealingExecutor.
+thread_local const WorkStealingExecutor* current_executor = nullptr;
+thread_local int current_worker_index = -1;
+
+}  // namespace
+
+struct WorkStealingExecutor::Worker {
+  WorkStealingDeque<Task> tasks;
+  // State of the xorshift generator used to pick the first steal victim.
+  uint32_t victim_seed;
+};
+
+// static
+::mediapipe::StatusOr<Executor*> WorkStealingExecutor::Create(
+    const MediaPipeOptions& extendable_options) {
+  MediaPipeOptions options = extendable_options;
+  options.MutableExtension(ThreadPoolExecutorOptions::ext)
+      ->set_task_queue_mode(ThreadPoolExecutorOptions::WORK_STEALING);
+  return ThreadPoolExecutor::Create(options);
+}
+
+WorkStealingExecutor::WorkStealingExecutor(int num_threads)
+    : thread_pool_("mediapipe", num_threads) {
+  Start();
+}
+
+WorkStealingExecutor::WorkStealingExecutor(const ThreadOptions& thread_options,
+                                           int num_threads)
+    : thread_pool_(thread_options,
+                   thread_options.name_prefix().empty()
+                       ? "mediapipe"
+                       : thread_options.name_prefix(),
+                   num_threads) {
+  Start();
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+  VLOG(2) << "Terminating work-stealing executor.";
+  absl::MutexLock lock(&mutex_);
+  stopped_ = true;
+  condition_.SignalAll();
+  // The worker loops return once every queue is drained, after which
+  // thread_pool_ joins the threads.
+}
+
+void WorkStealingExecutor::Start() {
+  const int num_threads = thread_pool_.num_threads();
+  workers_.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    auto worker = absl::make_unique<Worker>();
+    worker->victim_seed = 2654435761u * (i + 1);
+    workers_.push_back(std::move(worker));
+  }
+  thread_pool_.StartWorkers();
+  // Each pool thread picks up exactly one of these loops and keeps it until
+  // the executor is stopped.
+  for (int i = 0; i < num_threads; ++i) {
+    thread_pool_.Schedule([this, i] { RunWorker(i); });
+  }
+  VLOG(2) << "Started work-stealing executor with " << num_threads
+          << " threads.";
+}
+
+void WorkStealingExecutor::Schedule(std::function<void()> task) {
+  Task* new_task = new Task(std::move(task));
+  if (current_executor == this) {
+    workers_[current_worker_index]->tasks.Push(new_task);
+    WakeOneWorker();
+    return;
+  }
+  absl::MutexLock lock(&mutex_);
+  injected_tasks_.push_back(new_task);
+  num_injected_.fetch_add(1, std::memory_order_relaxed);
+  condition_.Signal();
+}
+
+void WorkStealingExecutor::WakeOneWorker() {
+  // Pairs with the increment of num_sleeping_ in RunWorker: either the
+  // sleeping worker sees the new task, or we see the sleeping worker.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (num_sleeping_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  absl::MutexLock lock(&mutex_);
+  condition_.Signal();
+}
+
+void WorkStealingExecutor::RunWorker(int index) {
+  current_executor = this;
+  current_worker_index = index;
+  Worker* worker = workers_[index].get();
+  while (true) {
+    Task* task = FindTask(worker);
+    if (task != nullptr) {
+      (*task)();
+      delete task;
+      continue;
+    }
+    absl::MutexLock lock(&mutex_);
+    num_sleeping_.fetch_add(1, std::memory_order_seq_cst);
+    while (!stopped_ && !HasPendingTasks()) {
+      condition_.Wait(&mutex_);
+    }
+    num_sleeping_.fetch_sub(1, std::memory_order_relaxed);
+    if (stopped_ && !HasPendingTasks()) {
+      break;
+    }
+  }
+  current_executor = nullptr;
+  current_worker_index = -1;
+}
+
+WorkStealingExecutor::Task* WorkStealingExecutor::FindTask(Worker* worker) {
+  Task* task = worker->tasks.Pop();
+  if (task == nullptr && num_injected_.load(std::memory_order_relaxed) > 0) {
+    task = PopInjected();
+  }
+  if (task == nullptr) {
+    task = StealFromOthers(worker);
+  }
+  return task;
+}
+
+WorkStealingExecutor::Task* WorkStealingExecutor::PopInjected() {
+  absl::MutexLock lock(&mutex_);
+  if (injected_tasks_.empty()) {
+    return nullptr;
+  }
+  Task* task = injected_tasks_.front();
+  injected_tasks_.pop_front();
+  num_injected_.fetch_sub(1, std::memory_order_relaxed);
+  return task;
+}
+
+WorkStealingExecutor::Task* WorkStealingExecutor::StealFromOthers(
+    Worker* thief) {
+  const int num_workers = workers_.size();
+  if (num_workers <= 1) {
+    return nullptr;
+  }
+  uint32_t x = thief->victim_seed;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  thief->victim_seed = x;
+  const int start = x % num_workers;
+  for (int i = 0; i < num_workers; ++i) {
+    Worker* victim = workers_[(start + i) % num_workers].get();
+    if (victim == thief) continue;
+    Task* task = victim->tasks.Steal();
+    if (task != nullptr) {
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+bool WorkStealingExecutor::HasPendingTasks() {
+  if (!injected_tasks_.empty()) {
+    return true;
+  }
+  for (const auto& worker : workers_) {
+    if (!worker->tasks.Empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+REGISTER_EXECUTOR(WorkStealingExecutor);
+
+}  // namespace mediapipe
@@ -0,0 +1,106 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_WORK_STEALING_EXECUTOR_H_
+#define MEDIAPIPE_FRAMEWORK_WORK_STEALING_EXECUTOR_H_
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/deps/thread_options.h"
+#include "mediapipe/framework/deps/work_stealing_deque.h"
+#include "mediapipe/framework/executor.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+
+// A multithreaded executor in which every worker thread owns a lock-free
+// deque of tasks. A task scheduled from a worker thread is pushed onto that
+// worker's deque and popped again in LIFO order, which keeps the data of a
+// just-finished calculator hot in cache for its downstream node. Idle workers
+// steal from the other end of their peers' deques in FIFO order. Tasks
+// scheduled from threads outside the executor go through a shared injection
+// queue.
+//
+// Unlike ThreadPoolExecutor, the common path of scheduling and running a task
+// takes no lock. The executor can be selected with the "WorkStealingExecutor"
+// executor type or by setting task_queue_mode to WORK_STEALING in
+// ThreadPoolExecutorOptions.
+class WorkStealingExecutor : public Executor {
+ public:
+  static ::mediapipe::StatusOr<Executor*> Create(
+      const MediaPipeOptions& extendable_options);
+
+  explicit WorkStealingExecutor(int num_threads);
+  WorkStealingExecutor(const ThreadOptions& thread_options, int num_threads);
+  ~WorkStealingExecutor() override;
+  void Schedule(std::function<void()> task) override;
+
+  // For testing.
+  int num_threads() const { return thread_pool_.num_threads(); }
+
+ private:
+  using Task = std::function<void()>;
+  struct Worker;
+
+  // Starts the worker loops on the threads of thread_pool_.
+  void Start();
+
+  // Main loop of the worker with the given index.
+  void RunWorker(int index);
+
+  // Returns the next task for "worker": its own deque first, then the
+  // injection queue, then the deques of the other workers. Returns nullptr if
+  // no task was found.
+  Task* FindTask(Worker* worker);
+
+  // Takes a task from the injection queue, or returns nullptr.
+  Task* PopInjected();
+
+  // Tries to steal a task from any worker other than "thief".
+  Task* StealFromOthers(Worker* thief);
+
+  // Returns true if any queue appears to hold a task.
+  bool HasPendingTasks() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Wakes up one sleeping worker, if there is one.
+  void WakeOneWorker();
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  // Guards the injection queue and the sleep/wake protocol.
+  absl::Mutex mutex_;
+  absl::CondVar condition_;
+  std::deque<Task*> injected_tasks_ ABSL_GUARDED_BY(mutex_);
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  // Mirrors injected_tasks_.size() so that workers can poll it without the
+  // lock.
+  std::atomic<int> num_injected_{0};
+  // Number of workers blocked (or about to block) on condition_.
+  std::atomic<int> num_sleeping_{0};
+
+  // Hosts the worker loops and takes care of thread naming, priority and
+  // affinity. Declared last so that its destructor joins the worker threads
+  // before any other member is destroyed.
+  ::mediapipe::ThreadPool thread_pool_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_WORK_STEALING_EXECUTOR_H_
@@ -0,0 +1,129 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/work_stealing_executor.h"
+
+#include <atomic>
+#include <memory>
+
+#include "absl/synchronization/blocking_counter.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/thread_pool_executor.h"
+#include "mediapipe/framework/thread_pool_executor.pb.h"
+
+namespace mediapipe {
+namespace {
+
+// Schedules a binary tree of tasks with "depth" levels below the current
+// task. Every task decrements "counter" once.
+void ScheduleTree(Executor* executor, int depth,
+                  absl::BlockingCounter* counter) {
+  if (depth > 0) {
+    for (int i = 0; i < 2; ++i) {
+      executor->Schedule([executor, depth, counter] {
+        ScheduleTree(executor, depth - 1, counter);
+      });
+    }
+  }
+  counter->DecrementCount();
+}
+
+constexpr int TreeSize(int depth) { return (1 << (depth + 1)) - 1; }
+
+TEST(WorkStealingExecutorTest, CreateFromThreadPoolExecutorOptions) {
+  MediaPipeOptions extendable_options;
+  ThreadPoolExecutorOptions* options =
+      extendable_options.MutableExtension(ThreadPoolExecutorOptions::ext);
+  options->set_num_threads(3);
+  options->set_task_queue_mode(ThreadPoolExecutorOptions::WORK_STEALING);
+  auto status_or_executor = ThreadPoolExecutor::Create(extendable_options);
+  MP_ASSERT_OK(status_or_executor);
+  std::unique_ptr<Executor> executor(status_or_executor.ValueOrDie());
+  auto* work_stealing = dynamic_cast<WorkStealingExecutor*>(executor.get());
+  ASSERT_NE(nullptr, work_stealing);
+  EXPECT_EQ(3, work_stealing->num_threads());
+}
+
+TEST(WorkStealingExecutorTest, CreateRequiresNumThreads) {
+  MediaPipeOptions extendable_options;
+  extendable_options.MutableExtension(ThreadPoolExecutorOptions::ext);
+  EXPECT_FALSE(WorkStealingExecutor::Create(extendable_options).ok());
+}
+
+TEST(WorkStealingExecutorTest, RunsExternallyScheduledTasks) {
+  std::atomic<int> count(0);
+  {
+    WorkStealingExecutor executor(4);
+    for (int i = 0; i < 1000; ++i) {
+      executor.Schedule([&count] { ++count; });
+    }
+  }
+  // The destructor runs every pending task before returning.
+  EXPECT_EQ(1000, count.load());
+}
+
+TEST(WorkStealingExecutorTest, RunsNestedTasks) {
+  constexpr int kDepth = 12;
+  WorkStealingExecutor executor(4);
+  absl::BlockingCounter counter(TreeSize(kDepth));
+  executor.Schedule(
+      [&executor, &counter] { ScheduleTree(&executor, kDepth, &counter); });
+  counter.Wait();
+}
+
+TEST(WorkStealingExecutorTest, SingleThread) {
+  constexpr int kDepth = 8;
+  WorkStealingExecutor executor(1);
+  absl::BlockingCounter counter(TreeSize(kDepth));
+  executor.Schedule(
+      [&executor, &counter] { ScheduleTree(&executor, kDepth, &counter); });
+  counter.Wait();
+}
+
+// Compares task scheduling throughput of the shared-queue and the
+// work-stealing executors. Each iteration runs a tree of tiny tasks that are
+// scheduled from worker threads, which is how the scheduler hands downstream
+// nodes to the executor.
+void BM_ScheduleTaskTree(benchmark::State& state) {
+  constexpr int kDepth = 14;
+  MediaPipeOptions extendable_options;
+  ThreadPoolExecutorOptions* options =
+      extendable_options.MutableExtension(ThreadPoolExecutorOptions::ext);
+  options->set_num_threads(state.range(1));
+  options->set_task_queue_mode(
+      static_cast<ThreadPoolExecutorOptions::TaskQueueMode>(state.range(0)));
+  std::unique_ptr<Executor> executor(
+      ThreadPoolExecutor::Create(extendable_options).ValueOrDie());
+  for (auto _ : state) {
+    absl::BlockingCounter counter(TreeSize(kDepth));
+    Executor* executor_ptr = executor.get();
+    executor->Schedule([executor_ptr, &counter] {
+      ScheduleTree(executor_ptr, kDepth, &counter);
+    });
+    counter.Wait();
+  }
+  state.SetItemsProcessed(state.iterations() * TreeSize(kDepth));
+}
+BENCHMARK(BM_ScheduleTaskTree)
+    ->ArgNames({"mode", "threads"})
+    ->ArgsProduct({{ThreadPoolExecutorOptions::SHARED_QUEUE,
+                    ThreadPoolExecutorOptions::WORK_STEALING},
+                   {1, 4, 16, 32}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace mediapipe
@@ -28,6 +28,8 @@
 #include "absl/algorithm/container.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 #include "mediapipe/framework/port/canonical_errors.h"
 #include "mediapipe/framework/port/integral_types.h"
@@ -125,4 +127,42 @@ std::set<int> InferHigherCoreIds() {
   return InferLowerOrHigherCoreIds(/* lower= */ false);
 }
 
+std::set<int> NumaNodeCoreIds(int node) {
+  if (node < 0) {
+    return {};
+  }
+  std::ifstream file(
+      absl::Substitute("/sys/devices/system/node/node$0/cpulist", node));
+  std::string cpu_list;
+  if (!file.is_open() || !std::getline(file, cpu_list)) {
+    return {};
+  }
+  return ParseCpuList(cpu_list);
+}
+
+std::set<int> ParseCpuList(const std::string& cpu_list) {
+  std::set<int> cpus;
+  for (absl::string_view range :
+       absl::StrSplit(cpu_list, ',', absl::SkipWhitespace())) {
+    std::pair<absl::string_view, absl::string_view> bounds =
+        absl::StrSplit(range, absl::MaxSplits('-', 1));
+    int first, last;
+    if (!absl::SimpleAtoi(bounds.first, &first)) {
+      return {};
+    }
+    if (bounds.second.empty()) {
+      last = first;
+    } else if (!absl::SimpleAtoi(bounds.second, &last)) {
+      return {};
+    }
+    if (first < 0 || last < first) {
+      return {};
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.insert(cpu);
+    }
+  }
+  return cpus;
+}
+
 }  // namespace mediapipe.
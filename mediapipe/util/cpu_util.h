@@ -16,6 +16,7 @@
 #define MEDIAPIPE_UTIL_CPU_UTIL_H_
 
 #include <set>
+#include <string>
 
 namespace mediapipe {
 // Returns the number of CPU cores. Compatible with Android.
@@ -24,6 +25,12 @@ int NumCPUCores();
 std::set<int> InferLowerCoreIds();
 // Returns a set of inferred CPU ids of higher cores.
 std::set<int> InferHigherCoreIds();
+// Returns the CPU ids of NUMA node "node", or an empty set if the node does
+// not exist or NUMA topology is not available (only Linux exposes it).
+std::set<int> NumaNodeCoreIds(int node);
+// Parses a CPU list in the Linux sysfs format, such as "0-3,8,10-11". Returns
+// an empty set if "cpu_list" is malformed.
+std::set<int> ParseCpuList(const std::string& cpu_list);
 }  // namespace mediapipe
 
 #endif  // MEDIAPIPE_UTIL_CPU_UTIL_H_
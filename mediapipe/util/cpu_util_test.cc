@@ -0,0 +1,39 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/cpu_util.h"
+
+#include <set>
+
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(CpuUtilTest, ParseCpuList) {
+  EXPECT_EQ(std::set<int>({0, 1, 2, 3, 8, 10, 11}),
+            ParseCpuList("0-3,8,10-11"));
+  EXPECT_EQ(std::set<int>({5}), ParseCpuList("5"));
+  EXPECT_TRUE(ParseCpuList("").empty());
+  EXPECT_TRUE(ParseCpuList("3-1").empty());
+  EXPECT_TRUE(ParseCpuList("0,a").empty());
+}
+
+TEST(CpuUtilTest, NumaNodeCoreIds) {
+  EXPECT_TRUE(NumaNodeCoreIds(-1).empty());
+  EXPECT_TRUE(NumaNodeCoreIds(1 << 20).empty());
+}
+
+}  // namespace
+}  // namespace mediapipe
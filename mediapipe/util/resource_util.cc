@@ -15,6 +15,7 @@
 #include "mediapipe/util/resource_util.h"
 
 #include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/str_split.h"
 #include "mediapipe/framework/deps/file_path.h"
 #include "mediapipe/framework/port/file_helpers.h"
@@ -38,4 +39,13 @@ namespace mediapipe {
   return mediapipe::file::GetContents(path, output);
 }
 
+::mediapipe::StatusOr<std::unique_ptr<ResourceContents>> MapResourceContents(
+    const std::string& path) {
+  ASSIGN_OR_RETURN(std::string full_path, PathToResourceAsFile(path));
+  absl::string_view contents;
+  MP_RETURN_IF_ERROR(mediapipe::file::MapContents(full_path, &contents));
+  return absl::make_unique<ResourceContents>(
+      contents, [contents] { mediapipe::file::UnmapContents(contents); });
+}
+
 }  // namespace mediapipe
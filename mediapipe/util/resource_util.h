@@ -15,8 +15,11 @@
 #ifndef MEDIAPIPE_UTIL_RESOURCE_UTIL_H_
 #define MEDIAPIPE_UTIL_RESOURCE_UTIL_H_
 
+#include <functional>
+#include <memory>
 #include <string>
 
+#include "absl/strings/string_view.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/statusor.h"
 
@@ -47,6 +50,36 @@ namespace mediapipe {
 ::mediapipe::Status GetResourceContents(const std::string& path,
                                         std::string* output);
 
+// Read-only contents of a resource. The data stays valid for the lifetime of
+// this object.
+class ResourceContents {
+ public:
+  // Calls "release" on destruction to free the data.
+  ResourceContents(absl::string_view data, std::function<void()> release)
+      : data_(data), release_(std::move(release)) {}
+  ~ResourceContents() {
+    if (release_) release_();
+  }
+  ResourceContents(const ResourceContents&) = delete;
+  ResourceContents& operator=(const ResourceContents&) = delete;
+
+  absl::string_view data() const { return data_; }
+
+ private:
+  absl::string_view data_;
+  std::function<void()> release_;
+};
+
+// Provides the contents of a resource without reading them into memory, where
+// the platform allows: files are memory-mapped, so that their pages are loaded
+// on demand and shared between processes, and Android assets are accessed in
+// place. The search path is as in PathToResourceAsFile.
+//
+// Holding the result in a packet lets everything built on the contents, such
+// as a TfLite model, share them without copies.
+::mediapipe::StatusOr<std::unique_ptr<ResourceContents>> MapResourceContents(
+    const std::string& path);
+
 }  // namespace mediapipe
 
 #endif  // MEDIAPIPE_UTIL_RESOURCE_UTIL_H_
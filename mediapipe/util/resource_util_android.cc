@@ -12,8 +12,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <vector>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/match.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/singleton.h"
@@ -28,6 +34,45 @@ namespace {
     const std::string& path) {
   return Singleton<AssetManager>::get()->CachedFileFromAsset(path);
 }
+
+::mediapipe::StatusOr<std::unique_ptr<ResourceContents>> MapFile(
+    const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  RET_CHECK_GE(fd, 0) << "could not open file: " << path;
+  struct stat file_stat;
+  const bool stat_ok = fstat(fd, &file_stat) == 0;
+  const size_t size = stat_ok ? file_stat.st_size : 0;
+  void* data = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)
+                        : nullptr;
+  close(fd);
+  RET_CHECK(stat_ok && data != MAP_FAILED) << "could not map file: " << path;
+  return absl::make_unique<ResourceContents>(
+      absl::string_view(static_cast<const char*>(data), size),
+      [data, size] {
+        if (data) munmap(data, size);
+      });
+}
+
+// Returns the contents of an asset in place. Uncompressed assets, such as
+// models packaged with noCompress, are mapped from the APK without copies.
+::mediapipe::StatusOr<std::unique_ptr<ResourceContents>> MapAsset(
+    const std::string& path) {
+  AAssetManager* asset_manager =
+      Singleton<AssetManager>::get()->GetAssetManager();
+  RET_CHECK(asset_manager) << "asset manager not initialized";
+  AAsset* asset =
+      AAssetManager_open(asset_manager, path.c_str(), AASSET_MODE_BUFFER);
+  RET_CHECK(asset) << "could not open asset: " << path;
+  const void* data = AAsset_getBuffer(asset);
+  if (!data) {
+    AAsset_close(asset);
+    RET_CHECK_FAIL() << "could not read asset: " << path;
+  }
+  return absl::make_unique<ResourceContents>(
+      absl::string_view(static_cast<const char*>(data),
+                        AAsset_getLength(asset)),
+      [asset] { AAsset_close(asset); });
+}
 }  // namespace
 
 ::mediapipe::StatusOr<std::string> PathToResourceAsFile(
@@ -74,4 +119,25 @@ namespace {
   return ::mediapipe::OkStatus();
 }
 
+::mediapipe::StatusOr<std::unique_ptr<ResourceContents>> MapResourceContents(
+    const std::string& path) {
+  if (absl::StartsWith(path, "/")) {
+    return MapFile(path);
+  }
+
+  if (absl::StartsWith(path, "content://")) {
+    auto contents = std::make_shared<std::string>();
+    MP_RETURN_IF_ERROR(
+        Singleton<AssetManager>::get()->ReadContentUri(path, contents.get()));
+    return absl::make_unique<ResourceContents>(*contents, [contents] {});
+  }
+
+  // As in PathToResourceAsFile, fall back to the base name of the asset.
+  auto status_or_contents = MapAsset(path);
+  if (status_or_contents.ok()) return status_or_contents;
+  const size_t last_slash_idx = path.find_last_of("\\/");
+  if (last_slash_idx == std::string::npos) return status_or_contents;
+  return MapAsset(path.substr(last_slash_idx + 1));
+}
+
 }  // namespace mediapipe
@@ -17,7 +17,9 @@
 #include <fstream>
 #include <sstream>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/match.h"
+#include "mediapipe/framework/port/file_helpers.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/util/resource_util.h"
 
@@ -77,4 +79,13 @@ namespace {
   return ::mediapipe::OkStatus();
 }
 
+::mediapipe::StatusOr<std::unique_ptr<ResourceContents>> MapResourceContents(
+    const std::string& path) {
+  ASSIGN_OR_RETURN(std::string full_path, PathToResourceAsFile(path));
+  absl::string_view contents;
+  MP_RETURN_IF_ERROR(file::MapContents(full_path, &contents));
+  return absl::make_unique<ResourceContents>(
+      contents, [contents] { file::UnmapContents(contents); });
+}
+
 }  // namespace mediapipe
@@ -0,0 +1,59 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/resource_util.h"
+
+#include <cstdlib>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(ResourceUtilTest, MapsResourceContents) {
+  const std::string path =
+      absl::StrCat(getenv("TEST_TMPDIR"), "/mapped_resource");
+  const std::string contents(10000, 'x');
+  MP_ASSERT_OK(file::SetContents(path, contents));
+
+  auto status_or_mapped = MapResourceContents(path);
+  MP_ASSERT_OK(status_or_mapped);
+  EXPECT_EQ(contents, status_or_mapped.ValueOrDie()->data());
+
+  std::string read_contents;
+  MP_ASSERT_OK(GetResourceContents(path, &read_contents));
+  EXPECT_EQ(read_contents, status_or_mapped.ValueOrDie()->data());
+}
+
+TEST(ResourceUtilTest, MapsEmptyResource) {
+  const std::string path = absl::StrCat(getenv("TEST_TMPDIR"), "/empty");
+  MP_ASSERT_OK(file::SetContents(path, ""));
+  auto status_or_mapped = MapResourceContents(path);
+  MP_ASSERT_OK(status_or_mapped);
+  EXPECT_TRUE(status_or_mapped.ValueOrDie()->data().empty());
+}
+
+TEST(ResourceUtilTest, FailsOnMissingResource) {
+  EXPECT_FALSE(
+      MapResourceContents(absl::StrCat(getenv("TEST_TMPDIR"), "/missing"))
+          .ok());
+}
+
+}  // namespace
+}  // namespace mediapipe
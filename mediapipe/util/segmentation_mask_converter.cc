@@ -0,0 +1,232 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/segmentation_mask_converter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+namespace {
+
+// std::exp and std::log are library calls, which keep the per-pixel loops
+// from being vectorized. FastExp has a relative error of about 1.2e-5 and
+// FastLog2 an absolute error of about 1.7e-5, far below the resolution of an
+// 8-bit mask.
+
+// The range of arguments of FastExp, where e^x is a normal float.
+constexpr float kMaxExpArg = 87.0f;
+
+// Returns e^x for x in [-kMaxExpArg, kMaxExpArg].
+inline float FastExp(float x) {
+  // 2^y = 2^i * 2^f, where i = floor(y) and f is in [0, 1). Adding 127 makes
+  // y positive, so that truncation is floor, and biases the exponent.
+  const float y = x * 1.44269504f + 127.0f;
+  const int32 i = static_cast<int32>(y);
+  const float f = y - i;
+  const float fraction =
+      1.0f +
+      f * (0.693043997f +
+           f * (0.241282777f + f * (0.0522407063f + f * 0.0134266699f)));
+  const int32 exponent_bits = i << 23;
+  float exponent;
+  std::memcpy(&exponent, &exponent_bits, sizeof(exponent));
+  return exponent * fraction;
+}
+
+// Returns log2(x) for a positive normal x.
+inline float FastLog2(float x) {
+  int32 bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  const float exponent = static_cast<float>((bits >> 23) - 127);
+  // The mantissa, as a float in [1, 2).
+  const int32 mantissa_bits = (bits & 0x007FFFFF) | 0x3F800000;
+  float mantissa;
+  std::memcpy(&mantissa, &mantissa_bits, sizeof(mantissa));
+  const float t = mantissa - 1.0f;
+  return exponent +
+         t * (1.44187984f +
+              t * (-0.708864546f +
+                   t * (0.415243258f +
+                        t * (-0.193513454f + t * 0.045266897f))));
+}
+
+}  // namespace
+
+// Follows cv::resize with cv::INTER_LINEAR, which aligns the centers of the
+// corner pixels and clamps samples past the edges.
+SegmentationMaskConverter::LinearTaps::LinearTaps(int src_size, int dst_size)
+    : first(dst_size), second(dst_size), weight(dst_size) {
+  const float scale = static_cast<float>(src_size) / std::max(dst_size, 1);
+  for (int i = 0; i < dst_size; ++i) {
+    const float src = std::max((i + 0.5f) * scale - 0.5f, 0.0f);
+    const int index = std::min(static_cast<int>(src), src_size - 1);
+    first[i] = index;
+    second[i] = std::min(index + 1, src_size - 1);
+    weight[i] = index == src_size - 1 ? 0.0f : src - index;
+  }
+}
+
+SegmentationMaskConverter::SegmentationMaskConverter(
+    const float* tensor, int tensor_width, int tensor_height,
+    const ImageFrame* prev_mask, const Options& options, ImageFrame* output)
+    : tensor_(tensor),
+      tensor_width_(tensor_width),
+      tensor_height_(tensor_height),
+      prev_mask_(prev_mask),
+      options_(options),
+      output_(output),
+      columns_(tensor_width, output->Width()),
+      rows_(tensor_height, output->Height()),
+      prev_columns_(prev_mask ? prev_mask->Width() : 1,
+                    prev_mask ? tensor_width : 0),
+      prev_rows_(prev_mask ? prev_mask->Height() : 1,
+                 prev_mask ? tensor_height : 0) {
+  CHECK_EQ(output->Format(), ImageFormat::SRGBA);
+  CHECK(options.output_layer_index == 0 || options.output_layer_index == 1);
+  if (prev_mask) {
+    CHECK_EQ(prev_mask->ByteDepth(), 1);
+  }
+}
+
+// Values are clamped in loops of their own, which store them, because GCC
+// does not vectorize loops that go on to compute with clamped values.
+void SegmentationMaskConverter::ComputeMaskRow(int row, float* scratch,
+                                               float* mask_row) const {
+  // With two classes, the softmax is a sigmoid of the difference between the
+  // logits.
+  const float* logits = tensor_ + 2 * tensor_width_ * row;
+  const int index = options_.output_layer_index;
+  for (int x = 0; x < tensor_width_; ++x) {
+    mask_row[x] = std::min(
+        std::max(logits[2 * x + 1 - index] - logits[2 * x + index],
+                 -kMaxExpArg),
+        kMaxExpArg);
+  }
+  for (int x = 0; x < tensor_width_; ++x) {
+    mask_row[x] = 1.0f / (1.0f + FastExp(mask_row[x]));
+  }
+  if (!prev_mask_) {
+    return;
+  }
+
+  // Resample the first channel of the previous mask to the tensor size.
+  float* prev_row = scratch;
+  const int channels = prev_mask_->NumberOfChannels();
+  const uint8* prev_data = prev_mask_->PixelData();
+  const uint8* prev_first =
+      prev_data + prev_rows_.first[row] * prev_mask_->WidthStep();
+  const uint8* prev_second =
+      prev_data + prev_rows_.second[row] * prev_mask_->WidthStep();
+  const float row_weight = prev_rows_.weight[row];
+  for (int x = 0; x < tensor_width_; ++x) {
+    const int first = prev_columns_.first[x] * channels;
+    const int second = prev_columns_.second[x] * channels;
+    const float weight = prev_columns_.weight[x];
+    const float top =
+        prev_first[first] + weight * (prev_first[second] - prev_first[first]);
+    const float bottom = prev_second[first] +
+                         weight * (prev_second[second] - prev_second[first]);
+    prev_row[x] = (top + row_weight * (bottom - top)) * (1.0f / 255.0f);
+  }
+
+  // Combine the previous value with the current one, using the squared
+  // uncertainty as the mixing coefficient.
+  constexpr float kEps = 0.001f;
+  float* alpha_row = scratch + tensor_width_;
+  for (int x = 0; x < tensor_width_; ++x) {
+    const float value = mask_row[x];
+    alpha_row[x] = std::min(
+        std::max(1.0f + value * FastLog2(value + kEps) +
+                     (1.0f - value) * FastLog2(1.0f - value + kEps),
+                 0.0f),
+        1.0f);
+  }
+  // Clamping the ratio keeps the mask in [0, 1].
+  const float ratio =
+      std::min(std::max(options_.combine_with_previous_ratio, 0.0f), 1.0f);
+  for (int x = 0; x < tensor_width_; ++x) {
+    const float value = mask_row[x];
+    float alpha = alpha_row[x];
+    // Equivalent to: a = 1 - (1 - a) * (1 - a);  (squaring the uncertainty)
+    alpha *= 2.0f - alpha;
+    const float mixed = value * alpha + prev_row[x] * (1.0f - alpha);
+    mask_row[x] = mixed * ratio + (1.0f - ratio) * value;
+  }
+}
+
+void SegmentationMaskConverter::ConvertRows(int begin_row, int end_row) const {
+  // Two cached rows of the tensor-sized mask, the vertically blended row, and
+  // two rows of scratch space for ComputeMaskRow.
+  std::vector<float> buffer(5 * tensor_width_);
+  float* cached[2] = {buffer.data(), buffer.data() + tensor_width_};
+  int cached_row[2] = {-1, -1};
+  float* blended = buffer.data() + 2 * tensor_width_;
+  float* scratch = buffer.data() + 3 * tensor_width_;
+  // Makes cached[slot] hold mask row "row", reusing a cached row if possible.
+  auto load_row = [&](int slot, int row) {
+    if (cached_row[slot] == row) {
+      return;
+    }
+    if (cached_row[1 - slot] == row) {
+      std::swap(cached[0], cached[1]);
+      std::swap(cached_row[0], cached_row[1]);
+      return;
+    }
+    ComputeMaskRow(row, scratch, cached[slot]);
+    cached_row[slot] = row;
+  };
+
+  const int width = output_->Width();
+  for (int y = begin_row; y < end_row; ++y) {
+    int first = rows_.first[y];
+    int second = rows_.second[y];
+    if (options_.flip_vertically) {
+      first = tensor_height_ - 1 - first;
+      second = tensor_height_ - 1 - second;
+    }
+    const float row_weight = rows_.weight[y];
+    load_row(0, first);
+    const float* mask_row = cached[0];
+    // The second row is only needed, and only computed, if it has weight.
+    if (row_weight != 0.0f) {
+      load_row(1, second);
+      const float* top = cached[0];
+      const float* bottom = cached[1];
+      for (int x = 0; x < tensor_width_; ++x) {
+        blended[x] = top[x] + row_weight * (bottom[x] - top[x]);
+      }
+      mask_row = blended;
+    }
+
+    // Set both R and A channels for convenience.
+    uint8* pixel = output_->MutablePixelData() + y * output_->WidthStep();
+    for (int x = 0; x < width; ++x) {
+      const float left = mask_row[columns_.first[x]];
+      const float right = mask_row[columns_.second[x]];
+      const float value = left + columns_.weight[x] * (right - left);
+      const uint8 mask_value = static_cast<uint8>(value * 255.0f + 0.5f);
+      pixel[4 * x] = mask_value;
+      pixel[4 * x + 1] = 0;
+      pixel[4 * x + 2] = 0;
+      pixel[4 * x + 3] = mask_value;
+    }
+  }
+}
+
+}  // namespace mediapipe
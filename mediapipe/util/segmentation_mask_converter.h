@@ -0,0 +1,91 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_UTIL_SEGMENTATION_MASK_CONVERTER_H_
+#define MEDIAPIPE_UTIL_SEGMENTATION_MASK_CONVERTER_H_
+
+#include <vector>
+
+#include "mediapipe/framework/formats/image_frame.h"
+
+namespace mediapipe {
+
+// Converts the output of a two-class segmentation model, such as the hair and
+// selfie segmentation models, to a mask on the CPU.
+//
+// The tensor holds "tensor_height" rows of "tensor_width" pairs of logits.
+// Each mask value is the softmax probability of the class
+// "output_layer_index". When there is a previous mask, the value is blended
+// with it where the model is uncertain, which keeps the mask stable from
+// frame to frame. The mask is flipped vertically if requested, upsampled
+// bilinearly to the dimensions of the output, and written, scaled to
+// [0, 255], to the R and A channels of an SRGBA output.
+//
+// All of this happens in a single pass over the output rows: the rows of the
+// tensor-sized mask are computed as the bilinear upsampling needs them, and
+// are never stored as a whole. The per-pixel loops are branch-free so that
+// the compiler can vectorize them.
+class SegmentationMaskConverter {
+ public:
+  struct Options {
+    // The class whose probability is the mask value; 0 or 1.
+    int output_layer_index = 1;
+    // How much to use the previous mask; range [0-1].
+    float combine_with_previous_ratio = 1.0f;
+    // Whether to flip the mask along the y-axis.
+    bool flip_vertically = false;
+  };
+
+  // "prev_mask" may be null, or an 8-bit image of any size whose first
+  // channel is the previous mask value. "output" must be SRGBA. None of the
+  // arguments are copied, and they must outlive the converter.
+  SegmentationMaskConverter(const float* tensor, int tensor_width,
+                            int tensor_height, const ImageFrame* prev_mask,
+                            const Options& options, ImageFrame* output);
+
+  // Writes rows [begin_row, end_row) of the output. Calls for disjoint ranges
+  // may run concurrently.
+  void ConvertRows(int begin_row, int end_row) const;
+
+ private:
+  // The two source samples, and the weight of the second, that bilinear
+  // resampling blends into each destination sample along one axis.
+  struct LinearTaps {
+    LinearTaps(int src_size, int dst_size);
+    std::vector<int> first;
+    std::vector<int> second;
+    std::vector<float> weight;
+  };
+
+  // Computes row "row" of the tensor-sized mask, before flipping, into
+  // "mask_row". "scratch" has room for 2 * tensor_width_ values.
+  void ComputeMaskRow(int row, float* scratch, float* mask_row) const;
+
+  const float* tensor_;
+  const int tensor_width_;
+  const int tensor_height_;
+  const ImageFrame* prev_mask_;
+  const Options options_;
+  ImageFrame* output_;
+  // Output to tensor-sized mask.
+  const LinearTaps columns_;
+  const LinearTaps rows_;
+  // Tensor-sized mask to previous mask.
+  const LinearTaps prev_columns_;
+  const LinearTaps prev_rows_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_SEGMENTATION_MASK_CONVERTER_H_
@@ -0,0 +1,206 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/segmentation_mask_converter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+namespace {
+
+std::vector<float> RandomLogits(int width, int height) {
+  std::mt19937 rng(width * 1000 + height);
+  std::uniform_real_distribution<float> logit(-8.0f, 8.0f);
+  std::vector<float> logits(2 * width * height);
+  for (float& value : logits) value = logit(rng);
+  return logits;
+}
+
+void FillRandom(ImageFrame* image) {
+  std::mt19937 rng(image->Width());
+  for (int y = 0; y < image->Height(); ++y) {
+    uint8* row = image->MutablePixelData() + y * image->WidthStep();
+    for (int x = 0; x < image->Width() * image->NumberOfChannels(); ++x) {
+      row[x] = rng() % 256;
+    }
+  }
+}
+
+// Bilinearly samples "value(x, y)", defined on a "src_width" x "src_height"
+// grid, at (x, y) of a "dst_width" x "dst_height" grid, like cv::resize.
+template <typename ValueFn>
+double Sample(const ValueFn& value, int src_width, int src_height,
+              int dst_width, int dst_height, int x, int y) {
+  auto taps = [](int src_size, int dst_size, int i, int* first, int* second,
+                 double* weight) {
+    double src = std::max((i + 0.5) * src_size / dst_size - 0.5, 0.0);
+    *first = std::min(static_cast<int>(src), src_size - 1);
+    *second = std::min(*first + 1, src_size - 1);
+    *weight = *first == src_size - 1 ? 0.0 : src - *first;
+  };
+  int x0, x1, y0, y1;
+  double wx, wy;
+  taps(src_width, dst_width, x, &x0, &x1, &wx);
+  taps(src_height, dst_height, y, &y0, &y1, &wy);
+  const double top = value(x0, y0) * (1 - wx) + value(x1, y0) * wx;
+  const double bottom = value(x0, y1) * (1 - wx) + value(x1, y1) * wx;
+  return top * (1 - wy) + bottom * wy;
+}
+
+// A straightforward version of the conversion, in double precision.
+std::vector<double> ReferenceMask(
+    const std::vector<float>& logits, int width, int height,
+    const ImageFrame* prev_mask,
+    const SegmentationMaskConverter::Options& options, int output_width,
+    int output_height) {
+  auto prev_value = [prev_mask](int x, int y) {
+    return prev_mask->PixelData()[y * prev_mask->WidthStep() +
+                                  x * prev_mask->NumberOfChannels()] /
+           255.0;
+  };
+  std::vector<double> small_mask(width * height);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const float* pixel = &logits[2 * (y * width + x)];
+      double value =
+          std::exp(pixel[options.output_layer_index]) /
+          (std::exp(static_cast<double>(pixel[0])) + std::exp(pixel[1]));
+      if (prev_mask) {
+        const double prev =
+            Sample(prev_value, prev_mask->Width(), prev_mask->Height(), width,
+                   height, x, y);
+        double alpha = 1.0 + (value * std::log(value + 0.001) +
+                              (1 - value) * std::log(1 - value + 0.001)) /
+                                 std::log(2.0);
+        alpha = std::min(std::max(alpha, 0.0), 1.0);
+        alpha *= 2 - alpha;
+        const double mixed = value * alpha + prev * (1 - alpha);
+        value = mixed * options.combine_with_previous_ratio +
+                (1 - options.combine_with_previous_ratio) * value;
+      }
+      const int row = options.flip_vertically ? height - 1 - y : y;
+      small_mask[row * width + x] = value;
+    }
+  }
+  auto small_value = [&small_mask, width](int x, int y) {
+    return small_mask[y * width + x];
+  };
+  std::vector<double> mask(output_width * output_height);
+  for (int y = 0; y < output_height; ++y) {
+    for (int x = 0; x < output_width; ++x) {
+      mask[y * output_width + x] =
+          255.0 * Sample(small_value, width, height, output_width,
+                         output_height, x, y);
+    }
+  }
+  return mask;
+}
+
+void ExpectMatchesReference(const std::vector<float>& logits, int width,
+                            int height, const ImageFrame* prev_mask,
+                            const SegmentationMaskConverter::Options& options,
+                            int output_width, int output_height) {
+  ImageFrame output(ImageFormat::SRGBA, output_width, output_height);
+  SegmentationMaskConverter(logits.data(), width, height, prev_mask, options,
+                            &output)
+      .ConvertRows(0, output_height);
+  const std::vector<double> expected = ReferenceMask(
+      logits, width, height, prev_mask, options, output_width, output_height);
+  for (int y = 0; y < output_height; ++y) {
+    const uint8* row = output.PixelData() + y * output.WidthStep();
+    for (int x = 0; x < output_width; ++x) {
+      const double value = expected[y * output_width + x];
+      EXPECT_LE(std::abs(row[4 * x] - value), 1.0) << x << ", " << y;
+      EXPECT_EQ(0, row[4 * x + 1]);
+      EXPECT_EQ(0, row[4 * x + 2]);
+      EXPECT_EQ(row[4 * x], row[4 * x + 3]);
+    }
+  }
+}
+
+TEST(SegmentationMaskConverterTest, MatchesReference) {
+  const std::vector<float> logits = RandomLogits(7, 5);
+  SegmentationMaskConverter::Options options;
+  ExpectMatchesReference(logits, 7, 5, nullptr, options, 7, 5);
+  ExpectMatchesReference(logits, 7, 5, nullptr, options, 19, 11);
+  ExpectMatchesReference(logits, 7, 5, nullptr, options, 3, 2);
+  options.output_layer_index = 0;
+  options.flip_vertically = true;
+  ExpectMatchesReference(logits, 7, 5, nullptr, options, 19, 11);
+}
+
+TEST(SegmentationMaskConverterTest, BlendsPreviousMask) {
+  const std::vector<float> logits = RandomLogits(7, 5);
+  SegmentationMaskConverter::Options options;
+  ImageFrame gray_mask(ImageFormat::GRAY8, 13, 9);
+  FillRandom(&gray_mask);
+  ExpectMatchesReference(logits, 7, 5, &gray_mask, options, 13, 9);
+  ImageFrame rgba_mask(ImageFormat::SRGBA, 4, 3);
+  FillRandom(&rgba_mask);
+  options.combine_with_previous_ratio = 0.6f;
+  options.flip_vertically = true;
+  ExpectMatchesReference(logits, 7, 5, &rgba_mask, options, 13, 9);
+}
+
+TEST(SegmentationMaskConverterTest, ConvertsRowRangesIndependently) {
+  const std::vector<float> logits = RandomLogits(7, 5);
+  ImageFrame prev_mask(ImageFormat::GRAY8, 13, 9);
+  FillRandom(&prev_mask);
+  SegmentationMaskConverter::Options options;
+  ImageFrame whole(ImageFormat::SRGBA, 13, 9);
+  SegmentationMaskConverter(logits.data(), 7, 5, &prev_mask, options, &whole)
+      .ConvertRows(0, 9);
+  ImageFrame parts(ImageFormat::SRGBA, 13, 9);
+  SegmentationMaskConverter converter(logits.data(), 7, 5, &prev_mask, options,
+                                      &parts);
+  converter.ConvertRows(4, 9);
+  converter.ConvertRows(0, 4);
+  for (int y = 0; y < 9; ++y) {
+    EXPECT_EQ(0, std::memcmp(whole.PixelData() + y * whole.WidthStep(),
+                             parts.PixelData() + y * parts.WidthStep(),
+                             4 * 13))
+        << y;
+  }
+}
+
+// Converts a 512x512 hair or selfie segmentation tensor to a 512x512 mask.
+void BM_ConvertSegmentationMask(benchmark::State& state) {
+  constexpr int kSize = 512;
+  const bool use_prev_mask = state.range(0);
+  const std::vector<float> logits = RandomLogits(kSize, kSize);
+  ImageFrame prev_mask(ImageFormat::SRGBA, kSize, kSize);
+  FillRandom(&prev_mask);
+  ImageFrame output(ImageFormat::SRGBA, kSize, kSize);
+  SegmentationMaskConverter::Options options;
+  for (auto _ : state) {
+    SegmentationMaskConverter(logits.data(), kSize, kSize,
+                              use_prev_mask ? &prev_mask : nullptr, options,
+                              &output)
+        .ConvertRows(0, kSize);
+    benchmark::DoNotOptimize(output.MutablePixelData());
+  }
+}
+BENCHMARK(BM_ConvertSegmentationMask)->ArgName("prev_mask")->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace mediapipe
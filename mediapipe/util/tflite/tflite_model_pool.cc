@@ -0,0 +1,238 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tflite/tflite_model_pool.h"
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/util/cpu_util.h"
+#include "mediapipe/util/resource_util.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+#include "tensorflow/lite/kernels/register.h"
+
+namespace mediapipe {
+
+const GraphService<TfLiteModelPool> kTfLiteModelPoolService(
+    "kTfLiteModelPoolService");
+
+namespace {
+
+using TfLiteDelegatePtr =
+    std::unique_ptr<TfLiteDelegate, std::function<void(TfLiteDelegate*)>>;
+
+// Interpreters are interchangeable if they have the same key.
+using InterpreterKey = std::tuple<std::string, int, bool>;
+
+struct PooledInterpreter {
+  InterpreterKey key;
+  int num_threads;
+  // Declared in this order so that the interpreter is destroyed first.
+  std::shared_ptr<tflite::FlatBufferModel> model;
+  TfLiteDelegatePtr delegate;
+  std::unique_ptr<tflite::Interpreter> interpreter;
+};
+
+::mediapipe::Status InitInterpreter(PooledInterpreter* pooled,
+                                    bool use_xnnpack) {
+  tflite::ops::builtin::BuiltinOpResolver op_resolver;
+  tflite::InterpreterBuilder(*pooled->model, op_resolver)(
+      &pooled->interpreter);
+  RET_CHECK(pooled->interpreter);
+  pooled->interpreter->SetNumThreads(pooled->num_threads);
+  RET_CHECK_EQ(pooled->interpreter->AllocateTensors(), kTfLiteOk);
+  if (use_xnnpack) {
+    TfLiteXNNPackDelegateOptions xnnpack_opts{};
+    xnnpack_opts.num_threads = pooled->num_threads;
+    pooled->delegate =
+        TfLiteDelegatePtr(TfLiteXNNPackDelegateCreate(&xnnpack_opts),
+                          &TfLiteXNNPackDelegateDelete);
+    RET_CHECK_EQ(
+        pooled->interpreter->ModifyGraphWithDelegate(pooled->delegate.get()),
+        kTfLiteOk);
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace
+
+class TfLiteModelPool::Shared {
+ public:
+  explicit Shared(int max_threads) : max_threads_(max_threads) {}
+
+  ::mediapipe::StatusOr<std::shared_ptr<tflite::FlatBufferModel>> GetModel(
+      const std::string& path) {
+    absl::MutexLock lock(&models_mutex_);
+    auto it = models_.find(path);
+    if (it != models_.end()) return it->second;
+    // The model is built on the mapped resource, without copying it.
+    ASSIGN_OR_RETURN(std::shared_ptr<ResourceContents> contents,
+                     MapResourceContents(path));
+    std::shared_ptr<tflite::FlatBufferModel> model(
+        tflite::FlatBufferModel::BuildFromBuffer(contents->data().data(),
+                                                 contents->data().size())
+            .release(),
+        [contents](tflite::FlatBufferModel* model) { delete model; });
+    RET_CHECK(model) << "Failed to load model from path " << path;
+    models_[path] = model;
+    return model;
+  }
+
+  // Takes an idle interpreter with the given key, or reserves the threads for
+  // a new one and returns null. Waits while the thread budget is used up.
+  std::unique_ptr<PooledInterpreter> TakeOrReserve(const InterpreterKey& key,
+                                                   int num_threads) {
+    std::vector<std::unique_ptr<PooledInterpreter>> evicted;
+    absl::MutexLock lock(&mutex_);
+    while (true) {
+      auto it = std::find_if(
+          idle_.begin(), idle_.end(),
+          [&key](const std::unique_ptr<PooledInterpreter>& pooled) {
+            return pooled->key == key;
+          });
+      if (it != idle_.end()) {
+        std::unique_ptr<PooledInterpreter> pooled = std::move(*it);
+        idle_.erase(it);
+        return pooled;
+      }
+      if (used_threads_ + num_threads <= max_threads_) {
+        used_threads_ += num_threads;
+        ++interpreter_count_;
+        return nullptr;
+      }
+      if (!idle_.empty()) {
+        // Make room by destroying the least recently used idle interpreter.
+        used_threads_ -= idle_.back()->num_threads;
+        --interpreter_count_;
+        evicted.push_back(std::move(idle_.back()));
+        idle_.pop_back();
+        continue;
+      }
+      cond_.Wait(&mutex_);
+    }
+  }
+
+  // Releases the threads reserved for an interpreter that was not created.
+  void Unreserve(int num_threads) {
+    absl::MutexLock lock(&mutex_);
+    used_threads_ -= num_threads;
+    --interpreter_count_;
+    cond_.SignalAll();
+  }
+
+  void Return(std::unique_ptr<PooledInterpreter> pooled) {
+    absl::MutexLock lock(&mutex_);
+    idle_.push_front(std::move(pooled));
+    cond_.SignalAll();
+  }
+
+  int used_threads() {
+    absl::MutexLock lock(&mutex_);
+    return used_threads_;
+  }
+
+  int interpreter_count() {
+    absl::MutexLock lock(&mutex_);
+    return interpreter_count_;
+  }
+
+  int idle_interpreter_count() {
+    absl::MutexLock lock(&mutex_);
+    return idle_.size();
+  }
+
+ private:
+  const int max_threads_;
+
+  absl::Mutex models_mutex_;
+  std::map<std::string, std::shared_ptr<tflite::FlatBufferModel>> models_
+      ABSL_GUARDED_BY(models_mutex_);
+
+  absl::Mutex mutex_;
+  absl::CondVar cond_;
+  // Idle interpreters, most recently returned first.
+  std::list<std::unique_ptr<PooledInterpreter>> idle_ ABSL_GUARDED_BY(mutex_);
+  // Threads and count of all interpreters, idle or lent.
+  int used_threads_ ABSL_GUARDED_BY(mutex_) = 0;
+  int interpreter_count_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+TfLiteModelPool::TfLiteModelPool() : TfLiteModelPool(NumCPUCores()) {}
+
+TfLiteModelPool::TfLiteModelPool(int max_threads)
+    : max_threads_(std::max(1, max_threads)),
+      shared_(std::make_shared<Shared>(max_threads_)) {}
+
+TfLiteModelPool::~TfLiteModelPool() = default;
+
+::mediapipe::StatusOr<std::shared_ptr<tflite::FlatBufferModel>>
+TfLiteModelPool::GetModel(const std::string& path) {
+  return shared_->GetModel(path);
+}
+
+::mediapipe::StatusOr<TfLiteModelPool::InterpreterHandle>
+TfLiteModelPool::AcquireInterpreter(const std::string& path,
+                                    const InterpreterOptions& options) {
+  const int num_threads =
+      std::min(std::max(1, options.num_threads), max_threads_);
+  const InterpreterKey key(path, num_threads, options.use_xnnpack);
+  std::unique_ptr<PooledInterpreter> pooled =
+      shared_->TakeOrReserve(key, num_threads);
+  if (!pooled) {
+    pooled = absl::make_unique<PooledInterpreter>();
+    pooled->key = key;
+    pooled->num_threads = num_threads;
+    auto status_or_model = shared_->GetModel(path);
+    ::mediapipe::Status status = status_or_model.status();
+    if (status.ok()) {
+      pooled->model = std::move(status_or_model).ValueOrDie();
+      status = InitInterpreter(pooled.get(), options.use_xnnpack);
+    }
+    if (!status.ok()) {
+      shared_->Unreserve(num_threads);
+      return status;
+    }
+  }
+
+  tflite::Interpreter* interpreter = pooled->interpreter.get();
+  std::weak_ptr<Shared> weak_shared(shared_);
+  PooledInterpreter* released = pooled.release();
+  return InterpreterHandle(
+      interpreter, [weak_shared, released](tflite::Interpreter*) {
+        std::unique_ptr<PooledInterpreter> pooled(released);
+        if (auto shared = weak_shared.lock()) {
+          shared->Return(std::move(pooled));
+        }
+      });
+}
+
+int TfLiteModelPool::used_threads() { return shared_->used_threads(); }
+
+int TfLiteModelPool::interpreter_count() {
+  return shared_->interpreter_count();
+}
+
+int TfLiteModelPool::idle_interpreter_count() {
+  return shared_->idle_interpreter_count();
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,102 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_UTIL_TFLITE_TFLITE_MODEL_POOL_H_
+#define MEDIAPIPE_UTIL_TFLITE_TFLITE_MODEL_POOL_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "mediapipe/framework/graph_service.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/model.h"
+
+namespace mediapipe {
+
+// Shares TfLite models and CPU interpreters between graphs. Each model file is
+// memory-mapped once, and its read-only weights are shared by all of its
+// interpreters. Interpreters are lent out for a single inference and then
+// returned, so that many graphs running the same model need only as many
+// interpreters as run concurrently.
+//
+// The interpreters of all models together use at most max_threads() threads.
+// When an interpreter is needed and the budget is used up, idle interpreters
+// of other configurations are destroyed to make room; if there are none,
+// AcquireInterpreter() waits until an interpreter is returned.
+//
+// To share a pool between graphs, create it once and set it on every graph:
+//
+//   auto pool = std::make_shared<TfLiteModelPool>(/*max_threads=*/16);
+//   for (auto& graph : graphs) {
+//     MP_RETURN_IF_ERROR(graph->SetServiceObject(kTfLiteModelPoolService,
+//                                                pool));
+//   }
+class TfLiteModelPool {
+ public:
+  struct InterpreterOptions {
+    // Number of threads the interpreter uses. Values below 1 mean 1.
+    int num_threads = 1;
+    // Whether to apply the XNNPACK delegate.
+    bool use_xnnpack = false;
+  };
+
+  // Returns the interpreter to the pool when destroyed.
+  using InterpreterHandle =
+      std::unique_ptr<tflite::Interpreter,
+                      std::function<void(tflite::Interpreter*)>>;
+
+  // Uses a thread budget of one thread per core.
+  TfLiteModelPool();
+  explicit TfLiteModelPool(int max_threads);
+  ~TfLiteModelPool();
+  TfLiteModelPool(const TfLiteModelPool&) = delete;
+  TfLiteModelPool& operator=(const TfLiteModelPool&) = delete;
+
+  // Returns the model at resource "path", loading it on first use. The search
+  // path is as in PathToResourceAsFile.
+  ::mediapipe::StatusOr<std::shared_ptr<tflite::FlatBufferModel>> GetModel(
+      const std::string& path);
+
+  // Returns an interpreter for the model at "path", with its tensors
+  // allocated. An idle interpreter with the same options is reused when
+  // possible. The interpreter must only be used by one thread at a time, and
+  // its inputs must be set before each Invoke().
+  ::mediapipe::StatusOr<InterpreterHandle> AcquireInterpreter(
+      const std::string& path, const InterpreterOptions& options);
+
+  int max_threads() const { return max_threads_; }
+  // Returns the number of threads used by existing interpreters.
+  int used_threads();
+  // Returns the number of existing and idle interpreters.
+  int interpreter_count();
+  int idle_interpreter_count();
+
+ private:
+  // The pool state that lent interpreters refer to. It is shared so that
+  // interpreters can outlive the pool.
+  class Shared;
+
+  const int max_threads_;
+  std::shared_ptr<Shared> shared_;
+};
+
+// Calculators that run TfLite models on CPU use the pool set for this service,
+// if any.
+extern const GraphService<TfLiteModelPool> kTfLiteModelPoolService;
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_TFLITE_TFLITE_MODEL_POOL_H_
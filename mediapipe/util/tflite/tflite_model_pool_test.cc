@@ -0,0 +1,129 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tflite/tflite_model_pool.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/notification.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr char kModelPath[] = "mediapipe/calculators/tensor/testdata/add.bin";
+
+TEST(TfLiteModelPoolTest, SharesModels) {
+  TfLiteModelPool pool;
+  auto model = pool.GetModel(kModelPath);
+  MP_ASSERT_OK(model);
+  auto same_model = pool.GetModel(kModelPath);
+  MP_ASSERT_OK(same_model);
+  EXPECT_EQ(model.ValueOrDie().get(), same_model.ValueOrDie().get());
+  EXPECT_FALSE(pool.GetModel("/nonexistent/model.tflite").ok());
+}
+
+// Acquires an interpreter for the test model, or returns null on failure.
+TfLiteModelPool::InterpreterHandle Acquire(
+    TfLiteModelPool* pool, const TfLiteModelPool::InterpreterOptions& options) {
+  auto interpreter = pool->AcquireInterpreter(kModelPath, options);
+  MP_EXPECT_OK(interpreter);
+  if (!interpreter.ok()) return nullptr;
+  return std::move(interpreter).ValueOrDie();
+}
+
+TEST(TfLiteModelPoolTest, ReusesInterpreters) {
+  TfLiteModelPool pool(/*max_threads=*/4);
+  TfLiteModelPool::InterpreterOptions options;
+  options.num_threads = 2;
+  auto interpreter = Acquire(&pool, options);
+  ASSERT_NE(nullptr, interpreter);
+  const tflite::Interpreter* first = interpreter.get();
+  EXPECT_EQ(1, pool.interpreter_count());
+  EXPECT_EQ(2, pool.used_threads());
+  EXPECT_EQ(0, pool.idle_interpreter_count());
+
+  // A second interpreter is created while the first one is in use.
+  auto other = Acquire(&pool, options);
+  ASSERT_NE(nullptr, other);
+  EXPECT_NE(first, other.get());
+  EXPECT_EQ(4, pool.used_threads());
+  other.reset();
+  interpreter.reset();
+  EXPECT_EQ(2, pool.idle_interpreter_count());
+
+  // The most recently returned interpreter is reused.
+  interpreter = Acquire(&pool, options);
+  EXPECT_EQ(first, interpreter.get());
+  EXPECT_EQ(2, pool.interpreter_count());
+  EXPECT_EQ(1, pool.idle_interpreter_count());
+}
+
+TEST(TfLiteModelPoolTest, EvictsIdleInterpretersOverBudget) {
+  TfLiteModelPool pool(/*max_threads=*/2);
+  TfLiteModelPool::InterpreterOptions options;
+  options.num_threads = 2;
+  ASSERT_NE(nullptr, Acquire(&pool, options));
+  EXPECT_EQ(1, pool.idle_interpreter_count());
+
+  // An interpreter with other options replaces the idle one.
+  options.use_xnnpack = true;
+  auto interpreter = Acquire(&pool, options);
+  ASSERT_NE(nullptr, interpreter);
+  EXPECT_EQ(1, pool.interpreter_count());
+  EXPECT_EQ(0, pool.idle_interpreter_count());
+  EXPECT_EQ(2, pool.used_threads());
+}
+
+TEST(TfLiteModelPoolTest, WaitsForInterpreterWithinBudget) {
+  TfLiteModelPool pool(/*max_threads=*/1);
+  TfLiteModelPool::InterpreterOptions options;
+  auto interpreter = Acquire(&pool, options);
+  ASSERT_NE(nullptr, interpreter);
+  const tflite::Interpreter* first = interpreter.get();
+
+  absl::Notification acquired;
+  const tflite::Interpreter* second = nullptr;
+  {
+    ThreadPool thread_pool(1);
+    thread_pool.StartWorkers();
+    thread_pool.Schedule([&pool, &options, &acquired, &second] {
+      second = Acquire(&pool, options).get();
+      acquired.Notify();
+    });
+    EXPECT_FALSE(acquired.WaitForNotificationWithTimeout(absl::Seconds(0.2)));
+    interpreter.reset();
+  }
+  EXPECT_TRUE(acquired.HasBeenNotified());
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(1, pool.interpreter_count());
+}
+
+TEST(TfLiteModelPoolTest, InterpretersOutliveThePool) {
+  auto pool = absl::make_unique<TfLiteModelPool>();
+  auto interpreter =
+      Acquire(pool.get(), TfLiteModelPool::InterpreterOptions());
+  ASSERT_NE(nullptr, interpreter);
+  pool.reset();
+  EXPECT_EQ(kTfLiteOk, interpreter->Invoke());
+}
+
+}  // namespace
+}  // namespace mediapipe